@@ -0,0 +1,334 @@
+#include "aabbtree.h"
+
+#include <algorithm>
+
+namespace es
+{
+	AABBTree::AABBTree(float margin)
+		:mMargin(margin),
+		 mRoot(kNullNode),
+		 mFreeList(kNullNode),
+		 mProxyCount(0),
+		 mLastVisitCount(0)
+	{
+
+	}
+
+	AABBTree::~AABBTree()
+	{
+
+	}
+
+	int32_t AABBTree::insert(const AABB& box, void* userData)
+	{
+		int32_t leaf = allocateNode();
+		Node& node = mNodes[leaf];
+		node.mBox.mMin = box.mMin - glm::vec3(mMargin);
+		node.mBox.mMax = box.mMax + glm::vec3(mMargin);
+		node.mUserData = userData;
+		node.mHeight = 0;
+
+		insertLeaf(leaf);
+		mProxyCount++;
+		return leaf;
+	}
+
+	void AABBTree::remove(int32_t proxy)
+	{
+		if (!isValid(proxy))
+		{
+			return;
+		}
+
+		removeLeaf(proxy);
+		freeNode(proxy);
+		mProxyCount--;
+	}
+
+	bool AABBTree::move(int32_t proxy, const AABB& box)
+	{
+		if (!isValid(proxy))
+		{
+			return false;
+		}
+
+		// a fat box much larger than needed is also rebuilt, otherwise a shrinking object would drag its old size around
+		AABB fatBox;
+		fatBox.mMin = box.mMin - glm::vec3(mMargin);
+		fatBox.mMax = box.mMax + glm::vec3(mMargin);
+		const AABB& current = mNodes[proxy].mBox;
+		if (current.contains(box) && current.getSurfaceArea() <= fatBox.getSurfaceArea() * 4.0f)
+		{
+			return false;
+		}
+
+		removeLeaf(proxy);
+		mNodes[proxy].mBox = fatBox;
+		insertLeaf(proxy);
+		return true;
+	}
+
+	void AABBTree::clear()
+	{
+		mNodes.clear();
+		mRoot = kNullNode;
+		mFreeList = kNullNode;
+		mProxyCount = 0;
+	}
+
+	bool AABBTree::isValid(int32_t proxy) const
+	{
+		return proxy >= 0 && proxy < static_cast<int32_t>(mNodes.size()) && mNodes[proxy].mHeight == 0;
+	}
+
+	void* AABBTree::getUserData(int32_t proxy) const
+	{
+		return isValid(proxy) ? mNodes[proxy].mUserData : nullptr;
+	}
+
+	const AABB& AABBTree::getFatBounds(int32_t proxy) const
+	{
+		return mNodes[proxy].mBox;
+	}
+
+	uint32_t AABBTree::getProxyCount() const
+	{
+		return mProxyCount;
+	}
+
+	int32_t AABBTree::getHeight() const
+	{
+		return mRoot == kNullNode ? 0 : mNodes[mRoot].mHeight;
+	}
+
+	uint32_t AABBTree::getLastVisitCount() const
+	{
+		return mLastVisitCount;
+	}
+
+	int32_t AABBTree::allocateNode()
+	{
+		int32_t index = mFreeList;
+		if (index == kNullNode)
+		{
+			index = static_cast<int32_t>(mNodes.size());
+			mNodes.emplace_back();
+		}
+		else
+		{
+			mFreeList = mNodes[index].mParent;
+		}
+
+		Node& node = mNodes[index];
+		node.mBox = AABB();
+		node.mUserData = nullptr;
+		node.mParent = kNullNode;
+		node.mChild1 = kNullNode;
+		node.mChild2 = kNullNode;
+		node.mHeight = 0;
+		return index;
+	}
+
+	void AABBTree::freeNode(int32_t index)
+	{
+		mNodes[index].mParent = mFreeList;
+		mNodes[index].mHeight = -1;
+		mNodes[index].mUserData = nullptr;
+		mFreeList = index;
+	}
+
+	void AABBTree::insertLeaf(int32_t leaf)
+	{
+		if (mRoot == kNullNode)
+		{
+			mRoot = leaf;
+			mNodes[leaf].mParent = kNullNode;
+			return;
+		}
+
+		// walk down to the sibling that grows the summed surface area the least
+		AABB leafBox = mNodes[leaf].mBox;
+		int32_t index = mRoot;
+		while (!mNodes[index].isLeaf())
+		{
+			const Node& node = mNodes[index];
+			float area = node.mBox.getSurfaceArea();
+			float combinedArea = combine(node.mBox, leafBox).getSurfaceArea();
+
+			// pairing with this node creates a parent of the combined size, going deeper also grows this node
+			float cost = 2.0f * combinedArea;
+			float inheritanceCost = 2.0f * (combinedArea - area);
+
+			auto descendCost = [&](int32_t child)
+			{
+				const AABB& childBox = mNodes[child].mBox;
+				float childCost = combine(childBox, leafBox).getSurfaceArea();
+				if (!mNodes[child].isLeaf())
+				{
+					childCost -= childBox.getSurfaceArea();
+				}
+				return childCost + inheritanceCost;
+			};
+
+			float cost1 = descendCost(node.mChild1);
+			float cost2 = descendCost(node.mChild2);
+			if (cost < cost1 && cost < cost2)
+			{
+				break;
+			}
+			index = cost1 < cost2 ? node.mChild1 : node.mChild2;
+		}
+
+		int32_t sibling = index;
+		int32_t oldParent = mNodes[sibling].mParent;
+		int32_t newParent = allocateNode();
+		mNodes[newParent].mParent = oldParent;
+		mNodes[newParent].mBox = combine(leafBox, mNodes[sibling].mBox);
+		mNodes[newParent].mHeight = mNodes[sibling].mHeight + 1;
+		mNodes[newParent].mChild1 = sibling;
+		mNodes[newParent].mChild2 = leaf;
+		mNodes[sibling].mParent = newParent;
+		mNodes[leaf].mParent = newParent;
+
+		if (oldParent == kNullNode)
+		{
+			mRoot = newParent;
+		}
+		else if (mNodes[oldParent].mChild1 == sibling)
+		{
+			mNodes[oldParent].mChild1 = newParent;
+		}
+		else
+		{
+			mNodes[oldParent].mChild2 = newParent;
+		}
+
+		refitUpwards(mNodes[leaf].mParent);
+	}
+
+	void AABBTree::removeLeaf(int32_t leaf)
+	{
+		if (leaf == mRoot)
+		{
+			mRoot = kNullNode;
+			return;
+		}
+
+		// the sibling takes the place of the parent
+		int32_t parent = mNodes[leaf].mParent;
+		int32_t grandParent = mNodes[parent].mParent;
+		int32_t sibling = mNodes[parent].mChild1 == leaf ? mNodes[parent].mChild2 : mNodes[parent].mChild1;
+
+		if (grandParent == kNullNode)
+		{
+			mRoot = sibling;
+			mNodes[sibling].mParent = kNullNode;
+			freeNode(parent);
+			return;
+		}
+
+		if (mNodes[grandParent].mChild1 == parent)
+		{
+			mNodes[grandParent].mChild1 = sibling;
+		}
+		else
+		{
+			mNodes[grandParent].mChild2 = sibling;
+		}
+		mNodes[sibling].mParent = grandParent;
+		freeNode(parent);
+
+		refitUpwards(grandParent);
+	}
+
+	void AABBTree::refitUpwards(int32_t index)
+	{
+		while (index != kNullNode)
+		{
+			index = balance(index);
+
+			Node& node = mNodes[index];
+			const Node& child1 = mNodes[node.mChild1];
+			const Node& child2 = mNodes[node.mChild2];
+			node.mHeight = 1 + std::max(child1.mHeight, child2.mHeight);
+			node.mBox = combine(child1.mBox, child2.mBox);
+
+			index = node.mParent;
+		}
+	}
+
+	int32_t AABBTree::balance(int32_t indexA)
+	{
+		Node& a = mNodes[indexA];
+		if (a.isLeaf() || a.mHeight < 2)
+		{
+			return indexA;
+		}
+
+		int32_t indexB = a.mChild1;
+		int32_t indexC = a.mChild2;
+		int32_t difference = mNodes[indexC].mHeight - mNodes[indexB].mHeight;
+		if (difference >= -1 && difference <= 1)
+		{
+			return indexA;
+		}
+
+		// the taller child becomes the subtree root, a keeps the shorter child and the shorter grandchild
+		bool isRightTaller = difference > 1;
+		int32_t indexUp = isRightTaller ? indexC : indexB;
+		int32_t indexStay = isRightTaller ? indexB : indexC;
+		Node& up = mNodes[indexUp];
+
+		int32_t indexF = up.mChild1;
+		int32_t indexG = up.mChild2;
+
+		up.mChild1 = indexA;
+		up.mParent = a.mParent;
+		a.mParent = indexUp;
+
+		if (up.mParent == kNullNode)
+		{
+			mRoot = indexUp;
+		}
+		else if (mNodes[up.mParent].mChild1 == indexA)
+		{
+			mNodes[up.mParent].mChild1 = indexUp;
+		}
+		else
+		{
+			mNodes[up.mParent].mChild2 = indexUp;
+		}
+
+		int32_t indexTall = mNodes[indexF].mHeight > mNodes[indexG].mHeight ? indexF : indexG;
+		int32_t indexShort = indexTall == indexF ? indexG : indexF;
+
+		up.mChild2 = indexTall;
+		if (isRightTaller)
+		{
+			a.mChild2 = indexShort;
+		}
+		else
+		{
+			a.mChild1 = indexShort;
+		}
+		mNodes[indexShort].mParent = indexA;
+
+		const Node& stay = mNodes[indexStay];
+		const Node& shorter = mNodes[indexShort];
+		const Node& taller = mNodes[indexTall];
+		a.mBox = combine(stay.mBox, shorter.mBox);
+		a.mHeight = 1 + std::max(stay.mHeight, shorter.mHeight);
+		up.mBox = combine(a.mBox, taller.mBox);
+		up.mHeight = 1 + std::max(a.mHeight, taller.mHeight);
+
+		return indexUp;
+	}
+
+	AABB AABBTree::combine(const AABB& a, const AABB& b)
+	{
+		AABB box;
+		box.mMin = glm::min(a.mMin, b.mMin);
+		box.mMax = glm::max(a.mMax, b.mMax);
+		return box;
+	}
+}
@@ -0,0 +1,202 @@
+#ifndef AABB_TREE_H_
+#define AABB_TREE_H_
+
+#include <geometry.h>
+
+#include <vector>
+#include <cstdint>
+
+namespace es
+{
+	// dynamic bounding volume hierarchy over fat boxes. leaves keep a box grown by a margin so small moves cost nothing,
+	// a leaf that leaves its fat box is taken out and inserted again and the tree is kept balanced by rotations on the way up.
+	// queries report every leaf whose fat box passes, callers that need exact answers test their own bounds afterwards
+	class AABBTree
+	{
+	public:
+		static const int32_t kNullNode = -1;
+
+		explicit AABBTree(float margin = 0.1f);
+		~AABBTree();
+
+		// returns the proxy the leaf is known by until it is removed
+		int32_t insert(const AABB& box, void* userData);
+
+		void remove(int32_t proxy);
+
+		// true when the box left the fat box and the leaf was reinserted
+		bool move(int32_t proxy, const AABB& box);
+
+		void clear();
+
+		bool isValid(int32_t proxy) const;
+
+		void* getUserData(int32_t proxy) const;
+
+		const AABB& getFatBounds(int32_t proxy) const;
+
+		uint32_t getProxyCount() const;
+
+		int32_t getHeight() const;
+
+		// nodes touched by the last query, stays near the number of hits times the height for a balanced tree
+		uint32_t getLastVisitCount() const;
+
+		// visit(void* userData) for every leaf in or touching the frustum, subtrees fully inside are taken without more plane tests
+		template<typename Visitor>
+		void queryFrustum(const Frustum& frustum, const Visitor& visit) const
+		{
+			traverse([&frustum](const AABB& box) { return frustum.classify(box); }, visit);
+		}
+
+		template<typename Visitor>
+		void queryBox(const AABB& query, const Visitor& visit) const
+		{
+			traverse([&query](const AABB& box) { return query.contains(box) ? Containment::INSIDE : (box.overlaps(query) ? Containment::INTERSECTS : Containment::OUTSIDE); }, visit);
+		}
+
+		template<typename Visitor>
+		void querySphere(const BoundingSphere& query, const Visitor& visit) const
+		{
+			traverse([&query](const AABB& box) { return box.overlaps(query) ? Containment::INTERSECTS : Containment::OUTSIDE; }, visit);
+		}
+
+		// nearest hit along the ray, hit(void* userData, float maxDistance, float& distance) tests the leaf exactly and returns
+		// whether it was hit closer than maxDistance. nodes farther than the closest hit so far are skipped
+		template<typename Hit>
+		void* raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, const Hit& hit, float& distance) const
+		{
+			void* closest = nullptr;
+			distance = maxDistance;
+			mLastVisitCount = 0;
+			if (mRoot == kNullNode)
+			{
+				return closest;
+			}
+
+			glm::vec3 inverseDirection = 1.0f / direction;
+
+			mStack.clear();
+			mStack.push_back(mRoot);
+			while (!mStack.empty())
+			{
+				int32_t index = mStack.back();
+				mStack.pop_back();
+				mLastVisitCount++;
+
+				const Node& node = mNodes[index];
+				float entry = 0.0f;
+				if (!node.mBox.intersectRay(origin, inverseDirection, distance, entry))
+				{
+					continue;
+				}
+
+				if (node.isLeaf())
+				{
+					float leafDistance = distance;
+					if (hit(node.mUserData, distance, leafDistance) && leafDistance < distance)
+					{
+						distance = leafDistance;
+						closest = node.mUserData;
+					}
+					continue;
+				}
+
+				mStack.push_back(node.mChild1);
+				mStack.push_back(node.mChild2);
+			}
+			return closest;
+		}
+	private:
+		struct Node
+		{
+			AABB mBox;
+			void* mUserData;
+			// next free node while the node is on the free list
+			int32_t mParent;
+			int32_t mChild1;
+			int32_t mChild2;
+			// 0 for leaves, -1 for free nodes
+			int32_t mHeight;
+
+			bool isLeaf() const
+			{
+				return mChild1 == kNullNode;
+			}
+		};
+
+		template<typename Test, typename Visitor>
+		void traverse(const Test& test, const Visitor& visit) const
+		{
+			mLastVisitCount = 0;
+			if (mRoot == kNullNode)
+			{
+				return;
+			}
+
+			// a complemented index marks a node whose parent was fully inside, it is reported without testing
+			mStack.clear();
+			mStack.push_back(mRoot);
+			while (!mStack.empty())
+			{
+				int32_t entry = mStack.back();
+				mStack.pop_back();
+				mLastVisitCount++;
+
+				bool isInside = entry < 0;
+				const Node& node = mNodes[isInside ? ~entry : entry];
+				if (!isInside)
+				{
+					Containment containment = test(node.mBox);
+					if (containment == Containment::OUTSIDE)
+					{
+						continue;
+					}
+					isInside = containment == Containment::INSIDE;
+				}
+
+				if (node.isLeaf())
+				{
+					visit(node.mUserData);
+				}
+				else if (isInside)
+				{
+					mStack.push_back(~node.mChild1);
+					mStack.push_back(~node.mChild2);
+				}
+				else
+				{
+					mStack.push_back(node.mChild1);
+					mStack.push_back(node.mChild2);
+				}
+			}
+		}
+
+		int32_t allocateNode();
+		void freeNode(int32_t index);
+
+		void insertLeaf(int32_t leaf);
+		void removeLeaf(int32_t leaf);
+
+		// refits and rebalances every node from index up to the root
+		void refitUpwards(int32_t index);
+
+		// rotates the taller grandchild up when the children of index differ in height by more than one, returns the new subtree root
+		int32_t balance(int32_t index);
+
+		static AABB combine(const AABB& a, const AABB& b);
+
+		float mMargin;
+
+		std::vector<Node> mNodes;
+		int32_t mRoot;
+		int32_t mFreeList;
+		uint32_t mProxyCount;
+
+		// shared by the queries, which must not be nested
+		mutable std::vector<int32_t> mStack;
+		mutable uint32_t mLastVisitCount;
+	};
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "buffer.h"
 
+#include <statecache.h>
+
 namespace es
 {
 	Buffer::Buffer(GLenum type)
@@ -7,8 +9,7 @@ namespace es
 		 mSize(0)
 	{
 		GLES_CHECK_ERROR(glGenBuffers(1, &mID));
-		GLES_CHECK_ERROR(glBindBuffer(type, mID));
-		GLES_CHECK_ERROR(glBindBuffer(type, 0));
+		bindForUpdate();
 	}
 
 	Buffer::Buffer(GLenum type, GLenum usage, std::size_t size, void* data)
@@ -16,14 +17,13 @@ namespace es
 		 mSize(size)
 	{
 		GLES_CHECK_ERROR(glGenBuffers(1, &mID));
-		GLES_CHECK_ERROR(glBindBuffer(type, mID));
+		bindForUpdate();
 		GLES_CHECK_ERROR(glBufferData(type, size, data, usage));
-		GLES_CHECK_ERROR(glBindBuffer(type, 0));
 	}
 
 	Buffer::~Buffer()
 	{
-		GLES_CHECK_ERROR(glDeleteBuffers(1, &mID));
+		StateCache::deleteBuffer(mID);
 	}
 
 	std::shared_ptr<Buffer> Buffer::createWithData(GLenum type, GLenum usage, std::size_t size, void* data)
@@ -33,44 +33,50 @@ namespace es
 
 	void Buffer::bind()
 	{
-		GLES_CHECK_ERROR(glBindBuffer(mType, mID));
+		StateCache::bindBuffer(mType, mID);
 	}
 
 	void Buffer::bindBase(GLuint index)
 	{
-		GLES_CHECK_ERROR(glBindBufferBase(mType, index, mID));
+		StateCache::bindBufferRange(mType, index, mID);
 	}
 
 	void Buffer::bindRange(int index, std::size_t offset, std::size_t size)
 	{
-		GLES_CHECK_ERROR(glBindBufferRange(mType, index, mID, offset, size));
+		StateCache::bindBufferRange(mType, index, mID, offset, size);
 	}
 
 	void Buffer::unbind()
 	{
-		GLES_CHECK_ERROR(glBindBuffer(mType, 0));
+		StateCache::bindBuffer(mType, 0);
 	}
 
 	void* Buffer::mapRange(GLenum access, std::size_t offset, std::size_t size)
 	{
-		GLES_CHECK_ERROR(glBindBuffer(mType, mID));
+		bindForUpdate();
 		GLES_CHECK_ERROR(void* ptr = glMapBufferRange(mType, offset, size, access));
-		GLES_CHECK_ERROR(glBindBuffer(mType, 0));
 		return ptr;
 	}
 
 	void Buffer::unMap()
 	{
-		GLES_CHECK_ERROR(glBindBuffer(mType, mID));
+		bindForUpdate();
 		GLES_CHECK_ERROR(glUnmapBuffer(mType));
-		GLES_CHECK_ERROR(glBindBuffer(mType, 0));
 	}
 
 	void Buffer::setData(GLintptr offset, GLsizeiptr size, void* data)
 	{
-		GLES_CHECK_ERROR(glBindBuffer(mType, mID));
+		bindForUpdate();
 		GLES_CHECK_ERROR(glBufferSubData(mType, offset, size, data));
-		GLES_CHECK_ERROR(glBindBuffer(mType, 0));
+	}
+
+	bool Buffer::hasStorage() const
+	{
+		// queried through the copy target so no vertex array picks up an element buffer
+		GLint64 size = 0;
+		StateCache::bindBuffer(GL_COPY_READ_BUFFER, mID);
+		GLES_CHECK_ERROR(glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size));
+		return static_cast<std::size_t>(size) == mSize;
 	}
 
 	GLuint Buffer::getID() const
@@ -78,6 +84,15 @@ namespace es
 		return mID;
 	}
 
+	void Buffer::bindForUpdate()
+	{
+		if (mType == GL_ELEMENT_ARRAY_BUFFER)
+		{
+			StateCache::bindVertexArray(0);
+		}
+		StateCache::bindBuffer(mType, mID);
+	}
+
 	// -----------------------------------------------------------------------------------------------------------------------------------
 
 	VertexBuffer::VertexBuffer(GLenum usage, std::size_t size, void* data) : Buffer(GL_ARRAY_BUFFER, usage, size, data)
@@ -97,9 +112,22 @@ namespace es
 
 	// -----------------------------------------------------------------------------------------------------------------------------------
 
-	ElementBuffer::ElementBuffer(GLenum usage, std::size_t size, void* data) : Buffer(GL_ELEMENT_ARRAY_BUFFER, usage, size, data)
+	ElementBuffer::ElementBuffer(GLenum usage, std::size_t size, void* data, GLenum indexType) : Buffer(GL_ELEMENT_ARRAY_BUFFER, usage, size, data)
+	{
+		mIndexType = indexType;
+		mIndexCount = static_cast<uint32_t>(size / getIndexTypeSize(indexType));
+	}
+
+	ElementBuffer::ElementBuffer(GLenum usage, const std::vector<uint32_t>& indices, bool allowByteIndices) : Buffer(GL_ELEMENT_ARRAY_BUFFER)
 	{
+		mIndexType = selectIndexType(indices, allowByteIndices);
+		mIndexCount = static_cast<uint32_t>(indices.size());
 
+		std::vector<uint8_t> packed = packIndices(indices, mIndexType);
+		mSize = packed.size();
+
+		bindForUpdate();
+		GLES_CHECK_ERROR(glBufferData(mType, mSize, packed.data(), usage));
 	}
 
 	ElementBuffer::~ElementBuffer()
@@ -107,16 +135,102 @@ namespace es
 
 	}
 
-	std::shared_ptr<ElementBuffer> ElementBuffer::createWithData(GLenum usage, std::size_t size, void* data)
+	std::shared_ptr<ElementBuffer> ElementBuffer::createWithData(GLenum usage, std::size_t size, void* data, GLenum indexType)
+	{
+		return std::make_shared<ElementBuffer>(usage, size, data, indexType);
+	}
+
+	std::shared_ptr<ElementBuffer> ElementBuffer::createWithIndices(GLenum usage, const std::vector<uint32_t>& indices, bool allowByteIndices)
+	{
+		return std::make_shared<ElementBuffer>(usage, indices, allowByteIndices);
+	}
+
+	GLenum ElementBuffer::selectIndexType(const std::vector<uint32_t>& indices, bool allowByteIndices)
+	{
+		uint32_t maxIndex = 0;
+		for (std::size_t i = 0; i < indices.size(); i++)
+		{
+			if (indices[i] != 0xFFFFFFFF)
+			{
+				maxIndex = std::max(maxIndex, indices[i]);
+			}
+		}
+
+		// the largest value of every type is reserved for primitive restart
+		if (allowByteIndices && maxIndex < 0xFF)
+		{
+			return GL_UNSIGNED_BYTE;
+		}
+		else if (maxIndex < 0xFFFF)
+		{
+			return GL_UNSIGNED_SHORT;
+		}
+		return GL_UNSIGNED_INT;
+	}
+
+	std::vector<uint8_t> ElementBuffer::packIndices(const std::vector<uint32_t>& indices, GLenum indexType)
+	{
+		std::vector<uint8_t> packed(indices.size() * getIndexTypeSize(indexType));
+
+		switch (indexType)
+		{
+			case GL_UNSIGNED_BYTE:
+			{
+				for (std::size_t i = 0; i < indices.size(); i++)
+				{
+					packed[i] = static_cast<uint8_t>(indices[i] == 0xFFFFFFFF ? 0xFF : indices[i]);
+				}
+				break;
+			}
+			case GL_UNSIGNED_SHORT:
+			{
+				uint16_t* dst = reinterpret_cast<uint16_t*>(packed.data());
+				for (std::size_t i = 0; i < indices.size(); i++)
+				{
+					dst[i] = static_cast<uint16_t>(indices[i] == 0xFFFFFFFF ? 0xFFFF : indices[i]);
+				}
+				break;
+			}
+			default:
+			{
+				if (!indices.empty())
+				{
+					std::memcpy(packed.data(), indices.data(), packed.size());
+				}
+				break;
+			}
+		}
+		return packed;
+	}
+
+	uint32_t ElementBuffer::getIndexTypeSize(GLenum indexType)
+	{
+		switch (indexType)
+		{
+			case GL_UNSIGNED_BYTE:
+				return 1;
+			case GL_UNSIGNED_SHORT:
+				return 2;
+			default:
+				return 4;
+		}
+	}
+
+	GLenum ElementBuffer::getIndexType() const
+	{
+		return mIndexType;
+	}
+
+	uint32_t ElementBuffer::getIndexCount() const
 	{
-		return std::make_shared<ElementBuffer>(usage, size, data);
+		return mIndexCount;
 	}
 
 	// -----------------------------------------------------------------------------------------------------------------------------------
 
 	InstanceBuffer::InstanceBuffer(GLenum usage, std::size_t size, void* data) : Buffer(GL_ARRAY_BUFFER, usage, size, data)
 	{
-
+		mUsage = usage;
 	}
 
 	InstanceBuffer::~InstanceBuffer()
@@ -129,6 +243,78 @@ namespace es
 		return std::make_shared<InstanceBuffer>(usage, size, data);
 	}
 
+	void InstanceBuffer::setInstances(const void* data, std::size_t size)
+	{
+		bindForUpdate();
+		if (size > mSize)
+		{
+			// grow in powers of two so a batch that keeps getting larger does not reallocate every frame
+			std::size_t capacity = mSize > 0 ? mSize : 256;
+			while (capacity < size)
+			{
+				capacity *= 2;
+			}
+			mSize = capacity;
+		}
+		GLES_CHECK_ERROR(glBufferData(mType, mSize, nullptr, mUsage));
+		GLES_CHECK_ERROR(glBufferSubData(mType, 0, size, data));
+	}
+
+	// -----------------------------------------------------------------------------------------------------------------------------------
+
+	IndirectBuffer::IndirectBuffer(GLenum usage, std::size_t size, void* data) : Buffer(GL_DRAW_INDIRECT_BUFFER, usage, size, data)
+	{
+		mUsage = usage;
+	}
+
+	IndirectBuffer::~IndirectBuffer()
+	{
+
+	}
+
+	std::shared_ptr<IndirectBuffer> IndirectBuffer::createWithData(GLenum usage, std::size_t size, void* data)
+	{
+		return std::make_shared<IndirectBuffer>(usage, size, data);
+	}
+
+	std::shared_ptr<IndirectBuffer> IndirectBuffer::createWithCommands(GLenum usage, const IndirectCommandBuilder& builder)
+	{
+		std::shared_ptr<IndirectBuffer> buffer = std::make_shared<IndirectBuffer>(usage, 0, nullptr);
+		buffer->setCommands(builder);
+		return buffer;
+	}
+
+	void IndirectBuffer::setCommands(const IndirectCommandBuilder& builder)
+	{
+		const std::vector<uint8_t>& data = builder.getData();
+		bindForUpdate();
+		if (data.size() > mSize)
+		{
+			mSize = data.size();
+			GLES_CHECK_ERROR(glBufferData(mType, mSize, data.data(), mUsage));
+		}
+		else if (!data.empty())
+		{
+			GLES_CHECK_ERROR(glBufferSubData(mType, 0, data.size(), data.data()));
+		}
+		mCommands = builder.getCommands();
+	}
+
+	void IndirectBuffer::setCommandLayout(uint32_t count, bool isIndexed, std::size_t offset)
+	{
+		std::size_t stride = isIndexed ? sizeof(DrawElementsIndirectCommand) : sizeof(DrawArraysIndirectCommand);
+		mCommands.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			mCommands[i] = { offset + i * stride, 0, isIndexed };
+		}
+	}
+
+	const std::vector<IndirectCommandInfo>& IndirectBuffer::getCommands() const
+	{
+		return mCommands;
+	}
+
 	// -----------------------------------------------------------------------------------------------------------------------------------
 
 	UniformBuffer::UniformBuffer(GLenum usage, std::size_t size, void* data) : Buffer(GL_UNIFORM_BUFFER, usage, size, data)
@@ -143,9 +329,8 @@ namespace es
 		GLES_CHECK_ERROR(glGetActiveUniformBlockiv(program->getID(), blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize));
 		mSize = blockSize;
 
-		bind();
+		bindForUpdate();
 		GLES_CHECK_ERROR(glBufferData(mType, blockSize, nullptr, usage));
-		unbind();
 		bindBase(bindingPoint);
 	}
 
@@ -189,10 +374,266 @@ namespace es
 
 	// -----------------------------------------------------------------------------------------------------------------------------------
 
-	VertexArray::VertexArray(VertexBuffer* vbo, ElementBuffer* ebo, std::size_t vertexSize, const std::vector<VertexAttrib>& attribs)
+	StreamBuffer* StreamBuffer::mUniformStream = nullptr;
+	StreamBuffer* StreamBuffer::mCommandStream = nullptr;
+
+	StreamBuffer::StreamBuffer(GLenum type, std::size_t regionSize, uint32_t regionCount) : Buffer(type)
+	{
+		mRegionCount = std::max(regionCount, 1u);
+		mRegion = 0;
+		mRegionOffset = 0;
+		mSerial = 0;
+
+		GLint alignment = 4;
+		if (type == GL_UNIFORM_BUFFER)
+		{
+			GLES_CHECK_ERROR(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+		}
+		else if (type == GL_SHADER_STORAGE_BUFFER)
+		{
+			GLES_CHECK_ERROR(glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment));
+		}
+		mAlignment = static_cast<std::size_t>(std::max(alignment, 4));
+
+		for (uint32_t i = 0; i < mRegionCount; i++)
+		{
+			mFences.push_back(std::make_unique<Fence>());
+		}
+		allocate(regionSize);
+	}
+
+	StreamBuffer::~StreamBuffer()
+	{
+
+	}
+
+	std::unique_ptr<StreamBuffer> StreamBuffer::create(GLenum type, std::size_t regionSize, uint32_t regionCount)
+	{
+		return std::make_unique<StreamBuffer>(type, regionSize, regionCount);
+	}
+
+	StreamBuffer* StreamBuffer::getUniformStream()
+	{
+		if (mUniformStream == nullptr)
+		{
+			// a few hundred draws worth of parameters per frame before the first reallocation
+			mUniformStream = new (std::nothrow) StreamBuffer(GL_UNIFORM_BUFFER, 64 * 1024, kDefaultRegionCount);
+		}
+		return mUniformStream;
+	}
+
+	StreamBuffer* StreamBuffer::getCommandStream()
+	{
+		if (mCommandStream == nullptr)
+		{
+			mCommandStream = new (std::nothrow) StreamBuffer(GL_DRAW_INDIRECT_BUFFER, 16 * 1024, kDefaultRegionCount);
+		}
+		return mCommandStream;
+	}
+
+	void StreamBuffer::beginFrame()
+	{
+		mRegion = (mRegion + 1) % mRegionCount;
+		mRegionOffset = 0;
+		mSerial++;
+
+		// only blocks when the cpu runs regionCount frames ahead of the gpu
+		mFences[mRegion]->wait(~0ull);
+	}
+
+	void StreamBuffer::endFrame()
+	{
+		mFences[mRegion]->insert();
+	}
+
+	std::size_t StreamBuffer::write(const void* data, std::size_t size)
+	{
+		std::size_t offset = (mRegionOffset + mAlignment - 1) / mAlignment * mAlignment;
+		if (offset + size > mRegionSize)
+		{
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "stream buffer region of %zu bytes is full, growing it", mRegionSize);
+			allocate(std::max(mRegionSize * 2, size));
+			offset = 0;
+		}
+
+		std::size_t start = mRegion * mRegionSize + offset;
+		void* target = mapRange(GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT, start, size);
+		if (target == nullptr)
+		{
+			return kInvalidOffset;
+		}
+		std::memcpy(target, data, size);
+		unMap();
+
+		mRegionOffset = offset + size;
+		return start;
+	}
+
+	uint64_t StreamBuffer::getSerial() const
+	{
+		return mSerial;
+	}
+
+	std::size_t StreamBuffer::getAlignment() const
+	{
+		return mAlignment;
+	}
+
+	void StreamBuffer::allocate(std::size_t regionSize)
+	{
+		// regions start on aligned offsets too
+		mRegionSize = (regionSize + mAlignment - 1) / mAlignment * mAlignment;
+		mSize = mRegionSize * mRegionCount;
+		mRegionOffset = 0;
+		mSerial++;
+
+		// new storage, nothing the gpu still reads lives in it
+		for (std::unique_ptr<Fence>& fence : mFences)
+		{
+			fence->reset();
+		}
+
+		bindForUpdate();
+		GLES_CHECK_ERROR(glBufferData(mType, mSize, nullptr, GL_STREAM_DRAW));
+	}
+
+	// -----------------------------------------------------------------------------------------------------------------------------------
+
+	VertexFormat::VertexFormat(const std::vector<Element>& elements)
+	{
+		for (std::size_t i = 0; i < elements.size(); i++)
+		{
+			const Element& element = elements[i];
+			if (element.stream >= mStrides.size())
+			{
+				mStrides.resize(element.stream + 1, 0);
+			}
+
+			VertexAttrib attrib;
+			attrib.numSubElements = element.numSubElements;
+			attrib.type = element.type;
+			attrib.normalized = element.normalized;
+			attrib.offset = mStrides[element.stream];
+			attrib.semantic = element.semantic;
+			attrib.stream = element.stream;
+			attrib.location = 0;
+			mAttribs.push_back(attrib);
+
+			mStrides[element.stream] += element.numSubElements * getTypeSize(element.type);
+		}
+
+		// locations follow the semantic order rather than the packing order
+		for (std::size_t i = 0; i < mAttribs.size(); i++)
+		{
+			for (std::size_t j = 0; j < mAttribs.size(); j++)
+			{
+				if (mAttribs[j].semantic < mAttribs[i].semantic)
+				{
+					mAttribs[i].location++;
+				}
+			}
+		}
+	}
+
+	uint32_t VertexFormat::getTypeSize(uint32_t type)
+	{
+		switch (type)
+		{
+			case GL_BYTE:
+			case GL_UNSIGNED_BYTE:
+				return 1;
+			case GL_SHORT:
+			case GL_UNSIGNED_SHORT:
+			case GL_HALF_FLOAT:
+				return 2;
+			default:
+				return 4;
+		}
+	}
+
+	bool VertexFormat::hasAttrib(VertexSemantic semantic) const
+	{
+		return getAttrib(semantic) != nullptr;
+	}
+
+	const VertexAttrib* VertexFormat::getAttrib(VertexSemantic semantic) const
+	{
+		for (std::size_t i = 0; i < mAttribs.size(); i++)
+		{
+			if (mAttribs[i].semantic == semantic)
+			{
+				return &mAttribs[i];
+			}
+		}
+		return nullptr;
+	}
+
+	const std::vector<VertexAttrib>& VertexFormat::getAttribs() const
+	{
+		return mAttribs;
+	}
+
+	uint32_t VertexFormat::getStreamCount() const
+	{
+		return static_cast<uint32_t>(mStrides.size());
+	}
+
+	uint32_t VertexFormat::getStride(uint32_t stream) const
+	{
+		return stream < mStrides.size() ? mStrides[stream] : 0;
+	}
+
+	uint32_t VertexFormat::getVertexSize() const
+	{
+		uint32_t size = 0;
+		for (std::size_t i = 0; i < mStrides.size(); i++)
+		{
+			size += mStrides[i];
+		}
+		return size;
+	}
+
+	std::size_t VertexFormat::getStreamOffset(uint32_t stream, std::size_t vertexCount) const
+	{
+		std::size_t offset = 0;
+		for (uint32_t i = 0; i < stream && i < mStrides.size(); i++)
+		{
+			offset += mStrides[i] * vertexCount;
+		}
+		return offset;
+	}
+
+	bool VertexFormat::operator==(const VertexFormat& other) const
+	{
+		if (mAttribs.size() != other.mAttribs.size() || mStrides != other.mStrides)
+		{
+			return false;
+		}
+
+		for (std::size_t i = 0; i < mAttribs.size(); i++)
+		{
+			const VertexAttrib& a = mAttribs[i];
+			const VertexAttrib& b = other.mAttribs[i];
+			if (a.semantic != b.semantic || a.numSubElements != b.numSubElements || a.type != b.type ||
+				a.normalized != b.normalized || a.offset != b.offset || a.stream != b.stream)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool VertexFormat::operator!=(const VertexFormat& other) const
+	{
+		return !(*this == other);
+	}
+
+	// -----------------------------------------------------------------------------------------------------------------------------------
+
+	VertexArray::VertexArray(VertexBuffer* vbo, ElementBuffer* ebo, const VertexFormat& format, std::size_t vertexCount)
 	{
 		GLES_CHECK_ERROR(glGenVertexArrays(1, &mID));
-		GLES_CHECK_ERROR(glBindVertexArray(mID));
+		StateCache::bindVertexArray(mID);
 		
 		vbo->bind();
 		if (ebo)
@@ -200,49 +641,47 @@ namespace es
 			ebo->bind();
 		}
 
+		const std::vector<VertexAttrib>& attribs = format.getAttribs();
 		for (std::size_t i = 0; i < attribs.size(); i++)
 		{
-			GLES_CHECK_ERROR(glEnableVertexAttribArray(i));
+			const VertexAttrib& attrib = attribs[i];
+			GLsizei stride = format.getStride(attrib.stream);
+			uint64_t offset = format.getStreamOffset(attrib.stream, vertexCount) + attrib.offset;
+
+			GLES_CHECK_ERROR(glEnableVertexAttribArray(attrib.location));
 
-			if (attribs[i].type == GL_INT)
+			if (attrib.type == GL_INT)
 			{
-				GLES_CHECK_ERROR(glVertexAttribIPointer(i, attribs[i].numSubElements, attribs[i].type, vertexSize, (void*)((uint64_t)attribs[i].offset)));
+				GLES_CHECK_ERROR(glVertexAttribIPointer(attrib.location, attrib.numSubElements, attrib.type, stride, (void*)offset));
 			}
 			else
 			{
-				GLES_CHECK_ERROR(glVertexAttribPointer(i, attribs[i].numSubElements, attribs[i].type, attribs[i].normalized, vertexSize, (void*)((uint64_t)attribs[i].offset)));
+				GLES_CHECK_ERROR(glVertexAttribPointer(attrib.location, attrib.numSubElements, attrib.type, attrib.normalized, stride, (void*)offset));
 			}
 		}
 		mVertexAttribCount = attribs.size();
 
-		GLES_CHECK_ERROR(glBindVertexArray(0));
-		
-		vbo->unbind();
-
-		if (ebo)
-		{
-			ebo->unbind();
-		}
+		StateCache::bindVertexArray(0);
 	}
 
 	VertexArray::~VertexArray()
 	{
-		GLES_CHECK_ERROR(glDeleteVertexArrays(1, &mID));
+		StateCache::deleteVertexArray(mID);
 	}
 
-	std::shared_ptr<VertexArray> VertexArray::createWithData(VertexBuffer* vbo, ElementBuffer* ebo, std::size_t vertexSize, const std::vector<VertexAttrib>& attribs)
+	std::shared_ptr<VertexArray> VertexArray::createWithData(VertexBuffer* vbo, ElementBuffer* ebo, const VertexFormat& format, std::size_t vertexCount)
 	{
-		return std::make_shared<VertexArray>(vbo, ebo, vertexSize, attribs);
+		return std::make_shared<VertexArray>(vbo, ebo, format, vertexCount);
 	}
 
 	void VertexArray::bind()
 	{
-		GLES_CHECK_ERROR(glBindVertexArray(mID));
+		StateCache::bindVertexArray(mID);
 	}
 
 	void VertexArray::unbind()
 	{
-		GLES_CHECK_ERROR(glBindVertexArray(0));
+		StateCache::bindVertexArray(0);
 	}
 
 	GLuint VertexArray::getID() const
@@ -255,6 +694,301 @@ namespace es
 		return mVertexAttribCount;
 	}
 
+	void VertexArray::attachInstanceBuffer(InstanceBuffer* buffer, GLuint firstLocation, GLuint vec4Count, std::size_t offset)
+	{
+		if (mInstanceBuffer == buffer->getID() && mInstanceLocation == firstLocation && mInstanceOffset == offset)
+		{
+			return;
+		}
+
+		StateCache::bindVertexArray(mID);
+		buffer->bind();
+
+		GLsizei stride = static_cast<GLsizei>(vec4Count * sizeof(float) * 4);
+		for (GLuint i = 0; i < vec4Count; i++)
+		{
+			uint64_t columnOffset = offset + i * sizeof(float) * 4;
+			GLES_CHECK_ERROR(glEnableVertexAttribArray(firstLocation + i));
+			GLES_CHECK_ERROR(glVertexAttribPointer(firstLocation + i, 4, GL_FLOAT, GL_FALSE, stride, (void*)columnOffset));
+			GLES_CHECK_ERROR(glVertexAttribDivisor(firstLocation + i, 1));
+		}
+
+		mInstanceBuffer = buffer->getID();
+		mInstanceLocation = firstLocation;
+		mInstanceOffset = offset;
+	}
+
+	// -----------------------------------------------------------------------------------------------------------------------------------
+
+	GeometryArena* GeometryArena::mArena = nullptr;
+
+	GeometryArena::GeometryArena()
+	{
+
+	}
+
+	GeometryArena::~GeometryArena()
+	{
+
+	}
+
+	GeometryArena* GeometryArena::getArena()
+	{
+		if (mArena == nullptr)
+		{
+			mArena = new (std::nothrow) GeometryArena();
+		}
+		return mArena;
+	}
+
+	GeometryArena::Allocation GeometryArena::allocate(const VertexFormat& format, const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, GLenum indexType)
+	{
+		Allocation allocation;
+		uint32_t poolIndex = findPool(format, indexType);
+		if (poolIndex == kInvalidPool)
+		{
+			return allocation;
+		}
+		Pool& pool = *mPools[poolIndex];
+
+		// both ranges are reserved before anything is written, a failed index range gives the vertex range back
+		uint32_t vertexHandle = RangeAllocator::kInvalidHandle;
+		uint32_t indexHandle = RangeAllocator::kInvalidHandle;
+		if (vertexCount > 0 && (vertexHandle = reserve(pool, true, vertexCount)) == RangeAllocator::kInvalidHandle)
+		{
+			return allocation;
+		}
+		if (indexCount > 0 && (indexHandle = reserve(pool, false, indexCount)) == RangeAllocator::kInvalidHandle)
+		{
+			if (vertexHandle != RangeAllocator::kInvalidHandle)
+			{
+				pool.mVertexRanges.release(vertexHandle);
+			}
+			return allocation;
+		}
+		allocation.mPool = poolIndex;
+		allocation.mVertices = vertexHandle;
+		allocation.mIndices = indexHandle;
+
+		if (vertexCount > 0)
+		{
+			// every stream of the mesh goes to its own stream of the pool
+			uint32_t capacity = pool.mVertexRanges.getCapacity();
+			uint32_t baseVertex = pool.mVertexRanges.getOffset(allocation.mVertices);
+			const uint8_t* source = static_cast<const uint8_t*>(vertices);
+			for (uint32_t stream = 0; stream < format.getStreamCount(); stream++)
+			{
+				std::size_t stride = format.getStride(stream);
+				pool.mVBO->setData(format.getStreamOffset(stream, capacity) + baseVertex * stride, vertexCount * stride,
+					const_cast<uint8_t*>(source + format.getStreamOffset(stream, vertexCount)));
+			}
+		}
+
+		if (indexCount > 0)
+		{
+			std::size_t indexSize = ElementBuffer::getIndexTypeSize(indexType);
+			pool.mEBO->setData(pool.mIndexRanges.getOffset(allocation.mIndices) * indexSize, indexCount * indexSize, const_cast<void*>(indices));
+		}
+		return allocation;
+	}
+
+	void GeometryArena::release(const Allocation& allocation)
+	{
+		if (allocation.mPool >= mPools.size())
+		{
+			return;
+		}
+
+		Pool& pool = *mPools[allocation.mPool];
+		if (allocation.mVertices != RangeAllocator::kInvalidHandle)
+		{
+			pool.mVertexRanges.release(allocation.mVertices);
+		}
+		if (allocation.mIndices != RangeAllocator::kInvalidHandle)
+		{
+			pool.mIndexRanges.release(allocation.mIndices);
+		}
+	}
+
+	VertexArray* GeometryArena::getVertexArray(const Allocation& allocation) const
+	{
+		return allocation.mPool < mPools.size() ? mPools[allocation.mPool]->mVAO.get() : nullptr;
+	}
+
+	VertexBuffer* GeometryArena::getVertexBuffer(const Allocation& allocation) const
+	{
+		return allocation.mPool < mPools.size() ? mPools[allocation.mPool]->mVBO.get() : nullptr;
+	}
+
+	ElementBuffer* GeometryArena::getElementBuffer(const Allocation& allocation) const
+	{
+		return allocation.mPool < mPools.size() ? mPools[allocation.mPool]->mEBO.get() : nullptr;
+	}
+
+	uint32_t GeometryArena::getBaseVertex(const Allocation& allocation) const
+	{
+		if (allocation.mPool >= mPools.size() || allocation.mVertices == RangeAllocator::kInvalidHandle)
+		{
+			return 0;
+		}
+		return mPools[allocation.mPool]->mVertexRanges.getOffset(allocation.mVertices);
+	}
+
+	uint32_t GeometryArena::getFirstIndex(const Allocation& allocation) const
+	{
+		if (allocation.mPool >= mPools.size() || allocation.mIndices == RangeAllocator::kInvalidHandle)
+		{
+			return 0;
+		}
+		return mPools[allocation.mPool]->mIndexRanges.getOffset(allocation.mIndices);
+	}
+
+	void GeometryArena::compact()
+	{
+		for (std::unique_ptr<Pool>& pool : mPools)
+		{
+			// everything is copied to new buffers first, the moves then read from the old ones so no range overwrites a source
+			std::shared_ptr<VertexBuffer> oldVBO = pool->mVBO;
+			std::shared_ptr<ElementBuffer> oldEBO = pool->mEBO;
+			uint32_t vertexCapacity = pool->mVertexRanges.getCapacity();
+			resize(*pool, vertexCapacity, pool->mIndexRanges.getCapacity());
+
+			const VertexFormat& format = pool->mFormat;
+			StateCache::bindBuffer(GL_COPY_READ_BUFFER, oldVBO->getID());
+			StateCache::bindBuffer(GL_COPY_WRITE_BUFFER, pool->mVBO->getID());
+			pool->mVertexRanges.compact([&](uint32_t, uint32_t oldOffset, uint32_t newOffset, uint32_t size)
+			{
+				for (uint32_t stream = 0; stream < format.getStreamCount(); stream++)
+				{
+					std::size_t streamOffset = format.getStreamOffset(stream, vertexCapacity);
+					std::size_t stride = format.getStride(stream);
+					GLES_CHECK_ERROR(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, streamOffset + oldOffset * stride, streamOffset + newOffset * stride, size * stride));
+				}
+			});
+
+			std::size_t indexSize = ElementBuffer::getIndexTypeSize(pool->mIndexType);
+			StateCache::bindBuffer(GL_COPY_READ_BUFFER, oldEBO->getID());
+			StateCache::bindBuffer(GL_COPY_WRITE_BUFFER, pool->mEBO->getID());
+			pool->mIndexRanges.compact([&](uint32_t, uint32_t oldOffset, uint32_t newOffset, uint32_t size)
+			{
+				GLES_CHECK_ERROR(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, oldOffset * indexSize, newOffset * indexSize, size * indexSize));
+			});
+		}
+	}
+
+	uint32_t GeometryArena::getPoolCount() const
+	{
+		return static_cast<uint32_t>(mPools.size());
+	}
+
+	RangeAllocatorStatistics GeometryArena::getVertexStatistics(uint32_t pool) const
+	{
+		return mPools[pool]->mVertexRanges.getStatistics();
+	}
+
+	RangeAllocatorStatistics GeometryArena::getIndexStatistics(uint32_t pool) const
+	{
+		return mPools[pool]->mIndexRanges.getStatistics();
+	}
+
+	uint32_t GeometryArena::findPool(const VertexFormat& format, GLenum indexType)
+	{
+		for (std::size_t i = 0; i < mPools.size(); i++)
+		{
+			if (mPools[i]->mFormat == format && mPools[i]->mIndexType == indexType)
+			{
+				return static_cast<uint32_t>(i);
+			}
+		}
+
+		std::unique_ptr<Pool> pool = std::make_unique<Pool>();
+		pool->mFormat = format;
+		pool->mIndexType = indexType;
+		if (!resize(*pool, kInitialVertexCapacity, kInitialIndexCapacity))
+		{
+			return kInvalidPool;
+		}
+		mPools.push_back(std::move(pool));
+		return static_cast<uint32_t>(mPools.size() - 1);
+	}
+
+	uint32_t GeometryArena::reserve(Pool& pool, bool isVertices, uint32_t size)
+	{
+		RangeAllocator& ranges = isVertices ? pool.mVertexRanges : pool.mIndexRanges;
+		uint32_t handle = ranges.allocate(size);
+		if (handle != RangeAllocator::kInvalidHandle)
+		{
+			return handle;
+		}
+
+		// a full pool grows by at least twice the request, the allocator only picks free blocks that fit any size of the size
+		// class of the request
+		uint64_t capacity = std::max(ranges.getCapacity(), 1u);
+		while (capacity < ranges.getCapacity() + static_cast<uint64_t>(size) * 2)
+		{
+			capacity *= 2;
+		}
+		if (capacity > kMaxCapacity)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "geometry arena pool can not grow to %llu %s", static_cast<unsigned long long>(capacity), isVertices ? "vertices" : "indices");
+			return RangeAllocator::kInvalidHandle;
+		}
+
+		uint32_t vertexCapacity = isVertices ? static_cast<uint32_t>(capacity) : pool.mVertexRanges.getCapacity();
+		uint32_t indexCapacity = isVertices ? pool.mIndexRanges.getCapacity() : static_cast<uint32_t>(capacity);
+		if (!resize(pool, vertexCapacity, indexCapacity))
+		{
+			return RangeAllocator::kInvalidHandle;
+		}
+		return ranges.allocate(size);
+	}
+
+	bool GeometryArena::resize(Pool& pool, uint32_t vertexCapacity, uint32_t indexCapacity)
+	{
+		const VertexFormat& format = pool.mFormat;
+		uint32_t oldVertexCapacity = pool.mVertexRanges.getCapacity();
+		uint32_t oldIndexCapacity = pool.mIndexRanges.getCapacity();
+		std::size_t indexSize = ElementBuffer::getIndexTypeSize(pool.mIndexType);
+
+		std::shared_ptr<VertexBuffer> vbo = VertexBuffer::createWithData(GL_STATIC_DRAW, static_cast<std::size_t>(vertexCapacity) * format.getVertexSize(), nullptr);
+		std::shared_ptr<ElementBuffer> ebo = ElementBuffer::createWithData(GL_STATIC_DRAW, indexCapacity * indexSize, nullptr, pool.mIndexType);
+		if (vbo == nullptr || ebo == nullptr || !vbo->hasStorage() || !ebo->hasStorage())
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to create the geometry arena buffers for %u vertices and %u indices", vertexCapacity, indexCapacity);
+			return false;
+		}
+
+		if (pool.mVBO != nullptr && oldVertexCapacity > 0)
+		{
+			StateCache::bindBuffer(GL_COPY_READ_BUFFER, pool.mVBO->getID());
+			StateCache::bindBuffer(GL_COPY_WRITE_BUFFER, vbo->getID());
+			for (uint32_t stream = 0; stream < format.getStreamCount(); stream++)
+			{
+				GLES_CHECK_ERROR(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, format.getStreamOffset(stream, oldVertexCapacity),
+					format.getStreamOffset(stream, vertexCapacity), oldVertexCapacity * format.getStride(stream)));
+			}
+		}
+
+		if (pool.mEBO != nullptr && oldIndexCapacity > 0)
+		{
+			StateCache::bindBuffer(GL_COPY_READ_BUFFER, pool.mEBO->getID());
+			StateCache::bindBuffer(GL_COPY_WRITE_BUFFER, ebo->getID());
+			GLES_CHECK_ERROR(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldIndexCapacity * indexSize));
+		}
+
+		if (oldVertexCapacity > 0 && (vertexCapacity != oldVertexCapacity || indexCapacity != oldIndexCapacity))
+		{
+			SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "geometry arena pool grows to %u vertices and %u indices", vertexCapacity, indexCapacity);
+		}
+
+		pool.mVertexRanges.grow(vertexCapacity);
+		pool.mIndexRanges.grow(indexCapacity);
+		pool.mVBO = vbo;
+		pool.mEBO = ebo;
+		pool.mVAO = VertexArray::createWithData(vbo.get(), ebo.get(), format, vertexCapacity);
+		return true;
+	}
+
 	// -----------------------------------------------------------------------------------------------------------------------------------
 
 	Renderbuffer::Renderbuffer(GLenum internalFormat, uint32_t w, uint32_t h)
@@ -319,7 +1053,7 @@ namespace es
 
 	Framebuffer::~Framebuffer()
 	{
-		GLES_CHECK_ERROR(glDeleteFramebuffers(1, &mID));
+		StateCache::deleteFramebuffer(mID);
 	}
 
 	std::unique_ptr<Framebuffer> Framebuffer::create()
@@ -329,19 +1063,17 @@ namespace es
 
 	void Framebuffer::bind()
 	{
-		GLES_CHECK_ERROR(glBindFramebuffer(GL_FRAMEBUFFER, mID));
+		StateCache::bindFramebuffer(GL_FRAMEBUFFER, mID);
 	}
 
 	void Framebuffer::unbind()
 	{
-		GLES_CHECK_ERROR(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+		StateCache::bindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 
 	void Framebuffer::attachRenderTarget(uint32_t attachment, Texture2D* texture, uint32_t layer, uint32_t mipLevel, bool draw, bool read)
 	{
 		bind();
-		GLES_CHECK_ERROR(glBindTexture(texture->getTarget(), texture->getID()));
-
 		GLenum buf = GL_COLOR_ATTACHMENT0 + attachment;
 
 		bool isExists = false;
@@ -380,8 +1112,6 @@ namespace es
 
 		checkStatus();
 
-		glBindTexture(texture->getTarget(), 0);
-
 	    unbind();
 	}
 
@@ -433,8 +1163,6 @@ namespace es
 	void Framebuffer::attachDepthRenderTarget(Texture* texture, uint32_t layer, uint32_t mipLevel)
 	{
 		bind();
-		GLES_CHECK_ERROR(glBindTexture(texture->getTarget(), texture->getID()));
-
 		GLES_CHECK_ERROR(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture->getTarget(), texture->getID(), mipLevel));
 
 		GLES_CHECK_ERROR(glDrawBuffers(0, GL_NONE));
@@ -443,8 +1171,6 @@ namespace es
 
 		checkStatus();
 
-		glBindTexture(texture->getTarget(), 0);
-
 		unbind();
 	}
 
@@ -3,9 +3,14 @@
 #include <ogles.h>
 #include <texture.h>
 #include <program.h>
+#include <sync.h>
+#include <rangeallocator.h>
+#include <indirectcommand.h>
 #include <vector>
 #include <optional>
 #include <memory>
+#include <algorithm>
+#include <cstring>
 
 namespace es
 {
@@ -28,8 +33,14 @@ namespace es
 
 		void setData(GLintptr offset, GLsizeiptr size, void* data);
 
+		// false when the data store could not be allocated, glBufferData leaves it empty when the driver runs out of memory
+		bool hasStorage() const;
+
 		GLuint getID() const;
 	protected:
+		// binds for data updates and leaves the buffer bound, element buffers first switch to vertex array 0 so no vao picks them up
+		void bindForUpdate();
+
 		GLenum mType;
 		GLuint mID;
 		size_t mSize;
@@ -47,10 +58,27 @@ namespace es
 	class ElementBuffer : public Buffer
 	{
 	public:
-		ElementBuffer(GLenum usage, std::size_t size, void* data);
+		ElementBuffer(GLenum usage, std::size_t size, void* data, GLenum indexType = GL_UNSIGNED_INT);
+		ElementBuffer(GLenum usage, const std::vector<uint32_t>& indices, bool allowByteIndices = false);
 		~ElementBuffer();
 
-		static std::shared_ptr<ElementBuffer> createWithData(GLenum usage, std::size_t size, void* data);
+		static std::shared_ptr<ElementBuffer> createWithData(GLenum usage, std::size_t size, void* data, GLenum indexType = GL_UNSIGNED_INT);
+
+		// stores indices with the smallest index type able to address them, 0xFFFFFFFF is kept as the primitive restart index
+		static std::shared_ptr<ElementBuffer> createWithIndices(GLenum usage, const std::vector<uint32_t>& indices, bool allowByteIndices = false);
+
+		static GLenum selectIndexType(const std::vector<uint32_t>& indices, bool allowByteIndices = false);
+
+		static std::vector<uint8_t> packIndices(const std::vector<uint32_t>& indices, GLenum indexType);
+
+		static uint32_t getIndexTypeSize(GLenum indexType);
+
+		GLenum getIndexType() const;
+
+		uint32_t getIndexCount() const;
+	private:
+		GLenum mIndexType;
+		uint32_t mIndexCount;
 	};
 
 	class InstanceBuffer : public Buffer
@@ -60,6 +88,33 @@ namespace es
 		~InstanceBuffer();
 
 		static std::shared_ptr<InstanceBuffer> createWithData(GLenum usage, std::size_t size, void* data);
+
+		// replaces the contents, the old storage is orphaned so draws still reading it do not stall the upload
+		void setInstances(const void* data, std::size_t size);
+	private:
+		GLenum mUsage;
+	};
+
+	class IndirectBuffer : public Buffer
+	{
+	public:
+		IndirectBuffer(GLenum usage, std::size_t size, void* data);
+		~IndirectBuffer();
+
+		static std::shared_ptr<IndirectBuffer> createWithData(GLenum usage, std::size_t size, void* data = nullptr);
+
+		static std::shared_ptr<IndirectBuffer> createWithCommands(GLenum usage, const IndirectCommandBuilder& builder);
+
+		// uploads the packed commands and keeps their descriptions for drawing, the buffer grows when needed
+		void setCommands(const IndirectCommandBuilder& builder);
+
+		// for commands written on the gpu, describes count tightly packed commands of one kind starting at offset
+		void setCommandLayout(uint32_t count, bool isIndexed, std::size_t offset = 0);
+
+		const std::vector<IndirectCommandInfo>& getCommands() const;
+	private:
+		GLenum mUsage;
+		std::vector<IndirectCommandInfo> mCommands;
 	};
 
 	class UniformBuffer : public Buffer
@@ -83,21 +138,123 @@ namespace es
 		~ShaderStorageBuffer();
 	};
 
+	// ring of regionCount regions for data written every frame. writes map their range unsynchronized, the fence of a region
+	// keeps it from being written again until the gpu finished the frame that used it
+	class StreamBuffer : public Buffer
+	{
+	public:
+		static const uint32_t kDefaultRegionCount = 3;
+		static const std::size_t kInvalidOffset = ~static_cast<std::size_t>(0);
+
+		StreamBuffer(GLenum type, std::size_t regionSize, uint32_t regionCount);
+		~StreamBuffer();
+
+		static std::unique_ptr<StreamBuffer> create(GLenum type, std::size_t regionSize, uint32_t regionCount = kDefaultRegionCount);
+
+		// ring the DrawParameters blocks of the programs are streamed through
+		static StreamBuffer* getUniformStream();
+
+		// ring of single draw commands, used for geometry arena draws that need a base vertex
+		static StreamBuffer* getCommandStream();
+
+		// moves to the next region and waits until the gpu is done with it
+		void beginFrame();
+
+		// fences the region written since beginFrame
+		void endFrame();
+
+		// copies size bytes to the next aligned offset of the current region and returns it. a full region is doubled, which
+		// orphans the storage and so invalidates the offsets returned before, compare getSerial to notice
+		std::size_t write(const void* data, std::size_t size);
+
+		// changes with every frame and every reallocation, offsets returned under the same serial stay valid
+		uint64_t getSerial() const;
+
+		std::size_t getAlignment() const;
+	private:
+		void allocate(std::size_t regionSize);
+
+		uint32_t mRegionCount;
+		std::size_t mRegionSize;
+		std::size_t mAlignment;
+
+		uint32_t mRegion;
+		std::size_t mRegionOffset;
+		std::vector<std::unique_ptr<Fence>> mFences;
+
+		uint64_t mSerial;
+
+		static StreamBuffer* mUniformStream;
+		static StreamBuffer* mCommandStream;
+	};
+
+	// vertex attribute semantics, attribute locations are assigned in this order to the semantics present in a format
+	enum class VertexSemantic : uint32_t
+	{
+		Position,
+		Texcoord,
+		Normal,
+		Tangent,
+		Bitangent,
+		Color,
+		Count
+	};
+
 	struct VertexAttrib
 	{
 		uint32_t numSubElements;
 		uint32_t type;
 		bool     normalized;
 		uint32_t offset;
+		VertexSemantic semantic;
+		uint32_t stream;
+		uint32_t location;
+	};
+
+	// describes a tightly packed vertex layout, attributes of one stream are interleaved
+	// and the streams are stored one after another in the same vertex buffer
+	class VertexFormat
+	{
+	public:
+		struct Element
+		{
+			VertexSemantic semantic;
+			uint32_t numSubElements;
+			uint32_t type = GL_FLOAT;
+			bool normalized = false;
+			uint32_t stream = 0;
+		};
+
+		VertexFormat() = default;
+		VertexFormat(const std::vector<Element>& elements);
+
+		static uint32_t getTypeSize(uint32_t type);
+
+		bool hasAttrib(VertexSemantic semantic) const;
+		const VertexAttrib* getAttrib(VertexSemantic semantic) const;
+		const std::vector<VertexAttrib>& getAttribs() const;
+
+		uint32_t getStreamCount() const;
+		uint32_t getStride(uint32_t stream) const;
+		// size of one vertex summed over all streams
+		uint32_t getVertexSize() const;
+		// byte offset of a stream inside a buffer holding vertexCount vertices
+		std::size_t getStreamOffset(uint32_t stream, std::size_t vertexCount) const;
+
+		bool operator==(const VertexFormat& other) const;
+		bool operator!=(const VertexFormat& other) const;
+	private:
+		std::vector<VertexAttrib> mAttribs;
+		std::vector<uint32_t> mStrides;
 	};
 
 	class VertexArray
 	{
 	public:
-		VertexArray(VertexBuffer* vbo, ElementBuffer* ebo, std::size_t vertexSize, const std::vector<VertexAttrib>& attribs);
+		VertexArray(VertexBuffer* vbo, ElementBuffer* ebo, const VertexFormat& format, std::size_t vertexCount);
 		~VertexArray();
 
-		static std::shared_ptr<VertexArray> createWithData(VertexBuffer* vbo, ElementBuffer* ebo, std::size_t vertexSize, const std::vector<VertexAttrib>& attribs);
+		static std::shared_ptr<VertexArray> createWithData(VertexBuffer* vbo, ElementBuffer* ebo, const VertexFormat& format, std::size_t vertexCount);
 
 		void bind();
 		void unbind();
@@ -106,11 +263,94 @@ namespace es
 
 		GLuint getVertexAttribCount() const;
 
+		// per instance vec4 columns at firstLocation onwards read from offset, nothing is done when the buffer is already attached
+		// there with that offset
+		void attachInstanceBuffer(InstanceBuffer* buffer, GLuint firstLocation, GLuint vec4Count, std::size_t offset = 0);
+
 		VertexArray(const VertexArray&) = delete;
 		const VertexArray& operator=(const VertexArray&) = delete;
 	private:
 		GLuint mID;
 		GLuint mVertexAttribCount;
+
+		GLuint mInstanceBuffer = 0;
+		GLuint mInstanceLocation = 0;
+		std::size_t mInstanceOffset = 0;
+	};
+
+	// shared vertex and element buffers, one pool per vertex format and index type, that meshes are sub-allocated from so
+	// compatible meshes draw from the same vertex array. indices stay local to their mesh, draws add the base vertex
+	class GeometryArena
+	{
+	public:
+		static const uint32_t kInvalidPool = 0xffffffffu;
+		static const uint32_t kInitialVertexCapacity = 64 * 1024;
+		static const uint32_t kInitialIndexCapacity = 192 * 1024;
+		// pools do not grow past this many vertices or indices
+		static const uint32_t kMaxCapacity = 1u << 30;
+
+		struct Allocation
+		{
+			uint32_t mPool = kInvalidPool;
+			uint32_t mVertices = RangeAllocator::kInvalidHandle;
+			uint32_t mIndices = RangeAllocator::kInvalidHandle;
+
+			bool isValid() const { return mPool != kInvalidPool; }
+		};
+
+		GeometryArena();
+		~GeometryArena();
+
+		static GeometryArena* getArena();
+
+		// copies the mesh into the pool of its format and index type, a pool that is too small doubles until it fits. an invalid
+		// allocation when the pool can not grow far enough or its buffers can not be created
+		Allocation allocate(const VertexFormat& format, const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, GLenum indexType);
+
+		void release(const Allocation& allocation);
+
+		VertexArray* getVertexArray(const Allocation& allocation) const;
+		VertexBuffer* getVertexBuffer(const Allocation& allocation) const;
+		ElementBuffer* getElementBuffer(const Allocation& allocation) const;
+
+		// place of the allocation in the pool buffers, in vertices and indices
+		uint32_t getBaseVertex(const Allocation& allocation) const;
+		uint32_t getFirstIndex(const Allocation& allocation) const;
+
+		// moves the allocations of every pool together so the free space is one block again. the buffers and vertex arrays are
+		// replaced, allocations stay valid but anything holding the old objects has to fetch them again
+		void compact();
+
+		uint32_t getPoolCount() const;
+		RangeAllocatorStatistics getVertexStatistics(uint32_t pool) const;
+		RangeAllocatorStatistics getIndexStatistics(uint32_t pool) const;
+
+		GeometryArena(const GeometryArena&) = delete;
+		const GeometryArena& operator=(const GeometryArena&) = delete;
+	private:
+		struct Pool
+		{
+			VertexFormat mFormat;
+			GLenum mIndexType;
+			RangeAllocator mVertexRanges;
+			RangeAllocator mIndexRanges;
+			std::shared_ptr<VertexBuffer> mVBO;
+			std::shared_ptr<ElementBuffer> mEBO;
+			std::shared_ptr<VertexArray> mVAO;
+		};
+
+		uint32_t findPool(const VertexFormat& format, GLenum indexType);
+
+		// new buffers of the given capacities with the old contents copied over, the streams of the format are laid out for
+		// the vertex capacity so every stream moves to its new offset. false leaves the pool as it was
+		bool resize(Pool& pool, uint32_t vertexCapacity, uint32_t indexCapacity);
+
+		// a handle of size units, the pool grows when no free block fits. kInvalidHandle when it can not
+		uint32_t reserve(Pool& pool, bool isVertices, uint32_t size);
+
+		std::vector<std::unique_ptr<Pool>> mPools;
+
+		static GeometryArena* mArena;
 	};
 
 	class Renderbuffer
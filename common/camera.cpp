@@ -18,7 +18,6 @@ namespace es
 
 		mOrientation = glm::quat();
 		mProjection = glm::perspective(glm::radians(fov), aspectRatio, near, far);
-		mPrevViewProjection = glm::mat4(1.0f);
 
 		mFrustum.mFov = fov;
 		mFrustum.mNear = near;
@@ -26,6 +25,7 @@ namespace es
 		mFrustum.mAspectRatio = aspectRatio;
 	
 		update();
+		mPrevViewProjection = mViewProjection;
 	}
 
 	Camera::~Camera()
@@ -68,6 +68,7 @@ namespace es
 
 	void Camera::update()
 	{
+		mPrevViewProjection = mViewProjection;
 		if (mIsDirty)
 		{
 			glm::quat qPitch = glm::angleAxis(mPitch, glm::vec3(1.0f, 0.0f, 0.0f));
@@ -87,7 +88,6 @@ namespace es
 
 			mTranslate = glm::translate(glm::mat4(1.0f), -mPosition);
 			mView = mRotate * mTranslate;
-			mPrevViewProjection = mViewProjection;
 			mViewProjection = mProjection * mView;
 
 			updateFrustum();
@@ -99,14 +99,23 @@ namespace es
 	void Camera::updateProjection(float fov, float near, float far, float aspectRatio)
 	{
 		mProjection = glm::perspective(glm::radians(fov), aspectRatio, near, far);
+
+		mFrustum.mFov = fov;
+		mFrustum.mNear = near;
+		mFrustum.mFar = far;
+		mFrustum.mAspectRatio = aspectRatio;
+
+		mViewProjection = mProjection * mView;
+		updateFrustum();
 	}
 
 	void Camera::updateFrustum()
 	{
-		float nearHeight = 2 * tan(mFrustum.mFov / 2) * mFrustum.mNear;
+		// the fov is stored in degrees
+		float nearHeight = 2 * tan(glm::radians(mFrustum.mFov) / 2) * mFrustum.mNear;
 		float nearWidth = nearHeight * mFrustum.mAspectRatio;
 
-		float farHeight = 2 * tan(mFrustum.mFov / 2) * mFrustum.mFar;
+		float farHeight = 2 * tan(glm::radians(mFrustum.mFov) / 2) * mFrustum.mFar;
 		float farWidth = farHeight * mFrustum.mAspectRatio;
 
 		glm::vec3 fc = mPosition + mFront * mFrustum.mFar;
@@ -121,6 +130,8 @@ namespace es
 		mFrustum.mFrustumCorners[1] = nc + (mUp * nearHeight / 2.0f) + (mRight * nearWidth / 2.0f); // 
 		mFrustum.mFrustumCorners[3] = nc - (mUp * nearHeight / 2.0f) - (mRight * nearWidth / 2.0f); // 
 		mFrustum.mFrustumCorners[2] = nc - (mUp * nearHeight / 2.0f) + (mRight * nearWidth / 2.0f); // 
+
+		mFrustum.setPlanes(mViewProjection);
 	}
 
 	const glm::vec3& Camera::getPosition() const
@@ -149,6 +160,16 @@ namespace es
 		return mProjection;
 	}
 
+	const glm::mat4& Camera::getViewProjection() const
+	{
+		return mViewProjection;
+	}
+
+	const glm::mat4& Camera::getPrevViewProjection() const
+	{
+		return mPrevViewProjection;
+	}
+
 	void Camera::setMoveSensitivity(float sensitivity)
 	{
 		mMoveSensitivity = sensitivity;
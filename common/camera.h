@@ -40,6 +40,11 @@ namespace es
 
 		const glm::mat4& getProjection() const;
 
+		const glm::mat4& getViewProjection() const;
+
+		// the view projection of the previous update, equal to the current one while the camera stands still
+		const glm::mat4& getPrevViewProjection() const;
+
 		void setMoveSensitivity(float sensitivity);
 
 		float getMoveSensitivity() const;
@@ -0,0 +1,180 @@
+#include "culling.h"
+
+#include <cmath>
+
+#include <statistics.h>
+
+#if defined(ES_CULLING_SSE)
+#include <xmmintrin.h>
+#endif
+
+namespace es
+{
+	namespace
+	{
+		// large enough to pass every plane, used for invalid volumes and the padding lanes
+		const float kHuge = 1.0e30f;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+
+	CullingBatch::CullingBatch()
+		:mCount(0)
+	{
+	}
+
+	CullingBatch::~CullingBatch()
+	{
+	}
+
+	void CullingBatch::clear()
+	{
+		mCount = 0;
+		mBoxCenterX.clear();
+		mBoxCenterY.clear();
+		mBoxCenterZ.clear();
+		mBoxExtentX.clear();
+		mBoxExtentY.clear();
+		mBoxExtentZ.clear();
+		mSphereX.clear();
+		mSphereY.clear();
+		mSphereZ.clear();
+		mSphereRadius.clear();
+		mVisible.clear();
+	}
+
+	uint32_t CullingBatch::add(const AABB& box, const BoundingSphere& sphere)
+	{
+		glm::vec3 center = box.isValid() ? box.getCenter() : glm::vec3(0.0f);
+		glm::vec3 extents = box.isValid() ? box.getExtents() : glm::vec3(kHuge);
+		mBoxCenterX.push_back(center.x);
+		mBoxCenterY.push_back(center.y);
+		mBoxCenterZ.push_back(center.z);
+		mBoxExtentX.push_back(extents.x);
+		mBoxExtentY.push_back(extents.y);
+		mBoxExtentZ.push_back(extents.z);
+
+		mSphereX.push_back(sphere.isValid() ? sphere.mCenter.x : 0.0f);
+		mSphereY.push_back(sphere.isValid() ? sphere.mCenter.y : 0.0f);
+		mSphereZ.push_back(sphere.isValid() ? sphere.mCenter.z : 0.0f);
+		mSphereRadius.push_back(sphere.isValid() ? sphere.mRadius : kHuge);
+
+		return mCount++;
+	}
+
+	uint32_t CullingBatch::cull(const Frustum& frustum)
+	{
+		mVisible.assign(mCount, 1);
+		if (mCount == 0)
+		{
+			return 0;
+		}
+
+#if defined(ES_CULLING_SSE)
+		// pad with volumes that are always visible so the last group of four can be loaded whole
+		while (mBoxCenterX.size() % 4 != 0)
+		{
+			mBoxCenterX.push_back(0.0f);
+			mBoxCenterY.push_back(0.0f);
+			mBoxCenterZ.push_back(0.0f);
+			mBoxExtentX.push_back(kHuge);
+			mBoxExtentY.push_back(kHuge);
+			mBoxExtentZ.push_back(kHuge);
+			mSphereX.push_back(0.0f);
+			mSphereY.push_back(0.0f);
+			mSphereZ.push_back(0.0f);
+			mSphereRadius.push_back(kHuge);
+		}
+		cullSSE(frustum);
+#else
+		cullScalar(frustum);
+#endif
+
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < mCount; i++)
+		{
+			visibleCount += mVisible[i];
+		}
+
+		FrameStatistics& statistics = Statistics::getCurrentFrame();
+		statistics.mObjectsVisible += visibleCount;
+		statistics.mObjectsCulled += mCount - visibleCount;
+		return visibleCount;
+	}
+
+	bool CullingBatch::isVisible(uint32_t index) const
+	{
+		return index < mVisible.size() && mVisible[index] != 0;
+	}
+
+	uint32_t CullingBatch::getCount() const
+	{
+		return mCount;
+	}
+
+	void CullingBatch::cullScalar(const Frustum& frustum)
+	{
+		for (uint32_t i = 0; i < mCount; i++)
+		{
+			bool isVisible = true;
+			for (const glm::vec4& plane : frustum.mPlanes)
+			{
+				float boxDistance = plane.x * mBoxCenterX[i] + plane.y * mBoxCenterY[i] + plane.z * mBoxCenterZ[i] + plane.w;
+				float boxRadius = std::fabs(plane.x) * mBoxExtentX[i] + std::fabs(plane.y) * mBoxExtentY[i] + std::fabs(plane.z) * mBoxExtentZ[i];
+				float sphereDistance = plane.x * mSphereX[i] + plane.y * mSphereY[i] + plane.z * mSphereZ[i] + plane.w;
+				if (boxDistance + boxRadius < 0.0f || sphereDistance + mSphereRadius[i] < 0.0f)
+				{
+					isVisible = false;
+					break;
+				}
+			}
+			mVisible[i] = isVisible ? 1 : 0;
+		}
+	}
+
+#if defined(ES_CULLING_SSE)
+	void CullingBatch::cullSSE(const Frustum& frustum)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+
+		for (uint32_t i = 0; i < mCount; i += 4)
+		{
+			__m128 boxX = _mm_loadu_ps(&mBoxCenterX[i]);
+			__m128 boxY = _mm_loadu_ps(&mBoxCenterY[i]);
+			__m128 boxZ = _mm_loadu_ps(&mBoxCenterZ[i]);
+			__m128 extentX = _mm_loadu_ps(&mBoxExtentX[i]);
+			__m128 extentY = _mm_loadu_ps(&mBoxExtentY[i]);
+			__m128 extentZ = _mm_loadu_ps(&mBoxExtentZ[i]);
+			__m128 sphereX = _mm_loadu_ps(&mSphereX[i]);
+			__m128 sphereY = _mm_loadu_ps(&mSphereY[i]);
+			__m128 sphereZ = _mm_loadu_ps(&mSphereZ[i]);
+			__m128 sphereRadius = _mm_loadu_ps(&mSphereRadius[i]);
+
+			__m128 outside = zero;
+			for (const glm::vec4& plane : frustum.mPlanes)
+			{
+				__m128 normalX = _mm_set1_ps(plane.x);
+				__m128 normalY = _mm_set1_ps(plane.y);
+				__m128 normalZ = _mm_set1_ps(plane.z);
+				__m128 distance = _mm_set1_ps(plane.w);
+
+				// signed distance of the box center plus the extents projected onto the plane normal
+				__m128 boxDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, boxX), _mm_mul_ps(normalY, boxY)), _mm_add_ps(_mm_mul_ps(normalZ, boxZ), distance));
+				__m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, normalX), extentX), _mm_mul_ps(_mm_andnot_ps(signMask, normalY), extentY)),
+					_mm_mul_ps(_mm_andnot_ps(signMask, normalZ), extentZ));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(boxDistance, boxRadius), zero));
+
+				__m128 sphereDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, sphereX), _mm_mul_ps(normalY, sphereY)), _mm_add_ps(_mm_mul_ps(normalZ, sphereZ), distance));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(sphereDistance, sphereRadius), zero));
+			}
+
+			int mask = _mm_movemask_ps(outside);
+			for (uint32_t lane = 0; lane < 4 && i + lane < mCount; lane++)
+			{
+				mVisible[i + lane] = (mask & (1 << lane)) ? 0 : 1;
+			}
+		}
+	}
+#endif
+}
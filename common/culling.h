@@ -0,0 +1,59 @@
+#ifndef CULLING_H_
+#define CULLING_H_
+
+#include <geometry.h>
+
+#include <vector>
+#include <cstdint>
+
+// sse is part of every x86-64 target, other cpus take the scalar path
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ES_CULLING_SSE 1
+#endif
+
+namespace es
+{
+	// world space volumes stored as structure of arrays and tested against the frustum planes four at a time.
+	// an entry is visible when both its box and its sphere touch the frustum
+	class CullingBatch
+	{
+	public:
+		CullingBatch();
+		~CullingBatch();
+
+		void clear();
+
+		// returns the index of the entry, an invalid box or sphere is never culled
+		uint32_t add(const AABB& box, const BoundingSphere& sphere);
+
+		// returns the number of visible entries and adds both counts to the frame statistics
+		uint32_t cull(const Frustum& frustum);
+
+		bool isVisible(uint32_t index) const;
+
+		uint32_t getCount() const;
+	private:
+		void cullScalar(const Frustum& frustum);
+#if defined(ES_CULLING_SSE)
+		void cullSSE(const Frustum& frustum);
+#endif
+
+		uint32_t mCount;
+
+		// box center and extents, sphere center and radius, padded to a multiple of 4
+		std::vector<float> mBoxCenterX;
+		std::vector<float> mBoxCenterY;
+		std::vector<float> mBoxCenterZ;
+		std::vector<float> mBoxExtentX;
+		std::vector<float> mBoxExtentY;
+		std::vector<float> mBoxExtentZ;
+		std::vector<float> mSphereX;
+		std::vector<float> mSphereY;
+		std::vector<float> mSphereZ;
+		std::vector<float> mSphereRadius;
+
+		std::vector<uint8_t> mVisible;
+	};
+}
+
+#endif
@@ -1,5 +1,8 @@
 ﻿#include "examplebase.h"
 #include "world.h"
+#include "statistics.h"
+#include "statecache.h"
+#include "buffer.h"
 
 namespace es
 {
@@ -85,6 +88,7 @@ namespace es
 				"failed to create an OpenGL context.", nullptr);
 			return false;
 		}
+		StateCache::invalidate();
 
 		if (settings.vsync == true)
 		{
@@ -141,7 +145,7 @@ namespace es
 	void ExampleBase::prepare()
 	{
 		// viewport conversion
-		glViewport(0, 0, mWindowWidth, mWindowHeight);
+		StateCache::viewport(0, 0, mWindowWidth, mWindowHeight);
 
 		World::getWorld()->createMainCamera(45.0f, 0.1f, 1000.0f, (float)mWindowWidth / (float)mWindowHeight, glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f));
 		mMainCamera = World::getWorld()->getMainCamera();
@@ -150,6 +154,14 @@ namespace es
 	void ExampleBase::renderFrame()
 	{
 		auto timeStart = std::chrono::high_resolution_clock::now();
+
+		Statistics::beginFrame();
+		mFramePacer->beginFrame();
+		StreamBuffer::getUniformStream()->beginFrame();
+		StreamBuffer::getCommandStream()->beginFrame();
+
+		// swap in textures whose decode finished since the last frame
+		Texture2D::processPendingUploads();
 		if (viewUpdated)
 		{
 			viewUpdated = false;
@@ -179,6 +191,13 @@ namespace es
 		ImGui::Render();
 
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		// imgui drives gl directly
+		StateCache::invalidate();
+
+		// the parameters streamed this frame stay untouched until the gpu passed this point
+		StreamBuffer::getUniformStream()->endFrame();
+		StreamBuffer::getCommandStream()->endFrame();
+		mFramePacer->endFrame();
 
 		frameCounter++;
 		auto timeEnd = std::chrono::high_resolution_clock::now();
@@ -215,6 +234,7 @@ namespace es
 	void ExampleBase::renderLoop()
 	{
 		lastTimestamp = std::chrono::high_resolution_clock::now();
+		mFramePacer = FramePacer::create(settings.framesInFlight);
 
 		while (!mIsApplicationQuit)
 		{
@@ -226,9 +246,16 @@ namespace es
 			handleKeyboardInput();
 			handleMouseMove();
 			renderFrame();
+
+			// the pacer already waited for the gpu, what is left here is vsync or a driver queue deeper than the frames in flight
+			auto swapStart = std::chrono::high_resolution_clock::now();
 			SDL_GL_SwapWindow(window);
+			auto swapEnd = std::chrono::high_resolution_clock::now();
+			Statistics::getCurrentFrame().mSwapTime = static_cast<float>(std::chrono::duration<double, std::milli>(swapEnd - swapStart).count());
 		}
 
+		mFramePacer.reset();
+
 		// clean up
 		ImGui_ImplOpenGL3_Shutdown();
 		ImGui_ImplSDL2_Shutdown();
@@ -361,7 +388,7 @@ namespace es
 
 	void ExampleBase::windowResized()
 	{
-		glViewport(0, 0, mWindowWidth, mWindowHeight);
+		StateCache::viewport(0, 0, mWindowWidth, mWindowHeight);
 		mMainCamera->updateProjection(45.0f, 0.1f, 1000.0f, (float)mWindowWidth / (float)mWindowHeight);
 	}
 
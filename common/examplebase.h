@@ -53,6 +53,8 @@
 
 #include "world.h"
 #include "object.h"
+#include "statecache.h"
+#include "sync.h"
 #include "UIOverlay.h"
 
 #include <imgui/imgui.h>
@@ -96,6 +98,9 @@ namespace es
 		std::string texturesDirectory;
 
 		Camera* mMainCamera;
+
+		// created by renderLoop with settings.framesInFlight
+		std::unique_ptr<FramePacer> mFramePacer;
 	public:
 		bool prepared = false;
 
@@ -113,6 +118,8 @@ namespace es
 			bool fullscreen = false;
 			bool vsync = false;
 			bool overlay = false;
+			// frames the cpu may queue ahead of the gpu before it waits, 0 leaves the pacing to the driver
+			uint32_t framesInFlight = FramePacer::kDefaultFramesInFlight;
 		} settings;
 
 		glm::vec4 defaultClearColor = glm::vec4(0.025f, 0.025f, 0.025f, 1.0f);
@@ -1 +1,210 @@
 #include "geometry.h"
+
+#include <cstring>
+#include <cmath>
+
+namespace es
+{
+	bool AABB::isValid() const
+	{
+		return mMin.x <= mMax.x && mMin.y <= mMax.y && mMin.z <= mMax.z;
+	}
+
+	void AABB::expand(const glm::vec3& point)
+	{
+		mMin = glm::min(mMin, point);
+		mMax = glm::max(mMax, point);
+	}
+
+	void AABB::expand(const AABB& box)
+	{
+		if (box.isValid())
+		{
+			expand(box.mMin);
+			expand(box.mMax);
+		}
+	}
+
+	glm::vec3 AABB::getCenter() const
+	{
+		return (mMin + mMax) * 0.5f;
+	}
+
+	glm::vec3 AABB::getExtents() const
+	{
+		return (mMax - mMin) * 0.5f;
+	}
+
+	AABB AABB::transform(const glm::mat4& matrix) const
+	{
+		if (!isValid())
+		{
+			return *this;
+		}
+
+		// center moves with the matrix, the extents are projected onto the absolute axes of the matrix
+		glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.0f));
+		glm::vec3 extents = getExtents();
+		glm::vec3 newExtents = glm::abs(glm::vec3(matrix[0])) * extents.x + glm::abs(glm::vec3(matrix[1])) * extents.y + glm::abs(glm::vec3(matrix[2])) * extents.z;
+
+		AABB box;
+		box.mMin = center - newExtents;
+		box.mMax = center + newExtents;
+		return box;
+	}
+
+	bool AABB::contains(const AABB& box) const
+	{
+		return mMin.x <= box.mMin.x && mMin.y <= box.mMin.y && mMin.z <= box.mMin.z &&
+			box.mMax.x <= mMax.x && box.mMax.y <= mMax.y && box.mMax.z <= mMax.z;
+	}
+
+	bool AABB::overlaps(const AABB& box) const
+	{
+		return mMin.x <= box.mMax.x && box.mMin.x <= mMax.x &&
+			mMin.y <= box.mMax.y && box.mMin.y <= mMax.y &&
+			mMin.z <= box.mMax.z && box.mMin.z <= mMax.z;
+	}
+
+	bool AABB::overlaps(const BoundingSphere& sphere) const
+	{
+		glm::vec3 offset = glm::clamp(sphere.mCenter, mMin, mMax) - sphere.mCenter;
+		return glm::dot(offset, offset) <= sphere.mRadius * sphere.mRadius;
+	}
+
+	bool AABB::intersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& distance) const
+	{
+		// an axis the ray runs parallel to gives infinite slabs, the comparisons below still reject it when the origin is outside
+		glm::vec3 toMin = (mMin - origin) * inverseDirection;
+		glm::vec3 toMax = (mMax - origin) * inverseDirection;
+		glm::vec3 entries = glm::min(toMin, toMax);
+		glm::vec3 exits = glm::max(toMin, toMax);
+
+		float enter = glm::max(glm::max(entries.x, entries.y), glm::max(entries.z, 0.0f));
+		float leave = glm::min(glm::min(exits.x, exits.y), glm::min(exits.z, maxDistance));
+		if (enter > leave)
+		{
+			return false;
+		}
+		distance = enter;
+		return true;
+	}
+
+	float AABB::getSurfaceArea() const
+	{
+		glm::vec3 size = mMax - mMin;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+
+	bool BoundingSphere::isValid() const
+	{
+		return mRadius >= 0.0f;
+	}
+
+	BoundingSphere BoundingSphere::transform(const glm::mat4& matrix) const
+	{
+		if (!isValid())
+		{
+			return *this;
+		}
+
+		float scaleX = glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0]));
+		float scaleY = glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]));
+		float scaleZ = glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]));
+		float maxScale = scaleX > scaleY ? scaleX : scaleY;
+		maxScale = maxScale > scaleZ ? maxScale : scaleZ;
+
+		BoundingSphere sphere;
+		sphere.mCenter = glm::vec3(matrix * glm::vec4(mCenter, 1.0f));
+		sphere.mRadius = mRadius * std::sqrt(maxScale);
+		return sphere;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+
+	void Frustum::setPlanes(const glm::mat4& viewProjection)
+	{
+		// gribb and hartmann, each plane is the fourth row plus or minus one of the others
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+		{
+			rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		}
+
+		mPlanes[0] = rows[3] + rows[0];
+		mPlanes[1] = rows[3] - rows[0];
+		mPlanes[2] = rows[3] + rows[1];
+		mPlanes[3] = rows[3] - rows[1];
+		mPlanes[4] = rows[3] + rows[2];
+		mPlanes[5] = rows[3] - rows[2];
+
+		for (glm::vec4& plane : mPlanes)
+		{
+			float length = glm::length(glm::vec3(plane));
+			if (length > 0.0f)
+			{
+				plane /= length;
+			}
+		}
+	}
+
+	Containment Frustum::classify(const AABB& box) const
+	{
+		glm::vec3 center = box.getCenter();
+		glm::vec3 extents = box.getExtents();
+
+		Containment result = Containment::INSIDE;
+		for (const glm::vec4& plane : mPlanes)
+		{
+			glm::vec3 normal = glm::vec3(plane);
+			float distance = glm::dot(normal, center) + plane.w;
+			float radius = glm::dot(glm::abs(normal), extents);
+			if (distance < -radius)
+			{
+				return Containment::OUTSIDE;
+			}
+			if (distance < radius)
+			{
+				result = Containment::INTERSECTS;
+			}
+		}
+		return result;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+
+	void computeBounds(const uint8_t* positions, uint32_t stride, uint32_t componentCount, uint32_t count, AABB& box, BoundingSphere& sphere)
+	{
+		box = AABB();
+		sphere = BoundingSphere();
+		if (positions == nullptr || count == 0 || componentCount < 2)
+		{
+			return;
+		}
+
+		auto readPosition = [&](uint32_t index)
+		{
+			float values[3] = { 0.0f, 0.0f, 0.0f };
+			std::memcpy(values, positions + static_cast<std::size_t>(index) * stride, sizeof(float) * (componentCount < 3 ? componentCount : 3));
+			return glm::vec3(values[0], values[1], values[2]);
+		};
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			box.expand(readPosition(i));
+		}
+
+		// centered on the box, tighter than the half diagonal for round shapes
+		sphere.mCenter = box.getCenter();
+		float maxDistance = 0.0f;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			glm::vec3 offset = readPosition(i) - sphere.mCenter;
+			float distance = glm::dot(offset, offset);
+			maxDistance = distance > maxDistance ? distance : maxDistance;
+		}
+		sphere.mRadius = std::sqrt(maxDistance);
+	}
+}
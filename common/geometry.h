@@ -3,9 +3,58 @@
 
 #include <glm/glm.hpp>
 #include <array>
+#include <cstdint>
 
 namespace es
 {
+	struct BoundingSphere;
+
+	enum class Containment
+	{
+		OUTSIDE,
+		INTERSECTS,
+		INSIDE
+	};
+
+	// axis aligned box, empty until the first point is added
+	struct AABB
+	{
+		glm::vec3 mMin = glm::vec3(3.402823466e+38f);
+		glm::vec3 mMax = glm::vec3(-3.402823466e+38f);
+
+		bool isValid() const;
+
+		void expand(const glm::vec3& point);
+		void expand(const AABB& box);
+
+		glm::vec3 getCenter() const;
+		glm::vec3 getExtents() const;
+
+		// box around the transformed box, an invalid box stays invalid
+		AABB transform(const glm::mat4& matrix) const;
+
+		bool contains(const AABB& box) const;
+		bool overlaps(const AABB& box) const;
+		bool overlaps(const BoundingSphere& sphere) const;
+
+		// slab test, distance is where the ray enters the box or 0 when it starts inside
+		bool intersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& distance) const;
+
+		float getSurfaceArea() const;
+	};
+
+	struct BoundingSphere
+	{
+		glm::vec3 mCenter = glm::vec3(0.0f);
+		// negative for an empty sphere
+		float mRadius = -1.0f;
+
+		bool isValid() const;
+
+		// the radius grows with the largest axis scale of the matrix
+		BoundingSphere transform(const glm::mat4& matrix) const;
+	};
+
 	struct Frustum
 	{
 		float mNear;
@@ -14,7 +63,19 @@ namespace es
 		float mAspectRatio;
 
 		std::array<glm::vec3, 8> mFrustumCorners;
+
+		// left, right, bottom, top, near, far as (normal, distance) with normals pointing inwards, normalized
+		std::array<glm::vec4, 6> mPlanes;
+
+		// extracts the planes from a projection * view matrix
+		void setPlanes(const glm::mat4& viewProjection);
+
+		// INSIDE only when the box lies behind every plane, boxes near the corners may report INTERSECTS while outside
+		Containment classify(const AABB& box) const;
 	};
+
+	// box and sphere over float positions read with the given byte stride, invalid volumes for count 0
+	void computeBounds(const uint8_t* positions, uint32_t stride, uint32_t componentCount, uint32_t count, AABB& box, BoundingSphere& sphere);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,269 @@
+#include "gpuculler.h"
+
+#include <statecache.h>
+#include <statistics.h>
+
+namespace es
+{
+	namespace
+	{
+		// large enough to pass every plane, small enough to stay finite under any sane transform
+		const float kUnboundedExtent = 1.0e30f;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+
+	GpuCuller::GpuCuller(const std::string& shaderPath)
+		:mIsLayoutDirty(false)
+	{
+		mProgram = Program::createFromFiles("gpu_culling", { shaderPath });
+	}
+
+	GpuCuller::~GpuCuller()
+	{
+
+	}
+
+	std::unique_ptr<GpuCuller> GpuCuller::create(const std::string& shaderPath)
+	{
+		return std::make_unique<GpuCuller>(shaderPath);
+	}
+
+	uint32_t GpuCuller::add(Mesh* mesh)
+	{
+		std::shared_ptr<Material> material = mesh->getMaterial();
+		if (material == nullptr || material->getInstancedProgram() == nullptr || mesh->getDrawType() != Mesh::DrawType::ELEMENTS)
+		{
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "gpu culling needs an instanced material and indexed draws, mesh %s is skipped", mesh->getName().c_str());
+			return kInvalidObject;
+		}
+
+		uint32_t command = findCommand(mesh);
+		if (command == kInvalidObject)
+		{
+			command = static_cast<uint32_t>(mCommands.size());
+			mCommands.push_back({ mesh, 0, 0 });
+
+			std::shared_ptr<const MeshGeometry> geometry = mesh->getGeometry();
+			mCommandRecords.push_back({ geometry->getIndexCount(), 0, geometry->getFirstIndex(), static_cast<int32_t>(geometry->getBaseVertex()), 0 });
+		}
+		mCommands[command].mObjectCount++;
+
+		GpuCullObject object;
+		fillObject(mesh, object);
+		object.mCommand = command;
+
+		mObjects.push_back(object);
+		mMeshes.push_back(mesh);
+		mIsLayoutDirty = true;
+		return static_cast<uint32_t>(mObjects.size() - 1);
+	}
+
+	void GpuCuller::clear()
+	{
+		mCommands.clear();
+		mMeshes.clear();
+		mObjects.clear();
+		mDirtyObjects.clear();
+		mCommandRecords.clear();
+		mIsLayoutDirty = true;
+	}
+
+	void GpuCuller::updateObject(uint32_t object)
+	{
+		if (object >= mObjects.size())
+		{
+			return;
+		}
+
+		uint32_t command = mObjects[object].mCommand;
+		fillObject(mMeshes[object], mObjects[object]);
+		mObjects[object].mCommand = command;
+		mDirtyObjects.push_back(object);
+	}
+
+	void GpuCuller::cull(const Frustum& frustum)
+	{
+		if (mObjects.empty() || mProgram == nullptr)
+		{
+			return;
+		}
+
+		if (mIsLayoutDirty)
+		{
+			uploadLayout();
+		}
+		else
+		{
+			for (uint32_t object : mDirtyObjects)
+			{
+				mObjectBuffer->setData(object * sizeof(GpuCullObject), sizeof(GpuCullObject), &mObjects[object]);
+			}
+		}
+		mDirtyObjects.clear();
+
+		// the counts of the last cull are still in the commands. arena geometry may have moved since the last upload
+		for (std::size_t i = 0; i < mCommands.size(); i++)
+		{
+			std::shared_ptr<const MeshGeometry> geometry = mCommands[i].mMesh->getGeometry();
+			mCommandRecords[i].mFirstIndex = geometry->getFirstIndex();
+			mCommandRecords[i].mBaseVertex = static_cast<int32_t>(geometry->getBaseVertex());
+		}
+		mCommandBuffer->setData(0, mCommandRecords.size() * sizeof(DrawElementsIndirectCommand), mCommandRecords.data());
+
+		mProgram->apply();
+		mProgram->setUniform("planes", frustum.mPlanes.data(), static_cast<uint32_t>(frustum.mPlanes.size()));
+		mProgram->setUniform("objectCount", static_cast<int>(mObjects.size()));
+
+		StateCache::bindBufferRange(GL_SHADER_STORAGE_BUFFER, kObjectBinding, mObjectBuffer->getID());
+		StateCache::bindBufferRange(GL_SHADER_STORAGE_BUFFER, kInstanceBinding, mInstanceBuffer->getID());
+		StateCache::bindBufferRange(GL_SHADER_STORAGE_BUFFER, kCommandBinding, mCommandBuffer->getID());
+		StateCache::bindBufferRange(GL_SHADER_STORAGE_BUFFER, kBaseBinding, mBaseBuffer->getID());
+
+		GLuint groupCount = static_cast<GLuint>((mObjects.size() + kWorkGroupSize - 1) / kWorkGroupSize);
+		GLES_CHECK_ERROR(glDispatchCompute(groupCount, 1, 1));
+
+		// the draws read the commands and the instances as attributes
+		GLES_CHECK_ERROR(glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT));
+	}
+
+	void GpuCuller::render()
+	{
+		if (mCommandBuffer == nullptr || mIsLayoutDirty)
+		{
+			return;
+		}
+
+		const std::vector<IndirectCommandInfo>& commands = mCommandBuffer->getCommands();
+		for (std::size_t i = 0; i < mCommands.size(); i++)
+		{
+			const Command& command = mCommands[i];
+			Mesh* mesh = command.mMesh;
+			std::shared_ptr<Material> material = mesh->getMaterial();
+			if (material == nullptr || material->getInstancedProgram() == nullptr)
+			{
+				continue;
+			}
+
+			material->applyInstanced();
+			mesh->applyUniforms(material->getInstancedProgram().get());
+			Program::commitDrawParameters();
+
+			// es 3.1 has no base instance, the attributes start at the first instance of the command instead
+			std::shared_ptr<const MeshGeometry> geometry = mesh->getGeometry();
+			VertexArray* vao = geometry->getVertexArray();
+			vao->attachInstanceBuffer(mInstanceBuffer.get(), InstanceBatcher::kFirstLocation, InstanceBatcher::kVec4Count, command.mBase * sizeof(InstanceData));
+			vao->bind();
+
+			mCommandBuffer->bind();
+			GLES_CHECK_ERROR(glDrawElementsIndirect(GL_TRIANGLES, geometry->getIndexType(), (const void*)commands[i].mOffset));
+		}
+
+		Statistics::getCurrentFrame().mDrawCalls += static_cast<uint32_t>(mCommands.size());
+	}
+
+	uint32_t GpuCuller::getObjectCount() const
+	{
+		return static_cast<uint32_t>(mObjects.size());
+	}
+
+	uint32_t GpuCuller::getCommandCount() const
+	{
+		return static_cast<uint32_t>(mCommands.size());
+	}
+
+	std::vector<uint32_t> GpuCuller::readVisibleCounts()
+	{
+		std::vector<uint32_t> counts;
+		if (mCommandBuffer == nullptr || mIsLayoutDirty)
+		{
+			return counts;
+		}
+
+		std::size_t size = mCommands.size() * sizeof(DrawElementsIndirectCommand);
+		const DrawElementsIndirectCommand* records = static_cast<const DrawElementsIndirectCommand*>(mCommandBuffer->mapRange(GL_MAP_READ_BIT, 0, size));
+		if (records != nullptr)
+		{
+			for (std::size_t i = 0; i < mCommands.size(); i++)
+			{
+				counts.push_back(records[i].mInstanceCount);
+			}
+			mCommandBuffer->unMap();
+		}
+		return counts;
+	}
+
+	bool GpuCuller::isVisible(const GpuCullObject& object, const Frustum& frustum)
+	{
+		glm::vec3 center = glm::vec3(object.mModel * glm::vec4(glm::vec3(object.mCenter), 1.0f));
+		glm::mat3 axes = glm::mat3(object.mModel);
+		glm::vec3 extents = glm::abs(axes[0]) * object.mExtents.x + glm::abs(axes[1]) * object.mExtents.y + glm::abs(axes[2]) * object.mExtents.z;
+
+		for (const glm::vec4& plane : frustum.mPlanes)
+		{
+			glm::vec3 normal = glm::vec3(plane);
+			if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extents) < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint32_t GpuCuller::findCommand(const Mesh* mesh) const
+	{
+		for (std::size_t i = 0; i < mCommands.size(); i++)
+		{
+			const Mesh* first = mCommands[i].mMesh;
+			if (first->getGeometry() == mesh->getGeometry() && first->getMaterial() == mesh->getMaterial())
+			{
+				return static_cast<uint32_t>(i);
+			}
+		}
+		return kInvalidObject;
+	}
+
+	void GpuCuller::fillObject(const Mesh* mesh, GpuCullObject& object) const
+	{
+		InstanceData instance;
+		InstanceBatcher::packInstance(mesh, mesh->getMaterial()->getInstanceParameters(), instance);
+		object.mModel = instance.mModel;
+		object.mParams[0] = instance.mParams[0];
+		object.mParams[1] = instance.mParams[1];
+
+		const AABB& bounds = mesh->getGeometry()->getBounds();
+		if (bounds.isValid())
+		{
+			object.mCenter = glm::vec4(bounds.getCenter(), 1.0f);
+			object.mExtents = glm::vec4(bounds.getExtents(), 0.0f);
+		}
+		else
+		{
+			object.mCenter = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			object.mExtents = glm::vec4(glm::vec3(kUnboundedExtent), 0.0f);
+		}
+		object.mCommand = 0;
+		object.mPadding[0] = object.mPadding[1] = object.mPadding[2] = 0;
+	}
+
+	void GpuCuller::uploadLayout()
+	{
+		// instances of a command are contiguous, a command never writes past the objects it owns
+		std::vector<uint32_t> bases(mCommands.size());
+		uint32_t base = 0;
+		for (std::size_t i = 0; i < mCommands.size(); i++)
+		{
+			mCommands[i].mBase = base;
+			bases[i] = base;
+			base += mCommands[i].mObjectCount;
+		}
+
+		mObjectBuffer = Buffer::createWithData(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, mObjects.size() * sizeof(GpuCullObject), mObjects.data());
+		mBaseBuffer = Buffer::createWithData(GL_SHADER_STORAGE_BUFFER, GL_STATIC_DRAW, bases.size() * sizeof(uint32_t), bases.data());
+		mInstanceBuffer = InstanceBuffer::createWithData(GL_DYNAMIC_COPY, mObjects.size() * sizeof(InstanceData), nullptr);
+		mCommandBuffer = IndirectBuffer::createWithData(GL_DYNAMIC_COPY, mCommandRecords.size() * sizeof(DrawElementsIndirectCommand), mCommandRecords.data());
+		mCommandBuffer->setCommandLayout(static_cast<uint32_t>(mCommandRecords.size()), true);
+
+		mIsLayoutDirty = false;
+	}
+}
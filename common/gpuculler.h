@@ -0,0 +1,107 @@
+#ifndef GPU_CULLER_H_
+#define GPU_CULLER_H_
+
+#include <mesh.h>
+#include <instancing.h>
+#include <geometry.h>
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace es
+{
+	// one object as the culling shader reads it, std430 layout. the first 96 bytes are copied to the instance when visible
+	struct GpuCullObject
+	{
+		glm::mat4 mModel;
+		glm::vec4 mParams[2];
+		// object space box, an invalid box gets infinite extents and is never culled
+		glm::vec4 mCenter;
+		glm::vec4 mExtents;
+		uint32_t mCommand;
+		uint32_t mPadding[3];
+	};
+
+	// frustum culling on the gpu. a compute pass tests every object and appends the visible ones to the instances of the
+	// indirect command of their mesh, render then issues one glDrawElementsIndirect per unique mesh. nothing is read back,
+	// the cpu cost of a frame only depends on the objects that changed and the number of unique meshes
+	class GpuCuller
+	{
+	public:
+		static const uint32_t kInvalidObject = 0xFFFFFFFF;
+
+		// layout resources/shaders/common/gpu_culling.comp is written against
+		static const uint32_t kWorkGroupSize = 64;
+		static const GLuint kObjectBinding = 0;
+		static const GLuint kInstanceBinding = 1;
+		static const GLuint kCommandBinding = 2;
+		static const GLuint kBaseBinding = 3;
+
+		GpuCuller(const std::string& shaderPath);
+		~GpuCuller();
+
+		static std::unique_ptr<GpuCuller> create(const std::string& shaderPath);
+
+		// meshes with the same geometry and material share a command, the material needs instancing enabled and the draw type
+		// has to be ELEMENTS. the transform and instance parameters are read now, returns the object or kInvalidObject
+		uint32_t add(Mesh* mesh);
+
+		void clear();
+
+		// reads the transform and instance parameters of the object again before the next cull
+		void updateObject(uint32_t object);
+
+		// uploads what changed, resets the instance counts and runs the compute pass
+		void cull(const Frustum& frustum);
+
+		// draws the commands written by the last cull with the instanced programs of the materials
+		void render();
+
+		uint32_t getObjectCount() const;
+		uint32_t getCommandCount() const;
+
+		// instance count of every command after the last cull, waits for the gpu and is meant for debugging
+		std::vector<uint32_t> readVisibleCounts();
+
+		// the shader's test on the cpu, the reference its results are checked against
+		static bool isVisible(const GpuCullObject& object, const Frustum& frustum);
+	private:
+		struct Command
+		{
+			Mesh* mMesh;
+			uint32_t mObjectCount;
+			// first instance of the command in the instance buffer
+			uint32_t mBase;
+		};
+
+		uint32_t findCommand(const Mesh* mesh) const;
+
+		void fillObject(const Mesh* mesh, GpuCullObject& object) const;
+
+		// recreates the buffers after objects were added
+		void uploadLayout();
+
+		std::shared_ptr<Program> mProgram;
+
+		std::vector<Command> mCommands;
+		std::vector<Mesh*> mMeshes;
+		std::vector<GpuCullObject> mObjects;
+		std::vector<uint32_t> mDirtyObjects;
+
+		// commands with zero instances, copied over the written ones before every cull
+		std::vector<DrawElementsIndirectCommand> mCommandRecords;
+
+		std::shared_ptr<Buffer> mObjectBuffer;
+		std::shared_ptr<Buffer> mBaseBuffer;
+		std::shared_ptr<InstanceBuffer> mInstanceBuffer;
+		std::shared_ptr<IndirectBuffer> mCommandBuffer;
+
+		bool mIsLayoutDirty;
+	};
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include "indirectcommand.h"
+
+#include <cstring>
+
+namespace es
+{
+	IndirectCommandBuilder::IndirectCommandBuilder()
+	{
+
+	}
+
+	IndirectCommandBuilder::~IndirectCommandBuilder()
+	{
+
+	}
+
+	void IndirectCommandBuilder::clear()
+	{
+		mData.clear();
+		mCommands.clear();
+	}
+
+	std::size_t IndirectCommandBuilder::addElements(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t baseInstance)
+	{
+		DrawElementsIndirectCommand command = { indexCount, instanceCount, firstIndex, baseVertex, 0 };
+		return append(&command, sizeof(command), baseInstance, true);
+	}
+
+	std::size_t IndirectCommandBuilder::addArrays(uint32_t vertexCount, uint32_t instanceCount, uint32_t first, uint32_t baseInstance)
+	{
+		DrawArraysIndirectCommand command = { vertexCount, instanceCount, first, 0 };
+		return append(&command, sizeof(command), baseInstance, false);
+	}
+
+	const std::vector<uint8_t>& IndirectCommandBuilder::getData() const
+	{
+		return mData;
+	}
+
+	const std::vector<IndirectCommandInfo>& IndirectCommandBuilder::getCommands() const
+	{
+		return mCommands;
+	}
+
+	std::size_t IndirectCommandBuilder::append(const void* command, std::size_t size, uint32_t baseInstance, bool isIndexed)
+	{
+		// both records are made of 4 byte fields, every offset stays aligned the way the draw calls require
+		std::size_t offset = mData.size();
+		mData.resize(offset + size);
+		std::memcpy(mData.data() + offset, command, size);
+		mCommands.push_back({ offset, baseInstance, isIndexed });
+		return offset;
+	}
+}
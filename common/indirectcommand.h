@@ -0,0 +1,60 @@
+#ifndef INDIRECT_COMMAND_H_
+#define INDIRECT_COMMAND_H_
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace es
+{
+	// record layouts read by glDrawArraysIndirect and glDrawElementsIndirect. es 3.1 reserves the last field and requires it
+	// to be 0, the base instance is kept next to the buffer and applied by the draw instead
+	struct DrawArraysIndirectCommand
+	{
+		uint32_t mCount;
+		uint32_t mInstanceCount;
+		uint32_t mFirst;
+		uint32_t mReserved;
+	};
+
+	struct DrawElementsIndirectCommand
+	{
+		uint32_t mCount;
+		uint32_t mInstanceCount;
+		uint32_t mFirstIndex;
+		int32_t mBaseVertex;
+		uint32_t mReserved;
+	};
+
+	// where a command sits in an indirect buffer and what the gpu record cannot hold
+	struct IndirectCommandInfo
+	{
+		std::size_t mOffset;
+		uint32_t mBaseInstance;
+		bool mIsIndexed;
+	};
+
+	// packs indirect commands into the byte layout of an indirect buffer, touches no gl state
+	class IndirectCommandBuilder
+	{
+	public:
+		IndirectCommandBuilder();
+		~IndirectCommandBuilder();
+
+		void clear();
+
+		// return the byte offset of the command, the value glDrawElementsIndirect and glDrawArraysIndirect take
+		std::size_t addElements(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t baseVertex = 0, uint32_t baseInstance = 0);
+		std::size_t addArrays(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t first = 0, uint32_t baseInstance = 0);
+
+		const std::vector<uint8_t>& getData() const;
+		const std::vector<IndirectCommandInfo>& getCommands() const;
+	private:
+		std::size_t append(const void* command, std::size_t size, uint32_t baseInstance, bool isIndexed);
+
+		std::vector<uint8_t> mData;
+		std::vector<IndirectCommandInfo> mCommands;
+	};
+}
+
+#endif
@@ -0,0 +1,103 @@
+#include "instancing.h"
+
+#include <statistics.h>
+
+namespace es
+{
+	InstanceBatcher::InstanceBatcher()
+	{
+
+	}
+
+	InstanceBatcher::~InstanceBatcher()
+	{
+
+	}
+
+	bool InstanceBatcher::canBatch(const Mesh* first, const Mesh* mesh)
+	{
+		std::shared_ptr<Material> material = first->getMaterial();
+		if (material == nullptr || material->getInstancedProgram() == nullptr || material != mesh->getMaterial())
+		{
+			return false;
+		}
+
+		if (first->getGeometry() != mesh->getGeometry() || first->getDrawType() != mesh->getDrawType())
+		{
+			return false;
+		}
+
+		return first->getDrawType() == Mesh::DrawType::ELEMENTS || first->getDrawType() == Mesh::DrawType::ARRAYS;
+	}
+
+	void InstanceBatcher::draw(const std::vector<Mesh*>& meshes)
+	{
+		if (meshes.empty())
+		{
+			return;
+		}
+
+		Mesh* first = meshes[0];
+		std::shared_ptr<Material> material = first->getMaterial();
+		const std::vector<InstanceParameter>& parameters = material->getInstanceParameters();
+
+		mInstances.resize(meshes.size());
+		for (std::size_t i = 0; i < meshes.size(); i++)
+		{
+			Mesh* mesh = meshes[i];
+			if (mesh->isAutoUpdated())
+			{
+				mesh->update();
+			}
+
+			packInstance(mesh, parameters, mInstances[i]);
+		}
+
+		if (mBuffer == nullptr)
+		{
+			mBuffer = InstanceBuffer::createWithData(GL_DYNAMIC_DRAW, mInstances.size() * sizeof(InstanceData), mInstances.data());
+		}
+		else
+		{
+			mBuffer->setInstances(mInstances.data(), mInstances.size() * sizeof(InstanceData));
+		}
+
+		Program* program = material->getInstancedProgram().get();
+		material->applyInstanced();
+		first->applyUniforms(program);
+		Program::commitDrawParameters();
+
+		std::shared_ptr<const MeshGeometry> geometry = first->getGeometry();
+		VertexArray* vao = geometry->getVertexArray();
+		vao->attachInstanceBuffer(mBuffer.get(), kFirstLocation, kVec4Count);
+		vao->bind();
+
+		GLsizei count = static_cast<GLsizei>(meshes.size());
+		if (first->getDrawType() == Mesh::DrawType::ELEMENTS)
+		{
+			geometry->drawElements(GL_TRIANGLES, count);
+		}
+		else
+		{
+			geometry->drawArrays(GL_TRIANGLES, count);
+		}
+
+		FrameStatistics& statistics = Statistics::getCurrentFrame();
+		statistics.mDrawCalls++;
+		statistics.mInstancedDraws++;
+		statistics.mInstances += count;
+	}
+
+	void InstanceBatcher::packInstance(const Mesh* mesh, const std::vector<InstanceParameter>& parameters, InstanceData& instance)
+	{
+		instance.mModel = mesh->getModelMatrix();
+		instance.mParams[0] = glm::vec4(0.0f);
+		instance.mParams[1] = glm::vec4(0.0f);
+
+		float* params = &instance.mParams[0].x;
+		for (const InstanceParameter& parameter : parameters)
+		{
+			mesh->getUniformValue(parameter.mId, parameter.mType, params + parameter.mOffset);
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef INSTANCING_H_
+#define INSTANCING_H_
+
+#include <mesh.h>
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace es
+{
+	// per instance attributes, the model matrix at locations 8 to 11 and the material's instance parameters at 12 and 13
+	struct InstanceData
+	{
+		glm::mat4 mModel;
+		glm::vec4 mParams[2];
+	};
+
+	// draws meshes that share geometry and material with one instanced call through the material's ES_INSTANCED variant
+	class InstanceBatcher
+	{
+	public:
+		static const GLuint kFirstLocation = 8;
+		static const GLuint kVec4Count = sizeof(InstanceData) / sizeof(glm::vec4);
+
+		InstanceBatcher();
+		~InstanceBatcher();
+
+		// same geometry, same plain draw type and a material with instancing enabled
+		static bool canBatch(const Mesh* first, const Mesh* mesh);
+
+		// meshes have to pass canBatch with the first one. uniforms that are not instance parameters are taken from the first mesh
+		void draw(const std::vector<Mesh*>& meshes);
+
+		// model matrix and instance parameters of the mesh, parameters it never set are 0
+		static void packInstance(const Mesh* mesh, const std::vector<InstanceParameter>& parameters, InstanceData& instance);
+	private:
+		std::shared_ptr<InstanceBuffer> mBuffer;
+		std::vector<InstanceData> mInstances;
+	};
+}
+
+#endif
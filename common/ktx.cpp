@@ -0,0 +1,162 @@
+#include "ktx.h"
+
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+
+namespace es
+{
+	namespace
+	{
+		const uint8_t kIdentifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+		const uint32_t kEndianness = 0x04030201;
+		const char* kOrientationKey = "KTXorientation";
+
+		struct KTXHeader
+		{
+			uint8_t mIdentifier[12];
+			uint32_t mEndianness;
+			uint32_t mGLType;
+			uint32_t mGLTypeSize;
+			uint32_t mGLFormat;
+			uint32_t mGLInternalFormat;
+			uint32_t mGLBaseInternalFormat;
+			uint32_t mPixelWidth;
+			uint32_t mPixelHeight;
+			uint32_t mPixelDepth;
+			uint32_t mNumberOfArrayElements;
+			uint32_t mNumberOfFaces;
+			uint32_t mNumberOfMipmapLevels;
+			uint32_t mBytesOfKeyValueData;
+		};
+
+		uint32_t padTo4(uint32_t size)
+		{
+			return (size + 3) & ~3u;
+		}
+	}
+
+	// ----------------------------------------------------------------------------------------------------------------------------------------
+
+	bool KTX::read(const std::string& path, KTXImage& image)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+
+		KTXHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.mIdentifier, kIdentifier, sizeof(kIdentifier)) != 0)
+		{
+			return false;
+		}
+
+		// only compressed 2d textures in the native byte order are supported
+		if (header.mEndianness != kEndianness || header.mGLType != 0 || header.mGLFormat != 0 || header.mPixelDepth > 1 ||
+			header.mNumberOfArrayElements > 1 || header.mNumberOfFaces != 1 || header.mPixelWidth == 0 || header.mPixelHeight == 0)
+		{
+			return false;
+		}
+
+		image.mInternalFormat = header.mGLInternalFormat;
+		image.mBaseInternalFormat = header.mGLBaseInternalFormat;
+		image.mWidth = header.mPixelWidth;
+		image.mHeight = header.mPixelHeight;
+		image.mIsBottomUp = false;
+		image.mLevels.clear();
+
+		// the orientation is the only key we care about, the spec default is top down
+		std::vector<char> keyValueData(header.mBytesOfKeyValueData);
+		if (!keyValueData.empty() && !file.read(keyValueData.data(), keyValueData.size()))
+		{
+			return false;
+		}
+		for (std::size_t offset = 0; offset + sizeof(uint32_t) <= keyValueData.size();)
+		{
+			uint32_t keyAndValueSize;
+			std::memcpy(&keyAndValueSize, keyValueData.data() + offset, sizeof(uint32_t));
+			offset += sizeof(uint32_t);
+			if (offset + keyAndValueSize > keyValueData.size())
+			{
+				break;
+			}
+
+			std::string keyAndValue(keyValueData.data() + offset, keyAndValueSize);
+			std::size_t separator = keyAndValue.find('\0');
+			if (separator != std::string::npos && keyAndValue.compare(0, separator, kOrientationKey) == 0)
+			{
+				image.mIsBottomUp = keyAndValue.find("T=u", separator) != std::string::npos;
+			}
+			offset += padTo4(keyAndValueSize);
+		}
+
+		uint32_t levelCount = header.mNumberOfMipmapLevels == 0 ? 1 : header.mNumberOfMipmapLevels;
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			uint32_t imageSize;
+			if (!file.read(reinterpret_cast<char*>(&imageSize), sizeof(imageSize)))
+			{
+				return false;
+			}
+
+			MipLevel mip;
+			mip.mWidth = std::max(1u, image.mWidth >> level);
+			mip.mHeight = std::max(1u, image.mHeight >> level);
+			mip.mData.resize(imageSize);
+			if (!file.read(reinterpret_cast<char*>(mip.mData.data()), imageSize))
+			{
+				return false;
+			}
+			file.seekg(padTo4(imageSize) - imageSize, std::ios::cur);
+
+			image.mLevels.push_back(std::move(mip));
+		}
+
+		return true;
+	}
+
+	bool KTX::write(const std::string& path, const KTXImage& image)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file || image.mLevels.empty())
+		{
+			return false;
+		}
+
+		std::string orientation = std::string(kOrientationKey) + '\0' + (image.mIsBottomUp ? "S=r,T=u" : "S=r,T=d") + '\0';
+		uint32_t orientationSize = static_cast<uint32_t>(orientation.size());
+
+		KTXHeader header;
+		std::memcpy(header.mIdentifier, kIdentifier, sizeof(kIdentifier));
+		header.mEndianness = kEndianness;
+		header.mGLType = 0;
+		header.mGLTypeSize = 1;
+		header.mGLFormat = 0;
+		header.mGLInternalFormat = image.mInternalFormat;
+		header.mGLBaseInternalFormat = image.mBaseInternalFormat;
+		header.mPixelWidth = image.mWidth;
+		header.mPixelHeight = image.mHeight;
+		header.mPixelDepth = 0;
+		header.mNumberOfArrayElements = 0;
+		header.mNumberOfFaces = 1;
+		header.mNumberOfMipmapLevels = static_cast<uint32_t>(image.mLevels.size());
+		header.mBytesOfKeyValueData = sizeof(uint32_t) + padTo4(orientationSize);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		const char padding[4] = { 0, 0, 0, 0 };
+		file.write(reinterpret_cast<const char*>(&orientationSize), sizeof(orientationSize));
+		file.write(orientation.data(), orientationSize);
+		file.write(padding, padTo4(orientationSize) - orientationSize);
+
+		for (const MipLevel& level : image.mLevels)
+		{
+			uint32_t imageSize = static_cast<uint32_t>(level.mData.size());
+			file.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+			file.write(reinterpret_cast<const char*>(level.mData.data()), imageSize);
+			file.write(padding, padTo4(imageSize) - imageSize);
+		}
+
+		return static_cast<bool>(file);
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef KTX_H_
+#define KTX_H_
+
+#include <GLES3/gl3.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <mipmap.h>
+
+namespace es
+{
+	// a 2d texture stored in a khronos ktx 1.1 container, level 0 first
+	struct KTXImage
+	{
+		GLenum mInternalFormat = 0;
+		GLenum mBaseInternalFormat = 0;
+		uint32_t mWidth = 0;
+		uint32_t mHeight = 0;
+		// rows run from the bottom of the image up, the order glTexImage2D expects
+		bool mIsBottomUp = true;
+		std::vector<MipLevel> mLevels;
+	};
+
+	// reads and writes compressed 2d ktx files, no gl calls so it works on any thread and without a context
+	class KTX
+	{
+	public:
+		// false for missing files, big endian files and anything but a single compressed 2d texture
+		static bool read(const std::string& path, KTXImage& image);
+
+		static bool write(const std::string& path, const KTXImage& image);
+	};
+}
+
+#endif
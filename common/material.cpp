@@ -2,6 +2,23 @@
 
 namespace es
 {
+	namespace
+	{
+		constexpr UniformId kModelUniform("model");
+
+		const char* kInstancedDefine = "ES_INSTANCED";
+
+		// neutral values while the real texture is decoded, a flat tangent space normal for normal maps and white otherwise
+		uint32_t placeholderColor(const std::string& uniformName)
+		{
+			if (uniformName.compare(0, 10, "normalsMap") == 0)
+			{
+				return 0xFFFF8080;
+			}
+			return 0xFFFFFFFF;
+		}
+	}
+
 	std::unordered_map<std::string, std::shared_ptr<Material>> Material::mMaterialCache;
 
 	Material::Material(const std::string& name, const std::vector<std::string>& shaderFiles, const std::unordered_map<std::string, std::string>& textureFiles)
@@ -18,7 +35,7 @@ namespace es
 			{
 				if (iter->first == uniform->first)
 				{
-					std::shared_ptr<Texture2D> tex2d = Texture2D::createFromFile(iter->second, -1, false, false);
+					std::shared_ptr<Texture2D> tex2d = Texture2D::createFromFileAsync(iter->second, -1, false, false, placeholderColor(iter->first));
 
 					mProgram->setUniform(iter->first, location);
 					mTextureMap[std::make_pair(iter->first, location)] = tex2d;
@@ -27,6 +44,7 @@ namespace es
 			}
 		}
 
+		resolveTransformHandles();
 		mProgram->unapply();
 	}
 
@@ -51,6 +69,7 @@ namespace es
 			}
 		}
 
+		resolveTransformHandles();
 		mProgram->unapply();
 	}
 
@@ -68,7 +87,7 @@ namespace es
 			{
 				if (iter->first == uniform->first)
 				{
-					std::shared_ptr<Texture2D> tex2d = Texture2D::createFromFile(iter->second, -1, false, false);
+					std::shared_ptr<Texture2D> tex2d = Texture2D::createFromFileAsync(iter->second, -1, false, false, placeholderColor(iter->first));
 
 					mProgram->setUniform(iter->first, location);
 					mTextureMap[std::make_pair(iter->first, location)] = tex2d;
@@ -77,6 +96,7 @@ namespace es
 			}
 		}
 
+		resolveTransformHandles();
 		mProgram->unapply();
 	}
 
@@ -169,6 +189,26 @@ namespace es
 		return mProgram;
 	}
 
+	void Material::setTranslucent(bool isTranslucent)
+	{
+		mIsTranslucent = isTranslucent;
+	}
+
+	bool Material::isTranslucent() const
+	{
+		return mIsTranslucent;
+	}
+
+	void Material::setTransforms(const glm::mat4& model)
+	{
+		mProgram->setUniform(mModelHandle, model);
+	}
+
+	void Material::resolveTransformHandles()
+	{
+		mModelHandle = mProgram->getUniformHandle(kModelUniform);
+	}
+
 	void Material::setTexture(const std::string& name, std::shared_ptr<Texture> texture)
 	{
 		bool isExists = false;
@@ -186,6 +226,85 @@ namespace es
 			int location = static_cast<int>(mTextureMap.size());
 			mTextureMap[std::make_pair(name, location)] = texture;
 			mProgram->setUniform(name, location);
+			if (mInstancedProgram != nullptr)
+			{
+				mInstancedProgram->setUniform(name, location);
+			}
+		}
+	}
+
+	bool Material::enableInstancing(const std::vector<InstanceParameter>& parameters)
+	{
+		if (mInstancedProgram != nullptr)
+		{
+			return true;
+		}
+
+		// vectors must not straddle two attributes
+		std::vector<InstanceParameter> packed = parameters;
+		uint32_t offset = 0;
+		for (InstanceParameter& parameter : packed)
+		{
+			if (parameter.mType < UniformType::FLOAT || parameter.mType > UniformType::VEC4)
+			{
+				SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "material %s: instance parameters have to be float to vec4", mName.c_str());
+				return false;
+			}
+
+			uint32_t size = UniformBlock::getTypeSize(parameter.mType) / sizeof(float);
+			if (offset % 4 + size > 4)
+			{
+				offset = (offset + 3) / 4 * 4;
+			}
+			if (offset + size > 8)
+			{
+				SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "material %s: instance parameters do not fit in 8 floats", mName.c_str());
+				return false;
+			}
+			parameter.mOffset = offset;
+			offset += size;
+		}
+
+		std::shared_ptr<Program> program = mProgram->createVariant(kInstancedDefine);
+		if (program == nullptr || program->getID() == 0)
+		{
+			return false;
+		}
+
+		const std::unordered_map<std::string, GLuint>& attribMap = program->getAttribLocationMap();
+		if (attribMap.find("iModel") == attribMap.end())
+		{
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "material %s: shaders have no %s path, drawing without instancing", mName.c_str(), kInstancedDefine);
+			return false;
+		}
+
+		for (auto iter = mTextureMap.begin(); iter != mTextureMap.end(); iter++)
+		{
+			program->setUniform(iter->first.first, static_cast<int>(iter->first.second));
+		}
+
+		mInstancedProgram = program;
+		mInstanceParameters = packed;
+		return true;
+	}
+
+	std::shared_ptr<Program> Material::getInstancedProgram() const
+	{
+		return mInstancedProgram;
+	}
+
+	const std::vector<InstanceParameter>& Material::getInstanceParameters() const
+	{
+		return mInstanceParameters;
+	}
+
+	void Material::applyInstanced()
+	{
+		mInstancedProgram->apply();
+
+		for (auto iter = mTextureMap.begin(); iter != mTextureMap.end(); iter++)
+		{
+			iter->second->bind(iter->first.second);
 		}
 	}
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <ogles.h>
 #include <program.h>
 #include <texture.h>
+#include <uniformblock.h>
 
 #include <string>
 #include <fstream>
@@ -17,6 +18,15 @@
 
 namespace es
 {
+	// mesh uniform that becomes a per instance value when meshes are drawn instanced, mOffset is the float it starts at in
+	// the 8 floats of per instance params and is assigned by Material::enableInstancing, callers leave it out
+	struct InstanceParameter
+	{
+		UniformId mId;
+		UniformType mType;
+		uint32_t mOffset = 0;
+	};
+
 	class Material
 	{
 		struct PairHash
@@ -47,22 +57,68 @@ namespace es
 		std::shared_ptr<Program> getProgram() const;
 
 		template<typename T>
-		void setUniform(const std::string& name, const T& value)
+		void setUniform(UniformId id, const T& value)
 		{
 			if (mProgram != nullptr)
 			{
-				mProgram->setUniform(name, value);
+				mProgram->setUniform(id, value);
+			}
+			if (mInstancedProgram != nullptr)
+			{
+				mInstancedProgram->setUniform(id, value);
 			}
 		}
 
+		template<typename T>
+		void setUniform(UniformId id, const T* values, uint32_t count, uint32_t firstElement = 0)
+		{
+			if (mProgram != nullptr)
+			{
+				mProgram->setUniform(id, values, count, firstElement);
+			}
+			if (mInstancedProgram != nullptr)
+			{
+				mInstancedProgram->setUniform(id, values, count, firstElement);
+			}
+		}
+
+		// the model matrix through a handle resolved once when the material is created, view and projection come from the
+		// FrameParameters block
+		void setTransforms(const glm::mat4& model);
+
 		void setTexture(const std::string& name, std::shared_ptr<Texture> texture);
+
+		// translucent materials are drawn after the opaque ones and back to front by the RenderQueue
+		void setTranslucent(bool isTranslucent);
+		bool isTranslucent() const;
+
+		// compiles the shaders again with ES_INSTANCED defined, which reads the model matrix and the parameters from instance
+		// attributes. parameters are float to vec4 uniforms and have to fit in 8 floats. false when the program has no such variant,
+		// the material then keeps drawing mesh by mesh. call it before setting uniforms so the variant receives them as well
+		bool enableInstancing(const std::vector<InstanceParameter>& parameters = {});
+
+		// nullptr until enableInstancing succeeded
+		std::shared_ptr<Program> getInstancedProgram() const;
+		const std::vector<InstanceParameter>& getInstanceParameters() const;
+
+		// apply for the instanced variant, the model matrix comes from the instances
+		void applyInstanced();
 	private:
+		void resolveTransformHandles();
+
 		static std::unordered_map<std::string, std::shared_ptr<Material>> mMaterialCache;
 	
 		std::string mName;
 
 		std::shared_ptr<Program> mProgram;
 		std::unordered_map<std::pair<std::string, GLuint>, std::shared_ptr<Texture>, PairHash> mTextureMap;
+
+		UniformHandle mModelHandle;
+
+		bool mIsTranslucent = false;
+
+		std::shared_ptr<Program> mInstancedProgram = nullptr;
+		std::vector<InstanceParameter> mInstanceParameters;
 	};
 }
 
@@ -1,84 +1,366 @@
 #include "mesh.h"
 
+#include <statecache.h>
+#include <statistics.h>
+
 namespace es
 {
-	Mesh::Mesh(const std::string& name, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) : Object(name)
+	namespace
 	{
-		mVertices.assign(vertices.begin(), vertices.end());
-		mIndices.assign(indices.begin(), indices.end());
+		// GL_OES_draw_elements_base_vertex or its EXT twin, es 3.1 itself only has a base vertex in indirect commands
+		struct BaseVertexDraws
+		{
+			PFNGLDRAWELEMENTSBASEVERTEXOESPROC mDrawElements = nullptr;
+			PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXOESPROC mDrawElementsInstanced = nullptr;
+		};
 
-		mDefaultProgramUniformMap = std::make_shared<std::unordered_map<std::string, ProgramUniform>>();
+		// looked up on the first draw, a context is current by then
+		const BaseVertexDraws& getBaseVertexDraws()
+		{
+			static BaseVertexDraws draws;
+			static bool isLoaded = false;
+			if (!isLoaded)
+			{
+				isLoaded = true;
+				const char* suffix = SDL_GL_ExtensionSupported("GL_OES_draw_elements_base_vertex") ? "OES" :
+					SDL_GL_ExtensionSupported("GL_EXT_draw_elements_base_vertex") ? "EXT" : nullptr;
+				if (suffix != nullptr)
+				{
+					draws.mDrawElements = reinterpret_cast<PFNGLDRAWELEMENTSBASEVERTEXOESPROC>(
+						SDL_GL_GetProcAddress((std::string("glDrawElementsBaseVertex") + suffix).c_str()));
+					draws.mDrawElementsInstanced = reinterpret_cast<PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXOESPROC>(
+						SDL_GL_GetProcAddress((std::string("glDrawElementsInstancedBaseVertex") + suffix).c_str()));
+				}
+				if (draws.mDrawElements == nullptr || draws.mDrawElementsInstanced == nullptr)
+				{
+					draws = BaseVertexDraws();
+				}
+			}
+			return draws;
+		}
+	}
 
-		mDrawType = DrawType::ELEMENTS;
+	bool MeshGeometry::mIsArenaAllocation = false;
+	std::vector<DrawElementsIndirectCommand> MeshGeometry::mPreparedCommands;
+	std::size_t MeshGeometry::mPreparedOffset = 0;
+	std::size_t MeshGeometry::mNextPreparedCommand = 0;
+	uint64_t MeshGeometry::mPreparedSerial = 0;
+
+	MeshGeometry::MeshGeometry(const VertexFormat& format, const std::vector<uint8_t>& vertices, const std::vector<uint32_t>& indices, bool keepCPUData)
+		:mVertexFormat(format),
+		 mVertexCount(format.getVertexSize() > 0 ? static_cast<uint32_t>(vertices.size() / format.getVertexSize()) : 0),
+		 mIndexCount(static_cast<uint32_t>(indices.size())),
+		 mIndexType(ElementBuffer::selectIndexType(indices)),
+		 mHasCPUData(keepCPUData),
+		 mIsArenaAllocated(mIsArenaAllocation)
+	{
+		std::vector<uint8_t> packed = ElementBuffer::packIndices(indices, mIndexType);
+		createBuffers(vertices.data(), packed.data());
 
-		mVBO = VertexBuffer::createWithData(GL_STATIC_DRAW, sizeof(Vertex) * mVertices.size(), (void*)mVertices.data());
-		if (!mVBO)
+		computeBounds(vertices.data());
+
+		if (mHasCPUData)
 		{
-			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to create VBO");
+			mVertices.assign(vertices.begin(), vertices.end());
+			mIndices.assign(indices.begin(), indices.end());
 		}
+	}
 
-		mEBO = ElementBuffer::createWithData(GL_STATIC_DRAW, sizeof(uint32_t) * mIndices.size(), (void*)mIndices.data());
-		if (!mEBO)
+	MeshGeometry::MeshGeometry(const VertexFormat& format, const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, GLenum indexType)
+		:mVertexFormat(format),
+		 mVertexCount(vertexCount),
+		 mIndexCount(indexCount),
+		 mIndexType(indexType),
+		 mHasCPUData(false),
+		 mIsArenaAllocated(mIsArenaAllocation)
+	{
+		createBuffers(vertices, indices);
+
+		computeBounds(vertices);
+	}
+
+	MeshGeometry::~MeshGeometry()
+	{
+		if (mIsArenaAllocated)
 		{
-			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to create EBO");
+			GeometryArena::getArena()->release(mAllocation);
 		}
+		mVAO.reset();
+		mVAO = nullptr;
+		mVBO.reset();
+		mVBO = nullptr;
+		mEBO.reset();
+		mEBO = nullptr;
+	}
+
+	std::shared_ptr<const MeshGeometry> MeshGeometry::createWithData(const VertexFormat& format, const std::vector<uint8_t>& vertices, const std::vector<uint32_t>& indices, bool keepCPUData)
+	{
+		return std::make_shared<const MeshGeometry>(format, vertices, indices, keepCPUData);
+	}
 
-		std::vector<VertexAttrib> attribLayout = {};
+	std::shared_ptr<const MeshGeometry> MeshGeometry::createWithPackedData(const VertexFormat& format, const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, GLenum indexType)
+	{
+		return std::make_shared<const MeshGeometry>(format, vertices, vertexCount, indices, indexCount, indexType);
+	}
+
+	void MeshGeometry::setArenaAllocation(bool isEnabled)
+	{
+		mIsArenaAllocation = isEnabled;
+	}
+
+	bool MeshGeometry::isArenaAllocated() const
+	{
+		return mIsArenaAllocated;
+	}
+
+	const VertexFormat& MeshGeometry::getVertexFormat() const
+	{
+		return mVertexFormat;
+	}
+
+	uint32_t MeshGeometry::getVertexCount() const
+	{
+		return mVertexCount;
+	}
+
+	uint32_t MeshGeometry::getIndexCount() const
+	{
+		return mIndexCount;
+	}
+
+	GLenum MeshGeometry::getIndexType() const
+	{
+		return mIndexType;
+	}
+
+	VertexArray* MeshGeometry::getVertexArray() const
+	{
+		return mIsArenaAllocated ? GeometryArena::getArena()->getVertexArray(mAllocation) : mVAO.get();
+	}
+
+	VertexBuffer* MeshGeometry::getVertexBuffer() const
+	{
+		return mIsArenaAllocated ? GeometryArena::getArena()->getVertexBuffer(mAllocation) : mVBO.get();
+	}
+
+	ElementBuffer* MeshGeometry::getElementBuffer() const
+	{
+		return mIsArenaAllocated ? GeometryArena::getArena()->getElementBuffer(mAllocation) : mEBO.get();
+	}
+
+	uint32_t MeshGeometry::getBaseVertex() const
+	{
+		return mIsArenaAllocated ? GeometryArena::getArena()->getBaseVertex(mAllocation) : 0;
+	}
 
-		if (mVertices[0].vPosition.has_value())
+	uint32_t MeshGeometry::getFirstIndex() const
+	{
+		return mIsArenaAllocated ? GeometryArena::getArena()->getFirstIndex(mAllocation) : 0;
+	}
+
+	void MeshGeometry::drawElements(GLenum mode, uint32_t instanceCount) const
+	{
+		drawElementRange(mode, 0, mIndexCount, instanceCount);
+	}
+
+	void MeshGeometry::drawElementRange(GLenum mode, uint32_t firstIndex, uint32_t indexCount, uint32_t instanceCount) const
+	{
+		if (needsIndirectDraw())
 		{
-			attribLayout.push_back({ 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, vPosition) });
+			DrawElementsIndirectCommand command = getDrawCommand(firstIndex, indexCount, instanceCount);
+			StreamBuffer* stream = StreamBuffer::getCommandStream();
+			std::size_t offset = takePreparedCommand(command);
+			if (offset == StreamBuffer::kInvalidOffset)
+			{
+				offset = stream->write(&command, sizeof(command));
+			}
+			if (offset != StreamBuffer::kInvalidOffset)
+			{
+				stream->bind();
+				GLES_CHECK_ERROR(glDrawElementsIndirect(mode, mIndexType, (const void*)offset));
+			}
+			return;
 		}
-		if (mVertices[0].vTexcoord.has_value())
+
+		uint64_t offset = static_cast<uint64_t>(firstIndex + getFirstIndex()) * ElementBuffer::getIndexTypeSize(mIndexType);
+		GLint baseVertex = static_cast<GLint>(getBaseVertex());
+		if (baseVertex != 0)
 		{
-			attribLayout.push_back({ 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, vTexcoord) });
+			const BaseVertexDraws& draws = getBaseVertexDraws();
+			if (instanceCount == 1)
+			{
+				GLES_CHECK_ERROR(draws.mDrawElements(mode, indexCount, mIndexType, (const void*)offset, baseVertex));
+			}
+			else
+			{
+				GLES_CHECK_ERROR(draws.mDrawElementsInstanced(mode, indexCount, mIndexType, (const void*)offset, instanceCount, baseVertex));
+			}
 		}
-		if (mVertices[0].vNormal.has_value())
+		else if (instanceCount == 1)
 		{
-			attribLayout.push_back({ 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, vNormal) });
+			GLES_CHECK_ERROR(glDrawElements(mode, indexCount, mIndexType, (const void*)offset));
 		}
-		if (mVertices[0].vTangent.has_value())
+		else
 		{
-			attribLayout.push_back({ 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, vTangent) });
+			GLES_CHECK_ERROR(glDrawElementsInstanced(mode, indexCount, mIndexType, (const void*)offset, instanceCount));
 		}
-		if (mVertices[0].vBitangent.has_value())
+	}
+
+	void MeshGeometry::drawArrays(GLenum mode, uint32_t instanceCount) const
+	{
+		GLint first = static_cast<GLint>(getBaseVertex());
+		if (instanceCount == 1)
+		{
+			GLES_CHECK_ERROR(glDrawArrays(mode, first, mVertexCount));
+		}
+		else
+		{
+			GLES_CHECK_ERROR(glDrawArraysInstanced(mode, first, mVertexCount, instanceCount));
+		}
+	}
+
+	bool MeshGeometry::needsIndirectDraw() const
+	{
+		return getBaseVertex() != 0 && getBaseVertexDraws().mDrawElements == nullptr;
+	}
+
+	DrawElementsIndirectCommand MeshGeometry::getDrawCommand(uint32_t firstIndex, uint32_t indexCount, uint32_t instanceCount) const
+	{
+		return { indexCount, instanceCount, firstIndex + getFirstIndex(), static_cast<int32_t>(getBaseVertex()), 0 };
+	}
+
+	void MeshGeometry::prepareDrawCommands(const std::vector<DrawElementsIndirectCommand>& commands)
+	{
+		mPreparedCommands.assign(commands.begin(), commands.end());
+		mNextPreparedCommand = 0;
+		if (commands.empty())
 		{
-			attribLayout.push_back({ 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, vBitangent) });
+			return;
 		}
-		if (mVertices[0].vColor.has_value())
+
+		StreamBuffer* stream = StreamBuffer::getCommandStream();
+		mPreparedOffset = stream->write(commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand));
+		mPreparedSerial = stream->getSerial();
+		if (mPreparedOffset == StreamBuffer::kInvalidOffset)
 		{
-			attribLayout.push_back({ 4, GL_FLOAT, GL_FALSE, offsetof(Vertex, vColor) });
+			mPreparedCommands.clear();
+		}
+	}
+
+	std::size_t MeshGeometry::takePreparedCommand(const DrawElementsIndirectCommand& command)
+	{
+		// a draw that was not prepared streams its own command and leaves the rest in place, a new frame or a grown
+		// stream invalidates the prepared offsets
+		if (mNextPreparedCommand >= mPreparedCommands.size() || mPreparedSerial != StreamBuffer::getCommandStream()->getSerial() ||
+			std::memcmp(&mPreparedCommands[mNextPreparedCommand], &command, sizeof(command)) != 0)
+		{
+			return StreamBuffer::kInvalidOffset;
+		}
+		return mPreparedOffset + mNextPreparedCommand++ * sizeof(DrawElementsIndirectCommand);
+	}
+
+	bool MeshGeometry::hasCPUData() const
+	{
+		return mHasCPUData;
+	}
+
+	const std::vector<uint8_t>& MeshGeometry::getVertices() const
+	{
+		return mVertices;
+	}
+
+	const std::vector<uint32_t>& MeshGeometry::getIndices() const
+	{
+		return mIndices;
+	}
+
+	const AABB& MeshGeometry::getBounds() const
+	{
+		return mBounds;
+	}
+
+	const BoundingSphere& MeshGeometry::getBoundingSphere() const
+	{
+		return mBoundingSphere;
+	}
+
+	void MeshGeometry::createBuffers(const void* vertices, const void* indices)
+	{
+		if (mIsArenaAllocated)
+		{
+			mAllocation = GeometryArena::getArena()->allocate(mVertexFormat, vertices, mVertexCount, indices, mIndexCount, mIndexType);
+			if (mAllocation.isValid())
+			{
+				return;
+			}
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "geometry arena is out of space, the mesh gets buffers of its own");
+			mIsArenaAllocated = false;
+		}
+
+		mVBO = VertexBuffer::createWithData(GL_STATIC_DRAW, static_cast<std::size_t>(mVertexCount) * mVertexFormat.getVertexSize(), const_cast<void*>(vertices));
+		if (!mVBO)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to create VBO");
 		}
 
-		mVAO = VertexArray::createWithData(mVBO.get(), mEBO.get(), sizeof(Vertex), attribLayout);
+		mEBO = ElementBuffer::createWithData(GL_STATIC_DRAW, static_cast<std::size_t>(mIndexCount) * ElementBuffer::getIndexTypeSize(mIndexType), const_cast<void*>(indices), mIndexType);
+		if (!mEBO)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to create EBO");
+		}
+
+		mVAO = VertexArray::createWithData(mVBO.get(), mEBO.get(), mVertexFormat, mVertexCount);
 		if (!mVAO)
 		{
 			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to create VAO");
 		}
 	}
 
+	void MeshGeometry::computeBounds(const void* vertices)
+	{
+		const VertexAttrib* position = mVertexFormat.getAttrib(VertexSemantic::Position);
+		if (vertices == nullptr || position == nullptr || position->type != GL_FLOAT)
+		{
+			return;
+		}
+
+		const uint8_t* data = static_cast<const uint8_t*>(vertices) + mVertexFormat.getStreamOffset(position->stream, mVertexCount) + position->offset;
+		es::computeBounds(data, mVertexFormat.getStride(position->stream), position->numSubElements, mVertexCount, mBounds, mBoundingSphere);
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+
+	Mesh::Mesh(const std::string& name, std::shared_ptr<const MeshGeometry> geometry) : Object(name)
+	{
+		mGeometry = geometry;
+
+		mDefaultUniforms = std::make_shared<UniformBlock>();
+
+		mDrawType = DrawType::ELEMENTS;
+	}
+
 	Mesh::Mesh(const std::string& name, const Mesh* mesh) : Object(name)
 	{
 		mPosition = mesh->mPosition;
 		mRotation = mesh->mRotation;
 		mScaling = mesh->mScaling;
 		mModelMatrix = mesh->mModelMatrix;
+		mLocalMatrix = mesh->mLocalMatrix;
 		mAutoUpdated = mesh->mAutoUpdated;
 		mTransformUpdated = mesh->mTransformUpdated;
 		mIsDirty = mesh->mIsDirty;
 
-		mVertices.assign(mesh->mVertices.begin(), mesh->mVertices.end());
-		mIndices.assign(mesh->mIndices.begin(), mesh->mIndices.end());
-
-		mVAO = mesh->mVAO;
-		mVBO = mesh->mVBO;
-		mEBO = mesh->mEBO;
+		// clones only share the geometry handle, vertex and index data are never copied
+		mGeometry = mesh->mGeometry;
 		mIBO = mesh->mIBO;
 		mInstanceCount = mesh->mInstanceCount;
+		mInstanceComponents = mesh->mInstanceComponents;
+		mInstanceStride = mesh->mInstanceStride;
+		mIndirectBuffer = mesh->mIndirectBuffer;
 
 		mMaterial = mesh->mMaterial;
 		
-		mDefaultProgramUniformMap = mesh->mDefaultProgramUniformMap;
+		mDefaultUniforms = mesh->mDefaultUniforms;
 
 		mDrawType = mesh->mDrawType;
 	}
@@ -91,20 +373,24 @@ namespace es
 			mMaterial = nullptr;
 		}
 
-		mVertices.swap(std::vector<Vertex>());
-		mIndices.swap(std::vector<uint32_t>());
+		mGeometry.reset();
+		mGeometry = nullptr;
+	}
 
-		mVAO.reset();
-		mVAO = nullptr;
-		mVBO.reset();
-		mVBO = nullptr;
-		mEBO.reset();
-		mEBO = nullptr;
+	std::shared_ptr<Mesh> Mesh::createWithData(const std::string& name, const VertexFormat& format, const std::vector<uint8_t>& vertices, const std::vector<uint32_t>& indices, bool keepCPUData)
+	{
+		return std::make_shared<Mesh>(name, MeshGeometry::createWithData(format, vertices, indices, keepCPUData));
+	}
+
+	std::shared_ptr<Mesh> Mesh::createWithData(const std::string& name, const VertexFormat& format, const std::vector<float>& vertices, const std::vector<uint32_t>& indices, bool keepCPUData)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(vertices.data());
+		return createWithData(name, format, std::vector<uint8_t>(bytes, bytes + vertices.size() * sizeof(float)), indices, keepCPUData);
 	}
 
-	std::shared_ptr<Mesh> Mesh::createWithData(const std::string& name, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	std::shared_ptr<Mesh> Mesh::createWithGeometry(const std::string& name, std::shared_ptr<const MeshGeometry> geometry)
 	{
-		return std::make_shared<Mesh>(name, vertices, indices);
+		return std::make_shared<Mesh>(name, geometry);
 	}
 
 	std::shared_ptr<Mesh> Mesh::clone(const std::string& name, const Mesh* mesh)
@@ -126,82 +412,38 @@ namespace es
 		mDrawType = drawType;
 	}
 
-	void Mesh::render(bool isUseLocalMaterial)
+	Mesh::DrawType Mesh::getDrawType() const
 	{
-		if (mAutoUpdated)
-		{
-			update();
-		}
+		return mDrawType;
+	}
 
-		if (isUseLocalMaterial && mMaterial != nullptr)
+	void Mesh::setIndirectBuffer(std::shared_ptr<IndirectBuffer> buffer)
+	{
+		// the commands count vertices and indices from the start of the buffers, not from the arena range of the mesh
+		if (mGeometry->isArenaAllocated())
 		{
-			mMaterial->apply();
-			mMaterial->setUniform("model", mModelMatrix);
-			mMaterial->setUniform("view", camera->getView());
-			mMaterial->setUniform("projection", camera->getProjection());
-
-			// firstly, set default uniform value to program
-			for (auto iter = mDefaultProgramUniformMap->begin(); iter != mDefaultProgramUniformMap->end(); iter++)
-			{
-				if (iter->second.typeName == "int")
-				{
-					mMaterial->setUniform(iter->first, iter->second.uniformValue.intValue);
-				}
-				else if (iter->second.typeName == "float")
-				{
-					mMaterial->setUniform(iter->first, iter->second.uniformValue.floatValue);
-				}
-				else if (iter->second.typeName == "bool")
-				{
-					mMaterial->setUniform(iter->first, iter->second.uniformValue.boolValue);
-				}
-				else if (iter->second.typeName == "glm::vec3")
-				{
-					mMaterial->setUniform(iter->first, iter->second.uniformValue.vec3Value);
-				}
-				else if (iter->second.typeName == "glm::mat4")
-				{
-					mMaterial->setUniform(iter->first, iter->second.uniformValue.mat4Value);
-				}
-			}
-			
-			// secondly, if needed, set newer uniform value to program
-			for (auto iter = mProgramUniformMap.begin(); iter != mProgramUniformMap.end(); iter++)
-			{
-				if (iter->second.typeName == "int")
-				{
-					mMaterial->setUniform(iter->first, iter->second.uniformValue.intValue);
-				}
-				else if (iter->second.typeName == "float")
-				{
-					mMaterial->setUniform(iter->first, iter->second.uniformValue.floatValue);
-				}
-				else if (iter->second.typeName == "bool")
-				{
-					mMaterial->setUniform(iter->first, iter->second.uniformValue.boolValue);
-				}
-				else if (iter->second.typeName == "glm::vec3")
-				{
-					mMaterial->setUniform(iter->first, iter->second.uniformValue.vec3Value);
-				}
-				else if (iter->second.typeName == "glm::mat4")
-				{
-					mMaterial->setUniform(iter->first, iter->second.uniformValue.mat4Value);
-				}
-			}
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "mesh %s lives in the geometry arena, indirect commands need geometry of its own", mName.c_str());
+			return;
 		}
-		mVAO->bind();
+		mIndirectBuffer = buffer;
+	}
 
+	void Mesh::render(bool isUseLocalMaterial)
+	{
+		prepareDraw(isUseLocalMaterial);
+
+		uint32_t drawCalls = 1;
 		switch (mDrawType)
 		{
 			case DrawType::ARRAYS:
 			{
-				GLES_CHECK_ERROR(glDrawArrays(GL_TRIANGLES, 0, mVertices.size()));
+				mGeometry->drawArrays(GL_TRIANGLES);
 				break;
 			}
 			case DrawType::ARRAYS_INDIRECT:
 			{
-
+				drawCalls = drawIndirect(false);
+				break;
 			}
 			case DrawType::ARRAYS_INSTANCED:
 			{
@@ -209,32 +451,66 @@ namespace es
 			}
 			case DrawType::ELEMENTS:
 			{
-				GLES_CHECK_ERROR(glDrawElements(GL_TRIANGLES, mIndices.size(), GL_UNSIGNED_INT, 0));
+				mGeometry->drawElements(GL_TRIANGLES);
 				break;
 			}
 			case DrawType::ELEMENTS_INDIRECT:
 			{
-
+				drawCalls = drawIndirect(true);
+				break;
 			}
 			case DrawType::ELEMENTS_INSTANCED:
 			{
-				GLES_CHECK_ERROR(glDrawElementsInstanced(GL_TRIANGLES, mIndices.size(), GL_UNSIGNED_INT, 0, mInstanceCount.value()));
+				mGeometry->drawElements(GL_TRIANGLES, mInstanceCount.value());
 				break;
 			}
 			case DrawType::ELEMENTS_RESTART_INDEX:
 			{
-				GLES_CHECK_ERROR(glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX));
-				GLES_CHECK_ERROR(glDrawElements(GL_TRIANGLE_STRIP, mIndices.size(), GL_UNSIGNED_INT, 0));
-				GLES_CHECK_ERROR(glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX));
+				StateCache::enable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+				mGeometry->drawElements(GL_TRIANGLE_STRIP);
+				StateCache::disable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
 				break;
 			}
 		}
+		Statistics::getCurrentFrame().mDrawCalls += drawCalls;
+
+		// program, textures and vertex array stay bound, the next draw only changes what differs
+	}
+
+	void Mesh::renderRanges(const std::vector<std::pair<uint32_t, uint32_t>>& ranges, bool isUseLocalMaterial)
+	{
+		if (mDrawType != DrawType::ELEMENTS)
+		{
+			render(isUseLocalMaterial);
+			return;
+		}
+
+		prepareDraw(isUseLocalMaterial);
+		for (const std::pair<uint32_t, uint32_t>& range : ranges)
+		{
+			mGeometry->drawElementRange(GL_TRIANGLES, range.first, range.second);
+		}
+		Statistics::getCurrentFrame().mDrawCalls += static_cast<uint32_t>(ranges.size());
+	}
+
+	void Mesh::prepareDraw(bool isUseLocalMaterial)
+	{
+		if (mAutoUpdated)
+		{
+			update();
+		}
 
-		mVAO->unbind();
 		if (isUseLocalMaterial && mMaterial != nullptr)
 		{
-			mMaterial->unapply();
+			mMaterial->apply();
+			mMaterial->setTransforms(mModelMatrix);
+
+			applyUniforms(mMaterial->getProgram().get());
 		}
+		Program::commitDrawParameters();
+
+		VertexArray* vao = mGeometry->getVertexArray();
+		vao->bind();
 	}
 
 	void Mesh::update()
@@ -242,84 +518,101 @@ namespace es
 		Object::update();
 	}
 
-	std::shared_ptr<Material> Mesh::getMaterial() const
+	uint32_t Mesh::drawIndirect(bool isIndexed)
 	{
-		return mMaterial;
-	}
+		if (mIndirectBuffer == nullptr)
+		{
+			return 0;
+		}
 
-	void Mesh::setUniform(const std::string& name, const int& value)
-	{
-		ProgramUniform proUni;
-		ProgramUniform defaultProUni;
+		mIndirectBuffer->bind();
 
-		proUni.typeName = "int";
-		proUni.uniformValue.intValue = value;
+		uint32_t drawCalls = 0;
+		for (const IndirectCommandInfo& command : mIndirectBuffer->getCommands())
+		{
+			if (command.mIsIndexed != isIndexed)
+			{
+				continue;
+			}
+
+			bool isOffset = command.mBaseInstance != 0 && mIBO.has_value();
+			if (isOffset)
+			{
+				setInstanceOffset(command.mBaseInstance);
+			}
 
-		defaultProUni.typeName = "int";
-		defaultProUni.uniformValue.intValue = 1;
+			if (isIndexed)
+			{
+				GLES_CHECK_ERROR(glDrawElementsIndirect(GL_TRIANGLES, mGeometry->getIndexType(), (const void*)command.mOffset));
+			}
+			else
+			{
+				GLES_CHECK_ERROR(glDrawArraysIndirect(GL_TRIANGLES, (const void*)command.mOffset));
+			}
+			drawCalls++;
 
-		mProgramUniformMap[name] = proUni;
-		(*mDefaultProgramUniformMap)[name] = defaultProUni;
+			if (isOffset)
+			{
+				setInstanceOffset(0);
+			}
+		}
+		return drawCalls;
 	}
 
-	void Mesh::setUniform(const std::string& name, const float& value)
+	void Mesh::setInstanceOffset(uint32_t baseInstance)
 	{
-		ProgramUniform proUni;
-		ProgramUniform defaultProUni;
-
-		proUni.typeName = "float";
-		proUni.uniformValue.floatValue = value;
-
-		defaultProUni.typeName = "float";
-		defaultProUni.uniformValue.floatValue = 1;
-
-		mProgramUniformMap[name] = proUni;
-		(*mDefaultProgramUniformMap)[name] = defaultProUni;
+		// the vertex array is bound by render
+		GLuint location = mGeometry->getVertexArray()->getVertexAttribCount();
+		uint64_t offset = static_cast<uint64_t>(baseInstance) * mInstanceStride;
+		mIBO.value()->bind();
+		GLES_CHECK_ERROR(glVertexAttribPointer(location, mInstanceComponents, GL_FLOAT, GL_FALSE, mInstanceStride, (void*)offset));
 	}
 
-	void Mesh::setUniform(const std::string& name, const bool& value)
+	bool Mesh::getUniformValue(UniformId id, UniformType type, void* out) const
 	{
-		ProgramUniform proUni;
-		ProgramUniform defaultProUni;
-
-		proUni.typeName = "bool";
-		proUni.uniformValue.boolValue = value;
-
-		defaultProUni.typeName = "bool";
-		defaultProUni.uniformValue.boolValue = false;
-
-		mProgramUniformMap[name] = proUni;
-		(*mDefaultProgramUniformMap)[name] = defaultProUni;
+		return mUniforms.read(id, type, out) || mDefaultUniforms->read(id, type, out);
 	}
 
-	void Mesh::setUniform(const std::string& name, const glm::vec3& value)
+	void Mesh::applyUniforms(Program* program)
 	{
-		ProgramUniform proUni;
-		ProgramUniform defaultProUni;
+		// defaults first, then the values of this mesh, clean entries are not uploaded again
+		mDefaultUniforms->applyMissing(program, mUniforms);
+		mUniforms.apply(program);
+	}
 
-		proUni.typeName = "glm::vec3";
-		proUni.uniformValue.vec3Value = value;
+	std::shared_ptr<Material> Mesh::getMaterial() const
+	{
+		return mMaterial;
+	}
 
-		defaultProUni.typeName = "glm::vec3";
-		defaultProUni.uniformValue.vec3Value = glm::vec3(0.0f);
+	std::shared_ptr<const MeshGeometry> Mesh::getGeometry() const
+	{
+		return mGeometry;
+	}
 
-		mProgramUniformMap[name] = proUni;
-		(*mDefaultProgramUniformMap)[name] = defaultProUni;
+	const VertexFormat& Mesh::getVertexFormat() const
+	{
+		return mGeometry->getVertexFormat();
 	}
 
-	void Mesh::setUniform(const std::string& name, const glm::mat4& value)
+	uint32_t Mesh::getVertexCount() const
 	{
-		ProgramUniform proUni;
-		ProgramUniform defaultProUni;
+		return mGeometry->getVertexCount();
+	}
 
-		proUni.typeName = "glm::mat4";
-		proUni.uniformValue.mat4Value = value;
+	uint32_t Mesh::getIndexCount() const
+	{
+		return mGeometry->getIndexCount();
+	}
 
-		defaultProUni.typeName = "glm::mat4";
-		defaultProUni.uniformValue.mat4Value = glm::mat4(1.0f);
+	AABB Mesh::getWorldBounds() const
+	{
+		return mGeometry->getBounds().transform(mModelMatrix);
+	}
 
-		mProgramUniformMap[name] = proUni;
-		(*mDefaultProgramUniformMap)[name] = defaultProUni;
+	BoundingSphere Mesh::getWorldBoundingSphere() const
+	{
+		return mGeometry->getBoundingSphere().transform(mModelMatrix);
 	}
 
 	void Mesh::setTexture(const std::string& name, std::shared_ptr<Texture> texture)
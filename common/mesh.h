@@ -13,50 +13,114 @@
 #include <object.h>
 #include <buffer.h>
 #include <material.h>
+#include <uniformblock.h>
+#include <geometry.h>
 
 namespace es
 {
-	// unique program uniform in every single mesh
-	struct ProgramUniform
+	// immutable gpu geometry, shared by a mesh and all of its clones
+	class MeshGeometry
 	{
-		std::string typeName;
+	public:
+		MeshGeometry(const VertexFormat& format, const std::vector<uint8_t>& vertices, const std::vector<uint32_t>& indices, bool keepCPUData);
+		MeshGeometry(const VertexFormat& format, const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, GLenum indexType);
+		~MeshGeometry();
 
-		union UniformValue
-		{
-			int intValue;
-			bool boolValue;
-			float floatValue;
-			glm::vec2 vec2Value;
-			glm::vec3 vec3Value;
-			glm::vec4 vec4Value;
-			glm::mat2 mat2Value;
-			glm::mat3 mat3Value;
-			glm::mat4 mat4Value;
-			/*
-			std::vector<int> intVecValue;
-			std::vector<bool> boolVecValue;
-			std::vector<float> floatVecValue;
-			std::vector<glm::vec2> vec2VecValue;
-			std::vector<glm::vec3> vec3VecValue;
-			std::vector<glm::vec4> vec4VecValue;
-			std::vector<glm::mat2> mat2VecValue;
-			std::vector<glm::mat3> mat3VecValue;
-			std::vector<glm::mat4> mat4VecValue;
-			*/
-		} uniformValue;
-	};
+		static std::shared_ptr<const MeshGeometry> createWithData(const VertexFormat& format, const std::vector<uint8_t>& vertices, const std::vector<uint32_t>& indices, bool keepCPUData = false);
 
-	// vertex attribute structure
-	struct Vertex
-	{
-		std::optional<glm::vec3> vPosition;
-		std::optional<glm::vec2> vTexcoord;
-		std::optional<glm::vec3> vNormal;
-		std::optional<glm::vec3> vTangent;
-		std::optional<glm::vec3> vBitangent;
-		std::optional<glm::vec4> vColor;
+		// uploads vertices and already packed indices straight from memory, e.g. a mapped mesh cache, no cpu copies are kept
+		static std::shared_ptr<const MeshGeometry> createWithPackedData(const VertexFormat& format, const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, GLenum indexType);
+
+		// geometry created while enabled is sub-allocated from the geometry arena and shares its vertex array with every mesh
+		// of the same vertex format and index type. meshes that attach their own instance attributes or draw their own
+		// indirect commands need buffers of their own
+		static void setArenaAllocation(bool isEnabled);
+
+		// false when the arena was off or could not take the geometry and it got buffers of its own
+		bool isArenaAllocated() const;
+
+		const VertexFormat& getVertexFormat() const;
+		uint32_t getVertexCount() const;
+		uint32_t getIndexCount() const;
+		// type picked by ElementBuffer::selectIndexType for the largest index value, GL_UNSIGNED_SHORT unless one reaches 0xFFFF
+		GLenum getIndexType() const;
+
+		VertexArray* getVertexArray() const;
+		VertexBuffer* getVertexBuffer() const;
+		ElementBuffer* getElementBuffer() const;
+
+		// where the geometry starts in its buffers, 0 unless it lives in the geometry arena
+		uint32_t getBaseVertex() const;
+		uint32_t getFirstIndex() const;
+
+		// draw all vertices or indices with the vertex array bound. arena geometry with a base vertex uses
+		// GL_OES/EXT_draw_elements_base_vertex when the context has it, otherwise a streamed indirect command
+		void drawElements(GLenum mode, uint32_t instanceCount = 1) const;
+		void drawArrays(GLenum mode, uint32_t instanceCount = 1) const;
+
+		// draws indexCount indices from firstIndex on, counted from the start of this geometry's indices
+		void drawElementRange(GLenum mode, uint32_t firstIndex, uint32_t indexCount, uint32_t instanceCount = 1) const;
+
+		// true when element draws take the indirect command path, and the command such a draw streams
+		bool needsIndirectDraw() const;
+		DrawElementsIndirectCommand getDrawCommand(uint32_t firstIndex, uint32_t indexCount, uint32_t instanceCount) const;
+
+		// writes the commands of the next draws in one go, e.g. everything a RenderQueue flush draws. a draw whose command is
+		// the next prepared one uses it instead of streaming its own, an empty list drops what is left
+		static void prepareDrawCommands(const std::vector<DrawElementsIndirectCommand>& commands);
+
+		// cpu copies are only available when requested at creation
+		bool hasCPUData() const;
+		const std::vector<uint8_t>& getVertices() const;
+		const std::vector<uint32_t>& getIndices() const;
+
+		// object space volumes over all vertices, computed once at creation
+		const AABB& getBounds() const;
+		const BoundingSphere& getBoundingSphere() const;
+
+		MeshGeometry(const MeshGeometry&) = delete;
+		const MeshGeometry& operator=(const MeshGeometry&) = delete;
+	private:
+		// sub-allocates from the geometry arena when enabled and falls back to buffers of its own when that fails
+		void createBuffers(const void* vertices, const void* indices);
+
+		// reads the float positions of tightly packed vertex data, other position types leave the volumes invalid so nothing is culled
+		void computeBounds(const void* vertices);
+
+		// stream offset of the prepared command when it matches, StreamBuffer::kInvalidOffset otherwise
+		static std::size_t takePreparedCommand(const DrawElementsIndirectCommand& command);
+
+		AABB mBounds;
+		BoundingSphere mBoundingSphere;
+
+		VertexFormat mVertexFormat;
+		uint32_t mVertexCount;
+		uint32_t mIndexCount;
+		GLenum mIndexType;
+
+		bool mHasCPUData;
+		std::vector<uint8_t> mVertices;
+		std::vector<uint32_t> mIndices;
+
+		// vertex array object
+		std::shared_ptr<VertexArray> mVAO = nullptr;
+		// vertex buffer object
+		std::shared_ptr<VertexBuffer> mVBO = nullptr;
+		// element buffer object
+		std::shared_ptr<ElementBuffer> mEBO = nullptr;
+
+		// replaces the three buffers above when the arena is used
+		GeometryArena::Allocation mAllocation;
+		bool mIsArenaAllocated;
+
+		static bool mIsArenaAllocation;
+
+		static std::vector<DrawElementsIndirectCommand> mPreparedCommands;
+		static std::size_t mPreparedOffset;
+		static std::size_t mNextPreparedCommand;
+		static uint64_t mPreparedSerial;
 	};
-	
+
 	class Mesh : public Object
 	{
 	public:
@@ -71,11 +135,16 @@ namespace es
 			ELEMENTS_RESTART_INDEX
 		};
 
-		Mesh(const std::string& name, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+		Mesh(const std::string& name, std::shared_ptr<const MeshGeometry> geometry);
 		Mesh(const std::string& name, const Mesh* mesh);
 		~Mesh();
 
-		static std::shared_ptr<Mesh> createWithData(const std::string& name, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+		// vertices are tightly packed as described by format, cpu copies are dropped after upload unless keepCPUData is set
+		static std::shared_ptr<Mesh> createWithData(const std::string& name, const VertexFormat& format, const std::vector<uint8_t>& vertices, const std::vector<uint32_t>& indices, bool keepCPUData = false);
+
+		static std::shared_ptr<Mesh> createWithData(const std::string& name, const VertexFormat& format, const std::vector<float>& vertices, const std::vector<uint32_t>& indices, bool keepCPUData = false);
+
+		static std::shared_ptr<Mesh> createWithGeometry(const std::string& name, std::shared_ptr<const MeshGeometry> geometry);
 	
 		static std::shared_ptr<Mesh> clone(const std::string& name, const Mesh* mesh);
 
@@ -83,9 +152,18 @@ namespace es
 
 		void setDrawType(DrawType drawType);
 
+		DrawType getDrawType() const;
+
 		template<typename T>
 		void setInstancingData(uint64_t size, void* data, uint32_t count)
 		{
+			// the attribute would be set on the vertex array every mesh of the arena pool shares
+			if (mGeometry->isArenaAllocated())
+			{
+				SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "mesh %s lives in the geometry arena, instancing data needs geometry of its own", mName.c_str());
+				return;
+			}
+
 			if (mIBO.has_value())
 			{
 				mIBO.value().reset();
@@ -93,50 +171,86 @@ namespace es
 			mIBO = InstanceBuffer::createWithData(GL_STATIC_DRAW, size, data);
 			mInstanceCount = count;
 
-			mVAO->bind();
+			VertexArray* vao = mGeometry->getVertexArray();
+			vao->bind();
 			mIBO.value()->bind();
 
-			glVertexAttribPointer(mVAO->getVertexAttribCount(), size / count / sizeof(T), GL_FLOAT, GL_FALSE, size / count, (void*)0);
-			glEnableVertexAttribArray(mVAO->getVertexAttribCount());
-			glVertexAttribDivisor(mVAO->getVertexAttribCount(), 1);
+			mInstanceComponents = static_cast<GLint>(size / count / sizeof(T));
+			mInstanceStride = static_cast<GLsizei>(size / count);
+			glVertexAttribPointer(vao->getVertexAttribCount(), mInstanceComponents, GL_FLOAT, GL_FALSE, mInstanceStride, (void*)0);
+			glEnableVertexAttribArray(vao->getVertexAttribCount());
+			glVertexAttribDivisor(vao->getVertexAttribCount(), 1);
 
 			mIBO.value()->unbind();
-			mVAO->bind();
+			vao->unbind();
 		}
 
+		// commands drawn by the ARRAYS_INDIRECT and ELEMENTS_INDIRECT draw types, commands of the other kind are skipped
+		void setIndirectBuffer(std::shared_ptr<IndirectBuffer> buffer);
+
 		void render(bool isUseLocalMaterial = true);
 
+		// draws parts of the index buffer with one material setup, one draw per (first index, index count) pair. meshes
+		// of other draw types than ELEMENTS are drawn whole
+		void renderRanges(const std::vector<std::pair<uint32_t, uint32_t>>& ranges, bool isUseLocalMaterial = true);
+
 		virtual void update() override;
 
 		std::shared_ptr<Material> getMaterial() const;
 
-		void setUniform(const std::string& name, const int& value);
-		void setUniform(const std::string& name, const float& value);
-		void setUniform(const std::string& name, const bool& value);
-		void setUniform(const std::string& name, const glm::vec3& value);
-		void setUniform(const std::string& name, const glm::mat4& value);
+		std::shared_ptr<const MeshGeometry> getGeometry() const;
+
+		const VertexFormat& getVertexFormat() const;
+
+		uint32_t getVertexCount() const;
+
+		uint32_t getIndexCount() const;
+
+		// geometry volumes moved by the model matrix
+		virtual AABB getWorldBounds() const override;
+		BoundingSphere getWorldBoundingSphere() const;
+
+		// clones that never set the uniform get UniformBlock::getDefault instead of the value another clone left in the program
+		template<typename T>
+		void setUniform(UniformId id, const T& value)
+		{
+			mUniforms.set(id, value);
+			mDefaultUniforms->set(id, UniformBlock::getDefault<T>());
+		}
 
 		void setTexture(const std::string& name, std::shared_ptr<Texture> texture);
+
+		// value the uniform has for this mesh, its own first and the shared default otherwise
+		bool getUniformValue(UniformId id, UniformType type, void* out) const;
+
+		// uploads the defaults and the uniforms of this mesh to the program
+		void applyUniforms(Program* program);
 	private:
-		std::vector<Vertex> mVertices;
-		std::vector<uint32_t> mIndices;
+		// updates the transform, applies the material and binds the vertex array
+		void prepareDraw(bool isUseLocalMaterial);
+
+		// returns the number of commands drawn
+		uint32_t drawIndirect(bool isIndexed);
+
+		// moves the instance attribute to the given first instance, es 3.1 indirect draws cannot offset instances themselves
+		void setInstanceOffset(uint32_t baseInstance);
+
+		std::shared_ptr<const MeshGeometry> mGeometry = nullptr;
 
-		// vertex array object
-		std::shared_ptr<VertexArray> mVAO = nullptr;
-		// vertex buffer object
-		std::shared_ptr<VertexBuffer> mVBO = nullptr;
-		// element buffer object
-		std::shared_ptr<ElementBuffer> mEBO = nullptr;
 		// instance buffer object
 		std::optional<std::shared_ptr<InstanceBuffer>> mIBO = std::nullopt;
 		std::optional<uint32_t> mInstanceCount = std::nullopt;
+		GLint mInstanceComponents = 0;
+		GLsizei mInstanceStride = 0;
+
+		std::shared_ptr<IndirectBuffer> mIndirectBuffer = nullptr;
 		
 		std::shared_ptr<Material> mMaterial = nullptr;
 
-		// storage default value in unordered_map
-		std::shared_ptr<std::unordered_map<std::string, ProgramUniform>> mDefaultProgramUniformMap;
+		// defaults are shared with all clones
+		std::shared_ptr<UniformBlock> mDefaultUniforms;
 
-		std::unordered_map<std::string, ProgramUniform> mProgramUniformMap;
+		UniformBlock mUniforms;
 
 		DrawType mDrawType;
 	};
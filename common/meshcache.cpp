@@ -0,0 +1,527 @@
+#include "meshcache.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace es
+{
+	namespace
+	{
+		const char kMagic[4] = { 'E', 'S', 'M', 'C' };
+
+		// every blob starts at a multiple of this, so vertex and index data can be read in place
+		const std::size_t kBlobAlignment = 16;
+
+		class CacheWriter
+		{
+		public:
+			void writeU32(uint32_t value)
+			{
+				writeBytes(&value, sizeof(value));
+			}
+
+			void writeU64(uint64_t value)
+			{
+				writeBytes(&value, sizeof(value));
+			}
+
+			void writeFloat(float value)
+			{
+				writeBytes(&value, sizeof(value));
+			}
+
+			void writeString(const std::string& value)
+			{
+				writeU32(static_cast<uint32_t>(value.size()));
+				writeBytes(value.data(), value.size());
+			}
+
+			void writeBlob(const void* data, std::size_t size)
+			{
+				mBuffer.resize((mBuffer.size() + kBlobAlignment - 1) / kBlobAlignment * kBlobAlignment, 0);
+				writeBytes(data, size);
+			}
+
+			void writeBytes(const void* data, std::size_t size)
+			{
+				const uint8_t* bytes = static_cast<const uint8_t*>(data);
+				mBuffer.insert(mBuffer.end(), bytes, bytes + size);
+			}
+
+			const std::vector<uint8_t>& getBuffer() const
+			{
+				return mBuffer;
+			}
+		private:
+			std::vector<uint8_t> mBuffer;
+		};
+
+		class CacheReader
+		{
+		public:
+			CacheReader(const uint8_t* data, std::size_t size) : mData(data), mSize(size), mOffset(0), mValid(true)
+			{
+			}
+
+			uint32_t readU32()
+			{
+				uint32_t value = 0;
+				readBytes(&value, sizeof(value));
+				return value;
+			}
+
+			uint64_t readU64()
+			{
+				uint64_t value = 0;
+				readBytes(&value, sizeof(value));
+				return value;
+			}
+
+			float readFloat()
+			{
+				float value = 0.0f;
+				readBytes(&value, sizeof(value));
+				return value;
+			}
+
+			std::string readString()
+			{
+				uint32_t length = readU32();
+				if (!check(length))
+				{
+					return "";
+				}
+				std::string value(reinterpret_cast<const char*>(mData + mOffset), length);
+				mOffset += length;
+				return value;
+			}
+
+			const void* readBlob(std::size_t size)
+			{
+				mOffset = (mOffset + kBlobAlignment - 1) / kBlobAlignment * kBlobAlignment;
+				if (!check(size))
+				{
+					return nullptr;
+				}
+				const void* blob = mData + mOffset;
+				mOffset += size;
+				return blob;
+			}
+
+			void readBytes(void* out, std::size_t size)
+			{
+				if (check(size))
+				{
+					std::memcpy(out, mData + mOffset, size);
+					mOffset += size;
+				}
+			}
+
+			bool isValid() const
+			{
+				return mValid;
+			}
+		private:
+			bool check(std::size_t size)
+			{
+				if (!mValid || mOffset > mSize || size > mSize - mOffset)
+				{
+					mValid = false;
+				}
+				return mValid;
+			}
+
+			const uint8_t* mData;
+			std::size_t mSize;
+			std::size_t mOffset;
+			bool mValid;
+		};
+
+		// true when every index but the primitive restart value of the type addresses one of the vertices
+		template<typename T>
+		bool checkIndices(const void* indices, uint32_t indexCount, uint32_t vertexCount)
+		{
+			const T* values = static_cast<const T*>(indices);
+			const T restart = std::numeric_limits<T>::max();
+			for (uint32_t i = 0; i < indexCount; i++)
+			{
+				if (values[i] != restart && values[i] >= vertexCount)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool checkIndices(const void* indices, uint32_t indexCount, GLenum indexType, uint32_t vertexCount)
+		{
+			switch (indexType)
+			{
+				case GL_UNSIGNED_BYTE:
+				{
+					return checkIndices<uint8_t>(indices, indexCount, vertexCount);
+				}
+				case GL_UNSIGNED_SHORT:
+				{
+					return checkIndices<uint16_t>(indices, indexCount, vertexCount);
+				}
+				default:
+				{
+					return checkIndices<uint32_t>(indices, indexCount, vertexCount);
+				}
+			}
+		}
+
+		const uint8_t* mapFile(const std::string& path, std::size_t& size)
+		{
+#ifdef WIN32
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				return nullptr;
+			}
+
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+			{
+				CloseHandle(file);
+				return nullptr;
+			}
+
+			// the view keeps the mapping alive, both handles can be closed right away
+			HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			CloseHandle(file);
+			if (mapping == nullptr)
+			{
+				return nullptr;
+			}
+
+			void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+			if (view == nullptr)
+			{
+				return nullptr;
+			}
+
+			size = static_cast<std::size_t>(fileSize.QuadPart);
+			return static_cast<const uint8_t*>(view);
+#else
+			int descriptor = ::open(path.c_str(), O_RDONLY);
+			if (descriptor < 0)
+			{
+				return nullptr;
+			}
+
+			struct stat info;
+			if (fstat(descriptor, &info) != 0 || info.st_size == 0)
+			{
+				::close(descriptor);
+				return nullptr;
+			}
+
+			void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+			::close(descriptor);
+			if (view == MAP_FAILED)
+			{
+				return nullptr;
+			}
+
+			size = static_cast<std::size_t>(info.st_size);
+			return static_cast<const uint8_t*>(view);
+#endif
+		}
+
+		void unmapFile(const uint8_t* data, std::size_t size)
+		{
+#ifdef WIN32
+			UnmapViewOfFile(data);
+#else
+			munmap(const_cast<uint8_t*>(data), size);
+#endif
+		}
+	}
+
+	// ----------------------------------------------------------------------------------------------------------------------------------------
+
+	MeshCache::Entry MeshCache::Entry::fromData(const MeshData& data)
+	{
+		Entry entry;
+		entry.mName = data.mName;
+		entry.mFormat = data.mFormat;
+		entry.mVertices = data.mVertices.data();
+		entry.mVertexCount = data.mVertexCount;
+		entry.mIndices = data.mIndices.data();
+		entry.mIndexCount = data.mIndexCount;
+		entry.mIndexType = data.mIndexType;
+		entry.mTextureFiles = data.mTextureFiles;
+		return entry;
+	}
+
+	MeshCache::MeshCache(const uint8_t* data, std::size_t size) : mData(data), mSize(size)
+	{
+	}
+
+	MeshCache::~MeshCache()
+	{
+		if (mData != nullptr)
+		{
+			unmapFile(mData, mSize);
+			mData = nullptr;
+		}
+	}
+
+	bool MeshCache::makeKey(const std::string& sourcePath, uint32_t importFlags, float weldEpsilon, Key& key)
+	{
+		struct stat info;
+		if (stat(sourcePath.c_str(), &info) != 0)
+		{
+			return false;
+		}
+
+		key.mSourcePath = sourcePath;
+		key.mSourceTime = static_cast<uint64_t>(info.st_mtime);
+		key.mSourceSize = static_cast<uint64_t>(info.st_size);
+		key.mImportFlags = importFlags;
+		key.mWeldEpsilon = weldEpsilon;
+		return true;
+	}
+
+	std::string MeshCache::cachePathFor(const std::string& sourcePath)
+	{
+		return sourcePath + ".meshcache";
+	}
+
+	std::unique_ptr<MeshCache> MeshCache::open(const std::string& cachePath, const Key& key)
+	{
+		std::size_t size = 0;
+		const uint8_t* data = mapFile(cachePath, size);
+		if (data == nullptr)
+		{
+			return nullptr;
+		}
+
+		std::unique_ptr<MeshCache> cache = std::make_unique<MeshCache>(data, size);
+		if (!cache->parse(key))
+		{
+			SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "mesh cache %s is stale or corrupt, reimporting", cachePath.c_str());
+			return nullptr;
+		}
+
+		return cache;
+	}
+
+	bool MeshCache::write(const std::string& cachePath, const Key& key, const std::vector<Entry>& entries, const std::vector<MeshNode>& nodes)
+	{
+		CacheWriter writer;
+		writer.writeBytes(kMagic, sizeof(kMagic));
+		writer.writeU32(kVersion);
+		writer.writeString(key.mSourcePath);
+		writer.writeU64(key.mSourceTime);
+		writer.writeU64(key.mSourceSize);
+		writer.writeU32(key.mImportFlags);
+		writer.writeFloat(key.mWeldEpsilon);
+		writer.writeU32(static_cast<uint32_t>(entries.size()));
+
+		for (const Entry& entry : entries)
+		{
+			writer.writeString(entry.mName);
+
+			const std::vector<VertexAttrib>& attribs = entry.mFormat.getAttribs();
+			writer.writeU32(static_cast<uint32_t>(attribs.size()));
+			for (const VertexAttrib& attrib : attribs)
+			{
+				writer.writeU32(static_cast<uint32_t>(attrib.semantic));
+				writer.writeU32(attrib.numSubElements);
+				writer.writeU32(attrib.type);
+				writer.writeU32(attrib.normalized ? 1 : 0);
+				writer.writeU32(attrib.stream);
+			}
+
+			writer.writeU32(static_cast<uint32_t>(entry.mTextureFiles.size()));
+			for (auto iter = entry.mTextureFiles.begin(); iter != entry.mTextureFiles.end(); iter++)
+			{
+				writer.writeString(iter->first);
+				writer.writeString(iter->second);
+			}
+
+			writer.writeU32(entry.mVertexCount);
+			writer.writeU32(entry.mIndexCount);
+			writer.writeU32(entry.mIndexType);
+			writer.writeBlob(entry.mVertices, static_cast<std::size_t>(entry.mVertexCount) * entry.mFormat.getVertexSize());
+			writer.writeBlob(entry.mIndices, static_cast<std::size_t>(entry.mIndexCount) * ElementBuffer::getIndexTypeSize(entry.mIndexType));
+		}
+
+		writer.writeU32(static_cast<uint32_t>(nodes.size()));
+		for (const MeshNode& node : nodes)
+		{
+			writer.writeString(node.mName);
+			writer.writeU32(static_cast<uint32_t>(node.mParent));
+			writer.writeBytes(&node.mTransform[0][0], sizeof(glm::mat4));
+			writer.writeU32(static_cast<uint32_t>(node.mMeshes.size()));
+			for (uint32_t mesh : node.mMeshes)
+			{
+				writer.writeU32(mesh);
+			}
+		}
+
+		// write to a temporary file first so an interrupted run never leaves a truncated cache behind
+		const std::string tempPath = cachePath + ".tmp";
+		{
+			std::ofstream ofs(tempPath, std::ios::binary | std::ios::trunc);
+			if (!ofs)
+			{
+				SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "failed to write mesh cache %s", cachePath.c_str());
+				return false;
+			}
+			ofs.write(reinterpret_cast<const char*>(writer.getBuffer().data()), writer.getBuffer().size());
+			if (!ofs)
+			{
+				SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "failed to write mesh cache %s", cachePath.c_str());
+				return false;
+			}
+		}
+
+		std::remove(cachePath.c_str());
+		if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+		{
+			std::remove(tempPath.c_str());
+			SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "failed to write mesh cache %s", cachePath.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	const std::vector<MeshCache::Entry>& MeshCache::getEntries() const
+	{
+		return mEntries;
+	}
+
+	const std::vector<MeshNode>& MeshCache::getNodes() const
+	{
+		return mNodes;
+	}
+
+	bool MeshCache::parse(const Key& key)
+	{
+		CacheReader reader(mData, mSize);
+
+		char magic[4];
+		reader.readBytes(magic, sizeof(magic));
+		if (!reader.isValid() || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || reader.readU32() != kVersion)
+		{
+			return false;
+		}
+
+		if (reader.readString() != key.mSourcePath ||
+			reader.readU64() != key.mSourceTime ||
+			reader.readU64() != key.mSourceSize ||
+			reader.readU32() != key.mImportFlags ||
+			reader.readFloat() != key.mWeldEpsilon)
+		{
+			return false;
+		}
+
+		uint32_t entryCount = reader.readU32();
+		for (uint32_t i = 0; i < entryCount && reader.isValid(); i++)
+		{
+			Entry entry;
+			entry.mName = reader.readString();
+
+			uint32_t attribCount = reader.readU32();
+			if (attribCount > static_cast<uint32_t>(VertexSemantic::Count))
+			{
+				return false;
+			}
+
+			std::vector<VertexFormat::Element> elements;
+			for (uint32_t j = 0; j < attribCount && reader.isValid(); j++)
+			{
+				VertexFormat::Element element;
+				element.semantic = static_cast<VertexSemantic>(reader.readU32());
+				element.numSubElements = reader.readU32();
+				element.type = reader.readU32();
+				element.normalized = reader.readU32() != 0;
+				element.stream = reader.readU32();
+				if (!reader.isValid() || element.semantic >= VertexSemantic::Count || element.stream >= kMaxStreams ||
+					element.numSubElements < 1 || element.numSubElements > kMaxSubElements)
+				{
+					return false;
+				}
+				elements.push_back(element);
+			}
+			entry.mFormat = VertexFormat(elements);
+
+			uint32_t textureCount = reader.readU32();
+			for (uint32_t j = 0; j < textureCount && reader.isValid(); j++)
+			{
+				std::string name = reader.readString();
+				std::string file = reader.readString();
+				entry.mTextureFiles.insert(std::make_pair(name, file));
+			}
+
+			entry.mVertexCount = reader.readU32();
+			entry.mIndexCount = reader.readU32();
+			entry.mIndexType = reader.readU32();
+			if (entry.mIndexType != GL_UNSIGNED_BYTE && entry.mIndexType != GL_UNSIGNED_SHORT && entry.mIndexType != GL_UNSIGNED_INT)
+			{
+				return false;
+			}
+
+			entry.mVertices = reader.readBlob(static_cast<std::size_t>(entry.mVertexCount) * entry.mFormat.getVertexSize());
+			entry.mIndices = reader.readBlob(static_cast<std::size_t>(entry.mIndexCount) * ElementBuffer::getIndexTypeSize(entry.mIndexType));
+
+			// an index past the vertices would be drawn as is and rebased into another mesh by static batching
+			if (!reader.isValid() || !checkIndices(entry.mIndices, entry.mIndexCount, entry.mIndexType, entry.mVertexCount))
+			{
+				return false;
+			}
+
+			mEntries.push_back(entry);
+		}
+
+		uint32_t nodeCount = reader.readU32();
+		for (uint32_t i = 0; i < nodeCount && reader.isValid(); i++)
+		{
+			MeshNode node;
+			node.mName = reader.readString();
+			node.mParent = static_cast<int32_t>(reader.readU32());
+			reader.readBytes(&node.mTransform[0][0], sizeof(glm::mat4));
+
+			uint32_t meshCount = reader.readU32();
+			for (uint32_t j = 0; j < meshCount && reader.isValid(); j++)
+			{
+				node.mMeshes.push_back(reader.readU32());
+			}
+
+			// the hierarchy must be breadth first and only name sub-meshes the file holds
+			if (node.mParent >= static_cast<int32_t>(i) || (node.mParent < 0) != (i == 0))
+			{
+				return false;
+			}
+			for (uint32_t mesh : node.mMeshes)
+			{
+				if (mesh >= mEntries.size())
+				{
+					return false;
+				}
+			}
+			mNodes.push_back(node);
+		}
+
+		return reader.isValid();
+	}
+}
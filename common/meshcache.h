@@ -0,0 +1,105 @@
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+#include <ogles.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include <buffer.h>
+
+namespace es
+{
+	// cpu side result of importing one sub-mesh, indices are already packed to mIndexType
+	struct MeshData
+	{
+		std::string mName;
+		VertexFormat mFormat;
+		std::vector<uint8_t> mVertices;
+		uint32_t mVertexCount = 0;
+		std::vector<uint8_t> mIndices;
+		uint32_t mIndexCount = 0;
+		GLenum mIndexType = GL_UNSIGNED_INT;
+		std::unordered_map<std::string, std::string> mTextureFiles;
+	};
+
+	// node of the imported hierarchy in breadth first order, parents come before their children
+	struct MeshNode
+	{
+		std::string mName;
+		// -1 for the root
+		int32_t mParent = -1;
+		glm::mat4 mTransform = glm::mat4(1.0f);
+		// indices into the sub-meshes of the model
+		std::vector<uint32_t> mMeshes;
+	};
+
+	// versioned binary file next to a model holding its processed sub-meshes, read back through a memory mapping
+	class MeshCache
+	{
+	public:
+		// bump whenever the file layout or the import pipeline output changes
+		static const uint32_t kVersion = 2;
+
+		// vertex formats read from a file have to stay within these, anything else is taken as a corrupt file
+		static const uint32_t kMaxStreams = 4;
+		static const uint32_t kMaxSubElements = 4;
+
+		// a cache is valid only for the exact source file and import settings it was written with
+		struct Key
+		{
+			std::string mSourcePath;
+			uint64_t mSourceTime;
+			uint64_t mSourceSize;
+			uint32_t mImportFlags;
+			float mWeldEpsilon;
+		};
+
+		// a sub-mesh as stored in the file, the data pointers stay valid as long as the cache or the MeshData lives
+		struct Entry
+		{
+			std::string mName;
+			VertexFormat mFormat;
+			const void* mVertices;
+			uint32_t mVertexCount;
+			const void* mIndices;
+			uint32_t mIndexCount;
+			GLenum mIndexType;
+			std::unordered_map<std::string, std::string> mTextureFiles;
+
+			static Entry fromData(const MeshData& data);
+		};
+
+		MeshCache(const uint8_t* data, std::size_t size);
+		~MeshCache();
+
+		static bool makeKey(const std::string& sourcePath, uint32_t importFlags, float weldEpsilon, Key& key);
+
+		static std::string cachePathFor(const std::string& sourcePath);
+
+		// maps the cache file, returns nullptr when it is missing, stale or corrupt
+		static std::unique_ptr<MeshCache> open(const std::string& cachePath, const Key& key);
+
+		static bool write(const std::string& cachePath, const Key& key, const std::vector<Entry>& entries, const std::vector<MeshNode>& nodes);
+
+		const std::vector<Entry>& getEntries() const;
+
+		const std::vector<MeshNode>& getNodes() const;
+
+		MeshCache(const MeshCache&) = delete;
+		const MeshCache& operator=(const MeshCache&) = delete;
+	private:
+		bool parse(const Key& key);
+
+		const uint8_t* mData;
+		std::size_t mSize;
+
+		std::vector<Entry> mEntries;
+		std::vector<MeshNode> mNodes;
+	};
+}
+
+#endif
@@ -0,0 +1,474 @@
+#include "meshoptimizer.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace es
+{
+	namespace
+	{
+		// scoring constants from Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+		const uint32_t kScoringCacheSize = 32;
+		const float kCacheDecayPower = 1.5f;
+		const float kLastTriangleScore = 0.75f;
+		const float kValenceBoostScale = 2.0f;
+		const float kValenceBoostPower = 0.5f;
+
+		float vertexScore(int cachePosition, uint32_t remainingTriangles)
+		{
+			if (remainingTriangles == 0)
+			{
+				return -1.0f;
+			}
+
+			float score = 0.0f;
+			if (cachePosition >= 0)
+			{
+				if (cachePosition < 3)
+				{
+					// the vertices of the last triangle get a fixed score so the next one does not simply reuse its edge
+					score = kLastTriangleScore;
+				}
+				else
+				{
+					const float scaler = 1.0f / (kScoringCacheSize - 3);
+					score = std::pow(1.0f - (cachePosition - 3) * scaler, kCacheDecayPower);
+				}
+			}
+
+			// favour vertices with few remaining triangles so that lone triangles are not left behind
+			score += kValenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -kValenceBoostPower);
+			return score;
+		}
+
+		uint32_t hashBytes(const uint8_t* data, std::size_t size)
+		{
+			// fnv-1a
+			uint32_t hash = 2166136261u;
+			for (std::size_t i = 0; i < size; i++)
+			{
+				hash = (hash ^ data[i]) * 16777619u;
+			}
+			return hash;
+		}
+
+		// writes the grid cell of every float followed by a 0, or the raw vertex followed by a 1 when a value is not finite or
+		// its cell does not fit an int32, such vertices are only welded with bit-identical ones
+		void quantizeVertex(const uint8_t* vertex, std::size_t vertexSize, float epsilon, int32_t* out)
+		{
+			const std::size_t count = vertexSize / sizeof(float);
+			for (std::size_t i = 0; i < count; i++)
+			{
+				float value;
+				std::memcpy(&value, vertex + i * sizeof(float), sizeof(float));
+				float cell = std::floor(value / epsilon + 0.5f);
+				if (!(std::fabs(cell) < 2147483648.0f))
+				{
+					std::memcpy(out, vertex, vertexSize);
+					out[count] = 1;
+					return;
+				}
+				out[i] = static_cast<int32_t>(cell);
+			}
+			out[count] = 0;
+		}
+
+		glm::vec3 readPosition(const uint8_t* vertices, std::size_t vertexSize, std::size_t positionOffset, uint32_t index)
+		{
+			glm::vec3 position;
+			std::memcpy(&position, vertices + index * vertexSize + positionOffset, sizeof(glm::vec3));
+			return position;
+		}
+	}
+
+	// ----------------------------------------------------------------------------------------------------------------------------------------
+
+	std::size_t MeshOptimizer::weldVertices(void* vertices, std::size_t vertexCount, std::size_t vertexSize, std::vector<uint32_t>& indices, float epsilon)
+	{
+		const uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+
+		if (vertexCount == 0)
+		{
+			return 0;
+		}
+
+		uint8_t* data = static_cast<uint8_t*>(vertices);
+
+		// the welding key is the raw vertex or its snapped float values
+		const bool quantize = epsilon > 0.0f && vertexSize % sizeof(float) == 0;
+		const std::size_t keySize = quantize ? vertexSize + sizeof(int32_t) : vertexSize;
+		std::vector<uint8_t> keys;
+		if (quantize)
+		{
+			keys.resize(vertexCount * keySize);
+			for (std::size_t v = 0; v < vertexCount; v++)
+			{
+				quantizeVertex(data + v * vertexSize, vertexSize, epsilon, reinterpret_cast<int32_t*>(&keys[v * keySize]));
+			}
+		}
+		const uint8_t* keyData = quantize ? keys.data() : data;
+
+		// open addressing table with linear probing, at most half full
+		std::size_t tableSize = 1;
+		while (tableSize < vertexCount * 2)
+		{
+			tableSize <<= 1;
+		}
+		std::vector<uint32_t> table(tableSize, kEmpty);
+
+		std::vector<uint32_t> remap(vertexCount);
+		uint32_t uniqueCount = 0;
+
+		for (std::size_t v = 0; v < vertexCount; v++)
+		{
+			const uint8_t* key = keyData + v * keySize;
+			std::size_t slot = hashBytes(key, keySize) & (tableSize - 1);
+
+			// kept vertices are compared at their compacted position, the raw data behind them may already be overwritten
+			while (table[slot] != kEmpty && std::memcmp(quantize ? keyData + table[slot] * keySize : data + remap[table[slot]] * vertexSize, key, keySize) != 0)
+			{
+				slot = (slot + 1) & (tableSize - 1);
+			}
+
+			if (table[slot] == kEmpty)
+			{
+				// the first vertex of a group is kept, it moves to the front of the buffer
+				table[slot] = static_cast<uint32_t>(v);
+				remap[v] = uniqueCount;
+				if (uniqueCount != v)
+				{
+					std::memcpy(data + uniqueCount * vertexSize, data + v * vertexSize, vertexSize);
+				}
+				uniqueCount++;
+			}
+			else
+			{
+				remap[v] = remap[table[slot]];
+			}
+		}
+
+		for (uint32_t& index : indices)
+		{
+			if (index != kEmpty)
+			{
+				index = remap[index];
+			}
+		}
+
+		return uniqueCount;
+	}
+
+	void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, std::size_t vertexCount)
+	{
+		const std::size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0 || vertexCount == 0)
+		{
+			return;
+		}
+
+		// vertex to triangle adjacency, the first remaining[v] entries of a vertex are its unemitted triangles
+		std::vector<uint32_t> remaining(vertexCount, 0);
+		for (std::size_t i = 0; i < triangleCount * 3; i++)
+		{
+			remaining[indices[i]]++;
+		}
+
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (std::size_t v = 0; v < vertexCount; v++)
+		{
+			offsets[v + 1] = offsets[v] + remaining[v];
+		}
+
+		std::vector<uint32_t> adjacency(triangleCount * 3);
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (std::size_t t = 0; t < triangleCount; t++)
+		{
+			for (std::size_t k = 0; k < 3; k++)
+			{
+				adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+			}
+		}
+
+		std::vector<int> cachePositions(vertexCount, -1);
+		std::vector<float> vertexScores(vertexCount);
+		for (std::size_t v = 0; v < vertexCount; v++)
+		{
+			vertexScores[v] = vertexScore(-1, remaining[v]);
+		}
+
+		std::vector<float> triangleScores(triangleCount);
+		std::vector<bool> emitted(triangleCount, false);
+		int bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (std::size_t t = 0; t < triangleCount; t++)
+		{
+			triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+			if (triangleScores[t] > bestScore)
+			{
+				bestScore = triangleScores[t];
+				bestTriangle = static_cast<int>(t);
+			}
+		}
+
+		std::vector<uint32_t> cache;
+		std::vector<uint32_t> newCache;
+		cache.reserve(kScoringCacheSize + 3);
+		newCache.reserve(kScoringCacheSize + 3);
+
+		std::vector<uint32_t> result;
+		result.reserve(triangleCount * 3);
+
+		std::size_t inputCursor = 0;
+
+		while (result.size() < triangleCount * 3)
+		{
+			if (bestTriangle < 0)
+			{
+				// nothing in the cache touches an unemitted triangle, continue with the next one in input order
+				while (emitted[inputCursor])
+				{
+					inputCursor++;
+				}
+				bestTriangle = static_cast<int>(inputCursor);
+			}
+
+			const uint32_t* triangle = &indices[bestTriangle * 3];
+			emitted[bestTriangle] = true;
+			result.insert(result.end(), triangle, triangle + 3);
+
+			newCache.clear();
+			for (std::size_t k = 0; k < 3; k++)
+			{
+				const uint32_t v = triangle[k];
+
+				// remove the triangle from the vertex adjacency
+				uint32_t* begin = &adjacency[offsets[v]];
+				uint32_t* end = begin + remaining[v];
+				uint32_t* found = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+				std::swap(*found, *(end - 1));
+				remaining[v]--;
+
+				newCache.push_back(v);
+			}
+
+			for (uint32_t v : cache)
+			{
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				{
+					newCache.push_back(v);
+				}
+			}
+
+			// vertices pushed out of the scoring cache lose their position
+			for (std::size_t i = kScoringCacheSize; i < newCache.size(); i++)
+			{
+				cachePositions[newCache[i]] = -1;
+				vertexScores[newCache[i]] = vertexScore(-1, remaining[newCache[i]]);
+			}
+
+			for (std::size_t i = 0; i < newCache.size() && i < kScoringCacheSize; i++)
+			{
+				cachePositions[newCache[i]] = static_cast<int>(i);
+				vertexScores[newCache[i]] = vertexScore(static_cast<int>(i), remaining[newCache[i]]);
+			}
+
+			// rescore triangles touching a changed vertex, the best one among them is emitted next
+			bestTriangle = -1;
+			bestScore = -1.0f;
+			for (uint32_t v : newCache)
+			{
+				for (uint32_t i = 0; i < remaining[v]; i++)
+				{
+					const uint32_t t = adjacency[offsets[v] + i];
+					triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+					if (triangleScores[t] > bestScore)
+					{
+						bestScore = triangleScores[t];
+						bestTriangle = static_cast<int>(t);
+					}
+				}
+			}
+
+			if (newCache.size() > kScoringCacheSize)
+			{
+				newCache.resize(kScoringCacheSize);
+			}
+			cache.swap(newCache);
+		}
+
+		indices.swap(result);
+	}
+
+	void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const void* vertices, std::size_t vertexCount, std::size_t vertexSize, std::size_t positionOffset, float threshold)
+	{
+		const std::size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0 || vertexCount == 0)
+		{
+			return;
+		}
+
+		const uint8_t* data = static_cast<const uint8_t*>(vertices);
+
+		// a cluster starts wherever a triangle misses the cache with all three vertices,
+		// reordering whole clusters then costs at most a few extra misses at the boundaries
+		std::vector<uint32_t> clusters;
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		uint32_t timestamp = kCacheSize + 1;
+		for (std::size_t t = 0; t < triangleCount; t++)
+		{
+			uint32_t misses = 0;
+			for (std::size_t k = 0; k < 3; k++)
+			{
+				const uint32_t v = indices[t * 3 + k];
+				if (timestamp - cacheTime[v] > kCacheSize)
+				{
+					cacheTime[v] = timestamp++;
+					misses++;
+				}
+			}
+
+			if (t == 0 || misses == 3)
+			{
+				clusters.push_back(static_cast<uint32_t>(t));
+			}
+		}
+
+		if (clusters.size() < 2)
+		{
+			return;
+		}
+
+		// area weighted centroid and normal of every cluster
+		struct ClusterInfo
+		{
+			uint32_t mFirst;
+			uint32_t mCount;
+			glm::vec3 mCentroid;
+			glm::vec3 mNormal;
+			float mSortKey;
+		};
+
+		std::vector<ClusterInfo> infos(clusters.size());
+		glm::vec3 meshCentroid(0.0f);
+		float meshArea = 0.0f;
+
+		for (std::size_t c = 0; c < clusters.size(); c++)
+		{
+			ClusterInfo& info = infos[c];
+			info.mFirst = clusters[c];
+			info.mCount = (c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangleCount)) - clusters[c];
+			info.mCentroid = glm::vec3(0.0f);
+			info.mNormal = glm::vec3(0.0f);
+
+			float clusterArea = 0.0f;
+			for (uint32_t t = info.mFirst; t < info.mFirst + info.mCount; t++)
+			{
+				const glm::vec3 p0 = readPosition(data, vertexSize, positionOffset, indices[t * 3]);
+				const glm::vec3 p1 = readPosition(data, vertexSize, positionOffset, indices[t * 3 + 1]);
+				const glm::vec3 p2 = readPosition(data, vertexSize, positionOffset, indices[t * 3 + 2]);
+
+				const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				const float area = glm::length(normal);
+
+				info.mCentroid += (p0 + p1 + p2) * (area / 3.0f);
+				info.mNormal += normal;
+				clusterArea += area;
+			}
+
+			meshCentroid += info.mCentroid;
+			meshArea += clusterArea;
+
+			info.mCentroid = clusterArea > 0.0f ? info.mCentroid / clusterArea : readPosition(data, vertexSize, positionOffset, indices[info.mFirst * 3]);
+		}
+
+		if (meshArea > 0.0f)
+		{
+			meshCentroid /= meshArea;
+		}
+
+		// clusters facing away from the mesh center are likely to occlude the rest, draw them first
+		for (ClusterInfo& info : infos)
+		{
+			const float normalLength = glm::length(info.mNormal);
+			info.mSortKey = normalLength > 0.0f ? glm::dot(info.mCentroid - meshCentroid, info.mNormal / normalLength) : 0.0f;
+		}
+
+		std::stable_sort(infos.begin(), infos.end(), [](const ClusterInfo& a, const ClusterInfo& b) { return a.mSortKey > b.mSortKey; });
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (const ClusterInfo& info : infos)
+		{
+			result.insert(result.end(), indices.begin() + info.mFirst * 3, indices.begin() + (info.mFirst + info.mCount) * 3);
+		}
+
+		const float inputACMR = analyzeVertexCache(indices, vertexCount).mACMR;
+		const float outputACMR = analyzeVertexCache(result, vertexCount).mACMR;
+		if (outputACMR <= inputACMR * threshold)
+		{
+			indices.swap(result);
+		}
+	}
+
+	std::size_t MeshOptimizer::optimizeVertexFetch(void* vertices, std::size_t vertexCount, std::size_t vertexSize, std::vector<uint32_t>& indices)
+	{
+		const uint32_t kUnused = std::numeric_limits<uint32_t>::max();
+
+		uint8_t* data = static_cast<uint8_t*>(vertices);
+		std::vector<uint8_t> source(data, data + vertexCount * vertexSize);
+
+		std::vector<uint32_t> remap(vertexCount, kUnused);
+		uint32_t nextVertex = 0;
+
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == kUnused)
+			{
+				remap[index] = nextVertex;
+				std::memcpy(data + nextVertex * vertexSize, &source[index * vertexSize], vertexSize);
+				nextVertex++;
+			}
+			index = remap[index];
+		}
+
+		return nextVertex;
+	}
+
+	VertexCacheStatistics MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, std::size_t vertexCount, uint32_t cacheSize)
+	{
+		VertexCacheStatistics statistics = { 0.0f, 0.0f };
+		const std::size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+		{
+			return statistics;
+		}
+
+		// fifo cache, a vertex is resident while fewer than cacheSize vertices were transformed after it
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		uint32_t timestamp = cacheSize + 1;
+		std::size_t misses = 0;
+		std::size_t uniqueVertices = 0;
+
+		for (uint32_t index : indices)
+		{
+			if (cacheTime[index] == 0)
+			{
+				uniqueVertices++;
+			}
+
+			if (timestamp - cacheTime[index] > cacheSize)
+			{
+				cacheTime[index] = timestamp++;
+				misses++;
+			}
+		}
+
+		statistics.mACMR = static_cast<float>(misses) / triangleCount;
+		statistics.mATVR = uniqueVertices > 0 ? static_cast<float>(misses) / uniqueVertices : 0.0f;
+		return statistics;
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef MESH_OPTIMIZER_H_
+#define MESH_OPTIMIZER_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace es
+{
+	struct VertexCacheStatistics
+	{
+		// average cache miss ratio, transformed vertices per triangle
+		float mACMR;
+		// average transform to vertex ratio, 1.0 when every vertex is transformed once
+		float mATVR;
+	};
+
+	// reorders indexed triangle lists for the post-transform vertex cache, early depth test and vertex fetch,
+	// all functions work on plain triangle lists without primitive restart
+	class MeshOptimizer
+	{
+	public:
+		// fifo size used to measure the cache, close to what current gpus keep for post-transform vertices
+		static const uint32_t kCacheSize = 16;
+
+		// merges vertices whose attributes match and rewrites the indices, returns the new vertex count,
+		// with epsilon > 0 the vertex data is read as floats and vertices whose values snap to the same cells of a grid of that
+		// size are merged. vertices closer than epsilon can still fall into neighbouring cells and stay apart
+		static std::size_t weldVertices(void* vertices, std::size_t vertexCount, std::size_t vertexSize, std::vector<uint32_t>& indices, float epsilon = 0.0f);
+
+		// reorders triangles for vertex cache locality with Forsyth's linear-speed algorithm
+		static void optimizeVertexCache(std::vector<uint32_t>& indices, std::size_t vertexCount);
+
+		// splits a cache optimized list into clusters and sorts them outside-in to reduce overdraw,
+		// the order is kept when the cache miss ratio grows above threshold times the input ratio
+		static void optimizeOverdraw(std::vector<uint32_t>& indices, const void* vertices, std::size_t vertexCount, std::size_t vertexSize, std::size_t positionOffset, float threshold = 1.05f);
+
+		// reorders vertices in the order of first use and drops unreferenced ones, returns the new vertex count
+		static std::size_t optimizeVertexFetch(void* vertices, std::size_t vertexCount, std::size_t vertexSize, std::vector<uint32_t>& indices);
+
+		static VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, std::size_t vertexCount, uint32_t cacheSize = kCacheSize);
+	};
+}
+
+#endif
@@ -0,0 +1,244 @@
+#include "mipmap.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace es
+{
+	namespace
+	{
+		const uint32_t kRowsPerTask = 16;
+
+		struct FilterTap
+		{
+			int mOffset;
+			float mWeight;
+		};
+
+		float srgbToLinear(float c)
+		{
+			return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+
+		float linearToSrgb(float c)
+		{
+			return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		}
+
+		// zeroth order modified bessel function of the first kind
+		float besselI0(float x)
+		{
+			float sum = 1.0f;
+			float term = 1.0f;
+			for (int k = 1; k < 16; k++)
+			{
+				term *= (x / (2.0f * k)) * (x / (2.0f * k));
+				sum += term;
+			}
+			return sum;
+		}
+
+		// taps of a 2:1 reduction, offsets are relative to the first source texel of a destination texel
+		std::vector<FilterTap> makeTaps(MipFilter filter)
+		{
+			if (filter == MipFilter::Box)
+			{
+				return { { 0, 0.5f }, { 1, 0.5f } };
+			}
+
+			// kaiser windowed sinc over three destination texels, alpha 4
+			const float kAlpha = 4.0f;
+			const float kHalfWidth = 1.5f;
+			const float kPi = 3.14159265358979f;
+
+			std::vector<FilterTap> taps;
+			float sum = 0.0f;
+			for (int offset = -2; offset <= 3; offset++)
+			{
+				// distance between source and destination texel centers in destination texels
+				float t = ((offset + 0.5f) - 1.0f) * 0.5f;
+				float sinc = std::sin(kPi * t) / (kPi * t);
+				float ratio = t / kHalfWidth;
+				float window = besselI0(kAlpha * std::sqrt(std::max(0.0f, 1.0f - ratio * ratio))) / besselI0(kAlpha);
+				taps.push_back({ offset, sinc * window });
+				sum += sinc * window;
+			}
+
+			for (FilterTap& tap : taps)
+			{
+				tap.mWeight /= sum;
+			}
+			return taps;
+		}
+
+		// runs body(firstRow, lastRow) for row chunks on the thread pool and waits for all of them
+		template<typename F>
+		void parallelRows(uint32_t rowCount, F body)
+		{
+			ThreadPool* threadPool = ThreadPool::getThreadPool();
+
+			std::vector<std::future<void>> chunks;
+			for (uint32_t row = 0; row < rowCount; row += kRowsPerTask)
+			{
+				uint32_t lastRow = std::min(rowCount, row + kRowsPerTask);
+				chunks.push_back(threadPool->enqueue([body, row, lastRow]() { body(row, lastRow); }));
+			}
+
+			for (std::future<void>& chunk : chunks)
+			{
+				threadPool->wait(chunk);
+			}
+		}
+	}
+
+	// ----------------------------------------------------------------------------------------------------------------------------------------
+
+	uint32_t MipGenerator::getFullChainLength(uint32_t w, uint32_t h)
+	{
+		uint32_t levels = 1;
+		uint32_t size = std::max(w, h);
+		while (size > 1)
+		{
+			size >>= 1;
+			levels++;
+		}
+		return levels;
+	}
+
+	std::vector<MipLevel> MipGenerator::generate(const void* pixels, uint32_t w, uint32_t h, uint32_t components, bool isFloat, bool srgb, uint32_t levelCount, MipFilter filter)
+	{
+		std::vector<MipLevel> levels;
+		if (levelCount < 2 || w == 0 || h == 0 || components == 0)
+		{
+			return levels;
+		}
+
+		const std::vector<FilterTap> taps = makeTaps(filter);
+		const uint32_t srgbChannels = (srgb && !isFloat) ? std::min(components, 3u) : 0;
+
+		std::array<float, 256> srgbTable;
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			srgbTable[i] = srgbToLinear(i / 255.0f);
+		}
+
+		// filtering happens in linear float, every level is built from the unquantized level above
+		std::vector<float> source(static_cast<std::size_t>(w) * h * components);
+		parallelRows(h, [&](uint32_t firstRow, uint32_t lastRow)
+		{
+			for (uint32_t y = firstRow; y < lastRow; y++)
+			{
+				for (std::size_t i = static_cast<std::size_t>(y) * w * components; i < static_cast<std::size_t>(y + 1) * w * components; i++)
+				{
+					if (isFloat)
+					{
+						source[i] = static_cast<const float*>(pixels)[i];
+					}
+					else
+					{
+						uint8_t value = static_cast<const uint8_t*>(pixels)[i];
+						source[i] = (i % components) < srgbChannels ? srgbTable[value] : value / 255.0f;
+					}
+				}
+			}
+		});
+
+		uint32_t srcWidth = w;
+		uint32_t srcHeight = h;
+		std::vector<float> horizontal;
+		std::vector<float> destination;
+
+		for (uint32_t level = 1; level < levelCount && (srcWidth > 1 || srcHeight > 1); level++)
+		{
+			const uint32_t dstWidth = std::max(1u, srcWidth / 2);
+			const uint32_t dstHeight = std::max(1u, srcHeight / 2);
+
+			// a dimension already at 1 is copied instead of filtered
+			const std::vector<FilterTap> identity = { { 0, 1.0f } };
+			const std::vector<FilterTap>& tapsX = srcWidth > 1 ? taps : identity;
+			const std::vector<FilterTap>& tapsY = srcHeight > 1 ? taps : identity;
+			const int scaleX = srcWidth > 1 ? 2 : 1;
+			const int scaleY = srcHeight > 1 ? 2 : 1;
+
+			horizontal.assign(static_cast<std::size_t>(dstWidth) * srcHeight * components, 0.0f);
+			parallelRows(srcHeight, [&](uint32_t firstRow, uint32_t lastRow)
+			{
+				for (uint32_t y = firstRow; y < lastRow; y++)
+				{
+					const float* srcRow = &source[static_cast<std::size_t>(y) * srcWidth * components];
+					float* dstRow = &horizontal[static_cast<std::size_t>(y) * dstWidth * components];
+					for (uint32_t x = 0; x < dstWidth; x++)
+					{
+						for (const FilterTap& tap : tapsX)
+						{
+							int sx = std::min(std::max(static_cast<int>(x) * scaleX + tap.mOffset, 0), static_cast<int>(srcWidth) - 1);
+							for (uint32_t c = 0; c < components; c++)
+							{
+								dstRow[x * components + c] += srcRow[sx * components + c] * tap.mWeight;
+							}
+						}
+					}
+				}
+			});
+
+			destination.assign(static_cast<std::size_t>(dstWidth) * dstHeight * components, 0.0f);
+			parallelRows(dstHeight, [&](uint32_t firstRow, uint32_t lastRow)
+			{
+				const std::size_t rowSize = static_cast<std::size_t>(dstWidth) * components;
+				for (uint32_t y = firstRow; y < lastRow; y++)
+				{
+					float* dstRow = &destination[y * rowSize];
+					for (const FilterTap& tap : tapsY)
+					{
+						int sy = std::min(std::max(static_cast<int>(y) * scaleY + tap.mOffset, 0), static_cast<int>(srcHeight) - 1);
+						const float* srcRow = &horizontal[sy * rowSize];
+						for (std::size_t i = 0; i < rowSize; i++)
+						{
+							dstRow[i] += srcRow[i] * tap.mWeight;
+						}
+					}
+				}
+			});
+
+			MipLevel mip;
+			mip.mWidth = dstWidth;
+			mip.mHeight = dstHeight;
+			mip.mData.resize(destination.size() * (isFloat ? sizeof(float) : sizeof(uint8_t)));
+			if (isFloat)
+			{
+				// the kaiser lobes can undershoot below zero
+				for (float& value : destination)
+				{
+					value = std::max(value, 0.0f);
+				}
+				std::memcpy(mip.mData.data(), destination.data(), mip.mData.size());
+			}
+			else
+			{
+				parallelRows(dstHeight, [&](uint32_t firstRow, uint32_t lastRow)
+				{
+					for (std::size_t i = static_cast<std::size_t>(firstRow) * dstWidth * components; i < static_cast<std::size_t>(lastRow) * dstWidth * components; i++)
+					{
+						// clamp kaiser over- and undershoot
+						float value = std::min(std::max(destination[i], 0.0f), 1.0f);
+						if ((i % components) < srgbChannels)
+						{
+							value = linearToSrgb(value);
+						}
+						mip.mData[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+					}
+				});
+			}
+			levels.push_back(std::move(mip));
+
+			source.swap(destination);
+			srcWidth = dstWidth;
+			srcHeight = dstHeight;
+		}
+
+		return levels;
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef MIPMAP_H_
+#define MIPMAP_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace es
+{
+	enum class MipFilter
+	{
+		Box,
+		Kaiser
+	};
+
+	struct MipLevel
+	{
+		uint32_t mWidth;
+		uint32_t mHeight;
+		std::vector<uint8_t> mData;
+	};
+
+	// cpu mip chain builder, rows of a level are filtered in parallel on the thread pool
+	class MipGenerator
+	{
+	public:
+		// number of levels down to 1x1
+		static uint32_t getFullChainLength(uint32_t w, uint32_t h);
+
+		// builds levels 1 to levelCount - 1 from level 0, texels are tightly packed uint8 or float channels,
+		// with srgb the first three 8-bit channels are filtered in linear space
+		static std::vector<MipLevel> generate(const void* pixels, uint32_t w, uint32_t h, uint32_t components, bool isFloat, bool srgb, uint32_t levelCount, MipFilter filter = MipFilter::Box);
+	};
+}
+
+#endif
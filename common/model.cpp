@@ -19,22 +19,106 @@ namespace es
 
 	std::unordered_map<std::string, std::shared_ptr<Model>> Model::mModelCache;
 
-	Model::Model(const std::string& name, const std::string& path, const std::vector<std::string>& shaderFiles, bool isLoadMaterials) : Object(name)
+	float Model::mWeldEpsilon = 0.0f;
+
+	bool Model::mIsStaticBatching = false;
+
+	const uint32_t Model::kImportFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+	Model::Model(const std::string& name, const std::string& path, const std::vector<std::string>& shaderFiles, bool isLoadMaterials)
+		: Model(name, importFromFile(path), shaderFiles, isLoadMaterials)
 	{
-		const aiScene* scene;
-		Assimp::Importer importer;
-		scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_PreTransformVertices);
+	}
 
-		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+	Model::Model(const std::string& name, ImportedModel&& imported, const std::vector<std::string>& shaderFiles, bool isLoadMaterials) : Object(name)
+	{
+		mDirectory = imported.mDirectory;
+		mShaderFiles = shaderFiles;
+
+		if (!imported.mIsValid)
 		{
-			SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, importer.GetErrorString());
 			return;
 		}
 
-		mDirectory = Utility::pathWithoutFile(path);
-		mShaderFiles = shaderFiles;
+		// only the gl buffer creation runs here, on the context thread
+		auto timeStart = std::chrono::high_resolution_clock::now();
+
+		mSceneGraph.addNode(SceneGraph::kNoParent, mModelMatrix, mName);
+
+		// sub-mesh and node pairs in breadth first order
+		std::vector<std::pair<uint32_t, int32_t>> references;
+		for (const MeshNode& node : imported.mNodes)
+		{
+			int32_t index = mSceneGraph.addNode(node.mParent < 0 ? 0 : node.mParent + 1, node.mTransform, node.mName);
+			if (index == SceneGraph::kNoParent)
+			{
+				break;
+			}
+
+			for (uint32_t meshIndex : node.mMeshes)
+			{
+				references.push_back(std::make_pair(meshIndex, index));
+			}
+		}
+
+		mSceneGraph.update();
 
-		handleNode(scene->mRootNode, scene, isLoadMaterials);
+		std::unordered_map<std::string, int32_t> meshNodes;
+		if (mIsStaticBatching)
+		{
+			createStaticBatches(imported.mEntries, references, isLoadMaterials, meshNodes);
+		}
+		else
+		{
+			// a sub-mesh referenced by several nodes is uploaded once, the other nodes get clones sharing its geometry
+			std::vector<std::shared_ptr<Mesh>> uploaded(imported.mEntries.size());
+			for (const std::pair<uint32_t, int32_t>& reference : references)
+			{
+				uint32_t meshIndex = reference.first;
+				const MeshCache::Entry& entry = imported.mEntries[meshIndex];
+				std::string name = entry.mName;
+				for (uint32_t suffix = 1; name.empty() || mMeshes.find(name) != mMeshes.end(); suffix++)
+				{
+					name = entry.mName + "_" + std::to_string(suffix);
+				}
+
+				if (uploaded[meshIndex] == nullptr)
+				{
+					uploaded[meshIndex] = createMesh(entry, isLoadMaterials);
+					mMeshes.insert(std::make_pair(name, uploaded[meshIndex]));
+				}
+				else
+				{
+					mMeshes.insert(std::make_pair(name, Mesh::clone(name, uploaded[meshIndex].get())));
+				}
+				meshNodes[name] = reference.second;
+			}
+		}
+
+		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
+		{
+			int32_t node = meshNodes[iter->first];
+			mMeshNodes.push_back(node);
+			mLocalBounds.expand(iter->second->getGeometry()->getBounds().transform(mSceneGraph.getWorldTransform(node)));
+		}
+
+		auto timeEnd = std::chrono::high_resolution_clock::now();
+		auto timeDiff = std::chrono::duration<double, std::milli>(timeEnd - timeStart).count();
+
+		std::size_t vertexCount = 0;
+		std::size_t vertexBytes = 0;
+		std::size_t indexBytes = 0;
+		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
+		{
+			std::shared_ptr<const MeshGeometry> geometry = iter->second->getGeometry();
+			vertexCount += geometry->getVertexCount();
+			vertexBytes += geometry->getVertexCount() * geometry->getVertexFormat().getVertexSize();
+			indexBytes += geometry->getIndexCount() * ElementBuffer::getIndexTypeSize(geometry->getIndexType());
+		}
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "model %s : %zu vertices, %.1f bytes per vertex, %zu bytes of vertex data, %zu bytes of index data",
+			mName.c_str(), vertexCount, vertexCount > 0 ? (float)vertexBytes / vertexCount : 0.0f, vertexBytes, indexBytes);
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "model %s : loaded in %.2f ms (%s), uploaded in %.2f ms",
+			mName.c_str(), imported.mImportTime, imported.mCache ? "warm, mesh cache" : "cold, assimp import", timeDiff);
 	}
 
 	Model::Model(const std::string& name, const Model* duplicateModel) : Object(name)
@@ -43,6 +127,7 @@ namespace es
 		mRotation = duplicateModel->mRotation;
 		mScaling = duplicateModel->mScaling;
 		mModelMatrix = duplicateModel->mModelMatrix;
+		mLocalMatrix = duplicateModel->mLocalMatrix;
 		mAutoUpdated = duplicateModel->mAutoUpdated;
 		mTransformUpdated = duplicateModel->mTransformUpdated;
 		mIsDirty = duplicateModel->mIsDirty;
@@ -55,6 +140,11 @@ namespace es
 		{
 			mMeshes.insert(std::make_pair(iter->first, Mesh::clone(iter->first, iter->second.get())));
 		}
+
+		mSceneGraph = duplicateModel->mSceneGraph;
+		mMeshNodes = duplicateModel->mMeshNodes;
+		mLocalBounds = duplicateModel->mLocalBounds;
+		mBatchRanges = duplicateModel->mBatchRanges;
 	}
 
 	Model::~Model()
@@ -84,6 +174,42 @@ namespace es
 		}
 	}
 
+	std::vector<std::shared_ptr<Model>> Model::createFromFiles(const std::vector<ModelDesc>& descs)
+	{
+		ThreadPool* threadPool = ThreadPool::getThreadPool();
+
+		// every model is imported on the pool with its own importer, the meshes of each are converted in parallel as well
+		std::vector<std::future<ImportedModel>> imports(descs.size());
+		for (std::size_t i = 0; i < descs.size(); i++)
+		{
+			if (mModelCache.find(descs[i].mName) == mModelCache.end())
+			{
+				std::string path = descs[i].mPath;
+				imports[i] = threadPool->enqueue([path]() { return importFromFile(path); });
+			}
+		}
+
+		std::vector<std::shared_ptr<Model>> models;
+		for (std::size_t i = 0; i < descs.size(); i++)
+		{
+			if (!imports[i].valid() || mModelCache.find(descs[i].mName) != mModelCache.end())
+			{
+				if (imports[i].valid())
+				{
+					threadPool->wait(imports[i]);
+				}
+				models.push_back(mModelCache[descs[i].mName]);
+				continue;
+			}
+
+			std::shared_ptr<Model> model = std::make_shared<Model>(descs[i].mName, threadPool->wait(imports[i]), descs[i].mShaderFiles, descs[i].mIsLoadMaterials);
+			mModelCache[descs[i].mName] = model;
+			models.push_back(model);
+		}
+
+		return models;
+	}
+
 	std::shared_ptr<Model> Model::clone(const std::string& name, const Model* duplicateModel)
 	{
 		if (mModelCache.find(name) == mModelCache.end())
@@ -98,6 +224,21 @@ namespace es
 		}
 	}
 
+	void Model::setWeldEpsilon(float epsilon)
+	{
+		mWeldEpsilon = epsilon;
+	}
+
+	void Model::setStaticBatching(bool isEnabled)
+	{
+		mIsStaticBatching = isEnabled;
+	}
+
+	const std::vector<BatchRange>& Model::getBatchRanges() const
+	{
+		return mBatchRanges;
+	}
+
 	void Model::setMaterial(std::shared_ptr<Material> mMat)
 	{
 		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
@@ -106,20 +247,222 @@ namespace es
 		}
 	}
 
+	bool Model::enableInstancing(const std::vector<InstanceParameter>& parameters)
+	{
+		bool isEnabled = true;
+		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
+		{
+			std::shared_ptr<Material> material = iter->second->getMaterial();
+			if (material == nullptr || !material->enableInstancing(parameters))
+			{
+				isEnabled = false;
+			}
+		}
+		return isEnabled;
+	}
+
 	void Model::render(bool isUseLocalMaterial)
+	{
+		updateMeshTransforms();
+
+		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
+		{
+			iter->second->render(isUseLocalMaterial);
+		}
+	}
+
+	void Model::render(const Frustum& frustum, bool isUseLocalMaterial)
+	{
+		updateMeshTransforms();
+		cullMeshes(frustum);
+
+		if (!mBatchRanges.empty())
+		{
+			for (std::size_t i = 0; i < mBatchRanges.size();)
+			{
+				const std::string& batch = mBatchRanges[i].mBatch;
+				i = collectBatchDraws(i, mBatchDraws);
+				if (!mBatchDraws.empty())
+				{
+					mMeshes[batch]->renderRanges(mBatchDraws, isUseLocalMaterial);
+				}
+			}
+			return;
+		}
+
+		uint32_t index = 0;
+		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
+		{
+			if (mCullingBatch.isVisible(index++))
+			{
+				iter->second->render(isUseLocalMaterial);
+			}
+		}
+	}
+
+	void Model::submit(RenderQueue& queue)
+	{
+		updateMeshTransforms();
+
+		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
+		{
+			queue.submit(iter->second.get());
+		}
+	}
+
+	void Model::submit(RenderQueue& queue, const Frustum& frustum)
+	{
+		updateMeshTransforms();
+		cullMeshes(frustum);
+
+		if (!mBatchRanges.empty())
+		{
+			for (std::size_t i = 0; i < mBatchRanges.size();)
+			{
+				const std::string& batch = mBatchRanges[i].mBatch;
+				i = collectBatchDraws(i, mBatchDraws);
+				if (!mBatchDraws.empty())
+				{
+					queue.submit(mMeshes[batch].get());
+				}
+			}
+			return;
+		}
+
+		uint32_t index = 0;
+		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
+		{
+			if (mCullingBatch.isVisible(index++))
+			{
+				queue.submit(iter->second.get());
+			}
+		}
+	}
+
+	void Model::addTo(GpuCuller& culler)
+	{
+		updateMeshTransforms();
+
+		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
+		{
+			culler.add(iter->second.get());
+		}
+	}
+
+	void Model::addTo(World& world)
+	{
+		updateMeshTransforms();
+
+		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
+		{
+			world.addObject(iter->second.get());
+		}
+	}
+
+	void Model::removeFrom(World& world)
+	{
+		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
+		{
+			world.removeObject(iter->second.get());
+		}
+	}
+
+	void Model::setNodeTransform(const std::string& node, const glm::mat4& local)
+	{
+		int32_t index = mSceneGraph.findNode(node);
+		if (index > 0)
+		{
+			mSceneGraph.setLocalTransform(index, local);
+		}
+	}
+
+	const SceneGraph& Model::getSceneGraph() const
+	{
+		return mSceneGraph;
+	}
+
+	AABB Model::getWorldBounds() const
+	{
+		return mLocalBounds.transform(mModelMatrix);
+	}
+
+	void Model::updateMeshTransforms()
 	{
 		if (mAutoUpdated)
 		{
 			Object::update();
 		}
 
+		if (mSceneGraph.getNodeCount() == 0)
+		{
+			return;
+		}
+
+		// nothing below is visited unless the model or one of its nodes moved
+		mSceneGraph.setLocalTransform(0, mModelMatrix);
+		if (mSceneGraph.update() == 0)
+		{
+			return;
+		}
+
+		// only the sub-meshes of visited nodes have a new transform
+		uint32_t index = 0;
 		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
 		{
-			iter->second->setModelMatrix(mModelMatrix);
-			iter->second->render(isUseLocalMaterial);
+			int32_t node = mMeshNodes[index++];
+			if (mSceneGraph.wasUpdated(node))
+			{
+				iter->second->setModelMatrix(mSceneGraph.getWorldTransform(node));
+			}
 		}
 	}
 
+	void Model::cullMeshes(const Frustum& frustum)
+	{
+		mCullingBatch.clear();
+		if (!mBatchRanges.empty())
+		{
+			// the batches hang off node 0, which carries the model transform
+			for (const BatchRange& range : mBatchRanges)
+			{
+				mCullingBatch.add(range.mBounds.transform(mModelMatrix), range.mBoundingSphere.transform(mModelMatrix));
+			}
+		}
+		else
+		{
+			for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
+			{
+				mCullingBatch.add(iter->second->getWorldBounds(), iter->second->getWorldBoundingSphere());
+			}
+		}
+		mCullingBatch.cull(frustum);
+	}
+
+	std::size_t Model::collectBatchDraws(std::size_t first, std::vector<std::pair<uint32_t, uint32_t>>& draws) const
+	{
+		// the ranges of a batch follow each other here and in its index buffer
+		draws.clear();
+		std::size_t i = first;
+		for (; i < mBatchRanges.size() && mBatchRanges[i].mBatch == mBatchRanges[first].mBatch; i++)
+		{
+			const BatchRange& range = mBatchRanges[i];
+			if (!mCullingBatch.isVisible(static_cast<uint32_t>(i)) || range.mIndexCount == 0)
+			{
+				continue;
+			}
+
+			if (!draws.empty() && draws.back().first + draws.back().second == range.mFirstIndex)
+			{
+				draws.back().second += range.mIndexCount;
+			}
+			else
+			{
+				draws.push_back(std::make_pair(range.mFirstIndex, range.mIndexCount));
+			}
+		}
+		return i;
+	}
+
 	void Model::setTexture(const std::string& name, std::shared_ptr<Texture> texture)
 	{
 		for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
@@ -128,23 +471,122 @@ namespace es
 		}
 	}
 
-	void Model::handleNode(aiNode* node, const aiScene* scene, bool isLoadMaterials)
+	ImportedModel Model::importFromFile(const std::string& path)
 	{
-		for (unsigned int i = 0; i < node->mNumMeshes; i++)
+		auto timeStart = std::chrono::high_resolution_clock::now();
+
+		ImportedModel imported;
+		imported.mDirectory = Utility::pathWithoutFile(path);
+
+		// a valid cache next to the model skips assimp and the mesh optimisation entirely
+		MeshCache::Key cacheKey;
+		bool hasCacheKey = MeshCache::makeKey(path, kImportFlags, mWeldEpsilon, cacheKey);
+		imported.mCache = hasCacheKey ? MeshCache::open(MeshCache::cachePathFor(path), cacheKey) : nullptr;
+
+		if (imported.mCache)
 		{
-			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-			mMeshes.insert(std::make_pair(std::string(mesh->mName.C_Str()), handleMesh(mesh, scene, isLoadMaterials)));
+			imported.mEntries = imported.mCache->getEntries();
+			imported.mNodes = imported.mCache->getNodes();
 		}
+		else
+		{
+			Assimp::Importer importer;
+			const aiScene* scene = importer.ReadFile(path, kImportFlags);
+
+			if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+			{
+				SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, importer.GetErrorString());
+				return imported;
+			}
+
+			handleNodes(scene, imported.mNodes);
 
-		for (unsigned int i = 0; i < node->mNumChildren; i++)
+			// the scene is only read from here on, so the sub-meshes can be converted concurrently
+			ThreadPool* threadPool = ThreadPool::getThreadPool();
+			std::vector<std::future<MeshData>> conversions;
+			for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+			{
+				aiMesh* mesh = scene->mMeshes[i];
+				const std::string& directory = imported.mDirectory;
+				conversions.push_back(threadPool->enqueue([mesh, scene, &directory]() { return handleMesh(mesh, scene, directory); }));
+			}
+
+			for (std::future<MeshData>& conversion : conversions)
+			{
+				imported.mMeshData.push_back(threadPool->wait(conversion));
+			}
+
+			for (const MeshData& data : imported.mMeshData)
+			{
+				imported.mEntries.push_back(MeshCache::Entry::fromData(data));
+			}
+
+			if (hasCacheKey)
+			{
+				MeshCache::write(MeshCache::cachePathFor(path), cacheKey, imported.mEntries, imported.mNodes);
+			}
+		}
+
+		auto timeEnd = std::chrono::high_resolution_clock::now();
+		imported.mImportTime = std::chrono::duration<double, std::milli>(timeEnd - timeStart).count();
+		imported.mIsValid = true;
+		return imported;
+	}
+
+	void Model::handleNodes(const aiScene* scene, std::vector<MeshNode>& nodes)
+	{
+		// breadth first, the queue holds each node next to the index its parent got
+		std::vector<std::pair<const aiNode*, int32_t>> queue;
+		queue.push_back(std::make_pair(scene->mRootNode, -1));
+		for (std::size_t i = 0; i < queue.size(); i++)
 		{
-			handleNode(node->mChildren[i], scene, isLoadMaterials);
+			const aiNode* source = queue[i].first;
+
+			MeshNode node;
+			node.mName = source->mName.C_Str();
+			node.mParent = queue[i].second;
+			// assimp matrices are row major
+			const aiMatrix4x4& m = source->mTransformation;
+			node.mTransform = glm::mat4(m.a1, m.b1, m.c1, m.d1, m.a2, m.b2, m.c2, m.d2, m.a3, m.b3, m.c3, m.d3, m.a4, m.b4, m.c4, m.d4);
+			node.mMeshes.assign(source->mMeshes, source->mMeshes + source->mNumMeshes);
+			nodes.push_back(node);
+
+			for (unsigned int j = 0; j < source->mNumChildren; j++)
+			{
+				queue.push_back(std::make_pair(source->mChildren[j], static_cast<int32_t>(i)));
+			}
 		}
 	}
 
-	std::shared_ptr<Mesh> Model::handleMesh(aiMesh* mesh, const aiScene* scene, bool isLoadMaterials)
+	MeshData Model::handleMesh(aiMesh* mesh, const aiScene* scene, const std::string& directory)
 	{
-		std::vector<Vertex> vertices(mesh->mNumVertices);
+		std::vector<VertexFormat::Element> elements;
+		if (mesh->HasPositions())
+		{
+			elements.push_back({ VertexSemantic::Position, 3 });
+		}
+		if (mesh->HasTextureCoords(0))
+		{
+			elements.push_back({ VertexSemantic::Texcoord, 2 });
+		}
+		if (mesh->HasNormals())
+		{
+			elements.push_back({ VertexSemantic::Normal, 3 });
+		}
+		if (mesh->HasTangentsAndBitangents())
+		{
+			elements.push_back({ VertexSemantic::Tangent, 3 });
+			elements.push_back({ VertexSemantic::Bitangent, 3 });
+		}
+		if (mesh->HasVertexColors(0))
+		{
+			elements.push_back({ VertexSemantic::Color, 4 });
+		}
+		VertexFormat format(elements);
+
+		// interleave only the attributes the mesh actually has
+		std::vector<float> vertices;
+		vertices.reserve(mesh->mNumVertices * format.getVertexSize() / sizeof(float));
 		std::vector<uint32_t> indices(mesh->mNumFaces * 3);
 
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -152,32 +594,32 @@ namespace es
 			// handle vertex positions
 			if (mesh->HasPositions())
 			{
-				vertices.at(i).vPosition = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+				vertices.insert(vertices.end(), { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z });
 			}
 
 			// handle vertex texture coords
 			if (mesh->HasTextureCoords(0))
 			{
-				vertices.at(i).vTexcoord = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+				vertices.insert(vertices.end(), { mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y });
 			}
 
 			// handle vertex normals
 			if (mesh->HasNormals())
 			{
-				vertices.at(i).vNormal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+				vertices.insert(vertices.end(), { mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z });
 			}
 
 			// handle vertex tangents and bitangents
 			if (mesh->HasTangentsAndBitangents())
 			{
-				vertices.at(i).vTangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
-				vertices.at(i).vBitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+				vertices.insert(vertices.end(), { mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z });
+				vertices.insert(vertices.end(), { mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z });
 			}
 
 			// handle vertex colors
 			if (mesh->HasVertexColors(0))
 			{
-				vertices.at(i).vColor = glm::vec4(mesh->mColors[0][i].r, mesh->mColors[0][i].g, mesh->mColors[0][i].b, mesh->mColors[0][i].a);
+				vertices.insert(vertices.end(), { mesh->mColors[0][i].r, mesh->mColors[0][i].g, mesh->mColors[0][i].b, mesh->mColors[0][i].a });
 			}
 		}
 
@@ -193,8 +635,47 @@ namespace es
 			}
 		}
 
-		std::shared_ptr<Mesh> subMesh = Mesh::createWithData(std::string(mesh->mName.C_Str()), vertices, indices);
 		if (indices.size() > 0)
+		{
+			std::size_t vertexCount = mesh->mNumVertices;
+			VertexCacheStatistics before = MeshOptimizer::analyzeVertexCache(indices, vertexCount);
+
+			// assimp emits every face corner as its own vertex, merge identical ones before reordering
+			vertexCount = MeshOptimizer::weldVertices(vertices.data(), vertexCount, format.getVertexSize(), indices, mWeldEpsilon);
+			SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "mesh %s : welded %u -> %zu vertices", mesh->mName.C_Str(), mesh->mNumVertices, vertexCount);
+
+			// reorder for the post-transform cache first, then for overdraw and finally the vertices for fetch locality
+			MeshOptimizer::optimizeVertexCache(indices, vertexCount);
+			if (format.hasAttrib(VertexSemantic::Position))
+			{
+				MeshOptimizer::optimizeOverdraw(indices, vertices.data(), vertexCount, format.getVertexSize(), format.getAttrib(VertexSemantic::Position)->offset);
+			}
+			vertexCount = MeshOptimizer::optimizeVertexFetch(vertices.data(), vertexCount, format.getVertexSize(), indices);
+			vertices.resize(vertexCount * format.getVertexSize() / sizeof(float));
+
+			VertexCacheStatistics after = MeshOptimizer::analyzeVertexCache(indices, vertexCount);
+			SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "mesh %s : ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+				mesh->mName.C_Str(), before.mACMR, after.mACMR, before.mATVR, after.mATVR);
+		}
+
+		MeshData data;
+		data.mName = mesh->mName.C_Str();
+		data.mFormat = format;
+		data.mVertexCount = format.getVertexSize() > 0 ? static_cast<uint32_t>(vertices.size() * sizeof(float) / format.getVertexSize()) : 0;
+		data.mVertices.resize(vertices.size() * sizeof(float));
+		std::memcpy(data.mVertices.data(), vertices.data(), data.mVertices.size());
+		data.mIndexType = ElementBuffer::selectIndexType(indices);
+		data.mIndexCount = static_cast<uint32_t>(indices.size());
+		data.mIndices = ElementBuffer::packIndices(indices, data.mIndexType);
+		data.mTextureFiles = handleTextures(mesh, scene, directory);
+		return data;
+	}
+
+	std::shared_ptr<Mesh> Model::createMesh(const MeshCache::Entry& entry, bool isLoadMaterials)
+	{
+		std::shared_ptr<const MeshGeometry> geometry = MeshGeometry::createWithPackedData(entry.mFormat, entry.mVertices, entry.mVertexCount, entry.mIndices, entry.mIndexCount, entry.mIndexType);
+		std::shared_ptr<Mesh> subMesh = Mesh::createWithGeometry(entry.mName, geometry);
+		if (entry.mIndexCount > 0)
 		{
 			subMesh->setDrawType(Mesh::DrawType::ELEMENTS);
 		}
@@ -206,14 +687,176 @@ namespace es
 
 		if (isLoadMaterials)
 		{
-			std::shared_ptr<Material> mat = handleMaterial(mesh, scene);
+			std::shared_ptr<Program> singleProgram = Program::createFromFiles(mName + "_program", mShaderFiles);
+			std::shared_ptr<Material> mat = Material::createFromProgram(mName + "_" + entry.mName + "_mat", singleProgram, entry.mTextureFiles);
 			subMesh->setMaterial(mat);
 		}
 
 		return subMesh;
 	}
 
-	std::shared_ptr<Material> Model::handleMaterial(aiMesh* mesh, const aiScene* scene)
+	void Model::createStaticBatches(const std::vector<MeshCache::Entry>& entries, const std::vector<std::pair<uint32_t, int32_t>>& references, bool isLoadMaterials, std::unordered_map<std::string, int32_t>& meshNodes)
+	{
+		// one batch per vertex layout and texture set, without loaded materials the textures do not tell meshes apart
+		std::vector<std::vector<std::pair<uint32_t, int32_t>>> groups;
+		for (const std::pair<uint32_t, int32_t>& reference : references)
+		{
+			const MeshCache::Entry& entry = entries[reference.first];
+			if (entry.mVertexCount == 0)
+			{
+				continue;
+			}
+
+			auto iter = std::find_if(groups.begin(), groups.end(), [&](const std::vector<std::pair<uint32_t, int32_t>>& group)
+			{
+				const MeshCache::Entry& first = entries[group.front().first];
+				return first.mFormat == entry.mFormat && (!isLoadMaterials || first.mTextureFiles == entry.mTextureFiles);
+			});
+			if (iter == groups.end())
+			{
+				groups.emplace_back();
+				iter = groups.end() - 1;
+			}
+			iter->push_back(reference);
+		}
+
+		// vertices are baked relative to the root so the model matrix still places the whole model
+		glm::mat4 rootInverse = glm::inverse(mSceneGraph.getWorldTransform(0));
+		for (std::size_t i = 0; i < groups.size(); i++)
+		{
+			const std::vector<std::pair<uint32_t, int32_t>>& group = groups[i];
+			const MeshCache::Entry& first = entries[group.front().first];
+			const VertexFormat& format = first.mFormat;
+			std::string batchName = mName + "_batch_" + std::to_string(i);
+
+			uint32_t totalVertices = 0;
+			for (const std::pair<uint32_t, int32_t>& reference : group)
+			{
+				totalVertices += entries[reference.first].mVertexCount;
+			}
+
+			// streams stay one after another, each one is filled separately
+			std::vector<std::vector<uint8_t>> streams(format.getStreamCount());
+			for (uint32_t stream = 0; stream < format.getStreamCount(); stream++)
+			{
+				streams[stream].reserve(static_cast<std::size_t>(totalVertices) * format.getStride(stream));
+			}
+			std::vector<uint32_t> indices;
+
+			for (const std::pair<uint32_t, int32_t>& reference : group)
+			{
+				const MeshCache::Entry& entry = entries[reference.first];
+				glm::mat4 transform = rootInverse * mSceneGraph.getWorldTransform(reference.second);
+				glm::mat3 linear = glm::mat3(transform);
+				glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+
+				BatchRange range;
+				range.mName = entry.mName;
+				range.mBatch = batchName;
+				range.mFirstIndex = static_cast<uint32_t>(indices.size());
+				range.mFirstVertex = static_cast<uint32_t>(streams.empty() ? 0 : streams[0].size() / format.getStride(0));
+				range.mVertexCount = entry.mVertexCount;
+
+				const uint8_t* source = static_cast<const uint8_t*>(entry.mVertices);
+				for (uint32_t stream = 0; stream < format.getStreamCount(); stream++)
+				{
+					std::size_t begin = streams[stream].size();
+					uint32_t stride = format.getStride(stream);
+					const uint8_t* streamData = source + format.getStreamOffset(stream, entry.mVertexCount);
+					streams[stream].insert(streams[stream].end(), streamData, streamData + static_cast<std::size_t>(entry.mVertexCount) * stride);
+
+					for (const VertexAttrib& attrib : format.getAttribs())
+					{
+						// only float vectors have a direction to transform, texcoords and colors are copied as they are
+						bool isPosition = attrib.semantic == VertexSemantic::Position;
+						bool isNormal = attrib.semantic == VertexSemantic::Normal;
+						bool isTangent = attrib.semantic == VertexSemantic::Tangent || attrib.semantic == VertexSemantic::Bitangent;
+						if (attrib.stream != stream || attrib.type != GL_FLOAT || attrib.numSubElements < 3 || !(isPosition || isNormal || isTangent))
+						{
+							continue;
+						}
+
+						for (uint32_t v = 0; v < entry.mVertexCount; v++)
+						{
+							float* value = reinterpret_cast<float*>(streams[stream].data() + begin + static_cast<std::size_t>(v) * stride + attrib.offset);
+							glm::vec3 vector = glm::vec3(value[0], value[1], value[2]);
+							if (isPosition)
+							{
+								vector = glm::vec3(transform * glm::vec4(vector, 1.0f));
+							}
+							else
+							{
+								vector = isNormal ? normalMatrix * vector : linear * vector;
+								float length = glm::length(vector);
+								vector = length > 0.0f ? vector / length : vector;
+							}
+							std::memcpy(value, &vector[0], sizeof(float) * 3);
+						}
+					}
+				}
+
+				if (entry.mIndexCount > 0)
+				{
+					for (uint32_t j = 0; j < entry.mIndexCount; j++)
+					{
+						uint32_t index = 0;
+						if (entry.mIndexType == GL_UNSIGNED_BYTE)
+						{
+							index = static_cast<const uint8_t*>(entry.mIndices)[j];
+						}
+						else if (entry.mIndexType == GL_UNSIGNED_SHORT)
+						{
+							index = static_cast<const uint16_t*>(entry.mIndices)[j];
+						}
+						else
+						{
+							index = static_cast<const uint32_t*>(entry.mIndices)[j];
+						}
+						indices.push_back(range.mFirstVertex + index);
+					}
+				}
+				else
+				{
+					for (uint32_t j = 0; j < entry.mVertexCount; j++)
+					{
+						indices.push_back(range.mFirstVertex + j);
+					}
+				}
+				range.mIndexCount = static_cast<uint32_t>(indices.size()) - range.mFirstIndex;
+
+				const VertexAttrib* position = format.getAttrib(VertexSemantic::Position);
+				if (position != nullptr && position->type == GL_FLOAT)
+				{
+					uint32_t stride = format.getStride(position->stream);
+					const uint8_t* positions = streams[position->stream].data() + static_cast<std::size_t>(range.mFirstVertex) * stride + position->offset;
+					computeBounds(positions, stride, position->numSubElements, range.mVertexCount, range.mBounds, range.mBoundingSphere);
+				}
+				mBatchRanges.push_back(range);
+			}
+
+			std::vector<uint8_t> vertices;
+			for (const std::vector<uint8_t>& stream : streams)
+			{
+				vertices.insert(vertices.end(), stream.begin(), stream.end());
+			}
+
+			std::shared_ptr<Mesh> batch = Mesh::createWithGeometry(batchName, MeshGeometry::createWithData(format, vertices, indices));
+			batch->setDrawType(Mesh::DrawType::ELEMENTS);
+			batch->setAutoUpdated(false);
+			if (isLoadMaterials)
+			{
+				std::shared_ptr<Program> singleProgram = Program::createFromFiles(mName + "_program", mShaderFiles);
+				batch->setMaterial(Material::createFromProgram(batchName + "_mat", singleProgram, first.mTextureFiles));
+			}
+
+			mMeshes.insert(std::make_pair(batchName, batch));
+			meshNodes[batchName] = 0;
+		}
+
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "model %s : %zu sub-meshes merged into %zu static batches", mName.c_str(), references.size(), groups.size());
+	}
+
+	std::unordered_map<std::string, std::string> Model::handleTextures(aiMesh* mesh, const aiScene* scene, const std::string& directory)
 	{
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 		aiTextureType texType = aiTextureType::aiTextureType_DIFFUSE;
@@ -229,13 +872,11 @@ namespace es
 				material->GetTexture(texType, j, &str);
 			
 				std::string texName = Utility::fileWithoutPath(std::string(str.C_Str()));
-				textureFiles.insert(std::make_pair(kTextureTypeStrings[i] + "_" + std::to_string(j), mDirectory + "/" + texName));
+				textureFiles.insert(std::make_pair(kTextureTypeStrings[i] + "_" + std::to_string(j), directory + "/" + texName));
 			}
 			texType = static_cast<aiTextureType>(texType + 1);
 		}
-		
-		std::shared_ptr<Program> singleProgram = Program::createFromFiles(mName + "_program", mShaderFiles);
-		std::shared_ptr<Material> subMaterial = Material::createFromProgram(mName + "_" + std::string(mesh->mName.C_Str()) + "_mat", singleProgram, textureFiles);
-		return subMaterial;
+
+		return textureFiles;
 	}
 }
\ No newline at end of file
@@ -10,45 +10,157 @@
 #include <map>
 #include <unordered_map>
 #include <vector>
+#include <chrono>
+#include <cstring>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
 #include <mesh.h>
+#include <renderqueue.h>
+#include <gpuculler.h>
+#include <culling.h>
+#include <scenegraph.h>
+#include <meshoptimizer.h>
+#include <meshcache.h>
+#include <threadpool.h>
 #include <utility.h>
 
 namespace es
 {
+	// cpu side result of loading a model file, produced on any thread and uploaded on the context thread
+	struct ImportedModel
+	{
+		std::string mDirectory;
+		// keeps the mapping alive while entries point into it
+		std::unique_ptr<MeshCache> mCache;
+		// owns the data of entries after an assimp import
+		std::vector<MeshData> mMeshData;
+		std::vector<MeshCache::Entry> mEntries;
+		// node hierarchy referencing mEntries by index
+		std::vector<MeshNode> mNodes;
+		double mImportTime = 0.0;
+		bool mIsValid = false;
+	};
+
+	// a sub-mesh merged into a static batch
+	struct BatchRange
+	{
+		std::string mName;
+		// batch mesh in the model that holds the range
+		std::string mBatch;
+		uint32_t mFirstIndex;
+		uint32_t mIndexCount;
+		uint32_t mFirstVertex;
+		uint32_t mVertexCount;
+		// volumes of the baked vertices, relative to the model like the batch
+		AABB mBounds;
+		BoundingSphere mBoundingSphere;
+	};
+
+	struct ModelDesc
+	{
+		std::string mName;
+		std::string mPath;
+		std::vector<std::string> mShaderFiles;
+		bool mIsLoadMaterials = true;
+	};
+
 	class Model : public Object
 	{
 	public:
 		Model(const std::string& name, const std::string& path, const std::vector<std::string>& shaderFiles, bool isLoadMaterials = true);
+		Model(const std::string& name, ImportedModel&& imported, const std::vector<std::string>& shaderFiles, bool isLoadMaterials = true);
 		Model(const std::string& name, const Model* duplicateModel);
 		~Model();
 
 		static std::shared_ptr<Model> createFromFile(const std::string& name, const std::string& path, const std::vector<std::string>& shaderFiles, bool isLoadMaterials = true);
 
+		// imports all models concurrently on the thread pool, buffers are created on the calling thread in the order of descs
+		static std::vector<std::shared_ptr<Model>> createFromFiles(const std::vector<ModelDesc>& descs);
+
+		// thread safe, touches no gl state
+		static ImportedModel importFromFile(const std::string& path);
+
 		static std::shared_ptr<Model> clone(const std::string& name, const Model* duplicateModel);
 
+		// 0 welds bit-identical vertices only, larger values snap every component to a grid of epsilon sized cells and merge the
+		// vertices that land in the same cells. this is not a distance test, two vertices closer than epsilon on either side of a
+		// cell border stay apart. values too large for the grid only weld when bit-identical
+		static void setWeldEpsilon(float epsilon);
+
+		// models created while enabled merge the sub-meshes that share vertex layout and textures into one mesh each, with the
+		// node transforms baked into the vertices. one draw per material, but setNodeTransform no longer moves anything.
+		// culled renders test the sub-meshes and draw each run of visible neighbours in a batch with one draw
+		static void setStaticBatching(bool isEnabled);
+
+		// sub-meshes of the static batches, empty for models created without static batching
+		const std::vector<BatchRange>& getBatchRanges() const;
+
 		void setMaterial(std::shared_ptr<Material> mMat);
 
+		// Material::enableInstancing on the materials of the sub-meshes, clones made afterwards share them. false when one has no
+		// instanced variant
+		bool enableInstancing(const std::vector<InstanceParameter>& parameters = {});
+
 		void render(bool isUseLocalMaterial = true);
 
+		// only draws the sub-meshes whose world volumes touch the frustum, passes from other viewpoints use the plain render
+		void render(const Frustum& frustum, bool isUseLocalMaterial = true);
+
+		// hands the sub-meshes to the queue instead of drawing them right away. the queue draws whole meshes, a static batch
+		// goes in when one of its ranges is visible
+		void submit(RenderQueue& queue);
+		void submit(RenderQueue& queue, const Frustum& frustum);
+
+		// registers the sub-meshes in their current pose, the culler draws them from then on
+		void addTo(GpuCuller& culler);
+
+		// registers the sub-meshes in the world's object tree, render and submit move them there along with their transforms
+		void addTo(World& world);
+
+		void removeFrom(World& world);
+
 		template<typename T>
-		void setUniform(const std::string& name, const T& value)
+		void setUniform(UniformId id, const T& value)
 		{
 			for (auto iter = mMeshes.begin(); iter != mMeshes.end(); iter++)
 			{
-				iter->second->setUniform(name, value);
+				iter->second->setUniform(id, value);
 			}
 		}
 
 		void setTexture(const std::string& name, std::shared_ptr<Texture> texture);
+
+		// replaces the local transform of an imported node, the sub-meshes below it follow on the next render
+		void setNodeTransform(const std::string& node, const glm::mat4& local);
+
+		const SceneGraph& getSceneGraph() const;
+
+		// union of the sub-mesh boxes in the imported pose under the model transform
+		virtual AABB getWorldBounds() const override;
 	private:
-		void handleNode(aiNode* node, const aiScene* scene, bool isLoadMaterials);
-		std::shared_ptr<Mesh> handleMesh(aiMesh* mesh, const aiScene* scene, bool isLoadMaterials);
-		std::shared_ptr<Material> handleMaterial(aiMesh* mesh, const aiScene* scene);
+		// import side, fills cpu data only and may run on worker threads
+		static void handleNodes(const aiScene* scene, std::vector<MeshNode>& nodes);
+		static MeshData handleMesh(aiMesh* mesh, const aiScene* scene, const std::string& directory);
+		static std::unordered_map<std::string, std::string> handleTextures(aiMesh* mesh, const aiScene* scene, const std::string& directory);
+
+		// uploads a sub-mesh from imported data or a mapped mesh cache
+		std::shared_ptr<Mesh> createMesh(const MeshCache::Entry& entry, bool isLoadMaterials);
+
+		// merges the referenced sub-meshes, each placed by the world transform of its node, into one mesh per batch key and
+		// attaches the batches to the root node
+		void createStaticBatches(const std::vector<MeshCache::Entry>& entries, const std::vector<std::pair<uint32_t, int32_t>>& references, bool isLoadMaterials, std::unordered_map<std::string, int32_t>& meshNodes);
+
+		// pushes the model transform into the scene graph and the node transforms into the sub-meshes
+		void updateMeshTransforms();
+
+		// moves the sub-meshes to their node transforms and tests them against the frustum, static batches are tested per range
+		void cullMeshes(const Frustum& frustum);
+
+		// visible ranges of the batch whose ranges start at first, merged where they touch. returns the index after its ranges
+		std::size_t collectBatchDraws(std::size_t first, std::vector<std::pair<uint32_t, uint32_t>>& draws) const;
 
 		std::string mDirectory;
 
@@ -56,9 +168,28 @@ namespace es
 
 		std::map<std::string, std::shared_ptr<Mesh>> mMeshes;
 
+		// node 0 carries the model transform, the imported hierarchy hangs below it
+		SceneGraph mSceneGraph;
+		// scene graph node of every sub-mesh in mMeshes order
+		std::vector<int32_t> mMeshNodes;
+		// sub-mesh boxes in the imported pose relative to the model
+		AABB mLocalBounds;
+
+		// one entry per sub-mesh in mMeshes order, or per batch range for static batches, refilled by every culled render
+		CullingBatch mCullingBatch;
+		std::vector<std::pair<uint32_t, uint32_t>> mBatchDraws;
+
 		static std::array<std::string, 11> kTextureTypeStrings;
 
 		static std::unordered_map<std::string, std::shared_ptr<Model>> mModelCache;
+
+		static float mWeldEpsilon;
+
+		static bool mIsStaticBatching;
+
+		std::vector<BatchRange> mBatchRanges;
+
+		static const uint32_t kImportFlags;
 	};
 }
 
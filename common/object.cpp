@@ -1,5 +1,8 @@
 #include "object.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace es
 {
 	Object::Object(const std::string& name)
@@ -17,6 +20,20 @@ namespace es
 
 	Object::~Object()
 	{
+		if (mParent != nullptr)
+		{
+			std::vector<Object*>& siblings = mParent->mChildren;
+			siblings.erase(std::remove(siblings.begin(), siblings.end(), this), siblings.end());
+		}
+		for (Object* child : mChildren)
+		{
+			child->mParent = nullptr;
+		}
+
+		if (mBoundsProxy != AABBTree::kNullNode)
+		{
+			World::getWorld()->removeObject(this);
+		}
 		camera = nullptr;
 	}
 
@@ -38,17 +55,9 @@ namespace es
 		mTransformUpdated = false;
 		if (mIsDirty)
 		{
-			mModelMatrix = glm::mat4(1.0f);
-
-			mModelMatrix = glm::translate(mModelMatrix, mPosition);
-
-			mModelMatrix = glm::rotate(mModelMatrix, glm::radians(mRotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-			mModelMatrix = glm::rotate(mModelMatrix, glm::radians(mRotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-			mModelMatrix = glm::rotate(mModelMatrix, glm::radians(mRotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-
-			mModelMatrix = glm::scale(mModelMatrix, mScaling);
-
+			mLocalMatrix = composeTransform(mPosition, mRotation, mScaling);
 			mIsDirty = false;
+			updateWorldMatrix();
 		}
 		mTransformUpdated = true;
 	}
@@ -117,6 +126,11 @@ namespace es
 	void Object::setModelMatrix(const glm::mat4& model)
 	{
 		this->mModelMatrix = model;
+		notifyMoved();
+		for (Object* child : mChildren)
+		{
+			child->updateWorldMatrix();
+		}
 	}
 
 	const glm::mat4& Object::getModelMatrix() const
@@ -124,8 +138,89 @@ namespace es
 		return mModelMatrix;
 	}
 
+	const glm::mat4& Object::getLocalMatrix() const
+	{
+		return mLocalMatrix;
+	}
+
+	void Object::setParent(Object* parent)
+	{
+		if (parent == mParent || parent == this)
+		{
+			return;
+		}
+
+		if (mParent != nullptr)
+		{
+			std::vector<Object*>& siblings = mParent->mChildren;
+			siblings.erase(std::remove(siblings.begin(), siblings.end(), this), siblings.end());
+		}
+
+		mParent = parent;
+		if (mParent != nullptr)
+		{
+			mParent->mChildren.push_back(this);
+		}
+		updateWorldMatrix();
+	}
+
+	Object* Object::getParent() const
+	{
+		return mParent;
+	}
+
+	const std::vector<Object*>& Object::getChildren() const
+	{
+		return mChildren;
+	}
+
 	void Object::setAutoUpdated(bool autoUpdated)
 	{
 		this->mAutoUpdated = autoUpdated;
 	}
+
+	bool Object::isAutoUpdated() const
+	{
+		return mAutoUpdated;
+	}
+
+	AABB Object::getWorldBounds() const
+	{
+		return AABB();
+	}
+
+	void Object::notifyMoved()
+	{
+		if (mBoundsProxy != AABBTree::kNullNode)
+		{
+			World::getWorld()->updateObject(this);
+		}
+	}
+
+	void Object::updateWorldMatrix()
+	{
+		mModelMatrix = mParent != nullptr ? mParent->mModelMatrix * mLocalMatrix : mLocalMatrix;
+		notifyMoved();
+		for (Object* child : mChildren)
+		{
+			child->updateWorldMatrix();
+		}
+	}
+
+	glm::mat4 Object::composeTransform(const glm::vec3& position, const glm::vec3& euler, const glm::vec3& scaling)
+	{
+		float cx = std::cos(glm::radians(euler.x));
+		float sx = std::sin(glm::radians(euler.x));
+		float cy = std::cos(glm::radians(euler.y));
+		float sy = std::sin(glm::radians(euler.y));
+		float cz = std::cos(glm::radians(euler.z));
+		float sz = std::sin(glm::radians(euler.z));
+
+		glm::mat4 matrix;
+		matrix[0] = glm::vec4(cy * cz, sx * sy * cz + cx * sz, sx * sz - cx * sy * cz, 0.0f) * scaling.x;
+		matrix[1] = glm::vec4(-cy * sz, cx * cz - sx * sy * sz, cx * sy * sz + sx * cz, 0.0f) * scaling.y;
+		matrix[2] = glm::vec4(sy, -sx * cy, cx * cy, 0.0f) * scaling.z;
+		matrix[3] = glm::vec4(position, 1.0f);
+		return matrix;
+	}
 }
\ No newline at end of file
@@ -8,9 +8,11 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
 #include <camera.h>
 #include <world.h>
+#include <geometry.h>
 
 namespace es
 {
@@ -50,12 +52,38 @@ namespace es
 
 		const glm::vec3& getScaling() const;
 
+		// sets the world matrix directly, children follow it
 		void setModelMatrix(const glm::mat4& model);
 
+		// world matrix, the parent's world matrix times the local one
 		const glm::mat4& getModelMatrix() const;
 
+		const glm::mat4& getLocalMatrix() const;
+
+		// the object keeps its local transform and moves with the parent from now on, nullptr detaches it.
+		// parents do not own their children
+		void setParent(Object* parent);
+
+		Object* getParent() const;
+
+		const std::vector<Object*>& getChildren() const;
+
 		void setAutoUpdated(bool autoUpdated);
+
+		bool isAutoUpdated() const;
+
+		// world space box the world's object tree is built from, objects without geometry return an invalid box
+		virtual AABB getWorldBounds() const;
 	protected:
+		// tells the world the bounds moved when the object is registered
+		void notifyMoved();
+
+		// recomputes the world matrix from the parent and pushes it down the subtree, static subtrees never get here
+		void updateWorldMatrix();
+
+		// translate * rotate x * rotate y * rotate z * scale built in one go, euler angles in degrees
+		static glm::mat4 composeTransform(const glm::vec3& position, const glm::vec3& euler, const glm::vec3& scaling);
+
 		std::string mName;
 
 		glm::vec3 mPosition;
@@ -63,6 +91,10 @@ namespace es
 		glm::vec3 mScaling;
 
 		glm::mat4 mModelMatrix;
+		glm::mat4 mLocalMatrix = glm::mat4(1.0f);
+
+		Object* mParent = nullptr;
+		std::vector<Object*> mChildren;
 
 		Camera* camera;
 
@@ -72,6 +104,11 @@ namespace es
 		bool mTransformUpdated;
 		// is transform updated not yet
 		bool mIsDirty;
+
+		// leaf in the world's object tree, set by World::addObject
+		int32_t mBoundsProxy = AABBTree::kNullNode;
+
+		friend class World;
 	};
 }
 
@@ -1,20 +1,102 @@
 #include "program.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <buffer.h>
 #include <utility.h>
+#include <statistics.h>
+#include <statecache.h>
 
 namespace es
 {
+	namespace
+	{
+		// bytes of one element as the client passes it, samplers and bools are set as int
+		uint32_t getUniformTypeSize(GLenum type)
+		{
+			switch (type)
+			{
+				case GL_FLOAT_VEC2:
+				case GL_INT_VEC2:
+				case GL_UNSIGNED_INT_VEC2:
+				case GL_BOOL_VEC2:
+					return 8;
+				case GL_FLOAT_VEC3:
+				case GL_INT_VEC3:
+				case GL_UNSIGNED_INT_VEC3:
+				case GL_BOOL_VEC3:
+					return 12;
+				case GL_FLOAT_VEC4:
+				case GL_INT_VEC4:
+				case GL_UNSIGNED_INT_VEC4:
+				case GL_BOOL_VEC4:
+				case GL_FLOAT_MAT2:
+					return 16;
+				case GL_FLOAT_MAT2x3:
+				case GL_FLOAT_MAT3x2:
+					return 24;
+				case GL_FLOAT_MAT2x4:
+				case GL_FLOAT_MAT4x2:
+					return 32;
+				case GL_FLOAT_MAT3:
+					return 36;
+				case GL_FLOAT_MAT3x4:
+				case GL_FLOAT_MAT4x3:
+					return 48;
+				case GL_FLOAT_MAT4:
+					return 64;
+				default:
+					return 4;
+			}
+		}
+
+		uint32_t getUniformColumnCount(GLenum type)
+		{
+			switch (type)
+			{
+				case GL_FLOAT_MAT2:
+				case GL_FLOAT_MAT2x3:
+				case GL_FLOAT_MAT2x4:
+					return 2;
+				case GL_FLOAT_MAT3:
+				case GL_FLOAT_MAT3x2:
+				case GL_FLOAT_MAT3x4:
+					return 3;
+				case GL_FLOAT_MAT4:
+				case GL_FLOAT_MAT4x2:
+				case GL_FLOAT_MAT4x3:
+					return 4;
+				default:
+					return 1;
+			}
+		}
+	}
+
 	std::unordered_map<std::string, std::shared_ptr<Program>> Program::mProgramCache;
 
+	Program* Program::mCurrentProgram = nullptr;
+
 	Program::Program(const std::string& name, const std::vector<Shader*>& shaders)
 		:mID(0),
-		 mName(name)
+		 mName(name),
+		 mUniformWriteCount(0),
+		 mIsDrawBlockDirty(false),
+		 mDrawBlockOffset(0),
+		 mDrawBlockSerial(0)
 	{
 		initFromShaders(shaders);
 	}
 
-	Program::Program(const std::string& name, const std::vector<std::string>& files)
+	Program::Program(const std::string& name, const std::vector<std::string>& files, const std::vector<std::string>& defines)
 		:mID(0),
-		 mName(name)
+		 mName(name),
+		 mFiles(files),
+		 mDefines(defines),
+		 mUniformWriteCount(0),
+		 mIsDrawBlockDirty(false),
+		 mDrawBlockOffset(0),
+		 mDrawBlockSerial(0)
 	{
 		std::vector<Shader*> shaders;
 		for (std::size_t i = 0; i < files.size(); i++)
@@ -23,19 +105,19 @@ namespace es
 			Shader* shader;
 			if (ext == "vert")
 			{
-				shader = VertexShader::createFromFile(files[i]);
+				shader = VertexShader::createFromFile(files[i], defines);
 			}
 			else if (ext == "geom")
 			{
-				shader = GeometryShader::createFromFile(files[i]);
+				shader = GeometryShader::createFromFile(files[i], defines);
 			}
 			else if (ext == "frag")
 			{
-				shader = FragmentShader::createFromFile(files[i]);
+				shader = FragmentShader::createFromFile(files[i], defines);
 			}
 			else if (ext == "comp")
 			{
-				shader = ComputeShader::createFromFile(files[i]);
+				shader = ComputeShader::createFromFile(files[i], defines);
 			}
 
 			shaders.push_back(shader);
@@ -46,8 +128,12 @@ namespace es
 
 	Program::~Program()
 	{
+		if (mCurrentProgram == this)
+		{
+			mCurrentProgram = nullptr;
+		}
 		mUniformLocationMap.swap(std::unordered_map<std::string, GLuint>());
-		GLES_CHECK_ERROR(glDeleteProgram(mID));
+		StateCache::deleteProgram(mID);
 	}
 
 	std::shared_ptr<Program> Program::createFromShaders(const std::string& name, const std::vector<Shader*>& shaders)
@@ -64,11 +150,11 @@ namespace es
 		}
 	}
 
-	std::shared_ptr<Program> Program::createFromFiles(const std::string& name, const std::vector<std::string>& files)
+	std::shared_ptr<Program> Program::createFromFiles(const std::string& name, const std::vector<std::string>& files, const std::vector<std::string>& defines)
 	{
 		if (mProgramCache.find(name) == mProgramCache.end())
 		{
-			std::shared_ptr<Program> program = std::make_shared<Program>(name, files);
+			std::shared_ptr<Program> program = std::make_shared<Program>(name, files, defines);
 			mProgramCache[name] = program;
 			return program;
 		}
@@ -78,14 +164,57 @@ namespace es
 		}
 	}
 
+	std::shared_ptr<Program> Program::createVariant(const std::string& define)
+	{
+		if (mFiles.empty())
+		{
+			return nullptr;
+		}
+
+		std::vector<std::string> defines = mDefines;
+		defines.push_back(define);
+		return createFromFiles(mName + "_" + define, mFiles, defines);
+	}
+
 	void Program::apply()
 	{
-		GLES_CHECK_ERROR(glUseProgram(mID));
+		StateCache::useProgram(mID);
+		mCurrentProgram = this;
 	}
 
 	void Program::unapply()
 	{
-		GLES_CHECK_ERROR(glUseProgram(0));
+		StateCache::useProgram(0);
+		mCurrentProgram = nullptr;
+	}
+
+	void Program::commitDrawParameters()
+	{
+		Program* program = mCurrentProgram;
+		if (program == nullptr || program->mDrawBlock.empty())
+		{
+			return;
+		}
+
+		// unchanged parameters drawn again in the same frame reuse the range written for the last draw
+		StreamBuffer* stream = StreamBuffer::getUniformStream();
+		if (program->mIsDrawBlockDirty || program->mDrawBlockSerial != stream->getSerial())
+		{
+			std::size_t offset = stream->write(program->mDrawBlock.data(), program->mDrawBlock.size());
+			if (offset == StreamBuffer::kInvalidOffset)
+			{
+				return;
+			}
+
+			program->mDrawBlockOffset = offset;
+			program->mDrawBlockSerial = stream->getSerial();
+			program->mIsDrawBlockDirty = false;
+
+			FrameStatistics& statistics = Statistics::getCurrentFrame();
+			statistics.mDrawBlockUploads++;
+			statistics.mDrawBlockBytes += static_cast<uint32_t>(program->mDrawBlock.size());
+		}
+		stream->bindRange(kDrawBlockBinding, program->mDrawBlockOffset, program->mDrawBlock.size());
 	}
 
 	void Program::uniformBlockBinding(std::string name, int binding)
@@ -102,206 +231,406 @@ namespace es
 		}
 	}
 
-	bool Program::setUniform(const std::string& name, const int& value)
+	UniformHandle Program::getUniformHandle(UniformId id, uint32_t element) const
+	{
+		UniformHandle handle;
+
+		auto iter = std::lower_bound(mUniformLookup.begin(), mUniformLookup.end(), std::make_pair(id.getHash(), 0u));
+		if (iter == mUniformLookup.end() || iter->first != id.getHash())
+		{
+			return handle;
+		}
+
+		// element slots of an array follow each other in the table
+		if (element < mUniformSlots[iter->second].mArrayRemaining)
+		{
+			handle.mIndex = static_cast<int32_t>(iter->second + element);
+		}
+		return handle;
+	}
+
+	Program::UniformSlot* Program::getUniformSlot(UniformHandle handle, uint32_t count)
+	{
+		if (!handle.isValid() || static_cast<std::size_t>(handle.mIndex) >= mUniformSlots.size())
+		{
+			return nullptr;
+		}
+
+		UniformSlot* slot = &mUniformSlots[handle.mIndex];
+		return count <= slot->mArrayRemaining ? slot : nullptr;
+	}
+
+	bool Program::updateShadow(UniformSlot* slot, const void* data, uint32_t size, uint32_t count)
+	{
+		FrameStatistics& statistics = Statistics::getCurrentFrame();
+
+		// a value of another size than the declared type is passed through untracked
+		if (size == slot->mShadowSize)
+		{
+			bool isKnown = true;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				isKnown = isKnown && slot[i].mHasShadow;
+			}
+
+			uint8_t* shadow = mUniformShadow.data() + slot->mShadowOffset;
+			if (isKnown && std::memcmp(shadow, data, size * count) == 0)
+			{
+				statistics.mUniformUploadsSkipped++;
+				return false;
+			}
+
+			std::memcpy(shadow, data, size * count);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				slot[i].mHasShadow = true;
+			}
+		}
+
+		mUniformWriteCount++;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			slot[i].mWriteSerial = mUniformWriteCount;
+		}
+
+		statistics.mUniformUploads++;
+		return true;
+	}
+
+	bool Program::writeDrawBlock(UniformSlot* slot, const void* data, uint32_t size, uint32_t count)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		if (slot->mBlockOffset < 0)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniform1i(mID, mUniformLocationMap[name], value));
+		// std140 pads array elements and matrix columns to vec4, the client data is tightly packed
+		const uint8_t* source = static_cast<const uint8_t*>(data);
+		uint32_t columnSize = size / slot->mColumns;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint8_t* element = mDrawBlock.data() + slot[i].mBlockOffset;
+			for (uint32_t column = 0; column < slot->mColumns; column++)
+			{
+				std::memcpy(element + column * slot->mMatrixStride, source + i * size + column * columnSize, columnSize);
+			}
+		}
+		mIsDrawBlockDirty = true;
+		return true;
+	}
+
+	uint64_t Program::getUniformWriteSerial(UniformHandle handle) const
+	{
+		if (!handle.isValid() || static_cast<std::size_t>(handle.mIndex) >= mUniformSlots.size())
+		{
+			return 0;
+		}
+		return mUniformSlots[handle.mIndex].mWriteSerial;
+	}
+
+	bool Program::setUniform(UniformHandle handle, const int& value)
+	{
+		UniformSlot* slot = getUniformSlot(handle, 1);
+		if (slot == nullptr)
+		{
+			return false;
+		}
+
+		if (!updateShadow(slot, &value, sizeof(value), 1) || writeDrawBlock(slot, &value, sizeof(value), 1))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniform1i(mID, slot->mLocation, value));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const bool& value)
+	bool Program::setUniform(UniformHandle handle, const bool& value)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, 1);
+		if (slot == nullptr)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniform1i(mID, mUniformLocationMap[name], (int)value));
+		int intValue = value;
+		if (!updateShadow(slot, &intValue, sizeof(intValue), 1) || writeDrawBlock(slot, &intValue, sizeof(intValue), 1))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniform1i(mID, slot->mLocation, intValue));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const float& value)
+	bool Program::setUniform(UniformHandle handle, const float& value)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, 1);
+		if (slot == nullptr)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniform1f(mID, mUniformLocationMap[name], value));
+		if (!updateShadow(slot, &value, sizeof(value), 1) || writeDrawBlock(slot, &value, sizeof(value), 1))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniform1f(mID, slot->mLocation, value));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const glm::vec2& value)
+	bool Program::setUniform(UniformHandle handle, const glm::vec2& value)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, 1);
+		if (slot == nullptr)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniform2f(mID, mUniformLocationMap[name], value.x, value.y));
+		if (!updateShadow(slot, &value, sizeof(value), 1) || writeDrawBlock(slot, &value, sizeof(value), 1))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniform2f(mID, slot->mLocation, value.x, value.y));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const glm::vec3& value)
+	bool Program::setUniform(UniformHandle handle, const glm::vec3& value)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
-		{ 
+		UniformSlot* slot = getUniformSlot(handle, 1);
+		if (slot == nullptr)
+		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniform3f(mID, mUniformLocationMap[name], value.x, value.y, value.z));
+		if (!updateShadow(slot, &value, sizeof(value), 1) || writeDrawBlock(slot, &value, sizeof(value), 1))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniform3f(mID, slot->mLocation, value.x, value.y, value.z));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const glm::vec4& value)
+	bool Program::setUniform(UniformHandle handle, const glm::vec4& value)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, 1);
+		if (slot == nullptr)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniform4f(mID, mUniformLocationMap[name], value.x, value.y, value.z, value.w));
+		if (!updateShadow(slot, &value, sizeof(value), 1) || writeDrawBlock(slot, &value, sizeof(value), 1))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniform4f(mID, slot->mLocation, value.x, value.y, value.z, value.w));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const glm::mat2& value)
+	bool Program::setUniform(UniformHandle handle, const glm::mat2& value)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, 1);
+		if (slot == nullptr)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniformMatrix2fv(mID, mUniformLocationMap[name], 1, GL_FALSE, glm::value_ptr(value)));
+		if (!updateShadow(slot, &value, sizeof(value), 1) || writeDrawBlock(slot, &value, sizeof(value), 1))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniformMatrix2fv(mID, slot->mLocation, 1, GL_FALSE, glm::value_ptr(value)));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const glm::mat3& value)
+	bool Program::setUniform(UniformHandle handle, const glm::mat3& value)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, 1);
+		if (slot == nullptr)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniformMatrix3fv(mID, mUniformLocationMap[name], 1, GL_FALSE, glm::value_ptr(value)));
+		if (!updateShadow(slot, &value, sizeof(value), 1) || writeDrawBlock(slot, &value, sizeof(value), 1))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniformMatrix3fv(mID, slot->mLocation, 1, GL_FALSE, glm::value_ptr(value)));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const glm::mat4& value)
+	bool Program::setUniform(UniformHandle handle, const glm::mat4& value)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, 1);
+		if (slot == nullptr)
 		{
 			return false;
 		}
-		
-		GLES_CHECK_ERROR(glProgramUniformMatrix4fv(mID, mUniformLocationMap[name], 1, GL_FALSE, glm::value_ptr(value)));
-	
+
+		if (!updateShadow(slot, &value, sizeof(value), 1) || writeDrawBlock(slot, &value, sizeof(value), 1))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniformMatrix4fv(mID, slot->mLocation, 1, GL_FALSE, glm::value_ptr(value)));
+
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const std::vector<int>& value)
+	bool Program::setUniform(UniformHandle handle, const int* values, uint32_t count)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, count);
+		if (slot == nullptr || count == 0)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniform1iv(mID, mUniformLocationMap[name], value.size(), value.data()));
+		if (!updateShadow(slot, values, sizeof(values[0]), count) || writeDrawBlock(slot, values, sizeof(values[0]), count))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniform1iv(mID, slot->mLocation, count, values));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const std::vector<float>& value)
+	bool Program::setUniform(UniformHandle handle, const float* values, uint32_t count)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, count);
+		if (slot == nullptr || count == 0)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniform1fv(mID, mUniformLocationMap[name], value.size(), value.data()));
+		if (!updateShadow(slot, values, sizeof(values[0]), count) || writeDrawBlock(slot, values, sizeof(values[0]), count))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniform1fv(mID, slot->mLocation, count, values));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const std::vector<glm::vec2>& value)
+	bool Program::setUniform(UniformHandle handle, const glm::vec2* values, uint32_t count)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, count);
+		if (slot == nullptr || count == 0)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniform2fv(mID, mUniformLocationMap[name], value.size(), glm::value_ptr(value[0])));
+		if (!updateShadow(slot, values, sizeof(values[0]), count) || writeDrawBlock(slot, values, sizeof(values[0]), count))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniform2fv(mID, slot->mLocation, count, glm::value_ptr(values[0])));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const std::vector<glm::vec3>& value)
+	bool Program::setUniform(UniformHandle handle, const glm::vec3* values, uint32_t count)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, count);
+		if (slot == nullptr || count == 0)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniform3fv(mID, mUniformLocationMap[name], value.size(), glm::value_ptr(value[0])));
+		if (!updateShadow(slot, values, sizeof(values[0]), count) || writeDrawBlock(slot, values, sizeof(values[0]), count))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniform3fv(mID, slot->mLocation, count, glm::value_ptr(values[0])));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const std::vector<glm::vec4>& value)
+	bool Program::setUniform(UniformHandle handle, const glm::vec4* values, uint32_t count)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, count);
+		if (slot == nullptr || count == 0)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniform4fv(mID, mUniformLocationMap[name], value.size(), glm::value_ptr(value[0])));
+		if (!updateShadow(slot, values, sizeof(values[0]), count) || writeDrawBlock(slot, values, sizeof(values[0]), count))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniform4fv(mID, slot->mLocation, count, glm::value_ptr(values[0])));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const std::vector<glm::mat2>& value)
+	bool Program::setUniform(UniformHandle handle, const glm::mat2* values, uint32_t count)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, count);
+		if (slot == nullptr || count == 0)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniformMatrix2fv(mID, mUniformLocationMap[name], value.size(), GL_FALSE, glm::value_ptr(value[0])));
+		if (!updateShadow(slot, values, sizeof(values[0]), count) || writeDrawBlock(slot, values, sizeof(values[0]), count))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniformMatrix2fv(mID, slot->mLocation, count, GL_FALSE, glm::value_ptr(values[0])));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const std::vector<glm::mat3>& value)
+	bool Program::setUniform(UniformHandle handle, const glm::mat3* values, uint32_t count)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, count);
+		if (slot == nullptr || count == 0)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniformMatrix3fv(mID, mUniformLocationMap[name], value.size(), GL_FALSE, glm::value_ptr(value[0])));
+		if (!updateShadow(slot, values, sizeof(values[0]), count) || writeDrawBlock(slot, values, sizeof(values[0]), count))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniformMatrix3fv(mID, slot->mLocation, count, GL_FALSE, glm::value_ptr(values[0])));
 
 		return true;
 	}
 
-	bool Program::setUniform(const std::string& name, const std::vector<glm::mat4>& value)
+	bool Program::setUniform(UniformHandle handle, const glm::mat4* values, uint32_t count)
 	{
-		if (mUniformLocationMap.find(name) == mUniformLocationMap.end())
+		UniformSlot* slot = getUniformSlot(handle, count);
+		if (slot == nullptr || count == 0)
 		{
 			return false;
 		}
 
-		GLES_CHECK_ERROR(glProgramUniformMatrix4fv(mID, mUniformLocationMap[name], value.size(), GL_FALSE, glm::value_ptr(value[0])));
+		if (!updateShadow(slot, values, sizeof(values[0]), count) || writeDrawBlock(slot, values, sizeof(values[0]), count))
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(glProgramUniformMatrix4fv(mID, slot->mLocation, count, GL_FALSE, glm::value_ptr(values[0])));
 
 		return true;
 	}
@@ -357,6 +686,22 @@ namespace es
 			}
 		}
 
+		GLES_CHECK_ERROR(GLuint drawBlock = glGetUniformBlockIndex(mID, kDrawBlockName));
+		if (drawBlock != GL_INVALID_INDEX)
+		{
+			GLint blockSize = 0;
+			GLES_CHECK_ERROR(glGetActiveUniformBlockiv(mID, drawBlock, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize));
+			GLES_CHECK_ERROR(glUniformBlockBinding(mID, drawBlock, kDrawBlockBinding));
+			mDrawBlock.resize(blockSize);
+			mIsDrawBlockDirty = true;
+		}
+
+		GLES_CHECK_ERROR(GLuint frameBlock = glGetUniformBlockIndex(mID, kFrameBlockName));
+		if (frameBlock != GL_INVALID_INDEX)
+		{
+			GLES_CHECK_ERROR(glUniformBlockBinding(mID, frameBlock, kFrameBlockBinding));
+		}
+
 		int uniformCount = 0;
 		GLES_CHECK_ERROR(glGetProgramiv(mID, GL_ACTIVE_UNIFORMS, &uniformCount));
 		for (int i = 0; i < uniformCount; i++)
@@ -368,9 +713,84 @@ namespace es
 			{
 				mUniformLocationMap[std::string(name)] = loc;
 			}
+
+			// uniforms in blocks have no location, only the members of DrawParameters are set like the others
+			GLint blockOffset = -1;
+			GLint arrayStride = 0;
+			GLint matrixStride = 0;
+			if (static_cast<GLint>(loc) < 0)
+			{
+				GLuint uniformIndex = static_cast<GLuint>(i);
+				GLint blockIndex = -1;
+				GLES_CHECK_ERROR(glGetActiveUniformsiv(mID, 1, &uniformIndex, GL_UNIFORM_BLOCK_INDEX, &blockIndex));
+				if (drawBlock == GL_INVALID_INDEX || blockIndex != static_cast<GLint>(drawBlock))
+				{
+					continue;
+				}
+
+				GLES_CHECK_ERROR(glGetActiveUniformsiv(mID, 1, &uniformIndex, GL_UNIFORM_OFFSET, &blockOffset));
+				GLES_CHECK_ERROR(glGetActiveUniformsiv(mID, 1, &uniformIndex, GL_UNIFORM_ARRAY_STRIDE, &arrayStride));
+				GLES_CHECK_ERROR(glGetActiveUniformsiv(mID, 1, &uniformIndex, GL_UNIFORM_MATRIX_STRIDE, &matrixStride));
+			}
+
+			// arrays are reported as "name[0]", every element gets its own slot so slices and "name[i]" resolve without strings
+			std::string uniformName(name);
+			std::string baseName = uniformName;
+			bool isArray = size > 1 || (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0);
+			if (isArray)
+			{
+				baseName = uniformName.substr(0, uniformName.size() - 3);
+			}
+
+			uint32_t firstSlot = static_cast<uint32_t>(mUniformSlots.size());
+			for (GLint element = 0; element < size; element++)
+			{
+				UniformSlot slot;
+				slot.mLocation = static_cast<GLint>(loc);
+				slot.mArrayRemaining = static_cast<uint32_t>(size - element);
+				slot.mShadowOffset = static_cast<uint32_t>(mUniformShadow.size());
+				slot.mShadowSize = getUniformTypeSize(type);
+				slot.mHasShadow = false;
+				slot.mWriteSerial = 0;
+				slot.mBlockOffset = blockOffset < 0 ? -1 : blockOffset + element * arrayStride;
+				slot.mMatrixStride = static_cast<uint32_t>(matrixStride);
+				slot.mColumns = getUniformColumnCount(type);
+				mUniformShadow.resize(mUniformShadow.size() + slot.mShadowSize);
+				if (element > 0 && blockOffset >= 0)
+				{
+					addUniformName(baseName + "[" + std::to_string(element) + "]", firstSlot + element);
+				}
+				else if (element > 0)
+				{
+					std::string elementName = baseName + "[" + std::to_string(element) + "]";
+					GLES_CHECK_ERROR(slot.mLocation = glGetUniformLocation(mID, elementName.c_str()));
+					addUniformName(elementName, firstSlot + element);
+				}
+				mUniformSlots.push_back(slot);
+			}
+
+			addUniformName(baseName, firstSlot);
+			if (isArray)
+			{
+				addUniformName(baseName + "[0]", firstSlot);
+			}
+		}
+
+		std::sort(mUniformLookup.begin(), mUniformLookup.end());
+		for (std::size_t i = 1; i < mUniformLookup.size(); i++)
+		{
+			if (mUniformLookup[i].first == mUniformLookup[i - 1].first)
+			{
+				SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "program %s : two uniform names share a hash", mName.c_str());
+			}
 		}
 	}
 
+	void Program::addUniformName(const std::string& name, uint32_t slot)
+	{
+		mUniformLookup.push_back(std::make_pair(UniformId::hash(name.c_str()), slot));
+	}
+
 	GLuint Program::getID() const
 	{
 		return mID;
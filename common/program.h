@@ -10,55 +10,191 @@
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <cstdint>
 
 namespace es
 {
+	// 64-bit fnv-1a hash of a uniform name, declare it constexpr to hash at compile time
+	class UniformId
+	{
+	public:
+		constexpr UniformId(const char* name)
+			:mHash(hash(name))
+		{
+		}
+
+		UniformId(const std::string& name)
+			:mHash(hash(name.c_str()))
+		{
+		}
+
+		constexpr uint64_t getHash() const
+		{
+			return mHash;
+		}
+
+		static constexpr uint64_t hash(const char* name)
+		{
+			uint64_t value = 14695981039346656037ull;
+			for (; *name != '\0'; name++)
+			{
+				value ^= static_cast<uint8_t>(*name);
+				value *= 1099511628211ull;
+			}
+			return value;
+		}
+	private:
+		uint64_t mHash;
+	};
+
+	// index into the flat location table of one program, only valid for the program that returned it
+	struct UniformHandle
+	{
+		int32_t mIndex = -1;
+
+		bool isValid() const
+		{
+			return mIndex >= 0;
+		}
+	};
+
 	class Program
 	{
 	public:
+		// members of a uniform block with this name are not set with glProgramUniform but packed into a copy of the block,
+		// which is streamed through StreamBuffer::getUniformStream and bound at kDrawBlockBinding right before each draw.
+		// shaders declare it with common/draw.glsl
+		static constexpr const char* kDrawBlockName = "DrawParameters";
+		static const GLuint kDrawBlockBinding = 1;
+
+		// the per frame block of resources/shaders/common/frame.glsl, World keeps it bound here for every program
+		static constexpr const char* kFrameBlockName = "FrameParameters";
+		static const GLuint kFrameBlockBinding = 2;
+
 		Program(const std::string& name, const std::vector<Shader*>& shaders);
-		Program(const std::string& name, const std::vector<std::string>& files);
+		Program(const std::string& name, const std::vector<std::string>& files, const std::vector<std::string>& defines = {});
 		~Program();
 
 		static std::shared_ptr<Program> createFromShaders(const std::string& name, const std::vector<Shader*>& shaders);
 
-		static std::shared_ptr<Program> createFromFiles(const std::string& name, const std::vector<std::string>& files);
+		static std::shared_ptr<Program> createFromFiles(const std::string& name, const std::vector<std::string>& files, const std::vector<std::string>& defines = {});
+
+		// the same files compiled with one more define, cached under the name plus the define. nullptr for programs built from
+		// shader objects, their sources are unknown
+		std::shared_ptr<Program> createVariant(const std::string& define);
 
 		void apply();
 		void unapply();
 
+		// streams the DrawParameters block of the applied program when it changed since its last draw this frame, the draw
+		// calls of the renderer classes go through here
+		static void commitDrawParameters();
+
 		void uniformBlockBinding(std::string name, int binding);
-		bool setUniform(const std::string& name, const int& value);
-		bool setUniform(const std::string& name, const bool& value);
-		bool setUniform(const std::string& name, const float& value);
-		bool setUniform(const std::string& name, const glm::vec2& value);
-		bool setUniform(const std::string& name, const glm::vec3& value);
-		bool setUniform(const std::string& name, const glm::vec4& value);
-		bool setUniform(const std::string& name, const glm::mat2& value);
-		bool setUniform(const std::string& name, const glm::mat3& value);
-		bool setUniform(const std::string& name, const glm::mat4& value);
-		bool setUniform(const std::string& name, const std::vector<int>& value);
-		bool setUniform(const std::string& name, const std::vector<float>& value);
-		bool setUniform(const std::string& name, const std::vector<glm::vec2>& value);
-		bool setUniform(const std::string& name, const std::vector<glm::vec3>& value);
-		bool setUniform(const std::string& name, const std::vector<glm::vec4>& value);
-		bool setUniform(const std::string& name, const std::vector<glm::mat2>& value);
-		bool setUniform(const std::string& name, const std::vector<glm::mat3>& value);
-		bool setUniform(const std::string& name, const std::vector<glm::mat4>& value);
+
+		// resolves "name", "name[0]" or "name[i]" once, element selects an entry of an array uniform
+		UniformHandle getUniformHandle(UniformId id, uint32_t element = 0) const;
+
+		// by name, hashes and looks the name up on every call
+		template<typename T>
+		bool setUniform(UniformId id, const T& value)
+		{
+			return setUniform(getUniformHandle(id), value);
+		}
+
+		// count consecutive array elements starting at firstElement
+		template<typename T>
+		bool setUniform(UniformId id, const T* values, uint32_t count, uint32_t firstElement = 0)
+		{
+			return setUniform(getUniformHandle(id, firstElement), values, count);
+		}
+
+		bool setUniform(UniformHandle handle, const int& value);
+		bool setUniform(UniformHandle handle, const bool& value);
+		bool setUniform(UniformHandle handle, const float& value);
+		bool setUniform(UniformHandle handle, const glm::vec2& value);
+		bool setUniform(UniformHandle handle, const glm::vec3& value);
+		bool setUniform(UniformHandle handle, const glm::vec4& value);
+		bool setUniform(UniformHandle handle, const glm::mat2& value);
+		bool setUniform(UniformHandle handle, const glm::mat3& value);
+		bool setUniform(UniformHandle handle, const glm::mat4& value);
+
+		// array slices, count must not run past the end of the array
+		bool setUniform(UniformHandle handle, const int* values, uint32_t count);
+		bool setUniform(UniformHandle handle, const float* values, uint32_t count);
+		bool setUniform(UniformHandle handle, const glm::vec2* values, uint32_t count);
+		bool setUniform(UniformHandle handle, const glm::vec3* values, uint32_t count);
+		bool setUniform(UniformHandle handle, const glm::vec4* values, uint32_t count);
+		bool setUniform(UniformHandle handle, const glm::mat2* values, uint32_t count);
+		bool setUniform(UniformHandle handle, const glm::mat3* values, uint32_t count);
+		bool setUniform(UniformHandle handle, const glm::mat4* values, uint32_t count);
+
+		template<typename T>
+		bool setUniform(UniformHandle handle, const std::vector<T>& values)
+		{
+			return !values.empty() && setUniform(handle, values.data(), static_cast<uint32_t>(values.size()));
+		}
+
+		// changes whenever a different value reaches the uniform, callers compare it to tell whether anyone else wrote since
+		uint64_t getUniformWriteSerial(UniformHandle handle) const;
 
 		const std::unordered_map<std::string, GLuint>& getAttribLocationMap() const;
 		const std::unordered_map<std::string, GLuint>& getUniformLocationMap() const;
 
 		GLuint getID() const;
 	private:
+		// one entry per array element
+		struct UniformSlot
+		{
+			GLint mLocation;
+			// elements from this one to the end of its array, 1 for plain uniforms
+			uint32_t mArrayRemaining;
+			// last uploaded value in mUniformShadow, elements of an array follow each other
+			uint32_t mShadowOffset;
+			uint32_t mShadowSize;
+			bool mHasShadow;
+			uint64_t mWriteSerial;
+			// std140 layout of DrawParameters members, mBlockOffset is -1 for uniforms with a location
+			int32_t mBlockOffset;
+			uint32_t mMatrixStride;
+			uint32_t mColumns;
+		};
+
 		void initFromShaders(const std::vector<Shader*>& shaders);
+		void addUniformName(const std::string& name, uint32_t slot);
+		UniformSlot* getUniformSlot(UniformHandle handle, uint32_t count);
+
+		// false when the program already holds these bytes, otherwise the shadow copy is updated and the upload counted
+		bool updateShadow(UniformSlot* slot, const void* data, uint32_t size, uint32_t count);
+
+		// true for DrawParameters members, whose values are then copied into mDrawBlock with the block's strides
+		bool writeDrawBlock(UniformSlot* slot, const void* data, uint32_t size, uint32_t count);
 
 		GLuint mID;
 		std::string mName;
 
+		// sources and defines the program was built from, empty when it was built from shader objects
+		std::vector<std::string> mFiles;
+		std::vector<std::string> mDefines;
+
 		std::unordered_map<std::string, GLuint> mAttribLocationMap;
 		std::unordered_map<std::string, GLuint> mUniformLocationMap;
 
+		std::vector<UniformSlot> mUniformSlots;
+		// name hash and slot index, sorted by hash
+		std::vector<std::pair<uint64_t, uint32_t>> mUniformLookup;
+
+		std::vector<uint8_t> mUniformShadow;
+		uint64_t mUniformWriteCount;
+
+		// empty when the program has no DrawParameters block, the offset is valid while the stream serial does not change
+		std::vector<uint8_t> mDrawBlock;
+		bool mIsDrawBlockDirty;
+		std::size_t mDrawBlockOffset;
+		uint64_t mDrawBlockSerial;
+
+		static Program* mCurrentProgram;
+
 		static std::unordered_map<std::string, std::shared_ptr<Program>> mProgramCache;
 	};
 }
@@ -0,0 +1,448 @@
+#include "rangeallocator.h"
+
+namespace es
+{
+	namespace
+	{
+		uint32_t findLowestBit(uint32_t bits)
+		{
+			uint32_t bit = 0;
+			while ((bits & 1u) == 0)
+			{
+				bits >>= 1;
+				bit++;
+			}
+			return bit;
+		}
+
+		uint32_t findHighestBit(uint32_t bits)
+		{
+			uint32_t bit = 0;
+			while (bits >>= 1)
+			{
+				bit++;
+			}
+			return bit;
+		}
+	}
+
+	RangeAllocator::RangeAllocator(uint32_t capacity)
+		:mUnusedBlocks(kNullBlock),
+		 mFirstBlock(kNullBlock),
+		 mLastBlock(kNullBlock),
+		 mCapacity(0),
+		 mFirstLevelMap(0)
+	{
+		for (uint32_t i = 0; i < kFirstLevelCount; i++)
+		{
+			mSecondLevelMap[i] = 0;
+			for (uint32_t j = 0; j < kSecondLevelCount; j++)
+			{
+				mFreeHeads[i][j] = kNullBlock;
+			}
+		}
+		grow(capacity);
+	}
+
+	RangeAllocator::~RangeAllocator()
+	{
+
+	}
+
+	uint32_t RangeAllocator::allocate(uint32_t size)
+	{
+		size = size == 0 ? 1 : size;
+		uint32_t index = findFree(size);
+		if (index == kNullBlock)
+		{
+			return kInvalidHandle;
+		}
+
+		removeFree(index);
+		mBlocks[index].mIsFree = false;
+
+		// the rest of the block goes back as a free block of its own
+		uint32_t remainder = mBlocks[index].mSize - size;
+		if (remainder > 0)
+		{
+			uint32_t split = createBlock(mBlocks[index].mOffset + size, remainder);
+			Block& block = mBlocks[index];
+			block.mSize = size;
+			mBlocks[split].mPrevPhysical = index;
+			mBlocks[split].mNextPhysical = block.mNextPhysical;
+			if (block.mNextPhysical != kNullBlock)
+			{
+				mBlocks[block.mNextPhysical].mPrevPhysical = split;
+			}
+			else
+			{
+				mLastBlock = split;
+			}
+			block.mNextPhysical = split;
+			insertFree(split);
+		}
+		return index;
+	}
+
+	void RangeAllocator::release(uint32_t handle)
+	{
+		if (handle >= mBlocks.size() || !mBlocks[handle].mIsUsed || mBlocks[handle].mIsFree)
+		{
+			return;
+		}
+
+		uint32_t index = handle;
+		mBlocks[index].mIsFree = true;
+
+		// the previous block absorbs this one
+		uint32_t prev = mBlocks[index].mPrevPhysical;
+		if (prev != kNullBlock && mBlocks[prev].mIsFree)
+		{
+			removeFree(prev);
+			mBlocks[prev].mSize += mBlocks[index].mSize;
+			mBlocks[prev].mNextPhysical = mBlocks[index].mNextPhysical;
+			if (mBlocks[index].mNextPhysical != kNullBlock)
+			{
+				mBlocks[mBlocks[index].mNextPhysical].mPrevPhysical = prev;
+			}
+			else
+			{
+				mLastBlock = prev;
+			}
+			destroyBlock(index);
+			index = prev;
+		}
+
+		// this block absorbs the next one
+		uint32_t next = mBlocks[index].mNextPhysical;
+		if (next != kNullBlock && mBlocks[next].mIsFree)
+		{
+			removeFree(next);
+			mBlocks[index].mSize += mBlocks[next].mSize;
+			mBlocks[index].mNextPhysical = mBlocks[next].mNextPhysical;
+			if (mBlocks[next].mNextPhysical != kNullBlock)
+			{
+				mBlocks[mBlocks[next].mNextPhysical].mPrevPhysical = index;
+			}
+			else
+			{
+				mLastBlock = index;
+			}
+			destroyBlock(next);
+		}
+
+		insertFree(index);
+	}
+
+	uint32_t RangeAllocator::getOffset(uint32_t handle) const
+	{
+		return handle < mBlocks.size() ? mBlocks[handle].mOffset : 0;
+	}
+
+	uint32_t RangeAllocator::getSize(uint32_t handle) const
+	{
+		return handle < mBlocks.size() ? mBlocks[handle].mSize : 0;
+	}
+
+	uint32_t RangeAllocator::getCapacity() const
+	{
+		return mCapacity;
+	}
+
+	void RangeAllocator::grow(uint32_t capacity)
+	{
+		if (capacity <= mCapacity)
+		{
+			return;
+		}
+
+		uint32_t extra = capacity - mCapacity;
+		if (mLastBlock != kNullBlock && mBlocks[mLastBlock].mIsFree)
+		{
+			removeFree(mLastBlock);
+			mBlocks[mLastBlock].mSize += extra;
+			insertFree(mLastBlock);
+		}
+		else
+		{
+			uint32_t index = createBlock(mCapacity, extra);
+			mBlocks[index].mPrevPhysical = mLastBlock;
+			if (mLastBlock != kNullBlock)
+			{
+				mBlocks[mLastBlock].mNextPhysical = index;
+			}
+			else
+			{
+				mFirstBlock = index;
+			}
+			mLastBlock = index;
+			insertFree(index);
+		}
+		mCapacity = capacity;
+	}
+
+	RangeAllocatorStatistics RangeAllocator::getStatistics() const
+	{
+		RangeAllocatorStatistics statistics;
+		statistics.mCapacity = mCapacity;
+
+		uint32_t freeUnits = 0;
+		for (uint32_t index = mFirstBlock; index != kNullBlock; index = mBlocks[index].mNextPhysical)
+		{
+			const Block& block = mBlocks[index];
+			if (block.mIsFree)
+			{
+				freeUnits += block.mSize;
+				statistics.mFreeBlocks++;
+				statistics.mLargestFreeBlock = block.mSize > statistics.mLargestFreeBlock ? block.mSize : statistics.mLargestFreeBlock;
+			}
+			else
+			{
+				statistics.mUsed += block.mSize;
+				statistics.mAllocations++;
+			}
+		}
+
+		if (freeUnits > 0)
+		{
+			statistics.mFragmentation = 1.0f - static_cast<float>(statistics.mLargestFreeBlock) / static_cast<float>(freeUnits);
+		}
+		return statistics;
+	}
+
+	bool RangeAllocator::validate() const
+	{
+		// the blocks tile [0, capacity) and no two free blocks touch
+		uint32_t offset = 0;
+		uint32_t freeBlocks = 0;
+		uint32_t prev = kNullBlock;
+		for (uint32_t index = mFirstBlock; index != kNullBlock; index = mBlocks[index].mNextPhysical)
+		{
+			const Block& block = mBlocks[index];
+			if (!block.mIsUsed || block.mOffset != offset || block.mSize == 0 || block.mPrevPhysical != prev)
+			{
+				return false;
+			}
+			if (block.mIsFree && prev != kNullBlock && mBlocks[prev].mIsFree)
+			{
+				return false;
+			}
+			freeBlocks += block.mIsFree ? 1 : 0;
+			offset += block.mSize;
+			prev = index;
+		}
+		if (offset != mCapacity || prev != mLastBlock)
+		{
+			return false;
+		}
+
+		// every free block sits in the list of its size class and the maps mark exactly the lists that are not empty
+		uint32_t listed = 0;
+		for (uint32_t i = 0; i < kFirstLevelCount; i++)
+		{
+			bool isFirstLevelSet = (mFirstLevelMap & (1u << i)) != 0;
+			if (isFirstLevelSet != (mSecondLevelMap[i] != 0))
+			{
+				return false;
+			}
+
+			for (uint32_t j = 0; j < kSecondLevelCount; j++)
+			{
+				bool isSecondLevelSet = (mSecondLevelMap[i] & (1u << j)) != 0;
+				if (isSecondLevelSet != (mFreeHeads[i][j] != kNullBlock))
+				{
+					return false;
+				}
+
+				uint32_t prevFree = kNullBlock;
+				for (uint32_t index = mFreeHeads[i][j]; index != kNullBlock; index = mBlocks[index].mNextFree)
+				{
+					uint32_t firstLevel = 0;
+					uint32_t secondLevel = 0;
+					mapSize(mBlocks[index].mSize, firstLevel, secondLevel);
+					if (!mBlocks[index].mIsFree || mBlocks[index].mPrevFree != prevFree || firstLevel != i || secondLevel != j)
+					{
+						return false;
+					}
+					prevFree = index;
+					listed++;
+				}
+			}
+		}
+		return listed == freeBlocks;
+	}
+
+	void RangeAllocator::mapSize(uint32_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+	{
+		// sizes below the second level count get a linear class each, above that a power of two split in equal steps
+		if (size < kSecondLevelCount)
+		{
+			firstLevel = 0;
+			secondLevel = size;
+			return;
+		}
+
+		uint32_t highestBit = findHighestBit(size);
+		firstLevel = highestBit - kSecondLevelBits + 1;
+		secondLevel = (size >> (highestBit - kSecondLevelBits)) - kSecondLevelCount;
+	}
+
+	uint32_t RangeAllocator::createBlock(uint32_t offset, uint32_t size)
+	{
+		uint32_t index = mUnusedBlocks;
+		if (index == kNullBlock)
+		{
+			index = static_cast<uint32_t>(mBlocks.size());
+			mBlocks.emplace_back();
+		}
+		else
+		{
+			mUnusedBlocks = mBlocks[index].mNextFree;
+		}
+
+		Block& block = mBlocks[index];
+		block.mOffset = offset;
+		block.mSize = size;
+		block.mPrevPhysical = kNullBlock;
+		block.mNextPhysical = kNullBlock;
+		block.mPrevFree = kNullBlock;
+		block.mNextFree = kNullBlock;
+		block.mIsFree = true;
+		block.mIsUsed = true;
+		return index;
+	}
+
+	void RangeAllocator::destroyBlock(uint32_t index)
+	{
+		Block& block = mBlocks[index];
+		block.mIsUsed = false;
+		block.mIsFree = false;
+		block.mNextFree = mUnusedBlocks;
+		mUnusedBlocks = index;
+	}
+
+	void RangeAllocator::insertFree(uint32_t index)
+	{
+		uint32_t firstLevel = 0;
+		uint32_t secondLevel = 0;
+		mapSize(mBlocks[index].mSize, firstLevel, secondLevel);
+
+		uint32_t& head = mFreeHeads[firstLevel][secondLevel];
+		Block& block = mBlocks[index];
+		block.mIsFree = true;
+		block.mPrevFree = kNullBlock;
+		block.mNextFree = head;
+		if (head != kNullBlock)
+		{
+			mBlocks[head].mPrevFree = index;
+		}
+		head = index;
+
+		mFirstLevelMap |= 1u << firstLevel;
+		mSecondLevelMap[firstLevel] |= 1u << secondLevel;
+	}
+
+	void RangeAllocator::removeFree(uint32_t index)
+	{
+		uint32_t firstLevel = 0;
+		uint32_t secondLevel = 0;
+		mapSize(mBlocks[index].mSize, firstLevel, secondLevel);
+
+		Block& block = mBlocks[index];
+		if (block.mPrevFree != kNullBlock)
+		{
+			mBlocks[block.mPrevFree].mNextFree = block.mNextFree;
+		}
+		else
+		{
+			mFreeHeads[firstLevel][secondLevel] = block.mNextFree;
+		}
+		if (block.mNextFree != kNullBlock)
+		{
+			mBlocks[block.mNextFree].mPrevFree = block.mPrevFree;
+		}
+		block.mPrevFree = kNullBlock;
+		block.mNextFree = kNullBlock;
+
+		if (mFreeHeads[firstLevel][secondLevel] == kNullBlock)
+		{
+			mSecondLevelMap[firstLevel] &= ~(1u << secondLevel);
+			if (mSecondLevelMap[firstLevel] == 0)
+			{
+				mFirstLevelMap &= ~(1u << firstLevel);
+			}
+		}
+	}
+
+	uint32_t RangeAllocator::findFree(uint32_t size) const
+	{
+		// rounding up to the next class boundary means any block of the class found is large enough
+		if (size >= kSecondLevelCount)
+		{
+			uint32_t round = (1u << (findHighestBit(size) - kSecondLevelBits)) - 1;
+			if (size > 0xffffffffu - round)
+			{
+				return kNullBlock;
+			}
+			size += round;
+		}
+
+		uint32_t firstLevel = 0;
+		uint32_t secondLevel = 0;
+		mapSize(size, firstLevel, secondLevel);
+
+		uint32_t secondLevelMap = mSecondLevelMap[firstLevel] & (~0u << secondLevel);
+		if (secondLevelMap == 0)
+		{
+			uint32_t firstLevelMap = firstLevel + 1 < 32 ? mFirstLevelMap & (~0u << (firstLevel + 1)) : 0;
+			if (firstLevelMap == 0)
+			{
+				return kNullBlock;
+			}
+			firstLevel = findLowestBit(firstLevelMap);
+			secondLevelMap = mSecondLevelMap[firstLevel];
+		}
+		return mFreeHeads[firstLevel][findLowestBit(secondLevelMap)];
+	}
+
+	void RangeAllocator::rebuildCompacted()
+	{
+		uint32_t offset = 0;
+		uint32_t prev = kNullBlock;
+		uint32_t index = mFirstBlock;
+		mFirstBlock = kNullBlock;
+		while (index != kNullBlock)
+		{
+			uint32_t next = mBlocks[index].mNextPhysical;
+			if (mBlocks[index].mIsFree)
+			{
+				removeFree(index);
+				destroyBlock(index);
+			}
+			else
+			{
+				Block& block = mBlocks[index];
+				block.mOffset = offset;
+				block.mPrevPhysical = prev;
+				block.mNextPhysical = kNullBlock;
+				if (prev != kNullBlock)
+				{
+					mBlocks[prev].mNextPhysical = index;
+				}
+				else
+				{
+					mFirstBlock = index;
+				}
+				offset += block.mSize;
+				prev = index;
+			}
+			index = next;
+		}
+		mLastBlock = prev;
+
+		// the freed space comes back as one block at the end
+		uint32_t capacity = mCapacity;
+		mCapacity = offset;
+		grow(capacity);
+	}
+}
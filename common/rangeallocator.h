@@ -0,0 +1,112 @@
+#ifndef RANGE_ALLOCATOR_H_
+#define RANGE_ALLOCATOR_H_
+
+#include <vector>
+#include <cstdint>
+
+namespace es
+{
+	struct RangeAllocatorStatistics
+	{
+		uint32_t mCapacity = 0;
+		uint32_t mUsed = 0;
+		uint32_t mAllocations = 0;
+		uint32_t mFreeBlocks = 0;
+		uint32_t mLargestFreeBlock = 0;
+		// 0 when all free space is one block, close to 1 when it is scattered in small pieces
+		float mFragmentation = 0.0f;
+	};
+
+	// two level segregated fit allocator over the units [0, capacity) of some other storage, e.g. the vertices of a buffer.
+	// free blocks are kept in size classes of 16 steps per power of two, allocate and release are constant time and neighbouring
+	// free blocks are merged. allocations are known by handles that stay valid when compact moves them
+	class RangeAllocator
+	{
+	public:
+		static const uint32_t kInvalidHandle = 0xffffffffu;
+
+		explicit RangeAllocator(uint32_t capacity = 0);
+		~RangeAllocator();
+
+		// kInvalidHandle when no free block holds size units, size 0 is taken as 1
+		uint32_t allocate(uint32_t size);
+
+		void release(uint32_t handle);
+
+		// 0 for kInvalidHandle
+		uint32_t getOffset(uint32_t handle) const;
+		uint32_t getSize(uint32_t handle) const;
+
+		uint32_t getCapacity() const;
+
+		// adds free units at the end, a smaller capacity is ignored
+		void grow(uint32_t capacity);
+
+		// slides every allocation down so all free units form one block at the end. move(handle, oldOffset, newOffset, size) is
+		// called for every allocation that changes place, in increasing offset order
+		template<typename Move>
+		void compact(const Move& move)
+		{
+			uint32_t next = 0;
+			for (uint32_t index = mFirstBlock; index != kNullBlock; index = mBlocks[index].mNextPhysical)
+			{
+				Block& block = mBlocks[index];
+				if (!block.mIsFree && block.mOffset != next)
+				{
+					move(index, block.mOffset, next, block.mSize);
+				}
+				next += block.mIsFree ? 0 : block.mSize;
+			}
+			rebuildCompacted();
+		}
+
+		RangeAllocatorStatistics getStatistics() const;
+
+		// walks the blocks and the size classes and checks they agree, for tests
+		bool validate() const;
+	private:
+		static const uint32_t kNullBlock = 0xffffffffu;
+		static const uint32_t kSecondLevelBits = 4;
+		static const uint32_t kSecondLevelCount = 1u << kSecondLevelBits;
+		static const uint32_t kFirstLevelCount = 32 - kSecondLevelBits + 1;
+
+		struct Block
+		{
+			uint32_t mOffset;
+			uint32_t mSize;
+			uint32_t mPrevPhysical;
+			uint32_t mNextPhysical;
+			// free list of the size class while free, the node free list while unused
+			uint32_t mPrevFree;
+			uint32_t mNextFree;
+			bool mIsFree;
+			bool mIsUsed;
+		};
+
+		static void mapSize(uint32_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+		uint32_t createBlock(uint32_t offset, uint32_t size);
+		void destroyBlock(uint32_t index);
+
+		void insertFree(uint32_t index);
+		void removeFree(uint32_t index);
+
+		// first free block of a size class that fits any request of the size, kNullBlock when there is none
+		uint32_t findFree(uint32_t size) const;
+
+		// merges the allocated blocks, now contiguous from 0, into place and leaves one free block after them
+		void rebuildCompacted();
+
+		std::vector<Block> mBlocks;
+		uint32_t mUnusedBlocks;
+		uint32_t mFirstBlock;
+		uint32_t mLastBlock;
+		uint32_t mCapacity;
+
+		uint32_t mFirstLevelMap;
+		uint32_t mSecondLevelMap[kFirstLevelCount];
+		uint32_t mFreeHeads[kFirstLevelCount][kSecondLevelCount];
+	};
+}
+
+#endif
@@ -0,0 +1,264 @@
+#include "renderqueue.h"
+
+#include <array>
+
+#include <statistics.h>
+#include <world.h>
+
+namespace es
+{
+	namespace
+	{
+		const uint64_t kTranslucentBit = 1ull << 63;
+
+		uint64_t quantize(float value, uint32_t bits)
+		{
+			uint64_t maxValue = (1ull << bits) - 1;
+			if (!(value > 0.0f))
+			{
+				return 0;
+			}
+			if (value >= 1.0f)
+			{
+				return maxValue;
+			}
+			return static_cast<uint64_t>(value * static_cast<float>(maxValue));
+		}
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+
+	RenderQueue::RenderQueue()
+		:mIsInstancing(true)
+	{
+
+	}
+
+	RenderQueue::~RenderQueue()
+	{
+
+	}
+
+	void RenderQueue::submit(Mesh* mesh)
+	{
+		if (mesh == nullptr)
+		{
+			return;
+		}
+
+		// the key needs this frame's transform, update only rebuilds it when the object moved
+		if (mesh->isAutoUpdated())
+		{
+			mesh->update();
+		}
+
+		DrawPacket packet;
+		packet.mMesh = mesh;
+		packet.mVertexArray = mesh->getGeometry()->getVertexArray()->getID();
+
+		std::shared_ptr<Material> material = mesh->getMaterial();
+		packet.mMaterial = material.get();
+		packet.mProgram = material != nullptr && material->getProgram() != nullptr ? material->getProgram()->getID() : 0;
+
+		float depth = getDepth(mesh);
+		uint32_t materialId = getMaterialId(packet.mMaterial);
+		if (material != nullptr && material->isTranslucent())
+		{
+			packet.mKey = makeTranslucentKey(packet.mProgram, materialId, depth);
+		}
+		else
+		{
+			packet.mKey = makeOpaqueKey(packet.mProgram, materialId, packet.mVertexArray, depth);
+		}
+
+		mPackets.push_back(packet);
+	}
+
+	void RenderQueue::flush()
+	{
+		if (mPackets.empty())
+		{
+			return;
+		}
+
+		uint32_t unsortedChanges = countStateChanges(mPackets);
+		sortPackets(mPackets, mScratch);
+		uint32_t sortedChanges = countStateChanges(mPackets);
+
+		FrameStatistics& statistics = Statistics::getCurrentFrame();
+		statistics.mQueuedDraws += static_cast<uint32_t>(mPackets.size());
+		statistics.mQueueStateChanges += sortedChanges;
+		if (unsortedChanges > sortedChanges)
+		{
+			statistics.mQueueStateChangesSaved += unsortedChanges - sortedChanges;
+		}
+
+		// sorting put draws of the same material and vertex array next to each other
+		mBatchSizes.clear();
+		mCommands.clear();
+		for (std::size_t i = 0; i < mPackets.size();)
+		{
+			Mesh* mesh = mPackets[i].mMesh;
+			std::size_t count = 1;
+			while (mIsInstancing && i + count < mPackets.size() && InstanceBatcher::canBatch(mesh, mPackets[i + count].mMesh))
+			{
+				count++;
+			}
+			mBatchSizes.push_back(count);
+			addDrawCommand(mesh, static_cast<uint32_t>(count));
+			i += count;
+		}
+		MeshGeometry::prepareDrawCommands(mCommands);
+
+		std::size_t first = 0;
+		for (std::size_t count : mBatchSizes)
+		{
+			if (count > 1)
+			{
+				mBatch.clear();
+				for (std::size_t i = first; i < first + count; i++)
+				{
+					mBatch.push_back(mPackets[i].mMesh);
+				}
+				mBatcher.draw(mBatch);
+			}
+			else
+			{
+				mPackets[first].mMesh->render(mPackets[first].mMaterial != nullptr);
+			}
+			first += count;
+		}
+
+		mCommands.clear();
+		MeshGeometry::prepareDrawCommands(mCommands);
+		clear();
+	}
+
+	void RenderQueue::setInstancing(bool isEnabled)
+	{
+		mIsInstancing = isEnabled;
+	}
+
+	void RenderQueue::clear()
+	{
+		mPackets.clear();
+	}
+
+	std::size_t RenderQueue::getPacketCount() const
+	{
+		return mPackets.size();
+	}
+
+	uint64_t RenderQueue::makeOpaqueKey(uint32_t program, uint32_t material, uint32_t vertexArray, float depth)
+	{
+		return (static_cast<uint64_t>(program & 0xFFFF) << 47) |
+			(static_cast<uint64_t>(material & 0xFFFF) << 31) |
+			(static_cast<uint64_t>(vertexArray & 0xFFFF) << 15) |
+			quantize(depth, 15);
+	}
+
+	uint64_t RenderQueue::makeTranslucentKey(uint32_t program, uint32_t material, float depth)
+	{
+		uint64_t invertedDepth = 0xFFFFFF - quantize(depth, 24);
+		return kTranslucentBit |
+			(invertedDepth << 39) |
+			(static_cast<uint64_t>(program & 0xFFFF) << 23) |
+			(static_cast<uint64_t>(material & 0xFFFF) << 7);
+	}
+
+	void RenderQueue::sortPackets(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch)
+	{
+		scratch.resize(packets.size());
+
+		for (uint32_t shift = 0; shift < 64; shift += 8)
+		{
+			std::array<uint32_t, 256> offsets = {};
+			for (const DrawPacket& packet : packets)
+			{
+				offsets[(packet.mKey >> shift) & 0xFF]++;
+			}
+
+			// every key has the same byte here, the pass would not move anything
+			if (offsets[(packets[0].mKey >> shift) & 0xFF] == packets.size())
+			{
+				continue;
+			}
+
+			uint32_t total = 0;
+			for (uint32_t& offset : offsets)
+			{
+				uint32_t count = offset;
+				offset = total;
+				total += count;
+			}
+
+			for (const DrawPacket& packet : packets)
+			{
+				scratch[offsets[(packet.mKey >> shift) & 0xFF]++] = packet;
+			}
+			packets.swap(scratch);
+		}
+	}
+
+	uint32_t RenderQueue::countStateChanges(const std::vector<DrawPacket>& packets)
+	{
+		uint32_t changes = 0;
+		for (std::size_t i = 0; i < packets.size(); i++)
+		{
+			const DrawPacket& packet = packets[i];
+			if (i == 0)
+			{
+				changes += 3;
+				continue;
+			}
+
+			const DrawPacket& previous = packets[i - 1];
+			changes += packet.mProgram != previous.mProgram ? 1 : 0;
+			changes += packet.mMaterial != previous.mMaterial ? 1 : 0;
+			changes += packet.mVertexArray != previous.mVertexArray ? 1 : 0;
+		}
+		return changes;
+	}
+
+	void RenderQueue::addDrawCommand(const Mesh* mesh, uint32_t instanceCount)
+	{
+		std::shared_ptr<const MeshGeometry> geometry = mesh->getGeometry();
+		if (!geometry->needsIndirectDraw())
+		{
+			return;
+		}
+
+		// the whole index range, as Mesh::render and InstanceBatcher::draw draw it
+		Mesh::DrawType drawType = mesh->getDrawType();
+		if (drawType == Mesh::DrawType::ELEMENTS || (instanceCount == 1 && drawType == Mesh::DrawType::ELEMENTS_RESTART_INDEX))
+		{
+			mCommands.push_back(geometry->getDrawCommand(0, geometry->getIndexCount(), instanceCount));
+		}
+	}
+
+	uint32_t RenderQueue::getMaterialId(const Material* material)
+	{
+		auto iter = mMaterialIds.find(material);
+		if (iter != mMaterialIds.end())
+		{
+			return iter->second;
+		}
+
+		uint32_t id = static_cast<uint32_t>(mMaterialIds.size());
+		mMaterialIds[material] = id;
+		return id;
+	}
+
+	float RenderQueue::getDepth(const Mesh* mesh) const
+	{
+		Camera* camera = World::getWorld()->getMainCamera();
+		if (camera == nullptr)
+		{
+			return 0.0f;
+		}
+
+		glm::vec3 position = glm::vec3(mesh->getModelMatrix()[3]);
+		float viewDepth = -(camera->getView() * glm::vec4(position, 1.0f)).z;
+		return (viewDepth - camera->getNearPlane()) / (camera->getFarPlane() - camera->getNearPlane());
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef RENDER_QUEUE_H_
+#define RENDER_QUEUE_H_
+
+#include <mesh.h>
+#include <instancing.h>
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace es
+{
+	// one mesh draw and the key it is sorted by
+	struct DrawPacket
+	{
+		uint64_t mKey;
+		Mesh* mMesh;
+		GLuint mProgram;
+		const Material* mMaterial;
+		GLuint mVertexArray;
+	};
+
+	// collects the draws of a frame and submits them sorted, opaque draws grouped by program, material and vertex array and
+	// front to back inside a group, translucent draws after them back to front
+	class RenderQueue
+	{
+	public:
+		RenderQueue();
+		~RenderQueue();
+
+		// meshes without a material are drawn with whatever program is bound, like Mesh::render(false)
+		void submit(Mesh* mesh);
+
+		// sorts and renders everything submitted since the last flush, then empties the queue. neighbouring packets that
+		// InstanceBatcher::canBatch accepts are merged into one instanced draw. the indirect commands of arena geometry without
+		// base vertex draws are written in one go before drawing
+		void flush();
+
+		// on by default, off draws every packet on its own
+		void setInstancing(bool isEnabled);
+
+		void clear();
+
+		std::size_t getPacketCount() const;
+
+		// opaque key, top bit clear: program 16 | material 16 | vertex array 16 | depth 15
+		static uint64_t makeOpaqueKey(uint32_t program, uint32_t material, uint32_t vertexArray, float depth);
+
+		// translucent key, top bit set: inverted depth 24 | program 16 | material 16 | unused 7
+		static uint64_t makeTranslucentKey(uint32_t program, uint32_t material, float depth);
+
+		// stable lsd radix sort over the 8 key bytes, bytes every key shares are skipped
+		static void sortPackets(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch);
+
+		// program, material and vertex array switches when drawing packets in the given order
+		static uint32_t countStateChanges(const std::vector<DrawPacket>& packets);
+	private:
+		// the command of a batch for MeshGeometry::prepareDrawCommands when it takes the indirect path
+		void addDrawCommand(const Mesh* mesh, uint32_t instanceCount);
+
+		// small ids for the key, handed out on first sight and kept across frames so keys stay stable
+		uint32_t getMaterialId(const Material* material);
+
+		// distance along the view direction mapped to [0, 1] between the near and far plane
+		float getDepth(const Mesh* mesh) const;
+
+		std::vector<DrawPacket> mPackets;
+		std::vector<DrawPacket> mScratch;
+
+		InstanceBatcher mBatcher;
+		std::vector<Mesh*> mBatch;
+		std::vector<std::size_t> mBatchSizes;
+		std::vector<DrawElementsIndirectCommand> mCommands;
+		bool mIsInstancing;
+
+		std::unordered_map<const Material*, uint32_t> mMaterialIds;
+	};
+}
+
+#endif
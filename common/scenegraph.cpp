@@ -0,0 +1,185 @@
+#include "scenegraph.h"
+
+#include <algorithm>
+
+#include <ogles.h>
+#include <statistics.h>
+
+namespace es
+{
+	SceneGraph::SceneGraph()
+		:mPass(0),
+		 mIsLayoutDirty(false),
+		 mVisitedNodes(0)
+	{
+
+	}
+
+	SceneGraph::~SceneGraph()
+	{
+
+	}
+
+	void SceneGraph::clear()
+	{
+		mParents.clear();
+		mFirstChild.clear();
+		mChildCount.clear();
+		mLocal.clear();
+		mWorld.clear();
+		mNames.clear();
+		mUpdatePass.clear();
+		mDirtyRoots.clear();
+		mIsLayoutDirty = false;
+	}
+
+	int32_t SceneGraph::addNode(int32_t parent, const glm::mat4& local, const std::string& name)
+	{
+		int32_t index = static_cast<int32_t>(mParents.size());
+
+		// a root after the first node, a parent that does not exist yet or one before the parent of the previous node
+		// would break the breadth first layout
+		bool isRoot = parent == kNoParent;
+		int32_t lastParent = mParents.empty() ? kNoParent : mParents.back();
+		if (isRoot != (index == 0) || parent >= index || (!isRoot && parent < lastParent))
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "scene graph node %s is not in breadth first order", name.c_str());
+			return kNoParent;
+		}
+
+		mParents.push_back(parent);
+		mFirstChild.push_back(0);
+		mChildCount.push_back(0);
+		mLocal.push_back(local);
+		mWorld.push_back(local);
+		mNames.push_back(name);
+		mUpdatePass.push_back(0);
+
+		if (!isRoot)
+		{
+			if (mChildCount[parent] == 0)
+			{
+				mFirstChild[parent] = static_cast<uint32_t>(index);
+			}
+			mChildCount[parent]++;
+		}
+
+		mDirtyRoots.push_back(index);
+		mIsLayoutDirty = true;
+		return index;
+	}
+
+	void SceneGraph::setLocalTransform(int32_t node, const glm::mat4& local)
+	{
+		if (mLocal[node] == local)
+		{
+			return;
+		}
+
+		mLocal[node] = local;
+		mDirtyRoots.push_back(node);
+	}
+
+	uint32_t SceneGraph::update()
+	{
+		mVisitedNodes = 0;
+		if (mDirtyRoots.empty())
+		{
+			return 0;
+		}
+
+		if (mIsLayoutDirty)
+		{
+			updateChildRanges();
+		}
+
+		// parents have lower indices than their children, going in order lets one sweep cover every dirty node below it
+		std::sort(mDirtyRoots.begin(), mDirtyRoots.end());
+		mPass++;
+		for (int32_t root : mDirtyRoots)
+		{
+			if (mUpdatePass[root] != mPass)
+			{
+				updateSubtree(root);
+			}
+		}
+		mDirtyRoots.clear();
+
+		Statistics::getCurrentFrame().mTransformsUpdated += mVisitedNodes;
+		return mVisitedNodes;
+	}
+
+	const glm::mat4& SceneGraph::getLocalTransform(int32_t node) const
+	{
+		return mLocal[node];
+	}
+
+	const glm::mat4& SceneGraph::getWorldTransform(int32_t node) const
+	{
+		return mWorld[node];
+	}
+
+	bool SceneGraph::wasUpdated(int32_t node) const
+	{
+		return mPass != 0 && mUpdatePass[node] == mPass;
+	}
+
+	int32_t SceneGraph::getParent(int32_t node) const
+	{
+		return mParents[node];
+	}
+
+	const std::string& SceneGraph::getName(int32_t node) const
+	{
+		return mNames[node];
+	}
+
+	int32_t SceneGraph::findNode(const std::string& name) const
+	{
+		auto iter = std::find(mNames.begin(), mNames.end(), name);
+		return iter != mNames.end() ? static_cast<int32_t>(iter - mNames.begin()) : kNoParent;
+	}
+
+	uint32_t SceneGraph::getNodeCount() const
+	{
+		return static_cast<uint32_t>(mParents.size());
+	}
+
+	void SceneGraph::updateChildRanges()
+	{
+		uint32_t next = 1;
+		for (std::size_t i = 0; i < mParents.size(); i++)
+		{
+			if (mChildCount[i] == 0)
+			{
+				mFirstChild[i] = next;
+			}
+			else
+			{
+				next = mFirstChild[i] + mChildCount[i];
+			}
+		}
+		mIsLayoutDirty = false;
+	}
+
+	void SceneGraph::updateSubtree(int32_t root)
+	{
+		// one level per iteration, the children of [begin, end) are [firstChild(begin), firstChild(end - 1) + childCount(end - 1))
+		uint32_t begin = static_cast<uint32_t>(root);
+		uint32_t end = begin + 1;
+		while (begin < end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				int32_t parent = mParents[i];
+				mWorld[i] = parent == kNoParent ? mLocal[i] : mWorld[parent] * mLocal[i];
+				mUpdatePass[i] = mPass;
+			}
+			mVisitedNodes += end - begin;
+
+			uint32_t last = end - 1;
+			begin = mFirstChild[begin];
+			end = mFirstChild[last] + mChildCount[last];
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef SCENE_GRAPH_H_
+#define SCENE_GRAPH_H_
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace es
+{
+	// transform hierarchy kept as contiguous arrays in breadth first order. the children of a node are adjacent and the
+	// children of adjacent nodes follow each other, so a subtree is a run of contiguous ranges, one per level.
+	// update only visits the subtrees below nodes whose local transform changed, a static hierarchy costs nothing
+	class SceneGraph
+	{
+	public:
+		static const int32_t kNoParent = -1;
+
+		SceneGraph();
+		~SceneGraph();
+
+		void clear();
+
+		// nodes have to be added in breadth first order: the root first, then the children of each node in the order of their
+		// parents. returns the index of the node or kNoParent when the order is broken
+		int32_t addNode(int32_t parent, const glm::mat4& local, const std::string& name = "");
+
+		// marks the subtree below the node for the next update
+		void setLocalTransform(int32_t node, const glm::mat4& local);
+
+		// recomputes the world transforms of the dirty subtrees, returns the number of nodes visited
+		uint32_t update();
+
+		const glm::mat4& getLocalTransform(int32_t node) const;
+
+		// valid after update
+		const glm::mat4& getWorldTransform(int32_t node) const;
+
+		// whether the last update that visited any node visited this one
+		bool wasUpdated(int32_t node) const;
+
+		int32_t getParent(int32_t node) const;
+
+		const std::string& getName(int32_t node) const;
+
+		// first node with the name, kNoParent when there is none
+		int32_t findNode(const std::string& name) const;
+
+		uint32_t getNodeCount() const;
+	private:
+		// leaves get the position their children would take so the child ranges of a level stay contiguous
+		void updateChildRanges();
+
+		void updateSubtree(int32_t root);
+
+		std::vector<int32_t> mParents;
+		std::vector<uint32_t> mFirstChild;
+		std::vector<uint32_t> mChildCount;
+		std::vector<glm::mat4> mLocal;
+		std::vector<glm::mat4> mWorld;
+		std::vector<std::string> mNames;
+
+		// update pass a node was last visited in, nodes inside a subtree that was already done are skipped
+		std::vector<uint32_t> mUpdatePass;
+		uint32_t mPass;
+
+		std::vector<int32_t> mDirtyRoots;
+
+		bool mIsLayoutDirty;
+		uint32_t mVisitedNodes;
+	};
+}
+
+#endif
@@ -1,19 +1,92 @@
 #include "shader.h"
 #include "utility.h"
 
+#include <fstream>
+
 namespace es
 {
-	Shader::Shader(GLenum type, const std::string& path)
+	namespace
+	{
+		const uint32_t kMaxIncludeDepth = 8;
+
+		// replaces the #include "file" lines recursively, shared files guard themselves with #ifndef like c headers
+		bool expandIncludes(const std::string& path, std::string& source, uint32_t depth)
+		{
+			std::string directory = Utility::pathWithoutFile(path);
+			std::size_t position = 0;
+			while ((position = source.find("#include", position)) != std::string::npos)
+			{
+				if (position > 0 && source[position - 1] != '\n')
+				{
+					position++;
+					continue;
+				}
+
+				std::size_t lineEnd = source.find('\n', position);
+				if (lineEnd == std::string::npos)
+				{
+					lineEnd = source.size();
+				}
+				std::size_t open = source.find('"', position);
+				std::size_t close = open < lineEnd ? source.find('"', open + 1) : std::string::npos;
+				if (close == std::string::npos || close > lineEnd)
+				{
+					SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "malformed #include in %s", path.c_str());
+					return false;
+				}
+
+				// next to the including file first, then the shader root the example directories live in
+				std::string name = source.substr(open + 1, close - open - 1);
+				std::string includePath = directory + "/" + name;
+				if (!std::ifstream(includePath).good())
+				{
+					includePath = Utility::pathWithoutFile(directory) + "/" + name;
+				}
+
+				std::string content;
+				if (depth >= kMaxIncludeDepth || !Utility::readFile(includePath, content) || !expandIncludes(includePath, content, depth + 1))
+				{
+					SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to include %s in %s", name.c_str(), path.c_str());
+					return false;
+				}
+
+				source.replace(position, lineEnd - position, content);
+				position += content.size();
+			}
+			return true;
+		}
+	}
+
+	Shader::Shader(GLenum type, const std::string& path, const std::vector<std::string>& defines)
 		:mID(0),
 		 mCompiled(false),
 		 mType(GL_INVALID_ENUM)
 	{
 		std::string shaderStr;
-		if (!Utility::readFile(path, shaderStr))
+		if (!Utility::readFile(path, shaderStr) || !expandIncludes(path, shaderStr, 0))
 		{
 			return;
 		}
 
+		if (!defines.empty())
+		{
+			// #version has to stay the first line
+			std::string defineLines;
+			for (const std::string& define : defines)
+			{
+				defineLines += "#define " + define + "\n";
+			}
+			std::size_t versionEnd = shaderStr.compare(0, 8, "#version") == 0 ? shaderStr.find('\n') : std::string::npos;
+			if (versionEnd == std::string::npos)
+			{
+				shaderStr.insert(0, defineLines);
+			}
+			else
+			{
+				shaderStr.insert(versionEnd + 1, defineLines);
+			}
+		}
+
 		mType = type;
 		GLES_CHECK_ERROR(mID = glCreateShader(type));
 
@@ -61,7 +134,7 @@ namespace es
 		return mType;
 	}
 
-	VertexShader::VertexShader(const std::string& path) : Shader(GL_VERTEX_SHADER, path)
+	VertexShader::VertexShader(const std::string& path, const std::vector<std::string>& defines) : Shader(GL_VERTEX_SHADER, path, defines)
 	{
 
 	}
@@ -71,9 +144,9 @@ namespace es
 
 	}
 
-	VertexShader* VertexShader::createFromFile(const std::string& path)
+	VertexShader* VertexShader::createFromFile(const std::string& path, const std::vector<std::string>& defines)
 	{
-		VertexShader* shader = new (std::nothrow) VertexShader(path);
+		VertexShader* shader = new (std::nothrow) VertexShader(path, defines);
 		if (shader)
 		{
 			return shader;
@@ -82,7 +155,7 @@ namespace es
 		return nullptr;
 	}
 
-	GeometryShader::GeometryShader(const std::string& path) : Shader(GL_GEOMETRY_SHADER_EXT, path)
+	GeometryShader::GeometryShader(const std::string& path, const std::vector<std::string>& defines) : Shader(GL_GEOMETRY_SHADER_EXT, path, defines)
 	{
 
 	}
@@ -92,9 +165,9 @@ namespace es
 
 	}
 
-	GeometryShader* GeometryShader::createFromFile(const std::string& path)
+	GeometryShader* GeometryShader::createFromFile(const std::string& path, const std::vector<std::string>& defines)
 	{
-		GeometryShader* shader = new (std::nothrow) GeometryShader(path);
+		GeometryShader* shader = new (std::nothrow) GeometryShader(path, defines);
 		if (shader)
 		{
 			return shader;
@@ -103,7 +176,7 @@ namespace es
 		return nullptr;
 	}
 
-	FragmentShader::FragmentShader(const std::string& path) : Shader(GL_FRAGMENT_SHADER, path)
+	FragmentShader::FragmentShader(const std::string& path, const std::vector<std::string>& defines) : Shader(GL_FRAGMENT_SHADER, path, defines)
 	{
 
 	}
@@ -113,9 +186,9 @@ namespace es
 
 	}
 
-	FragmentShader* FragmentShader::createFromFile(const std::string& path)
+	FragmentShader* FragmentShader::createFromFile(const std::string& path, const std::vector<std::string>& defines)
 	{
-		FragmentShader* shader = new (std::nothrow) FragmentShader(path);
+		FragmentShader* shader = new (std::nothrow) FragmentShader(path, defines);
 		if (shader)
 		{
 			return shader;
@@ -124,7 +197,7 @@ namespace es
 		return nullptr;
 	}
 
-	ComputeShader::ComputeShader(const std::string& path) : Shader(GL_COMPUTE_SHADER, path)
+	ComputeShader::ComputeShader(const std::string& path, const std::vector<std::string>& defines) : Shader(GL_COMPUTE_SHADER, path, defines)
 	{
 
 	}
@@ -134,9 +207,9 @@ namespace es
 
 	}
 
-	ComputeShader* ComputeShader::createFromFile(const std::string& path)
+	ComputeShader* ComputeShader::createFromFile(const std::string& path, const std::vector<std::string>& defines)
 	{
-		ComputeShader* shader = new (std::nothrow) ComputeShader(path);
+		ComputeShader* shader = new (std::nothrow) ComputeShader(path, defines);
 		if (shader)
 		{
 			return shader;
@@ -11,7 +11,9 @@ namespace es
 	class Shader
 	{
 	public:
-		Shader(GLenum type, const std::string& path);
+		// every define becomes a #define line right after the #version line. a line #include "file" is replaced by the file, found
+		// next to the shader or in the shader root above it, so "common/frame.glsl" works from every example directory
+		Shader(GLenum type, const std::string& path, const std::vector<std::string>& defines = {});
 		virtual ~Shader();
 
 		bool isCompiled();
@@ -26,37 +28,37 @@ namespace es
 	class VertexShader : public Shader
 	{
 	public:
-		VertexShader(const std::string& path);
+		VertexShader(const std::string& path, const std::vector<std::string>& defines = {});
 		~VertexShader();
 
-		static VertexShader* createFromFile(const std::string& path);
+		static VertexShader* createFromFile(const std::string& path, const std::vector<std::string>& defines = {});
 	};
 
 	class GeometryShader : public Shader
 	{
 	public:
-		GeometryShader(const std::string& path);
+		GeometryShader(const std::string& path, const std::vector<std::string>& defines = {});
 		~GeometryShader();
 
-		static GeometryShader* createFromFile(const std::string& path);
+		static GeometryShader* createFromFile(const std::string& path, const std::vector<std::string>& defines = {});
 	};
 
 	class FragmentShader : public Shader
 	{
 	public:
-		FragmentShader(const std::string& path);
+		FragmentShader(const std::string& path, const std::vector<std::string>& defines = {});
 		~FragmentShader();
 
-		static FragmentShader* createFromFile(const std::string& path);
+		static FragmentShader* createFromFile(const std::string& path, const std::vector<std::string>& defines = {});
 	};
 
 	class ComputeShader : public Shader
 	{
 	public:
-		ComputeShader(const std::string& path);
+		ComputeShader(const std::string& path, const std::vector<std::string>& defines = {});
 		~ComputeShader();
 
-		static ComputeShader* createFromFile(const std::string& path);
+		static ComputeShader* createFromFile(const std::string& path, const std::vector<std::string>& defines = {});
 	};
 }
 
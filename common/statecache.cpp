@@ -0,0 +1,343 @@
+#include "statecache.h"
+
+#include <utility.h>
+#include <statistics.h>
+
+namespace es
+{
+	namespace
+	{
+		// no gl name can take this value, marks a binding the cache does not know
+		const GLuint kUnknown = 0xFFFFFFFF;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+
+	GLuint StateCache::mProgram = kUnknown;
+	GLuint StateCache::mVertexArray = kUnknown;
+	std::array<GLuint, StateCache::kBufferTargetCount> StateCache::mBuffers;
+	std::unordered_map<GLenum, std::vector<StateCache::IndexedBinding>> StateCache::mIndexedBuffers;
+	uint32_t StateCache::mActiveTexture = kUnknown;
+	std::array<std::array<GLuint, StateCache::kTextureTargetCount>, StateCache::kMaxTextureUnits> StateCache::mTextures;
+	GLuint StateCache::mDrawFramebuffer = kUnknown;
+	GLuint StateCache::mReadFramebuffer = kUnknown;
+	std::array<GLint, 4> StateCache::mViewport;
+	bool StateCache::mIsViewportKnown = false;
+	std::unordered_map<GLenum, bool> StateCache::mCaps;
+
+	void StateCache::useProgram(GLuint program)
+	{
+		if (update(mProgram, program))
+		{
+			GLES_CHECK_ERROR(glUseProgram(program));
+		}
+	}
+
+	void StateCache::bindVertexArray(GLuint vao)
+	{
+		if (update(mVertexArray, vao))
+		{
+			GLES_CHECK_ERROR(glBindVertexArray(vao));
+			mBuffers[getBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = kUnknown;
+		}
+	}
+
+	void StateCache::bindBuffer(GLenum target, GLuint buffer)
+	{
+		int index = getBufferTargetIndex(target);
+		if (index < 0 || update(mBuffers[index], buffer))
+		{
+			GLES_CHECK_ERROR(glBindBuffer(target, buffer));
+		}
+	}
+
+	void StateCache::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+	{
+		std::vector<IndexedBinding>& bindings = mIndexedBuffers[target];
+		if (index >= bindings.size())
+		{
+			bindings.resize(index + 1, { kUnknown, 0, 0 });
+		}
+
+		IndexedBinding& binding = bindings[index];
+		FrameStatistics& statistics = Statistics::getCurrentFrame();
+		if (binding.mBuffer == buffer && binding.mOffset == offset && binding.mSize == size)
+		{
+			statistics.mStateChangesSkipped++;
+			return;
+		}
+
+		binding = { buffer, offset, size };
+		statistics.mStateChanges++;
+		if (size == 0)
+		{
+			GLES_CHECK_ERROR(glBindBufferBase(target, index, buffer));
+		}
+		else
+		{
+			GLES_CHECK_ERROR(glBindBufferRange(target, index, buffer, offset, size));
+		}
+
+		int targetIndex = getBufferTargetIndex(target);
+		if (targetIndex >= 0)
+		{
+			mBuffers[targetIndex] = buffer;
+		}
+	}
+
+	void StateCache::activeTexture(uint32_t unit)
+	{
+		if (update(mActiveTexture, unit))
+		{
+			GLES_CHECK_ERROR(glActiveTexture(GL_TEXTURE0 + unit));
+		}
+	}
+
+	void StateCache::bindTexture(GLenum target, GLuint texture)
+	{
+		// nothing is known about the active unit yet, unit 0 is as good as any
+		if (mActiveTexture == kUnknown)
+		{
+			activeTexture(0);
+		}
+		bindTexture(mActiveTexture, target, texture);
+	}
+
+	void StateCache::bindTexture(uint32_t unit, GLenum target, GLuint texture)
+	{
+		int index = getTextureTargetIndex(target);
+		if (index < 0 || unit >= kMaxTextureUnits)
+		{
+			activeTexture(unit);
+			GLES_CHECK_ERROR(glBindTexture(target, texture));
+			return;
+		}
+
+		if (update(mTextures[unit][index], texture))
+		{
+			activeTexture(unit);
+			GLES_CHECK_ERROR(glBindTexture(target, texture));
+		}
+	}
+
+	void StateCache::bindFramebuffer(GLenum target, GLuint framebuffer)
+	{
+		FrameStatistics& statistics = Statistics::getCurrentFrame();
+
+		bool isDraw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+		bool isRead = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+		if ((!isDraw || mDrawFramebuffer == framebuffer) && (!isRead || mReadFramebuffer == framebuffer))
+		{
+			statistics.mStateChangesSkipped++;
+			return;
+		}
+
+		if (isDraw)
+		{
+			mDrawFramebuffer = framebuffer;
+		}
+		if (isRead)
+		{
+			mReadFramebuffer = framebuffer;
+		}
+		statistics.mStateChanges++;
+		GLES_CHECK_ERROR(glBindFramebuffer(target, framebuffer));
+	}
+
+	void StateCache::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		FrameStatistics& statistics = Statistics::getCurrentFrame();
+		if (mIsViewportKnown && mViewport[0] == x && mViewport[1] == y && mViewport[2] == width && mViewport[3] == height)
+		{
+			statistics.mStateChangesSkipped++;
+			return;
+		}
+
+		mViewport = { x, y, width, height };
+		mIsViewportKnown = true;
+		statistics.mStateChanges++;
+		GLES_CHECK_ERROR(glViewport(x, y, width, height));
+	}
+
+	void StateCache::enable(GLenum cap)
+	{
+		setEnabled(cap, true);
+	}
+
+	void StateCache::disable(GLenum cap)
+	{
+		setEnabled(cap, false);
+	}
+
+	void StateCache::setEnabled(GLenum cap, bool isEnabled)
+	{
+		FrameStatistics& statistics = Statistics::getCurrentFrame();
+
+		auto iter = mCaps.find(cap);
+		if (iter != mCaps.end() && iter->second == isEnabled)
+		{
+			statistics.mStateChangesSkipped++;
+			return;
+		}
+
+		mCaps[cap] = isEnabled;
+		statistics.mStateChanges++;
+		if (isEnabled)
+		{
+			GLES_CHECK_ERROR(glEnable(cap));
+		}
+		else
+		{
+			GLES_CHECK_ERROR(glDisable(cap));
+		}
+	}
+
+	void StateCache::deleteProgram(GLuint program)
+	{
+		// a program in use is only flagged for deletion, the binding stays valid
+		GLES_CHECK_ERROR(glDeleteProgram(program));
+	}
+
+	void StateCache::deleteVertexArray(GLuint vao)
+	{
+		GLES_CHECK_ERROR(glDeleteVertexArrays(1, &vao));
+		if (mVertexArray == vao)
+		{
+			mVertexArray = 0;
+			mBuffers[getBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = kUnknown;
+		}
+	}
+
+	void StateCache::deleteBuffer(GLuint buffer)
+	{
+		GLES_CHECK_ERROR(glDeleteBuffers(1, &buffer));
+		for (GLuint& cached : mBuffers)
+		{
+			if (cached == buffer)
+			{
+				cached = 0;
+			}
+		}
+		for (auto& bindings : mIndexedBuffers)
+		{
+			for (IndexedBinding& binding : bindings.second)
+			{
+				if (binding.mBuffer == buffer)
+				{
+					binding = { 0, 0, 0 };
+				}
+			}
+		}
+	}
+
+	void StateCache::deleteTexture(GLuint texture)
+	{
+		GLES_CHECK_ERROR(glDeleteTextures(1, &texture));
+		for (auto& unit : mTextures)
+		{
+			for (GLuint& cached : unit)
+			{
+				if (cached == texture)
+				{
+					cached = 0;
+				}
+			}
+		}
+	}
+
+	void StateCache::deleteFramebuffer(GLuint framebuffer)
+	{
+		GLES_CHECK_ERROR(glDeleteFramebuffers(1, &framebuffer));
+		if (mDrawFramebuffer == framebuffer)
+		{
+			mDrawFramebuffer = 0;
+		}
+		if (mReadFramebuffer == framebuffer)
+		{
+			mReadFramebuffer = 0;
+		}
+	}
+
+	void StateCache::invalidate()
+	{
+		mProgram = kUnknown;
+		mVertexArray = kUnknown;
+		mBuffers.fill(kUnknown);
+		mIndexedBuffers.clear();
+		mActiveTexture = kUnknown;
+		for (auto& unit : mTextures)
+		{
+			unit.fill(kUnknown);
+		}
+		mDrawFramebuffer = kUnknown;
+		mReadFramebuffer = kUnknown;
+		mIsViewportKnown = false;
+		mCaps.clear();
+	}
+
+	int StateCache::getTextureTargetIndex(GLenum target)
+	{
+		switch (target)
+		{
+			case GL_TEXTURE_2D:
+				return 0;
+			case GL_TEXTURE_CUBE_MAP:
+				return 1;
+			case GL_TEXTURE_2D_ARRAY:
+				return 2;
+			case GL_TEXTURE_3D:
+				return 3;
+			case GL_TEXTURE_2D_MULTISAMPLE:
+				return 4;
+			default:
+				return -1;
+		}
+	}
+
+	int StateCache::getBufferTargetIndex(GLenum target)
+	{
+		switch (target)
+		{
+			case GL_ARRAY_BUFFER:
+				return 0;
+			case GL_ELEMENT_ARRAY_BUFFER:
+				return 1;
+			case GL_UNIFORM_BUFFER:
+				return 2;
+			case GL_SHADER_STORAGE_BUFFER:
+				return 3;
+			case GL_DRAW_INDIRECT_BUFFER:
+				return 4;
+			case GL_DISPATCH_INDIRECT_BUFFER:
+				return 5;
+			case GL_COPY_READ_BUFFER:
+				return 6;
+			case GL_COPY_WRITE_BUFFER:
+				return 7;
+			case GL_PIXEL_PACK_BUFFER:
+				return 8;
+			case GL_PIXEL_UNPACK_BUFFER:
+				return 9;
+			case GL_TRANSFORM_FEEDBACK_BUFFER:
+				return 10;
+			case GL_ATOMIC_COUNTER_BUFFER:
+				return 11;
+			default:
+				return -1;
+		}
+	}
+
+	bool StateCache::update(GLuint& cached, GLuint value)
+	{
+		FrameStatistics& statistics = Statistics::getCurrentFrame();
+		if (cached == value)
+		{
+			statistics.mStateChangesSkipped++;
+			return false;
+		}
+
+		cached = value;
+		statistics.mStateChanges++;
+		return true;
+	}
+}
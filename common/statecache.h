@@ -0,0 +1,84 @@
+#ifndef STATE_CACHE_H_
+#define STATE_CACHE_H_
+
+#include <ogles.h>
+
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace es
+{
+	// shadow of the gl bindings of the one context, every wrapper binds through it so calls that change nothing are dropped.
+	// raw gl calls that touch the same state must be followed by invalidate
+	class StateCache
+	{
+	public:
+		static void useProgram(GLuint program);
+
+		static void bindVertexArray(GLuint vao);
+
+		// the element array binding belongs to the bound vertex array and is forgotten whenever it changes
+		static void bindBuffer(GLenum target, GLuint buffer);
+
+		// size 0 binds the whole buffer like glBindBufferBase, both also change the generic binding of target
+		static void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset = 0, GLsizeiptr size = 0);
+
+		static void activeTexture(uint32_t unit);
+
+		// binds to the active unit, used by the texture wrappers to update parameters and data
+		static void bindTexture(GLenum target, GLuint texture);
+		static void bindTexture(uint32_t unit, GLenum target, GLuint texture);
+
+		// GL_FRAMEBUFFER sets both the draw and read binding
+		static void bindFramebuffer(GLenum target, GLuint framebuffer);
+
+		static void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+		static void enable(GLenum cap);
+		static void disable(GLenum cap);
+		static void setEnabled(GLenum cap, bool isEnabled);
+
+		// gl resets the bindings of deleted objects, the cache has to forget them too or a recycled name would never be bound
+		static void deleteProgram(GLuint program);
+		static void deleteVertexArray(GLuint vao);
+		static void deleteBuffer(GLuint buffer);
+		static void deleteTexture(GLuint texture);
+		static void deleteFramebuffer(GLuint framebuffer);
+
+		// forgets everything, the next call of each kind reaches gl again
+		static void invalidate();
+	private:
+		struct IndexedBinding
+		{
+			GLuint mBuffer;
+			GLintptr mOffset;
+			GLsizeiptr mSize;
+		};
+
+		static const uint32_t kMaxTextureUnits = 32;
+		static const uint32_t kTextureTargetCount = 5;
+		static const uint32_t kBufferTargetCount = 12;
+
+		static int getTextureTargetIndex(GLenum target);
+		static int getBufferTargetIndex(GLenum target);
+
+		// true when the value differs and the call has to be issued, counts both outcomes
+		static bool update(GLuint& cached, GLuint value);
+
+		static GLuint mProgram;
+		static GLuint mVertexArray;
+		static std::array<GLuint, kBufferTargetCount> mBuffers;
+		static std::unordered_map<GLenum, std::vector<IndexedBinding>> mIndexedBuffers;
+		static uint32_t mActiveTexture;
+		static std::array<std::array<GLuint, kTextureTargetCount>, kMaxTextureUnits> mTextures;
+		static GLuint mDrawFramebuffer;
+		static GLuint mReadFramebuffer;
+		static std::array<GLint, 4> mViewport;
+		static bool mIsViewportKnown;
+		static std::unordered_map<GLenum, bool> mCaps;
+	};
+}
+
+#endif
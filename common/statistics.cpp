@@ -0,0 +1,23 @@
+#include "statistics.h"
+
+namespace es
+{
+	FrameStatistics Statistics::mCurrentFrame;
+	FrameStatistics Statistics::mLastFrame;
+
+	FrameStatistics& Statistics::getCurrentFrame()
+	{
+		return mCurrentFrame;
+	}
+
+	const FrameStatistics& Statistics::getLastFrame()
+	{
+		return mLastFrame;
+	}
+
+	void Statistics::beginFrame()
+	{
+		mLastFrame = mCurrentFrame;
+		mCurrentFrame = FrameStatistics();
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef STATISTICS_H_
+#define STATISTICS_H_
+
+#include <cstdint>
+
+namespace es
+{
+	// counters and timings of one frame, filled by the renderer classes
+	struct FrameStatistics
+	{
+		// glProgramUniform calls issued and the ones avoided because the program already held the value, values written into
+		// DrawParameters blocks count as uploads too
+		uint32_t mUniformUploads = 0;
+		uint32_t mUniformUploadsSkipped = 0;
+
+		// DrawParameters blocks streamed for draws and their bytes
+		uint32_t mDrawBlockUploads = 0;
+		uint32_t mDrawBlockBytes = 0;
+
+		// binds and enables that reached gl through the StateCache and the ones it dropped as redundant
+		uint32_t mStateChanges = 0;
+		uint32_t mStateChangesSkipped = 0;
+
+		// draws flushed by RenderQueues, the program, material and vertex array switches they cost and how many the sort saved
+		uint32_t mQueuedDraws = 0;
+		uint32_t mQueueStateChanges = 0;
+		uint32_t mQueueStateChangesSaved = 0;
+
+		// volumes tested by CullingBatch and the ones outside the frustum
+		uint32_t mObjectsVisible = 0;
+		uint32_t mObjectsCulled = 0;
+
+		// world transforms recomputed by scene graph updates
+		uint32_t mTransformsUpdated = 0;
+
+		// draw calls issued by meshes and InstanceBatcher, the instanced ones among them and the meshes they covered
+		uint32_t mDrawCalls = 0;
+		uint32_t mInstancedDraws = 0;
+		uint32_t mInstances = 0;
+
+		// milliseconds the FramePacer measured: work between the start and the end of the frame and waiting at the start for
+		// the gpu to finish an earlier frame. swap is the time ExampleBase spent in SDL_GL_SwapWindow, where vsync waits
+		float mCpuTime = 0.0f;
+		float mFenceWaitTime = 0.0f;
+		float mSwapTime = 0.0f;
+
+		// the cpu waited on the gpu for a noticeable part of the frame, false when the gpu kept up
+		bool mIsGpuBound = false;
+	};
+
+	class Statistics
+	{
+	public:
+		// counters of the frame being rendered
+		static FrameStatistics& getCurrentFrame();
+
+		// counters of the last finished frame
+		static const FrameStatistics& getLastFrame();
+
+		// called by ExampleBase at the start of every frame
+		static void beginFrame();
+	private:
+		static FrameStatistics mCurrentFrame;
+		static FrameStatistics mLastFrame;
+	};
+}
+
+#endif
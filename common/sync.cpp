@@ -0,0 +1,165 @@
+#include "sync.h"
+
+#include <statistics.h>
+
+namespace es
+{
+	namespace
+	{
+		// share of a frame the cpu has to spend waiting on the fence before the frame counts as gpu bound
+		const double kGpuBoundRatio = 0.1;
+
+		double elapsedMs(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end)
+		{
+			return std::chrono::duration<double, std::milli>(end - start).count();
+		}
+	}
+
+	Fence::Fence()
+		:mSync(nullptr)
+	{
+
+	}
+
+	Fence::~Fence()
+	{
+		reset();
+	}
+
+	void Fence::insert()
+	{
+		reset();
+		GLES_CHECK_ERROR(mSync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+	}
+
+	bool Fence::wait(uint64_t timeout)
+	{
+		if (mSync == nullptr)
+		{
+			return true;
+		}
+
+		GLES_CHECK_ERROR(GLenum result = glClientWaitSync(mSync, GL_SYNC_FLUSH_COMMANDS_BIT, timeout));
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+		{
+			reset();
+			return true;
+		}
+
+		if (result == GL_WAIT_FAILED)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "waiting for a fence failed");
+			reset();
+			return true;
+		}
+		return false;
+	}
+
+	bool Fence::isSignaled()
+	{
+		if (mSync == nullptr)
+		{
+			return true;
+		}
+
+		GLint status = GL_UNSIGNALED;
+		GLES_CHECK_ERROR(glGetSynciv(mSync, GL_SYNC_STATUS, sizeof(status), nullptr, &status));
+		return status == GL_SIGNALED;
+	}
+
+	bool Fence::isPending() const
+	{
+		return mSync != nullptr;
+	}
+
+	void Fence::reset()
+	{
+		if (mSync != nullptr)
+		{
+			GLES_CHECK_ERROR(glDeleteSync(mSync));
+			mSync = nullptr;
+		}
+	}
+
+	// -----------------------------------------------------------------------------------------------------------------------------------
+
+	FramePacer::FramePacer(uint32_t framesInFlight)
+		:mFrame(0),
+		 mWaitTime(0.0),
+		 mCpuTime(0.0),
+		 mIsGpuBound(false)
+	{
+		setFramesInFlight(framesInFlight);
+		mFrameStart = std::chrono::high_resolution_clock::now();
+	}
+
+	FramePacer::~FramePacer()
+	{
+
+	}
+
+	std::unique_ptr<FramePacer> FramePacer::create(uint32_t framesInFlight)
+	{
+		return std::make_unique<FramePacer>(framesInFlight);
+	}
+
+	void FramePacer::beginFrame()
+	{
+		auto waitStart = std::chrono::high_resolution_clock::now();
+		if (!mFences.empty())
+		{
+			// the slot of this frame was fenced framesInFlight frames ago
+			mFences[mFrame % mFences.size()]->wait(~0ull);
+		}
+		mFrameStart = std::chrono::high_resolution_clock::now();
+		mWaitTime = elapsedMs(waitStart, mFrameStart);
+	}
+
+	void FramePacer::endFrame()
+	{
+		if (!mFences.empty())
+		{
+			mFences[mFrame % mFences.size()]->insert();
+		}
+		mFrame++;
+
+		mCpuTime = elapsedMs(mFrameStart, std::chrono::high_resolution_clock::now());
+		mIsGpuBound = mWaitTime > (mWaitTime + mCpuTime) * kGpuBoundRatio;
+
+		FrameStatistics& statistics = Statistics::getCurrentFrame();
+		statistics.mCpuTime = static_cast<float>(mCpuTime);
+		statistics.mFenceWaitTime = static_cast<float>(mWaitTime);
+		statistics.mIsGpuBound = mIsGpuBound;
+	}
+
+	void FramePacer::setFramesInFlight(uint32_t framesInFlight)
+	{
+		framesInFlight = framesInFlight < kMaxFramesInFlight ? framesInFlight : kMaxFramesInFlight;
+		mFences.clear();
+		for (uint32_t i = 0; i < framesInFlight; i++)
+		{
+			mFences.push_back(std::make_unique<Fence>());
+		}
+		mFrame = 0;
+	}
+
+	uint32_t FramePacer::getFramesInFlight() const
+	{
+		return static_cast<uint32_t>(mFences.size());
+	}
+
+	double FramePacer::getWaitTime() const
+	{
+		return mWaitTime;
+	}
+
+	double FramePacer::getCpuTime() const
+	{
+		return mCpuTime;
+	}
+
+	bool FramePacer::isGpuBound() const
+	{
+		return mIsGpuBound;
+	}
+}
@@ -0,0 +1,81 @@
+#ifndef SYNC_H_
+#define SYNC_H_
+
+#include <ogles.h>
+
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace es
+{
+	// one glFenceSync at a time, tells the cpu whether the gpu finished the commands issued before insert
+	class Fence
+	{
+	public:
+		Fence();
+		~Fence();
+
+		// replaces the fence inserted before
+		void insert();
+
+		// true when no fence is pending or it signaled within timeout nanoseconds, flushes so the fence can signal at all
+		bool wait(uint64_t timeout);
+
+		bool isSignaled();
+
+		bool isPending() const;
+
+		void reset();
+
+		Fence(const Fence&) = delete;
+		const Fence& operator=(const Fence&) = delete;
+	private:
+		GLsync mSync;
+	};
+
+	// keeps at most framesInFlight frames queued on the gpu. every frame ends with a fence and the frame that reuses its slot
+	// waits for it, so the cpu neither runs ahead unbounded nor stalls at an unpredictable point inside the driver
+	class FramePacer
+	{
+	public:
+		static const uint32_t kDefaultFramesInFlight = 2;
+		static const uint32_t kMaxFramesInFlight = 4;
+
+		explicit FramePacer(uint32_t framesInFlight = kDefaultFramesInFlight);
+		~FramePacer();
+
+		static std::unique_ptr<FramePacer> create(uint32_t framesInFlight = kDefaultFramesInFlight);
+
+		// waits until the gpu finished the frame framesInFlight frames back, call before the frame issues any gl command
+		void beginFrame();
+
+		// fences the frame and classifies it, call after its last gl command and before the swap
+		void endFrame();
+
+		// 0 disables pacing, pending fences are dropped
+		void setFramesInFlight(uint32_t framesInFlight);
+		uint32_t getFramesInFlight() const;
+
+		// milliseconds of the last frame spent waiting for the gpu in beginFrame and working between beginFrame and endFrame
+		double getWaitTime() const;
+		double getCpuTime() const;
+
+		// the cpu waited for the gpu for a noticeable part of the last frame, otherwise the gpu kept up and the cpu is the limit
+		bool isGpuBound() const;
+
+		FramePacer(const FramePacer&) = delete;
+		const FramePacer& operator=(const FramePacer&) = delete;
+	private:
+		std::vector<std::unique_ptr<Fence>> mFences;
+		uint64_t mFrame;
+
+		std::chrono::high_resolution_clock::time_point mFrameStart;
+		double mWaitTime;
+		double mCpuTime;
+		bool mIsGpuBound;
+	};
+}
+
+#endif
@@ -1,6 +1,10 @@
 #include "texture.h"
+#include <threadpool.h>
 #include <stb_image.h>
 #include <utility.h>
+#include <statecache.h>
+
+#include <cstring>
 
 namespace es
 {
@@ -17,26 +21,23 @@ namespace es
 
 	Texture::~Texture()
 	{
-		GLES_CHECK_ERROR(glDeleteTextures(1, &mID));
+		StateCache::deleteTexture(mID);
 	}
 
 	void Texture::bind(uint32_t unit)
 	{
-		GLES_CHECK_ERROR(glActiveTexture(GL_TEXTURE0 + unit));
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(unit, mTarget, mID);
 	}
 
 	void Texture::unbind(uint32_t unit)
 	{
-		GLES_CHECK_ERROR(glActiveTexture(GL_TEXTURE0 + unit));
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
+		StateCache::bindTexture(unit, mTarget, 0);
 	}
 
 	void Texture::generateMipmaps()
 	{
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 		GLES_CHECK_ERROR(glGenerateMipmap(mTarget));
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 	}
 
 	GLuint Texture::getID()
@@ -66,33 +67,29 @@ namespace es
 
 	void Texture::setWrapping(GLenum s, GLenum t, GLenum r)
 	{
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_WRAP_S, s));
 		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_WRAP_T, t));
 		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_WRAP_R, r));
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 	}
 
 	void Texture::setBorderColor(float r, float g, float b, float a)
 	{
 		std::array<float, 4> borderColor = { r, g, b, a };
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 		GLES_CHECK_ERROR(glTexParameterfv(mTarget, GL_TEXTURE_BORDER_COLOR_EXT, borderColor.data()));
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 	}
 
 	void Texture::setMinFilter(GLenum filter)
 	{
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_MIN_FILTER, filter));
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 	}
 
 	void Texture::setMagFilter(GLenum filter)
 	{
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_MAG_FILTER, filter));
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 	}
 
 	void Texture::bindImage(uint32_t unit, uint32_t mipLevel, uint32_t layer, GLenum access, GLenum format)
@@ -102,29 +99,55 @@ namespace es
 
 	void Texture::setCompareMode(GLenum mode)
 	{
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_COMPARE_MODE, mode));
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 	}
 
 	void Texture::setCompareFunc(GLenum func)
 	{
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_COMPARE_FUNC, func));
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 	}
 
 	// ------------------------------------------------------------------------------------------------------------------------------------------
 
 	std::unordered_map<std::string, std::shared_ptr<Texture2D>> Texture2D::mTexture2DCache;
 
+	std::vector<Texture2D::PendingUpload> Texture2D::mPendingUploads;
+
+	double Texture2D::mTotalPlaceholderTime = 0.0;
+
+	Texture2D::MipGeneration Texture2D::mMipGeneration = Texture2D::MipGeneration::GPU;
+
+	bool Texture2D::mIsPreferCompressed = true;
+
+	Texture2D::Texture2D() : Texture()
+	{
+		mUploadBytes = 0;
+		mUploadTime = 0.0;
+		mIsLoaded = false;
+		mLoadFuture = mLoadPromise.get_future().share();
+	}
+
 	Texture2D::Texture2D(std::string path, int mipLevels, bool srgb, bool isFlipY) : Texture()
 	{
+		mUploadBytes = 0;
+		mUploadTime = 0.0;
+		mIsLoaded = true;
+		mLoadFuture = mLoadPromise.get_future().share();
+		mLoadPromise.set_value(true);
+
 		initFromFile(path, mipLevels, srgb, isFlipY);
 	}
 
 	Texture2D::Texture2D(uint32_t w, uint32_t h, int32_t mipLevels, uint32_t numSamples, GLenum internalFormat, GLenum format, GLenum type, bool isFixed) : Texture()
 	{
+		mUploadBytes = 0;
+		mUploadTime = 0.0;
+		mIsLoaded = true;
+		mLoadFuture = mLoadPromise.get_future().share();
+		mLoadPromise.set_value(true);
+
 		initFromData(w, h, mipLevels, numSamples, internalFormat, format, type, isFixed);
 	}
 
@@ -147,6 +170,234 @@ namespace es
 		}
 	}
 
+	std::shared_ptr<Texture2D> Texture2D::createFromFileAsync(std::string path, int mipLevels, bool srgb, bool isFlipY, uint32_t placeholderColor, std::function<void(Texture2D*)> callback)
+	{
+		if (mTexture2DCache.find(path) != mTexture2DCache.end())
+		{
+			std::shared_ptr<Texture2D> tex2d = mTexture2DCache[path];
+			if (callback)
+			{
+				if (tex2d->mIsLoaded)
+				{
+					callback(tex2d.get());
+				}
+				else
+				{
+					// chain onto the upload already in flight
+					for (PendingUpload& upload : mPendingUploads)
+					{
+						if (upload.mTexture == tex2d)
+						{
+							std::function<void(Texture2D*)> previous = upload.mCallback;
+							upload.mCallback = [previous, callback](Texture2D* texture)
+							{
+								if (previous)
+								{
+									previous(texture);
+								}
+								callback(texture);
+							};
+						}
+					}
+				}
+			}
+			return tex2d;
+		}
+
+		std::shared_ptr<Texture2D> tex2d = std::make_shared<Texture2D>();
+		tex2d->initPlaceholder(placeholderColor);
+		mTexture2DCache[path] = tex2d;
+
+		PendingUpload upload;
+		upload.mTexture = tex2d;
+		upload.mImage = ThreadPool::getThreadPool()->enqueue([path, isFlipY, mipLevels, srgb]()
+		{
+			// a cpu mip chain is built on the worker as well
+			ImageData image = decodeFile(path, isFlipY);
+			prepareMips(image, mipLevels, srgb);
+			return image;
+		});
+		upload.mMipLevels = mipLevels;
+		upload.mSRGB = srgb;
+		upload.mCallback = callback;
+		upload.mStartTime = std::chrono::high_resolution_clock::now();
+		mPendingUploads.push_back(std::move(upload));
+
+		return tex2d;
+	}
+
+	void Texture2D::processPendingUploads(double budgetMs)
+	{
+		if (mPendingUploads.empty())
+		{
+			return;
+		}
+
+		auto timeStart = std::chrono::high_resolution_clock::now();
+
+		for (auto iter = mPendingUploads.begin(); iter != mPendingUploads.end();)
+		{
+			if (iter->mImage.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				iter++;
+				continue;
+			}
+
+			PendingUpload upload = std::move(*iter);
+			iter = mPendingUploads.erase(iter);
+			finishUpload(upload);
+
+			// at least one upload per call, the rest waits for the next frame once the budget is spent
+			auto timeDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - timeStart).count();
+			if (timeDiff > budgetMs)
+			{
+				break;
+			}
+		}
+
+		if (mPendingUploads.empty())
+		{
+			SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "async textures done, %.2f ms spent with placeholders in total", mTotalPlaceholderTime);
+		}
+	}
+
+	void Texture2D::finishPendingUploads()
+	{
+		while (!mPendingUploads.empty())
+		{
+			PendingUpload upload = std::move(mPendingUploads.front());
+			mPendingUploads.erase(mPendingUploads.begin());
+
+			ThreadPool::getThreadPool()->wait(upload.mImage);
+			finishUpload(upload);
+		}
+	}
+
+	uint32_t Texture2D::getPendingUploadCount()
+	{
+		return static_cast<uint32_t>(mPendingUploads.size());
+	}
+
+	double Texture2D::getTotalPlaceholderTime()
+	{
+		return mTotalPlaceholderTime;
+	}
+
+	void Texture2D::finishUpload(PendingUpload& upload)
+	{
+		Texture2D* texture = upload.mTexture.get();
+		ImageData image = upload.mImage.get();
+
+		auto decodeEnd = std::chrono::high_resolution_clock::now();
+		auto placeholderTime = std::chrono::duration<double, std::milli>(decodeEnd - upload.mStartTime).count();
+
+		if (image.isEmpty())
+		{
+			// the placeholder stays bound for good
+			mTotalPlaceholderTime += placeholderTime;
+			texture->mLoadPromise.set_value(false);
+			return;
+		}
+
+		// build the real texture in a new object and swap the id, so every material holding this texture sees it on the next bind
+		GLuint placeholderID = texture->mID;
+		GLES_CHECK_ERROR(glGenTextures(1, &texture->mID));
+		texture->initFromImage(image, upload.mMipLevels, upload.mSRGB);
+		StateCache::deleteTexture(placeholderID);
+
+		auto uploadEnd = std::chrono::high_resolution_clock::now();
+		placeholderTime = std::chrono::duration<double, std::milli>(uploadEnd - upload.mStartTime).count();
+		mTotalPlaceholderTime += placeholderTime;
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "texture %ux%u : placeholder for %.2f ms, uploaded %llu bytes in %.2f ms",
+			texture->mWidth, texture->mHeight, placeholderTime, (unsigned long long)texture->mUploadBytes, texture->mUploadTime);
+
+		texture->mIsLoaded = true;
+		texture->mLoadPromise.set_value(true);
+
+		if (upload.mCallback)
+		{
+			upload.mCallback(texture);
+		}
+	}
+
+	ImageData Texture2D::decodeFile(const std::string& path, bool isFlipY)
+	{
+		ImageData image;
+		void* data;
+
+		std::string compressedPath = findCompressedFile(path);
+		if (!compressedPath.empty())
+		{
+			KTXImage ktx;
+			if (KTX::read(compressedPath, ktx) && TextureCompressor::isSupported(ktx.mInternalFormat))
+			{
+				// blocks cannot be flipped here, the encoder already wrote them in the wanted row order
+				if (ktx.mIsBottomUp != isFlipY)
+				{
+					SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "%s is stored %s, it will appear upside down", compressedPath.c_str(), ktx.mIsBottomUp ? "bottom up" : "top down");
+				}
+
+				image.mWidth = ktx.mWidth;
+				image.mHeight = ktx.mHeight;
+				image.mComponents = TextureCompressor::getChannelCount(ktx.mInternalFormat);
+				image.mCompressedFormat = ktx.mInternalFormat;
+				image.mCompressedLevels = std::move(ktx.mLevels);
+				return image;
+			}
+
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to read compressed texture %s", compressedPath.c_str());
+			if (compressedPath == path)
+			{
+				return image;
+			}
+		}
+
+		if (Utility::fileExtension(path) == "hdr")
+		{
+			image.mIsHDR = true;
+			data = (void*)stbi_loadf(path.c_str(), &image.mWidth, &image.mHeight, &image.mComponents, 0);
+		}
+		else
+		{
+			data = (void*)stbi_load(path.c_str(), &image.mWidth, &image.mHeight, &image.mComponents, 0);
+		}
+
+		if (!data)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to decode image %s", path.c_str());
+			return image;
+		}
+
+		image.mPixels = std::shared_ptr<void>(data, stbi_image_free);
+
+		if (isFlipY)
+		{
+			std::size_t rowSize = static_cast<std::size_t>(image.mWidth) * image.mComponents * (image.mIsHDR ? sizeof(float) : sizeof(uint8_t));
+			std::vector<uint8_t> row(rowSize);
+			uint8_t* pixels = static_cast<uint8_t*>(data);
+			for (int y = 0; y < image.mHeight / 2; y++)
+			{
+				uint8_t* top = pixels + y * rowSize;
+				uint8_t* bottom = pixels + (image.mHeight - 1 - y) * rowSize;
+				std::memcpy(row.data(), top, rowSize);
+				std::memcpy(top, bottom, rowSize);
+				std::memcpy(bottom, row.data(), rowSize);
+			}
+		}
+
+		return image;
+	}
+
+	bool Texture2D::isLoaded() const
+	{
+		return mIsLoaded;
+	}
+
+	std::shared_future<bool> Texture2D::getLoadFuture() const
+	{
+		return mLoadFuture;
+	}
+
 	std::shared_ptr<Texture2D> Texture2D::createFromData(uint32_t w, uint32_t h, int32_t mipLevels, uint32_t numSamples, GLenum internalFormat, GLenum format, GLenum type, bool isFixed)
 	{
 		return std::make_shared<Texture2D>(w, h, mipLevels, numSamples, internalFormat, format, type, isFixed);
@@ -169,7 +420,7 @@ namespace es
 				height = max(1, height / 2);
 			}
 
-			GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+			StateCache::bindTexture(mTarget, mID);
 
 			if (mFixed)
 			{
@@ -179,78 +430,188 @@ namespace es
 			{
 				GLES_CHECK_ERROR(glTexImage2D(mTarget, mipLevel, mInternalFormat, width, height, 0, mFormat, mType, data));
 			}
-
-			GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 		}
 	}
 
 	void Texture2D::initFromFile(std::string path, int mipLevels, bool srgb, bool isFlipY)
 	{
-		int width, height, components;
-		void* data;
-		bool ishdr = false;
+		ImageData image = decodeFile(path, isFlipY);
+		if (image.isEmpty())
+		{
+			return;
+		}
 
-		stbi_set_flip_vertically_on_load(isFlipY);
-		if (Utility::fileExtension(path) == "hdr")
+		initFromImage(image, mipLevels, srgb);
+	}
+
+	void Texture2D::initFromImage(ImageData& image, int mipLevels, bool srgb)
+	{
+		if (image.mCompressedFormat != 0)
 		{
-			ishdr = true;
-			data = (void*)stbi_loadf(path.c_str(), &width, &height, &components, 0);
+			initFromCompressed(image, mipLevels, srgb);
+			return;
 		}
-		else
+
+		auto timeStart = std::chrono::high_resolution_clock::now();
+
+		GLenum internalFormat, format, type;
+		selectFormats(image, srgb, internalFormat, format, type);
+
+		mInternalFormat = internalFormat;
+		mFormat = format;
+		mType = type;
+		mWidth = image.mWidth;
+		mHeight = image.mHeight;
+		mNumSamples = 1;
+		mFixed = true;
+		mMipLevels = resolveMipLevels(image, mipLevels);
+		mTarget = GL_TEXTURE_2D;
+
+		prepareMips(image, mipLevels, srgb);
+
+		const uint32_t texelSize = image.mComponents * (image.mIsHDR ? sizeof(float) : sizeof(uint8_t));
+
+		// rows of odd sized levels are not 4 byte aligned for 1 and 3 channel formats
+		GLES_CHECK_ERROR(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+		StateCache::bindTexture(mTarget, mID);
+		GLES_CHECK_ERROR(glTexStorage2D(mTarget, mMipLevels, mInternalFormat, mWidth, mHeight));
+
+		// level 0 is uploaded once, the other levels come from the precomputed chain or the gpu
+		GLES_CHECK_ERROR(glTexSubImage2D(mTarget, 0, 0, 0, mWidth, mHeight, mFormat, mType, image.mPixels.get()));
+		mUploadBytes = static_cast<uint64_t>(mWidth) * mHeight * texelSize;
+
+		if (mMipLevels > 1)
 		{
-			data = (void*)stbi_load(path.c_str(), &width, &height, &components, 0);
+			if (image.mMips.size() + 1 >= mMipLevels)
+			{
+				for (uint32_t i = 1; i < mMipLevels; i++)
+				{
+					const MipLevel& level = image.mMips[i - 1];
+					GLES_CHECK_ERROR(glTexSubImage2D(mTarget, i, 0, 0, level.mWidth, level.mHeight, mFormat, mType, level.mData.data()));
+					mUploadBytes += level.mData.size();
+				}
+			}
+			else
+			{
+				GLES_CHECK_ERROR(glGenerateMipmap(mTarget));
+			}
 		}
 
-		if (!data)
+		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+		GLES_CHECK_ERROR(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+
+		auto timeEnd = std::chrono::high_resolution_clock::now();
+		mUploadTime = std::chrono::duration<double, std::milli>(timeEnd - timeStart).count();
+	}
+
+	void Texture2D::initFromCompressed(const ImageData& image, int mipLevels, bool srgb)
+	{
+		auto timeStart = std::chrono::high_resolution_clock::now();
+
+		// the file decides the format, only the color space follows the request since the blocks are the same
+		mInternalFormat = TextureCompressor::toColorSpace(image.mCompressedFormat, srgb);
+		mFormat = TextureCompressor::getBaseFormat(image.mCompressedFormat);
+		mType = GL_UNSIGNED_BYTE;
+		mWidth = image.mWidth;
+		mHeight = image.mHeight;
+		mNumSamples = 1;
+		mFixed = true;
+		mTarget = GL_TEXTURE_2D;
+
+		// compressed levels cannot be generated, so a file with fewer levels than requested keeps what it has
+		uint32_t levelCount = static_cast<uint32_t>(image.mCompressedLevels.size());
+		mMipLevels = resolveMipLevels(image, mipLevels);
+		if (mMipLevels > levelCount)
 		{
-			stbi_image_free(data);
-			return;
+			mMipLevels = levelCount;
+		}
+
+		StateCache::bindTexture(mTarget, mID);
+		GLES_CHECK_ERROR(glTexStorage2D(mTarget, mMipLevels, mInternalFormat, mWidth, mHeight));
+
+		mUploadBytes = 0;
+		for (uint32_t i = 0; i < mMipLevels; i++)
+		{
+			const MipLevel& level = image.mCompressedLevels[i];
+			GLES_CHECK_ERROR(glCompressedTexSubImage2D(mTarget, i, 0, 0, level.mWidth, level.mHeight, mInternalFormat, static_cast<GLsizei>(level.mData.size()), level.mData.data()));
+			mUploadBytes += level.mData.size();
+		}
+
+		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_MIN_FILTER, mMipLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+		auto timeEnd = std::chrono::high_resolution_clock::now();
+		mUploadTime = std::chrono::duration<double, std::milli>(timeEnd - timeStart).count();
+	}
+
+	std::string Texture2D::findCompressedFile(const std::string& path)
+	{
+		if (Utility::fileExtension(path) == "ktx")
+		{
+			return path;
+		}
+
+		if (!mIsPreferCompressed)
+		{
+			return "";
 		}
 
-		GLenum internalFormat, format;
-		GLenum type = GL_UNSIGNED_BYTE;
+		std::string compressedPath = path.substr(0, path.find_last_of('.')) + ".ktx";
+		return std::ifstream(compressedPath).good() ? compressedPath : "";
+	}
+
+	void Texture2D::setPreferCompressed(bool isPreferCompressed)
+	{
+		mIsPreferCompressed = isPreferCompressed;
+	}
+
+	bool Texture2D::isPreferCompressed()
+	{
+		return mIsPreferCompressed;
+	}
+
+	void Texture2D::selectFormats(const ImageData& image, bool srgb, GLenum& internalFormat, GLenum& format, GLenum& type)
+	{
+		type = image.mIsHDR ? GL_FLOAT : GL_UNSIGNED_BYTE;
 
-		switch (components)
+		switch (image.mComponents)
 		{
 			case 1:
 			{
-				internalFormat = GL_R8;
+				internalFormat = image.mIsHDR ? GL_R32F : GL_R8;
 				format = GL_RED;
 				break;
 			}
 			case 2:
 			{
-				internalFormat = GL_RG8;
+				internalFormat = image.mIsHDR ? GL_RG32F : GL_RG8;
 				format = GL_RG;
 				break;
 			}
 			case 3:
 			{
-				if (srgb)
+				if (image.mIsHDR)
+					internalFormat = GL_RGB32F;
+				else if (srgb)
 					internalFormat = GL_SRGB8;
 				else
 					internalFormat = GL_RGB8;
-
-				if (ishdr)
-				{
-					internalFormat = GL_RGB32F;
-					type = GL_FLOAT;
-				}
 				format = GL_RGB;
 				break;
 			}
 			case 4:
 			{
-				if (srgb)
+				if (image.mIsHDR)
+					internalFormat = GL_RGBA32F;
+				else if (srgb)
 					internalFormat = GL_SRGB8_ALPHA8;
 				else
 					internalFormat = GL_RGBA8;
-
-				if (ishdr)
-				{
-					internalFormat = GL_RGBA32F;
-					type = GL_FLOAT;
-				}
 				format = GL_RGBA;
 				break;
 			}
@@ -261,64 +622,109 @@ namespace es
 				break;
 			}
 		}
+	}
 
-		mInternalFormat = internalFormat;
-		mFormat = format;
-		mType = type;
-		mWidth = width;
-		mHeight = height;
-		mNumSamples = 1;
-		mFixed = true;
-	    
-		if (mipLevels == -1)
+	uint32_t Texture2D::resolveMipLevels(const ImageData& image, int mipLevels)
+	{
+		uint32_t fullChain = MipGenerator::getFullChainLength(image.mWidth, image.mHeight);
+		if (mipLevels < 1 || static_cast<uint32_t>(mipLevels) > fullChain)
 		{
-			mMipLevels = 1;
+			return fullChain;
+		}
+		return static_cast<uint32_t>(mipLevels);
+	}
 
-			while (width > 1 && height > 1)
-			{
-				width = max(1, (width / 2));
-				height = max(1, (height / 2));
-				mMipLevels++;
-			}
+	bool Texture2D::canGenerateMipsOnGPU(GLenum internalFormat)
+	{
+		// glGenerateMipmap needs a color-renderable and filterable format, GL_SRGB8 and 32-bit float formats are neither in ES 3.1
+		switch (internalFormat)
+		{
+			case GL_R8:
+			case GL_RG8:
+			case GL_RGB8:
+			case GL_RGBA8:
+			case GL_SRGB8_ALPHA8:
+				return true;
+			default:
+				return false;
 		}
-		else
+	}
+
+	void Texture2D::prepareMips(ImageData& image, int mipLevels, bool srgb)
+	{
+		if (!image.mPixels)
 		{
-			mMipLevels = mipLevels;
+			return;
 		}
 
-		if (mNumSamples > 1)
+		GLenum internalFormat, format, type;
+		selectFormats(image, srgb, internalFormat, format, type);
+
+		uint32_t levels = resolveMipLevels(image, mipLevels);
+		if (levels < 2 || image.mMips.size() + 1 >= levels)
 		{
-			mTarget = GL_TEXTURE_2D_MULTISAMPLE;
+			return;
 		}
-		else
+
+		if (mMipGeneration == MipGeneration::GPU && canGenerateMipsOnGPU(internalFormat))
 		{
-			mTarget = GL_TEXTURE_2D;
+			return;
 		}
 
-		width = mWidth;
-		height = mHeight;
+		bool isSRGB = internalFormat == GL_SRGB8 || internalFormat == GL_SRGB8_ALPHA8;
+		MipFilter filter = mMipGeneration == MipGeneration::CPUKaiser ? MipFilter::Kaiser : MipFilter::Box;
+		image.mMips = MipGenerator::generate(image.mPixels.get(), image.mWidth, image.mHeight, image.mComponents, image.mIsHDR, isSRGB, levels, filter);
+	}
 
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
-		GLES_CHECK_ERROR(glTexStorage2D(mTarget, mMipLevels, mInternalFormat, mWidth, mHeight));
+	void Texture2D::setMipGeneration(MipGeneration mode)
+	{
+		mMipGeneration = mode;
+	}
 
-		for (int i = 0; i < mMipLevels; i++)
-		{
-			glTexSubImage2D(mTarget, i, 0, 0, width, height, mFormat, mType, data);
+	Texture2D::MipGeneration Texture2D::getMipGeneration()
+	{
+		return mMipGeneration;
+	}
 
-			width = max(1, (width / 2));
-			height = max(1, (height / 2));
+	void Texture2D::setMipChain(const std::vector<MipLevel>& levels)
+	{
+		GLES_CHECK_ERROR(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+		StateCache::bindTexture(mTarget, mID);
+
+		for (std::size_t i = 0; i < levels.size() && i + 1 < mMipLevels; i++)
+		{
+			GLES_CHECK_ERROR(glTexSubImage2D(mTarget, static_cast<GLint>(i + 1), 0, 0, levels[i].mWidth, levels[i].mHeight, mFormat, mType, levels[i].mData.data()));
 		}
+		GLES_CHECK_ERROR(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+	}
 
-		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
-		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+	uint64_t Texture2D::getUploadBytes() const
+	{
+		return mUploadBytes;
+	}
 
-		GLES_CHECK_ERROR(glGenerateMipmap(mTarget));
+	double Texture2D::getUploadTime() const
+	{
+		return mUploadTime;
+	}
 
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
+	void Texture2D::initPlaceholder(uint32_t color)
+	{
+		mInternalFormat = GL_RGBA8;
+		mFormat = GL_RGBA;
+		mType = GL_UNSIGNED_BYTE;
+		mWidth = 1;
+		mHeight = 1;
+		mMipLevels = 1;
+		mNumSamples = 1;
+		mFixed = true;
+		mTarget = GL_TEXTURE_2D;
 
-		stbi_image_free(data);
+		StateCache::bindTexture(mTarget, mID);
+		GLES_CHECK_ERROR(glTexStorage2D(mTarget, 1, mInternalFormat, 1, 1));
+		GLES_CHECK_ERROR(glTexSubImage2D(mTarget, 0, 0, 0, 1, 1, mFormat, mType, &color));
+		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
 	}
 
 	void Texture2D::initFromData(uint32_t w, uint32_t h, int32_t mipLevels, uint32_t numSamples, GLenum internalFormat, GLenum format, GLenum type, bool isFixed)
@@ -358,7 +764,7 @@ namespace es
 		int width = mWidth;
 		int height = mHeight;
 
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 
 		if (mNumSamples > 1)
 		{
@@ -390,17 +796,14 @@ namespace es
 		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
 
 		GLES_CHECK_ERROR(glGenerateMipmap(mTarget));
-
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 	}
 
 	void Texture2D::resize(uint32_t mipLevel, uint32_t w, uint32_t h)
 	{
 		if (!mFixed)
 		{
-			GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+			StateCache::bindTexture(mTarget, mID);
 			GLES_CHECK_ERROR(glTexImage2D(mTarget, mipLevel, mInternalFormat, w, h, 0, mFormat, mType, nullptr));
-			GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 
 			mWidth = w;
 			mHeight = h;
@@ -489,7 +892,7 @@ namespace es
 		int width = mWidth;
 		int height = mHeight;
 
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 
 		if (mNumSamples > 1)
 		{
@@ -522,8 +925,6 @@ namespace es
 		GLES_CHECK_ERROR(glTexParameteri(mTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
 
 		GLES_CHECK_ERROR(glGenerateMipmap(mTarget));
-
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 	}
 
 	uint32_t Texture2DArray::getWidth() const
@@ -560,9 +961,8 @@ namespace es
 	{
 		if (!mFixed)
 		{
-			GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+			StateCache::bindTexture(mTarget, mID);
 			GLES_CHECK_ERROR(glTexImage3D(mTarget, mipLevel, mInternalFormat, w, h, d, 0, mFormat, mType, nullptr));
-			GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 
 			mWidth = w;
 			mHeight = h;
@@ -630,9 +1030,8 @@ namespace es
 			height = max(1, (height / 2));
 		}
 
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 		GLES_CHECK_ERROR(glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + faceIndex, mipLevel, mInternalFormat, width, height, 0, mFormat, mType, data));
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 	}
 
 	bool TextureCube::initFromFiles(std::vector<std::string> paths, int mipLevels, bool srgb)
@@ -655,7 +1054,7 @@ namespace es
 		}
 
 		mTarget = GL_TEXTURE_CUBE_MAP;
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 		for (std::size_t i = 0; i < paths.size(); i++)
 		{
 			if (ishdr)
@@ -725,7 +1124,6 @@ namespace es
 			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, mInternalFormat, width, height, 0, mFormat, mType, data);
 			stbi_image_free(data);
 		}
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 
 		setMinFilter(GL_LINEAR);
 		setMagFilter(GL_LINEAR);
@@ -745,24 +1143,22 @@ namespace es
 		mHeight = h;
 		mMipLevels = mipLevels;
 
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 		for (GLuint i = 0; i < 6; i++)
 		{
 			GLES_CHECK_ERROR(glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, mInternalFormat, mWidth, mHeight, 0, mFormat, mType, data));
 		}
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 		
 		return true;
 	}
 
 	void TextureCube::resize(uint32_t mipLevel, uint32_t w, uint32_t h)
 	{
-		GLES_CHECK_ERROR(glBindTexture(mTarget, mID));
+		StateCache::bindTexture(mTarget, mID);
 		for (GLuint i = 0; i < 6; i++)
 		{
 			GLES_CHECK_ERROR(glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mipLevel, mInternalFormat, w, h, 0, mFormat, mType, nullptr));
 		}
-		GLES_CHECK_ERROR(glBindTexture(mTarget, 0));
 
 		mWidth = w;
 		mHeight = h;
@@ -10,6 +10,13 @@
 #include <vector>
 #include <array>
 #include <unordered_map>
+#include <functional>
+#include <future>
+#include <chrono>
+
+#include <mipmap.h>
+#include <ktx.h>
+#include <texturecompressor.h>
 
 namespace es
 {
@@ -51,19 +58,81 @@ namespace es
 
 	// ----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 
+	// decoded pixels of an image file, produced on any thread
+	struct ImageData
+	{
+		std::shared_ptr<void> mPixels;
+		int mWidth = 0;
+		int mHeight = 0;
+		int mComponents = 0;
+		bool mIsHDR = false;
+		// optional precomputed levels starting at level 1
+		std::vector<MipLevel> mMips;
+		// blocks of a ktx file, level 0 first, mPixels stays empty
+		GLenum mCompressedFormat = 0;
+		std::vector<MipLevel> mCompressedLevels;
+
+		bool isEmpty() const
+		{
+			return !mPixels && mCompressedLevels.empty();
+		}
+	};
+
 	class Texture2D : public Texture
 	{
 	public:
+		// how file textures get their mip chain, formats the gpu cannot generate for always use the cpu box filter
+		enum class MipGeneration
+		{
+			GPU,
+			CPUBox,
+			CPUKaiser
+		};
+
+		Texture2D();
 		Texture2D(std::string path, int mipLevels = 1, bool srgb = true, bool isFlipY = true);
 		Texture2D(uint32_t w, uint32_t h, int32_t mipLevels, uint32_t numSamples, GLenum internalFormat, GLenum format, GLenum type, bool isFixed = true);
 		~Texture2D();
 
 		static std::shared_ptr<Texture2D> createFromFile(std::string path, int mipLevels = 1, bool srgb = true, bool isFlipY = true);
 
+		// returns at once with a 1x1 placeholder of placeholderColor (0xAABBGGRR), the file is decoded on the thread pool
+		// and the real texture replaces the placeholder inside processPendingUploads, where the callback is invoked as well
+		static std::shared_ptr<Texture2D> createFromFileAsync(std::string path, int mipLevels = 1, bool srgb = true, bool isFlipY = true,
+			uint32_t placeholderColor = 0xFFFFFFFF, std::function<void(Texture2D*)> callback = nullptr);
+
+		// uploads finished decodes on the context thread until the time budget is spent, called once per frame
+		static void processPendingUploads(double budgetMs = 4.0);
+
+		// blocks until every pending texture is uploaded
+		static void finishPendingUploads();
+
+		static uint32_t getPendingUploadCount();
+
+		// summed over all async textures, the time between creation and the swap to the real image
+		static double getTotalPlaceholderTime();
+
+		// thread safe, the rows are flipped here since the stb_image flip flag is global,
+		// ktx files and preferred .ktx siblings keep their compressed blocks
+		static ImageData decodeFile(const std::string& path, bool isFlipY);
+
+		// when set, foo.png is loaded from foo.ktx if that file exists, on by default
+		static void setPreferCompressed(bool isPreferCompressed);
+		static bool isPreferCompressed();
+
+		// thread safe, fills image.mMips when the current mip generation mode needs a cpu chain
+		static void prepareMips(ImageData& image, int mipLevels, bool srgb);
+
+		static void setMipGeneration(MipGeneration mode);
+		static MipGeneration getMipGeneration();
+
 		static std::shared_ptr<Texture2D> createFromData(uint32_t w, uint32_t h, int32_t mipLevels, uint32_t numSamples, GLenum internalFormat, GLenum format, GLenum type, bool isFixed = true);
 
 		void setData(uint32_t mipLevel, void* data);
 
+		// uploads precomputed levels starting at level 1
+		void setMipChain(const std::vector<MipLevel>& levels);
+
 		void resize(uint32_t mipLevel, uint32_t w, uint32_t h);
 
 		uint32_t getWidth();
@@ -71,8 +140,36 @@ namespace es
 		uint32_t getMipLevels();
 		uint32_t getNumSamples();
 		bool getFixed() const;
+
+		// false while a placeholder is bound
+		bool isLoaded() const;
+
+		// bytes passed to the driver and cpu time spent on the last upload from a file, mips included
+		uint64_t getUploadBytes() const;
+		double getUploadTime() const;
+
+		// ready once the texture holds its final image, false when decoding failed, only fulfilled by processPendingUploads
+		std::shared_future<bool> getLoadFuture() const;
 	private:
+		struct PendingUpload
+		{
+			std::shared_ptr<Texture2D> mTexture;
+			std::future<ImageData> mImage;
+			int mMipLevels;
+			bool mSRGB;
+			std::function<void(Texture2D*)> mCallback;
+			std::chrono::time_point<std::chrono::high_resolution_clock> mStartTime;
+		};
+
 		void initFromFile(std::string path, int mipLevels, bool srgb, bool isFlipY);
+		void initFromImage(ImageData& image, int mipLevels, bool srgb);
+		void initFromCompressed(const ImageData& image, int mipLevels, bool srgb);
+		static std::string findCompressedFile(const std::string& path);
+		void initPlaceholder(uint32_t color);
+		static void finishUpload(PendingUpload& upload);
+		static void selectFormats(const ImageData& image, bool srgb, GLenum& internalFormat, GLenum& format, GLenum& type);
+		static uint32_t resolveMipLevels(const ImageData& image, int mipLevels);
+		static bool canGenerateMipsOnGPU(GLenum internalFormat);
 		void initFromData(uint32_t w, uint32_t h, int32_t mipLevels, uint32_t numSamples, GLenum internalFormat, GLenum format, GLenum type, bool isFixed);
 
 		uint32_t mWidth;
@@ -81,7 +178,19 @@ namespace es
 		uint32_t mNumSamples;
 		bool mFixed;
 
+		uint64_t mUploadBytes;
+		double mUploadTime;
+
+		bool mIsLoaded;
+		std::promise<bool> mLoadPromise;
+		std::shared_future<bool> mLoadFuture;
+
 		static std::unordered_map<std::string, std::shared_ptr<Texture2D>> mTexture2DCache;
+
+		static std::vector<PendingUpload> mPendingUploads;
+		static double mTotalPlaceholderTime;
+		static MipGeneration mMipGeneration;
+		static bool mIsPreferCompressed;
 	};
 
 	class Texture2DArray : public Texture
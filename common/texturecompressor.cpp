@@ -0,0 +1,620 @@
+#include "texturecompressor.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace es
+{
+	namespace
+	{
+		// etc1/etc2 intensity modifiers, a pixel index selects +a, +b, -a or -b
+		const int kETCModifiers[8][2] =
+		{
+			{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+		};
+
+		const int kEACModifiers[16][8] =
+		{
+			{ -3, -6, -9, -15, 2, 5, 8, 14 },
+			{ -3, -7, -10, -13, 2, 6, 9, 12 },
+			{ -2, -5, -8, -13, 1, 4, 7, 12 },
+			{ -2, -4, -6, -13, 1, 3, 5, 12 },
+			{ -3, -6, -8, -12, 2, 5, 7, 11 },
+			{ -3, -7, -9, -11, 2, 6, 8, 10 },
+			{ -4, -7, -8, -11, 3, 6, 7, 10 },
+			{ -3, -5, -8, -11, 2, 4, 7, 10 },
+			{ -2, -6, -8, -10, 1, 5, 7, 9 },
+			{ -2, -5, -8, -10, 1, 4, 7, 9 },
+			{ -2, -4, -8, -10, 1, 3, 7, 9 },
+			{ -2, -5, -7, -10, 1, 4, 6, 9 },
+			{ -3, -4, -7, -10, 2, 3, 6, 9 },
+			{ -1, -2, -3, -10, 0, 1, 2, 9 },
+			{ -4, -6, -8, -9, 3, 5, 7, 8 },
+			{ -3, -5, -7, -9, 2, 4, 6, 8 }
+		};
+
+		int clampInt(int value, int low, int high)
+		{
+			return value < low ? low : (value > high ? high : value);
+		}
+
+		int etcModifier(int table, int index)
+		{
+			int modifier = kETCModifiers[table][index & 1];
+			return (index & 2) ? -modifier : modifier;
+		}
+
+		int eacValue(int base, int multiplier, int table, int index, bool eac11)
+		{
+			int modifier = kEACModifiers[table][index];
+			if (!eac11)
+			{
+				return clampInt(base + modifier * multiplier, 0, 255);
+			}
+			if (multiplier == 0)
+			{
+				return clampInt(base * 8 + 4 + modifier, 0, 2047);
+			}
+			return clampInt(base * 8 + 4 + modifier * multiplier * 8, 0, 2047);
+		}
+
+		// the sub-block of a texel, side by side 2x4 halves without flip, stacked 4x2 halves with flip
+		int subBlockOf(int x, int y, bool flip)
+		{
+			return flip ? (y >= 2 ? 1 : 0) : (x >= 2 ? 1 : 0);
+		}
+
+		struct SubBlockFit
+		{
+			int mTable;
+			uint8_t mIndices[16];
+			uint32_t mError;
+		};
+
+		// picks the modifier table and per texel indices of one sub-block around a base color
+		SubBlockFit fitSubBlock(const uint8_t* pixels, bool flip, int subBlock, const int* base)
+		{
+			SubBlockFit best;
+			best.mError = std::numeric_limits<uint32_t>::max();
+
+			for (int table = 0; table < 8; table++)
+			{
+				SubBlockFit fit;
+				fit.mTable = table;
+				fit.mError = 0;
+
+				for (int y = 0; y < 4; y++)
+				{
+					for (int x = 0; x < 4; x++)
+					{
+						if (subBlockOf(x, y, flip) != subBlock)
+						{
+							continue;
+						}
+
+						const uint8_t* texel = pixels + (y * 4 + x) * 4;
+						uint32_t bestTexelError = std::numeric_limits<uint32_t>::max();
+						for (int index = 0; index < 4; index++)
+						{
+							int modifier = etcModifier(table, index);
+							uint32_t error = 0;
+							for (int c = 0; c < 3; c++)
+							{
+								int diff = clampInt(base[c] + modifier, 0, 255) - texel[c];
+								error += diff * diff;
+							}
+							if (error < bestTexelError)
+							{
+								bestTexelError = error;
+								fit.mIndices[x * 4 + y] = static_cast<uint8_t>(index);
+							}
+						}
+						fit.mError += bestTexelError;
+					}
+				}
+
+				if (fit.mError < best.mError)
+				{
+					best = fit;
+				}
+			}
+
+			return best;
+		}
+
+		// runs body(firstRow, lastRow) over block rows on the thread pool and waits for all of them
+		template<typename F>
+		void parallelBlockRows(uint32_t rowCount, F body)
+		{
+			ThreadPool* threadPool = ThreadPool::getThreadPool();
+
+			std::vector<std::future<void>> chunks;
+			for (uint32_t row = 0; row < rowCount; row += 4)
+			{
+				uint32_t lastRow = std::min(rowCount, row + 4);
+				chunks.push_back(threadPool->enqueue([body, row, lastRow]() { body(row, lastRow); }));
+			}
+
+			for (std::future<void>& chunk : chunks)
+			{
+				threadPool->wait(chunk);
+			}
+		}
+	}
+
+	// ----------------------------------------------------------------------------------------------------------------------------------------
+
+	bool TextureCompressor::isSupported(GLenum format)
+	{
+		switch (format)
+		{
+			case GL_COMPRESSED_RGB8_ETC2:
+			case GL_COMPRESSED_SRGB8_ETC2:
+			case GL_COMPRESSED_RGBA8_ETC2_EAC:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+			case GL_COMPRESSED_R11_EAC:
+			case GL_COMPRESSED_RG11_EAC:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	uint32_t TextureCompressor::getBlockSize(GLenum format)
+	{
+		switch (format)
+		{
+			case GL_COMPRESSED_RGB8_ETC2:
+			case GL_COMPRESSED_SRGB8_ETC2:
+			case GL_COMPRESSED_R11_EAC:
+				return 8;
+			default:
+				return 16;
+		}
+	}
+
+	std::size_t TextureCompressor::getCompressedSize(GLenum format, uint32_t w, uint32_t h)
+	{
+		return static_cast<std::size_t>((w + 3) / 4) * ((h + 3) / 4) * getBlockSize(format);
+	}
+
+	uint32_t TextureCompressor::getChannelCount(GLenum format)
+	{
+		switch (format)
+		{
+			case GL_COMPRESSED_R11_EAC:
+				return 1;
+			case GL_COMPRESSED_RG11_EAC:
+				return 2;
+			case GL_COMPRESSED_RGB8_ETC2:
+			case GL_COMPRESSED_SRGB8_ETC2:
+				return 3;
+			default:
+				return 4;
+		}
+	}
+
+	GLenum TextureCompressor::toColorSpace(GLenum format, bool srgb)
+	{
+		switch (format)
+		{
+			case GL_COMPRESSED_RGB8_ETC2:
+			case GL_COMPRESSED_SRGB8_ETC2:
+				return srgb ? GL_COMPRESSED_SRGB8_ETC2 : GL_COMPRESSED_RGB8_ETC2;
+			case GL_COMPRESSED_RGBA8_ETC2_EAC:
+			case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+				return srgb ? GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC : GL_COMPRESSED_RGBA8_ETC2_EAC;
+			default:
+				return format;
+		}
+	}
+
+	GLenum TextureCompressor::getBaseFormat(GLenum format)
+	{
+		switch (format)
+		{
+			case GL_COMPRESSED_R11_EAC:
+				return GL_RED;
+			case GL_COMPRESSED_RG11_EAC:
+				return GL_RG;
+			case GL_COMPRESSED_RGB8_ETC2:
+			case GL_COMPRESSED_SRGB8_ETC2:
+				return GL_RGB;
+			default:
+				return GL_RGBA;
+		}
+	}
+
+	std::vector<uint8_t> TextureCompressor::compress(const uint8_t* rgba, uint32_t w, uint32_t h, GLenum format)
+	{
+		const uint32_t blocksX = (w + 3) / 4;
+		const uint32_t blocksY = (h + 3) / 4;
+		const uint32_t blockSize = getBlockSize(format);
+
+		std::vector<uint8_t> blocks(getCompressedSize(format, w, h));
+		parallelBlockRows(blocksY, [&](uint32_t firstRow, uint32_t lastRow)
+		{
+			uint8_t pixels[16 * 4];
+			for (uint32_t by = firstRow; by < lastRow; by++)
+			{
+				for (uint32_t bx = 0; bx < blocksX; bx++)
+				{
+					// texels outside the image repeat the edge
+					for (uint32_t y = 0; y < 4; y++)
+					{
+						for (uint32_t x = 0; x < 4; x++)
+						{
+							uint32_t sx = std::min(bx * 4 + x, w - 1);
+							uint32_t sy = std::min(by * 4 + y, h - 1);
+							std::memcpy(pixels + (y * 4 + x) * 4, rgba + (static_cast<std::size_t>(sy) * w + sx) * 4, 4);
+						}
+					}
+
+					uint8_t* block = blocks.data() + (static_cast<std::size_t>(by) * blocksX + bx) * blockSize;
+					switch (format)
+					{
+						case GL_COMPRESSED_RGB8_ETC2:
+						case GL_COMPRESSED_SRGB8_ETC2:
+							encodeETC2Block(pixels, block);
+							break;
+						case GL_COMPRESSED_RGBA8_ETC2_EAC:
+						case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+							encodeEACBlock(pixels + 3, 4, false, block);
+							encodeETC2Block(pixels, block + 8);
+							break;
+						case GL_COMPRESSED_R11_EAC:
+							encodeEACBlock(pixels, 4, true, block);
+							break;
+						case GL_COMPRESSED_RG11_EAC:
+							encodeEACBlock(pixels, 4, true, block);
+							encodeEACBlock(pixels + 1, 4, true, block + 8);
+							break;
+					}
+				}
+			}
+		});
+
+		return blocks;
+	}
+
+	std::vector<uint8_t> TextureCompressor::decompress(const uint8_t* blocks, uint32_t w, uint32_t h, GLenum format)
+	{
+		const uint32_t blocksX = (w + 3) / 4;
+		const uint32_t blocksY = (h + 3) / 4;
+		const uint32_t blockSize = getBlockSize(format);
+
+		std::vector<uint8_t> rgba(static_cast<std::size_t>(w) * h * 4);
+		for (uint32_t by = 0; by < blocksY; by++)
+		{
+			for (uint32_t bx = 0; bx < blocksX; bx++)
+			{
+				uint8_t pixels[16 * 4];
+				for (int i = 0; i < 16; i++)
+				{
+					pixels[i * 4 + 0] = 0;
+					pixels[i * 4 + 1] = 0;
+					pixels[i * 4 + 2] = 0;
+					pixels[i * 4 + 3] = 255;
+				}
+
+				const uint8_t* block = blocks + (static_cast<std::size_t>(by) * blocksX + bx) * blockSize;
+				switch (format)
+				{
+					case GL_COMPRESSED_RGB8_ETC2:
+					case GL_COMPRESSED_SRGB8_ETC2:
+						decodeETC2Block(block, pixels);
+						break;
+					case GL_COMPRESSED_RGBA8_ETC2_EAC:
+					case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+						decodeETC2Block(block + 8, pixels);
+						decodeEACBlock(block, false, pixels + 3, 4);
+						break;
+					case GL_COMPRESSED_R11_EAC:
+						decodeEACBlock(block, true, pixels, 4);
+						break;
+					case GL_COMPRESSED_RG11_EAC:
+						decodeEACBlock(block, true, pixels, 4);
+						decodeEACBlock(block + 8, true, pixels + 1, 4);
+						break;
+				}
+
+				for (uint32_t y = 0; y < 4 && by * 4 + y < h; y++)
+				{
+					for (uint32_t x = 0; x < 4 && bx * 4 + x < w; x++)
+					{
+						std::memcpy(rgba.data() + (static_cast<std::size_t>(by * 4 + y) * w + bx * 4 + x) * 4, pixels + (y * 4 + x) * 4, 4);
+					}
+				}
+			}
+		}
+
+		return rgba;
+	}
+
+	double TextureCompressor::computePSNR(const uint8_t* reference, const uint8_t* image, uint32_t w, uint32_t h, uint32_t channelCount)
+	{
+		double squaredError = 0.0;
+		const std::size_t texelCount = static_cast<std::size_t>(w) * h;
+		for (std::size_t i = 0; i < texelCount; i++)
+		{
+			for (uint32_t c = 0; c < channelCount; c++)
+			{
+				double diff = static_cast<double>(reference[i * 4 + c]) - image[i * 4 + c];
+				squaredError += diff * diff;
+			}
+		}
+
+		double meanSquaredError = squaredError / (static_cast<double>(texelCount) * channelCount);
+		if (meanSquaredError <= 0.0)
+		{
+			return 99.0;
+		}
+		return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+	}
+
+	// ----------------------------------------------------------------------------------------------------------------------------------------
+
+	void TextureCompressor::encodeETC2Block(const uint8_t* pixels, uint8_t* block)
+	{
+		// only the etc1 compatible individual and differential modes are searched, the differential
+		// base colors never overflow so decoders never see the etc2 t, h or planar modes
+		uint32_t bestError = std::numeric_limits<uint32_t>::max();
+
+		for (int flip = 0; flip < 2; flip++)
+		{
+			float average[2][3] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+			for (int y = 0; y < 4; y++)
+			{
+				for (int x = 0; x < 4; x++)
+				{
+					int subBlock = subBlockOf(x, y, flip != 0);
+					for (int c = 0; c < 3; c++)
+					{
+						average[subBlock][c] += pixels[(y * 4 + x) * 4 + c] / 8.0f;
+					}
+				}
+			}
+
+			for (int differential = 1; differential >= 0; differential--)
+			{
+				int quantized[2][3];
+				int base[2][3];
+				for (int s = 0; s < 2; s++)
+				{
+					for (int c = 0; c < 3; c++)
+					{
+						if (differential)
+						{
+							quantized[s][c] = clampInt(static_cast<int>(average[s][c] * 31.0f / 255.0f + 0.5f), 0, 31);
+						}
+						else
+						{
+							quantized[s][c] = clampInt(static_cast<int>(average[s][c] * 15.0f / 255.0f + 0.5f), 0, 15);
+						}
+					}
+				}
+
+				for (int c = 0; c < 3; c++)
+				{
+					if (differential)
+					{
+						// the second color is stored as a 3 bit signed offset from the first
+						quantized[1][c] = quantized[0][c] + clampInt(quantized[1][c] - quantized[0][c], -4, 3);
+						base[0][c] = (quantized[0][c] << 3) | (quantized[0][c] >> 2);
+						base[1][c] = (quantized[1][c] << 3) | (quantized[1][c] >> 2);
+					}
+					else
+					{
+						base[0][c] = (quantized[0][c] << 4) | quantized[0][c];
+						base[1][c] = (quantized[1][c] << 4) | quantized[1][c];
+					}
+				}
+
+				SubBlockFit fits[2] =
+				{
+					fitSubBlock(pixels, flip != 0, 0, base[0]),
+					fitSubBlock(pixels, flip != 0, 1, base[1])
+				};
+				uint32_t error = fits[0].mError + fits[1].mError;
+				if (error >= bestError)
+				{
+					continue;
+				}
+				bestError = error;
+
+				for (int c = 0; c < 3; c++)
+				{
+					if (differential)
+					{
+						block[c] = static_cast<uint8_t>((quantized[0][c] << 3) | ((quantized[1][c] - quantized[0][c]) & 7));
+					}
+					else
+					{
+						block[c] = static_cast<uint8_t>((quantized[0][c] << 4) | quantized[1][c]);
+					}
+				}
+				block[3] = static_cast<uint8_t>((fits[0].mTable << 5) | (fits[1].mTable << 2) | (differential << 1) | flip);
+
+				uint32_t msb = 0;
+				uint32_t lsb = 0;
+				for (int y = 0; y < 4; y++)
+				{
+					for (int x = 0; x < 4; x++)
+					{
+						int texel = x * 4 + y;
+						uint32_t index = fits[subBlockOf(x, y, flip != 0)].mIndices[texel];
+						msb |= (index >> 1) << texel;
+						lsb |= (index & 1) << texel;
+					}
+				}
+				block[4] = static_cast<uint8_t>(msb >> 8);
+				block[5] = static_cast<uint8_t>(msb);
+				block[6] = static_cast<uint8_t>(lsb >> 8);
+				block[7] = static_cast<uint8_t>(lsb);
+			}
+		}
+	}
+
+	void TextureCompressor::decodeETC2Block(const uint8_t* block, uint8_t* pixels)
+	{
+		// covers the individual and differential modes written by encodeETC2Block
+		bool flip = (block[3] & 1) != 0;
+		bool differential = (block[3] & 2) != 0;
+
+		int base[2][3];
+		for (int c = 0; c < 3; c++)
+		{
+			if (differential)
+			{
+				int first = block[c] >> 3;
+				int offset = block[c] & 7;
+				int second = clampInt(first + (offset >= 4 ? offset - 8 : offset), 0, 31);
+				base[0][c] = (first << 3) | (first >> 2);
+				base[1][c] = (second << 3) | (second >> 2);
+			}
+			else
+			{
+				base[0][c] = (block[c] & 0xF0) | (block[c] >> 4);
+				base[1][c] = ((block[c] & 0x0F) << 4) | (block[c] & 0x0F);
+			}
+		}
+
+		int tables[2] = { block[3] >> 5, (block[3] >> 2) & 7 };
+		uint32_t msb = (block[4] << 8) | block[5];
+		uint32_t lsb = (block[6] << 8) | block[7];
+
+		for (int y = 0; y < 4; y++)
+		{
+			for (int x = 0; x < 4; x++)
+			{
+				int texel = x * 4 + y;
+				int subBlock = subBlockOf(x, y, flip);
+				int index = static_cast<int>((((msb >> texel) & 1) << 1) | ((lsb >> texel) & 1));
+				int modifier = etcModifier(tables[subBlock], index);
+				for (int c = 0; c < 3; c++)
+				{
+					pixels[(y * 4 + x) * 4 + c] = static_cast<uint8_t>(clampInt(base[subBlock][c] + modifier, 0, 255));
+				}
+			}
+		}
+	}
+
+	void TextureCompressor::encodeEACBlock(const uint8_t* values, uint32_t stride, bool eac11, uint8_t* block)
+	{
+		// targets live in the decoded range, 0..255 for alpha and 0..2047 for r11
+		const int scale = eac11 ? 8 : 1;
+		int targets[16];
+		int low = std::numeric_limits<int>::max();
+		int high = std::numeric_limits<int>::min();
+		for (int i = 0; i < 16; i++)
+		{
+			int value = values[i * stride];
+			targets[i] = eac11 ? (value * 2047 + 127) / 255 : value;
+			low = std::min(low, targets[i]);
+			high = std::max(high, targets[i]);
+		}
+
+		uint64_t bestError = std::numeric_limits<uint64_t>::max();
+		int bestBase = 0;
+		int bestMultiplier = 1;
+		int bestTable = 0;
+		uint8_t bestIndices[16] = { 0 };
+
+		for (int table = 0; table < 16 && bestError > 0; table++)
+		{
+			const int modifierLow = kEACModifiers[table][3];
+			const int modifierHigh = kEACModifiers[table][7];
+			const float span = static_cast<float>((modifierHigh - modifierLow) * scale);
+			const int idealMultiplier = static_cast<int>((high - low) / span + 0.5f);
+
+			for (int multiplier = idealMultiplier - 1; multiplier <= idealMultiplier + 1; multiplier++)
+			{
+				if (multiplier < 1 || multiplier > 15)
+				{
+					continue;
+				}
+
+				// base that centers the modifier range on the value range
+				float center = (low + high) * 0.5f - (modifierLow + modifierHigh) * 0.5f * multiplier * scale;
+				int centerBase = static_cast<int>(std::floor((eac11 ? (center - 4.0f) / 8.0f : center) + 0.5f));
+
+				for (int base = centerBase - 1; base <= centerBase + 1; base++)
+				{
+					if (base < 0 || base > 255)
+					{
+						continue;
+					}
+
+					uint64_t error = 0;
+					uint8_t indices[16];
+					for (int i = 0; i < 16 && error < bestError; i++)
+					{
+						int bestTexelError = std::numeric_limits<int>::max();
+						for (int index = 0; index < 8; index++)
+						{
+							int diff = eacValue(base, multiplier, table, index, eac11) - targets[i];
+							if (diff * diff < bestTexelError)
+							{
+								bestTexelError = diff * diff;
+								indices[i] = static_cast<uint8_t>(index);
+							}
+						}
+						error += bestTexelError;
+					}
+
+					if (error < bestError)
+					{
+						bestError = error;
+						bestBase = base;
+						bestMultiplier = multiplier;
+						bestTable = table;
+						std::memcpy(bestIndices, indices, sizeof(indices));
+					}
+				}
+			}
+		}
+
+		block[0] = static_cast<uint8_t>(bestBase);
+		block[1] = static_cast<uint8_t>((bestMultiplier << 4) | bestTable);
+
+		// 3 bit indices in column order, the first texel in the most significant bits
+		uint64_t bits = 0;
+		for (int y = 0; y < 4; y++)
+		{
+			for (int x = 0; x < 4; x++)
+			{
+				bits |= static_cast<uint64_t>(bestIndices[y * 4 + x]) << (45 - 3 * (x * 4 + y));
+			}
+		}
+		for (int i = 0; i < 6; i++)
+		{
+			block[2 + i] = static_cast<uint8_t>(bits >> (40 - 8 * i));
+		}
+	}
+
+	void TextureCompressor::decodeEACBlock(const uint8_t* block, bool eac11, uint8_t* values, uint32_t stride)
+	{
+		int base = block[0];
+		int multiplier = block[1] >> 4;
+		int table = block[1] & 0x0F;
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			bits = (bits << 8) | block[2 + i];
+		}
+
+		for (int y = 0; y < 4; y++)
+		{
+			for (int x = 0; x < 4; x++)
+			{
+				int index = static_cast<int>((bits >> (45 - 3 * (x * 4 + y))) & 7);
+				int value = eacValue(base, multiplier, table, index, eac11);
+				values[(y * 4 + x) * stride] = static_cast<uint8_t>(eac11 ? (value * 255 + 1023) / 2047 : value);
+			}
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef TEXTURE_COMPRESSOR_H_
+#define TEXTURE_COMPRESSOR_H_
+
+#include <GLES3/gl3.h>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace es
+{
+	// cpu codec for the block formats every es 3.x device samples natively, works without a gl context
+	class TextureCompressor
+	{
+	public:
+		// true for the etc2 and eac formats handled here
+		static bool isSupported(GLenum format);
+
+		// bytes of one 4x4 block, 8 or 16
+		static uint32_t getBlockSize(GLenum format);
+
+		static std::size_t getCompressedSize(GLenum format, uint32_t w, uint32_t h);
+
+		// number of channels the format stores, used for psnr
+		static uint32_t getChannelCount(GLenum format);
+
+		// the srgb or linear variant of an etc2 color format, the block data is identical, eac formats are returned unchanged
+		static GLenum toColorSpace(GLenum format, bool srgb);
+
+		// base internal format written to the ktx header
+		static GLenum getBaseFormat(GLenum format);
+
+		// rgba is tightly packed rgba8, rg11 takes its channels from red and green, rows are padded to whole blocks by edge clamping
+		static std::vector<uint8_t> compress(const uint8_t* rgba, uint32_t w, uint32_t h, GLenum format);
+
+		// decodes into tightly packed rgba8, missing channels are 0 and alpha 255
+		static std::vector<uint8_t> decompress(const uint8_t* blocks, uint32_t w, uint32_t h, GLenum format);
+
+		// peak signal to noise ratio over the first channelCount channels of two rgba8 images, 99 for identical images
+		static double computePSNR(const uint8_t* reference, const uint8_t* image, uint32_t w, uint32_t h, uint32_t channelCount);
+
+		// single blocks, pixels are 16 rgba8 texels in row order
+		static void encodeETC2Block(const uint8_t* pixels, uint8_t* block);
+		static void decodeETC2Block(const uint8_t* block, uint8_t* pixels);
+
+		// values are 16 bytes read with the given stride, eac11 is the 11 bit r11/rg11 variant, otherwise the 8 bit alpha variant
+		static void encodeEACBlock(const uint8_t* values, uint32_t stride, bool eac11, uint8_t* block);
+		static void decodeEACBlock(const uint8_t* block, bool eac11, uint8_t* values, uint32_t stride);
+	};
+}
+
+#endif
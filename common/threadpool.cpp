@@ -0,0 +1,85 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace es
+{
+	ThreadPool* ThreadPool::threadPool = nullptr;
+	ThreadPool::GarbageDeleter ThreadPool::gd;
+
+	ThreadPool::ThreadPool(std::size_t threadCount)
+	{
+		mIsStopping = false;
+
+		for (std::size_t i = 0; i < threadCount; i++)
+		{
+			mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mIsStopping = true;
+		}
+		mCondition.notify_all();
+
+		for (std::thread& worker : mWorkers)
+		{
+			worker.join();
+		}
+	}
+
+	ThreadPool* ThreadPool::getThreadPool()
+	{
+		if (threadPool == nullptr)
+		{
+			std::size_t hardwareThreads = std::thread::hardware_concurrency();
+			threadPool = new (std::nothrow) ThreadPool(std::max<std::size_t>(hardwareThreads, 2) - 1);
+		}
+		return threadPool;
+	}
+
+	bool ThreadPool::runPendingTask()
+	{
+		std::function<void()> task;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mTasks.empty())
+			{
+				return false;
+			}
+			task = std::move(mTasks.front());
+			mTasks.pop();
+		}
+
+		task();
+		return true;
+	}
+
+	std::size_t ThreadPool::getThreadCount() const
+	{
+		return mWorkers.size();
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mCondition.wait(lock, [this]() { return mIsStopping || !mTasks.empty(); });
+				if (mIsStopping && mTasks.empty())
+				{
+					return;
+				}
+				task = std::move(mTasks.front());
+				mTasks.pop();
+			}
+
+			task();
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <chrono>
+
+namespace es
+{
+	// fixed set of worker threads for cpu work such as model import, never touches the gl context
+	class ThreadPool
+	{
+	public:
+		ThreadPool(std::size_t threadCount);
+		~ThreadPool();
+
+		// shared pool with one worker less than the hardware threads, the context thread helps while it waits
+		static ThreadPool* getThreadPool();
+
+		template<typename F>
+		auto enqueue(F&& task) -> std::future<decltype(task())>
+		{
+			using ResultType = decltype(task());
+
+			auto packagedTask = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(task));
+			std::future<ResultType> future = packagedTask->get_future();
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mTasks.push([packagedTask]() { (*packagedTask)(); });
+			}
+			mCondition.notify_one();
+			return future;
+		}
+
+		// runs queued tasks on the calling thread until the future is ready, so nested waits cannot starve the pool
+		template<typename T>
+		T wait(std::future<T>& future)
+		{
+			while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				if (!runPendingTask())
+				{
+					future.wait_for(std::chrono::milliseconds(1));
+				}
+			}
+			return future.get();
+		}
+
+		bool runPendingTask();
+
+		std::size_t getThreadCount() const;
+
+		ThreadPool(const ThreadPool&) = delete;
+		const ThreadPool& operator=(const ThreadPool&) = delete;
+	private:
+		void workerLoop();
+
+		std::vector<std::thread> mWorkers;
+		std::queue<std::function<void()>> mTasks;
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+		bool mIsStopping;
+
+		static ThreadPool* threadPool;
+
+		class GarbageDeleter
+		{
+		public:
+			GarbageDeleter() = default;
+			~GarbageDeleter()
+			{
+				if (ThreadPool::threadPool)
+				{
+					delete ThreadPool::threadPool;
+					ThreadPool::threadPool = nullptr;
+				}
+			}
+		};
+		static GarbageDeleter gd;
+	};
+}
+
+#endif
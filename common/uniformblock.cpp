@@ -0,0 +1,188 @@
+#include "uniformblock.h"
+
+#include <statistics.h>
+
+namespace es
+{
+	namespace
+	{
+		template<typename T>
+		bool uploadValue(Program* program, UniformHandle handle, const uint8_t* data)
+		{
+			// storage carries no alignment guarantees, copy out before handing it to the program
+			T value;
+			std::memcpy(&value, data, sizeof(T));
+			return program->setUniform(handle, value);
+		}
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+
+	UniformBlock::UniformBlock()
+		:mProgram(nullptr)
+	{
+	}
+
+	bool UniformBlock::contains(UniformId id) const
+	{
+		return findEntry(id) != nullptr;
+	}
+
+	bool UniformBlock::read(UniformId id, UniformType type, void* out) const
+	{
+		const Entry* entry = findEntry(id);
+		if (entry == nullptr || entry->mType != type)
+		{
+			return false;
+		}
+
+		std::memcpy(out, mStorage.data() + entry->mOffset, getTypeSize(type));
+		return true;
+	}
+
+	uint32_t UniformBlock::getTypeSize(UniformType type)
+	{
+		switch (type)
+		{
+			case UniformType::INT:
+				return sizeof(int);
+			case UniformType::BOOL:
+				return sizeof(bool);
+			case UniformType::FLOAT:
+				return sizeof(float);
+			case UniformType::VEC2:
+				return sizeof(glm::vec2);
+			case UniformType::VEC3:
+				return sizeof(glm::vec3);
+			case UniformType::VEC4:
+				return sizeof(glm::vec4);
+			case UniformType::MAT2:
+				return sizeof(glm::mat2);
+			case UniformType::MAT3:
+				return sizeof(glm::mat3);
+			case UniformType::MAT4:
+				return sizeof(glm::mat4);
+		}
+		return 0;
+	}
+
+	void UniformBlock::apply(Program* program)
+	{
+		applyEntries(program, nullptr);
+	}
+
+	void UniformBlock::applyMissing(Program* program, const UniformBlock& overrides)
+	{
+		applyEntries(program, &overrides);
+	}
+
+	UniformBlock::Entry* UniformBlock::findEntry(UniformId id)
+	{
+		for (Entry& entry : mEntries)
+		{
+			if (entry.mId.getHash() == id.getHash())
+			{
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+
+	const UniformBlock::Entry* UniformBlock::findEntry(UniformId id) const
+	{
+		for (const Entry& entry : mEntries)
+		{
+			if (entry.mId.getHash() == id.getHash())
+			{
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+
+	UniformBlock::Entry* UniformBlock::addEntry(UniformId id, UniformType type, uint32_t size)
+	{
+		Entry* entry = findEntry(id);
+		if (entry == nullptr)
+		{
+			mEntries.push_back({ id, type, 0, UniformHandle(), 0, true });
+			entry = &mEntries.back();
+
+			// a new name has no handle for the current program yet
+			mProgram = nullptr;
+		}
+
+		// a uniform that changes its type gets fresh storage, the old bytes stay unused
+		entry->mType = type;
+		entry->mOffset = static_cast<uint32_t>(mStorage.size());
+		mStorage.resize(mStorage.size() + size);
+
+		return entry;
+	}
+
+	void UniformBlock::applyEntries(Program* program, const UniformBlock* overrides)
+	{
+		if (program == nullptr)
+		{
+			return;
+		}
+
+		if (program != mProgram)
+		{
+			for (Entry& entry : mEntries)
+			{
+				entry.mHandle = program->getUniformHandle(entry.mId);
+				entry.mIsDirty = true;
+			}
+			mProgram = program;
+		}
+
+		FrameStatistics& statistics = Statistics::getCurrentFrame();
+		for (Entry& entry : mEntries)
+		{
+			if (overrides != nullptr && overrides->contains(entry.mId))
+			{
+				continue;
+			}
+
+			// clean and nobody wrote to the slot since, the program still holds our value
+			uint64_t writeSerial = program->getUniformWriteSerial(entry.mHandle);
+			if (!entry.mIsDirty && writeSerial == entry.mWriteSerial)
+			{
+				statistics.mUniformUploadsSkipped++;
+				continue;
+			}
+
+			upload(program, entry);
+			entry.mWriteSerial = program->getUniformWriteSerial(entry.mHandle);
+			entry.mIsDirty = false;
+		}
+	}
+
+	bool UniformBlock::upload(Program* program, const Entry& entry) const
+	{
+		const uint8_t* data = mStorage.data() + entry.mOffset;
+		switch (entry.mType)
+		{
+			case UniformType::INT:
+				return uploadValue<int>(program, entry.mHandle, data);
+			case UniformType::BOOL:
+				return uploadValue<bool>(program, entry.mHandle, data);
+			case UniformType::FLOAT:
+				return uploadValue<float>(program, entry.mHandle, data);
+			case UniformType::VEC2:
+				return uploadValue<glm::vec2>(program, entry.mHandle, data);
+			case UniformType::VEC3:
+				return uploadValue<glm::vec3>(program, entry.mHandle, data);
+			case UniformType::VEC4:
+				return uploadValue<glm::vec4>(program, entry.mHandle, data);
+			case UniformType::MAT2:
+				return uploadValue<glm::mat2>(program, entry.mHandle, data);
+			case UniformType::MAT3:
+				return uploadValue<glm::mat3>(program, entry.mHandle, data);
+			case UniformType::MAT4:
+				return uploadValue<glm::mat4>(program, entry.mHandle, data);
+		}
+		return false;
+	}
+}
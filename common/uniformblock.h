@@ -0,0 +1,118 @@
+#ifndef UNIFORM_BLOCK_H_
+#define UNIFORM_BLOCK_H_
+
+#include <program.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+namespace es
+{
+	enum class UniformType : uint8_t
+	{
+		INT,
+		BOOL,
+		FLOAT,
+		VEC2,
+		VEC3,
+		VEC4,
+		MAT2,
+		MAT3,
+		MAT4
+	};
+
+	template<typename T>
+	struct UniformTypeOf;
+
+	template<> struct UniformTypeOf<int> { static constexpr UniformType value = UniformType::INT; };
+	template<> struct UniformTypeOf<bool> { static constexpr UniformType value = UniformType::BOOL; };
+	template<> struct UniformTypeOf<float> { static constexpr UniformType value = UniformType::FLOAT; };
+	template<> struct UniformTypeOf<glm::vec2> { static constexpr UniformType value = UniformType::VEC2; };
+	template<> struct UniformTypeOf<glm::vec3> { static constexpr UniformType value = UniformType::VEC3; };
+	template<> struct UniformTypeOf<glm::vec4> { static constexpr UniformType value = UniformType::VEC4; };
+	template<> struct UniformTypeOf<glm::mat2> { static constexpr UniformType value = UniformType::MAT2; };
+	template<> struct UniformTypeOf<glm::mat3> { static constexpr UniformType value = UniformType::MAT3; };
+	template<> struct UniformTypeOf<glm::mat4> { static constexpr UniformType value = UniformType::MAT4; };
+
+	// typed uniform values packed into one byte array, only entries whose bytes changed are uploaded again
+	class UniformBlock
+	{
+	public:
+		UniformBlock();
+
+		template<typename T>
+		void set(UniformId id, const T& value)
+		{
+			constexpr UniformType type = UniformTypeOf<T>::value;
+
+			Entry* entry = findEntry(id);
+			if (entry == nullptr || entry->mType != type)
+			{
+				entry = addEntry(id, type, sizeof(T));
+			}
+			else if (std::memcmp(mStorage.data() + entry->mOffset, &value, sizeof(T)) == 0)
+			{
+				return;
+			}
+
+			std::memcpy(mStorage.data() + entry->mOffset, &value, sizeof(T));
+			entry->mIsDirty = true;
+		}
+
+		bool contains(UniformId id) const;
+
+		// copies the stored value into out when the entry exists with that type
+		bool read(UniformId id, UniformType type, void* out) const;
+
+		static uint32_t getTypeSize(UniformType type);
+
+		// uploads the entries that changed here or were overwritten in the program since our last upload
+		void apply(Program* program);
+
+		// same as apply but leaves out the entries overrides holds, used for the defaults a mesh shares with its clones
+		void applyMissing(Program* program, const UniformBlock& overrides);
+
+		// value a mesh uniform falls back to when a clone never set it
+		template<typename T>
+		static T getDefault()
+		{
+			return T(0);
+		}
+	private:
+		struct Entry
+		{
+			UniformId mId;
+			UniformType mType;
+			uint32_t mOffset;
+			UniformHandle mHandle;
+			// write serial of the program slot after our last upload
+			uint64_t mWriteSerial;
+			bool mIsDirty;
+		};
+
+		Entry* findEntry(UniformId id);
+		const Entry* findEntry(UniformId id) const;
+		Entry* addEntry(UniformId id, UniformType type, uint32_t size);
+
+		void applyEntries(Program* program, const UniformBlock* overrides);
+		bool upload(Program* program, const Entry& entry) const;
+
+		std::vector<Entry> mEntries;
+		std::vector<uint8_t> mStorage;
+
+		// program the handles were resolved for
+		const Program* mProgram;
+	};
+
+	template<> inline int UniformBlock::getDefault<int>() { return 1; }
+	template<> inline float UniformBlock::getDefault<float>() { return 1.0f; }
+	template<> inline bool UniformBlock::getDefault<bool>() { return false; }
+	template<> inline glm::mat2 UniformBlock::getDefault<glm::mat2>() { return glm::mat2(1.0f); }
+	template<> inline glm::mat3 UniformBlock::getDefault<glm::mat3>() { return glm::mat3(1.0f); }
+	template<> inline glm::mat4 UniformBlock::getDefault<glm::mat4>() { return glm::mat4(1.0f); }
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "world.h"
 
+#include "object.h"
+
 namespace es
 {
 	World* World::world = nullptr;
@@ -10,6 +12,7 @@ namespace es
 		mMainCamera = nullptr;
 		mGlobalMaterial = nullptr;
 		mIsGlobalMaterialEnabled = false;
+		mFrameUniforms = FrameUniforms();
 	}
 
 	World::~World()
@@ -72,6 +75,7 @@ namespace es
 		{
 			mMainCamera->update();
 		}
+		updateFrameUniforms(deltaTime);
 	}
 
 	void World::createMainCamera(float fov, float near, float far, float aspectRatio, glm::vec3 position, glm::vec3 forward)
@@ -81,10 +85,132 @@ namespace es
 			mMainCamera.reset(nullptr);
 		}
 		mMainCamera = Camera::create(fov, near, far, aspectRatio, position, forward);
+
+		// the first frame is rendered before the first update
+		updateFrameUniforms(0.0f);
 	}
 
 	Camera* World::getMainCamera() const
 	{
 		return mMainCamera.get();
 	}
+
+	void World::addObject(Object* object)
+	{
+		if (object == nullptr || object->mBoundsProxy != AABBTree::kNullNode)
+		{
+			return;
+		}
+
+		// objects without bounds have nothing to be found by, they are left out
+		AABB bounds = object->getWorldBounds();
+		if (!bounds.isValid())
+		{
+			return;
+		}
+		object->mBoundsProxy = mObjectTree.insert(bounds, object);
+	}
+
+	void World::removeObject(Object* object)
+	{
+		if (object == nullptr || object->mBoundsProxy == AABBTree::kNullNode)
+		{
+			return;
+		}
+
+		if (mObjectTree.getUserData(object->mBoundsProxy) == object)
+		{
+			mObjectTree.remove(object->mBoundsProxy);
+		}
+		object->mBoundsProxy = AABBTree::kNullNode;
+	}
+
+	void World::updateObject(Object* object)
+	{
+		if (object == nullptr || mObjectTree.getUserData(object->mBoundsProxy) != object)
+		{
+			return;
+		}
+
+		AABB bounds = object->getWorldBounds();
+		if (bounds.isValid())
+		{
+			mObjectTree.move(object->mBoundsProxy, bounds);
+		}
+	}
+
+	void World::queryFrustum(const Frustum& frustum, std::vector<Object*>& objects) const
+	{
+		mObjectTree.queryFrustum(frustum, [&objects](void* userData) { objects.push_back(static_cast<Object*>(userData)); });
+	}
+
+	void World::queryBox(const AABB& box, std::vector<Object*>& objects) const
+	{
+		mObjectTree.queryBox(box, [&objects](void* userData) { objects.push_back(static_cast<Object*>(userData)); });
+	}
+
+	void World::querySphere(const BoundingSphere& sphere, std::vector<Object*>& objects) const
+	{
+		mObjectTree.querySphere(sphere, [&objects](void* userData) { objects.push_back(static_cast<Object*>(userData)); });
+	}
+
+	Object* World::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float* distance) const
+	{
+		glm::vec3 inverseDirection = 1.0f / direction;
+
+		// the tree only knows the fat boxes, the leaves are tested against the real bounds
+		auto hit = [&](void* userData, float limit, float& hitDistance)
+		{
+			return static_cast<Object*>(userData)->getWorldBounds().intersectRay(origin, inverseDirection, limit, hitDistance);
+		};
+
+		float hitDistance = maxDistance;
+		Object* object = static_cast<Object*>(mObjectTree.raycast(origin, direction, maxDistance, hit, hitDistance));
+		if (distance != nullptr && object != nullptr)
+		{
+			*distance = hitDistance;
+		}
+		return object;
+	}
+
+	const FrameUniforms& World::getFrameUniforms() const
+	{
+		return mFrameUniforms;
+	}
+
+	void World::updateFrameUniforms(float deltaTime)
+	{
+		if (mMainCamera == nullptr)
+		{
+			return;
+		}
+
+		if (mFrameStream == nullptr)
+		{
+			mFrameStream = StreamBuffer::create(GL_UNIFORM_BUFFER, sizeof(FrameUniforms));
+		}
+
+		FrameUniforms& uniforms = mFrameUniforms;
+		uniforms.mPreviousViewProjection = mMainCamera->getPrevViewProjection();
+		uniforms.mView = mMainCamera->getView();
+		uniforms.mProjection = mMainCamera->getProjection();
+		uniforms.mViewProjection = mMainCamera->getViewProjection();
+		uniforms.mCameraPosition = mMainCamera->getPosition();
+		uniforms.mTime += deltaTime;
+		uniforms.mFrameIndex++;
+
+		// the frame rendered since the last write read the previous region, it is fenced before the ring moves on
+		mFrameStream->endFrame();
+		mFrameStream->beginFrame();
+		std::size_t offset = mFrameStream->write(&uniforms, sizeof(FrameUniforms));
+		if (offset != StreamBuffer::kInvalidOffset)
+		{
+			mFrameStream->bindRange(Program::kFrameBlockBinding, offset, sizeof(FrameUniforms));
+		}
+	}
+
+	const AABBTree& World::getObjectTree() const
+	{
+		return mObjectTree;
+	}
 }
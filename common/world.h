@@ -5,12 +5,30 @@
 
 #include <iostream>
 #include <memory>
+#include <vector>
 
 #include "camera.h"
 #include "material.h"
+#include "aabbtree.h"
+#include "buffer.h"
 
 namespace es
 {
+	class Object;
+
+	// std140 image of the FrameParameters block in resources/shaders/common/frame.glsl
+	struct FrameUniforms
+	{
+		glm::mat4 mView;
+		glm::mat4 mProjection;
+		glm::mat4 mViewProjection;
+		glm::mat4 mPreviousViewProjection;
+		glm::vec3 mCameraPosition;
+		float mTime;
+		uint32_t mFrameIndex;
+		uint32_t mPadding[3];
+	};
+
 	class World
 	{
 	public:
@@ -27,16 +45,47 @@ namespace es
 
 		bool getGlobalMaterialEnabled() const;
 
+		// also writes the FrameParameters block for the frame rendered next
 		void update(float deltaTime);
 
 		void createMainCamera(float fov, float near, float far, float aspectRatio, glm::vec3 position, glm::vec3 forward);
 
 		Camera* getMainCamera() const;
+
+		// registered objects are found by the queries below, they tell the world themselves when their transform changes
+		void addObject(Object* object);
+
+		void removeObject(Object* object);
+
+		// moves the object in the tree, only objects that left their fat box are reinserted
+		void updateObject(Object* object);
+
+		// objects whose fat box touches the volume, the fat box may reach a little past the real bounds
+		void queryFrustum(const Frustum& frustum, std::vector<Object*>& objects) const;
+
+		void queryBox(const AABB& box, std::vector<Object*>& objects) const;
+
+		void querySphere(const BoundingSphere& sphere, std::vector<Object*>& objects) const;
+
+		// nearest object whose bounds the ray crosses within maxDistance, nullptr when nothing is hit
+		Object* raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float* distance = nullptr) const;
+
+		const AABBTree& getObjectTree() const;
+
+		const FrameUniforms& getFrameUniforms() const;
 	private:
+		// one write and one bind per frame replace the view and projection uploads of every draw
+		void updateFrameUniforms(float deltaTime);
+
 		std::unique_ptr<Camera> mMainCamera;
 		std::shared_ptr<Material> mGlobalMaterial;
 		bool mIsGlobalMaterialEnabled;
 
+		AABBTree mObjectTree;
+
+		FrameUniforms mFrameUniforms;
+		std::unique_ptr<StreamBuffer> mFrameStream;
+
 		static World* world;
 
 		class GarbageDeleter
@@ -4,12 +4,11 @@ layout(location = 1) in vec2 vTexCoord;
 
 out vec2 fTexCoord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 void main()
 {
 	fTexCoord = vTexCoord;
-	gl_Position = projection * view * model * vec4(vPos, 1.0f);
+	gl_Position = viewProjection * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
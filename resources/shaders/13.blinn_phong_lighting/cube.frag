@@ -39,7 +39,7 @@ struct SpotLight {
 	float quadratic;
 };
 
-uniform vec3 viewPos;
+#include "common/frame.glsl"
 uniform float shininess;
 
 uniform DirectionalLight dirLight;
@@ -126,7 +126,7 @@ vec3 calculateSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir
 
 void main()
 {
-    vec3 viewDir = normalize(viewPos - fFragPos);
+    vec3 viewDir = normalize(cameraPosition - fFragPos);
 	vec3 normal = normalize(fNormal);
 
 	// combine all the light sources
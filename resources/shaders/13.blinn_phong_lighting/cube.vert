@@ -7,9 +7,8 @@ out vec3 fFragPos;
 out vec2 fTexcoord;
 out vec3 fNormal;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 void main()
 {
@@ -17,5 +16,5 @@ void main()
 	fTexcoord = vTexcoord;
 	fNormal = mat3(transpose(inverse(model))) * vNormal;
 
-	gl_Position = projection * view * model * vec4(vPos, 1.0f);
+	gl_Position = viewProjection * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
@@ -2,11 +2,10 @@
 layout(location = 0) in vec3 vPos;
 layout(location = 1) in vec2 vTexcoord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(vPos, 1.0f);
+	gl_Position = viewProjection * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
@@ -13,7 +13,9 @@ uniform sampler2D normalMap_0;
 void main()
 {
     vec3 V = normalize(fTangentViewPos - fTangentFragPos);
-    vec3 N = normalize(texture(normalMap_0, fTexcoord).rgb * 2.0f - 1.0f);
+    // z is rebuilt from xy so two channel eac normal maps work as well
+    vec2 NXY = texture(normalMap_0, fTexcoord).rg * 2.0f - 1.0f;
+    vec3 N = normalize(vec3(NXY, sqrt(max(1.0f - dot(NXY, NXY), 0.0f))));
     vec3 L = normalize(-fTangentLightPos - fTangentFragPos);
     vec3 H = normalize(L + V);
 
@@ -5,11 +5,9 @@ layout(location = 2) in vec3 vNormal;
 layout(location = 3) in vec3 vTangent;
 layout(location = 4) in vec3 vBitangent;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+#define DRAW_PARAMETERS highp vec3 lightPos;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 out vec2 fTexcoord;
 out vec3 fTangentFragPos;
@@ -27,7 +25,7 @@ void main()
 
 	fTangentFragPos = TBN * vec3(model * vec4(vPos, 1.0f));
 	fTangentLightPos = TBN * lightPos;
-	fTangentViewPos = TBN * viewPos;
+	fTangentViewPos = TBN * cameraPosition;
 
-	gl_Position = projection * view * model * vec4(vPos, 1.0f);
+	gl_Position = viewProjection * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
@@ -3,9 +3,8 @@ layout(location = 0) in vec3 vPos;
 layout(location = 1) in vec2 vTexcoord;
 layout(location = 2) in vec3 vNormal;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 out vec3 fFragPos;
 out vec3 fNormal;
@@ -22,5 +21,5 @@ void main()
 	fLightVec = vec3(0.0f, -5.0f, -5.0f) - fFragPos.xyz;
 	fInvModel = inverse(model);
 
-	gl_Position = projection * view * model * vec4(vPos, 1.0f);
+	gl_Position = viewProjection * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
@@ -1,9 +1,8 @@
 #version 310 es
 layout(location = 0) in vec3 vPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 out vec3 fUVW;
 
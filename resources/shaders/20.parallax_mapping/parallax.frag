@@ -7,9 +7,8 @@ in vec3 fTangentFragPos;
 in vec3 fTangentLightPos;
 in vec3 fTangentViewPos;
 
-uniform float numLayers;
-uniform float heightScale;
-uniform float parallaxBias;
+#define DRAW_PARAMETERS highp vec3 lightPos; highp float numLayers; highp float heightScale; highp float parallaxBias;
+#include "common/draw.glsl"
 
 uniform sampler2D diffuseMap_0;
 uniform sampler2D normalMap_0;
@@ -7,8 +7,9 @@ in vec3 fNormal;
 in vec3 fFragPos;
 in vec4 fFragPosLightSpace;
 
-uniform vec3 lightDir;
-uniform vec3 viewPos;
+#define DRAW_PARAMETERS highp mat4 lightSpaceMatrix; highp mat4 biasMatrix; highp vec3 lightDir;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 uniform highp sampler2DShadow depthMap;
 
@@ -46,7 +47,7 @@ void main()
 	vec3 diffuse = diff * lightColor;
 
 	// specular
-    vec3 viewDir = normalize(viewPos - fFragPos);
+    vec3 viewDir = normalize(cameraPosition - fFragPos);
     vec3 halfwayDir = normalize(lightDir + viewDir);  
     float spec = pow(max(dot(normal, halfwayDir), 0.0f), 64.0f);
     vec3 specular = spec * lightColor;    
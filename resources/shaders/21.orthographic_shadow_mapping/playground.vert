@@ -5,11 +5,9 @@ layout(location = 2) in vec3 vNormal;
 layout(location = 3) in vec3 vTangent;
 layout(location = 4) in vec3 vBitangent;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
-uniform mat4 biasMatrix;
+#define DRAW_PARAMETERS highp mat4 lightSpaceMatrix; highp mat4 biasMatrix; highp vec3 lightDir;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 out vec2 fTexcoord;
 out vec3 fNormal;
@@ -23,5 +21,5 @@ void main()
 	fFragPos = vec3(model * vec4(vPos, 1.0f));
 	fFragPosLightSpace = biasMatrix * lightSpaceMatrix * model * vec4(vPos, 1.0f);
 
-	gl_Position = projection * view * model * vec4(vPos, 1.0f);
+	gl_Position = viewProjection * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
@@ -3,8 +3,8 @@ precision mediump float;
 
 in vec3 fFragPos;
 
-uniform vec3 lightPos;
-uniform float farPlane;
+#define DRAW_PARAMETERS highp mat4 lightSpaceMatrix; highp vec3 lightPos; highp float farPlane;
+#include "common/draw.glsl"
 
 void main()
 {
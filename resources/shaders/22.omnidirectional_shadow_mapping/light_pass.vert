@@ -3,8 +3,8 @@ layout(location = 0) in vec3 vPos;
 
 out vec3 fFragPos;
 
-uniform mat4 model;
-uniform mat4 lightSpaceMatrix;
+#define DRAW_PARAMETERS highp mat4 lightSpaceMatrix; highp vec3 lightPos; highp float farPlane;
+#include "common/draw.glsl"
 
 void main()
 {
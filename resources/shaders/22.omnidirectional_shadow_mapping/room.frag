@@ -6,9 +6,9 @@ in vec2 fTexcoord;
 in vec3 fNormal;
 in vec3 fFragPos;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform float farPlane;
+#define DRAW_PARAMETERS highp vec3 lightPos; highp float farPlane;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 uniform samplerCube depthMap;
 
@@ -30,7 +30,7 @@ float calculateShadow(vec3 fragPos)
 	float shadow = 0.0f;
 	float bias = 0.005f;
 	int samples = 20;
-	float viewDistance = length(viewPos - fragPos);
+	float viewDistance = length(cameraPosition - fragPos);
 	float diskRadius = (1.0f + (viewDistance / farPlane)) / 200.0f;
 	for(int i = 0; i < samples; ++i)
     {
@@ -60,7 +60,7 @@ void main()
 	vec3 diffuse = diff * lightColor;
 
 	// specular
-    vec3 viewDir = normalize(viewPos - fFragPos);
+    vec3 viewDir = normalize(cameraPosition - fFragPos);
     vec3 halfwayDir = normalize(lightDir + viewDir);  
     float spec = pow(max(dot(normal, halfwayDir), 0.0f), 64.0f);
     vec3 specular = spec * lightColor;    
@@ -5,9 +5,9 @@ layout(location = 2) in vec3 vNormal;
 layout(location = 3) in vec3 vTangent;
 layout(location = 4) in vec3 vBitangent;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#define DRAW_PARAMETERS highp vec3 lightPos; highp float farPlane;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 out vec2 fTexcoord;
 out vec3 fNormal;
@@ -19,5 +19,5 @@ void main()
 	fNormal = transpose(inverse(mat3(model))) * vNormal;
 	fFragPos = vec3(model * vec4(vPos, 1.0f));
 
-	gl_Position = projection * view * model * vec4(vPos, 1.0f);
+	gl_Position = viewProjection * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
@@ -1,8 +1,8 @@
 #version 310 es
 layout(location = 0) in vec3 vPos;
 
-uniform mat4 model;
-uniform mat4 lightSpaceMatrix;
+#define DRAW_PARAMETERS highp mat4 lightSpaceMatrix;
+#include "common/draw.glsl"
 
 void main()
 {
@@ -7,8 +7,9 @@ in vec3 fNormal;
 in vec3 fFragPos;
 in vec4 fFragPosLightSpace;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+#define DRAW_PARAMETERS highp mat4 lightSpaceMatrix; highp mat4 biasMatrix; highp vec3 lightPos;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 uniform sampler2D depthMap;
 
@@ -81,7 +82,7 @@ void main()
 	vec3 diffuse = diff * lightColor;
 
 	// specular
-    vec3 viewDir = normalize(viewPos - fFragPos);
+    vec3 viewDir = normalize(cameraPosition - fFragPos);
     vec3 halfwayDir = normalize(lightDir + viewDir);  
     float spec = pow(max(dot(normal, halfwayDir), 0.0f), 64.0f);
     vec3 specular = spec * lightColor;    
@@ -5,10 +5,16 @@ layout(location = 2) in vec3 vNormal;
 layout(location = 3) in vec3 vTangent;
 layout(location = 4) in vec3 vBitangent;
 
-uniform mat4 model;
+#ifdef ES_INSTANCED
+layout(location = 8) in mat4 iModel;
+#endif
+#include "common/draw.glsl"
 uniform mat4 lightSpaceMatrix;
 
 void main()
 {
+#ifdef ES_INSTANCED
+	mat4 model = iModel;
+#endif
 	gl_Position = lightSpaceMatrix * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
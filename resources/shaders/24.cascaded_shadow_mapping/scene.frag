@@ -18,7 +18,7 @@ struct DirectionalLight {
 uniform float cascadedSplits[MAX_SPLITS];
 uniform mat4 lightSpaceMatrices[MAX_SPLITS];
 uniform DirectionalLight dirLight;
-uniform vec3 viewPos;
+#include "common/frame.glsl"
 uniform highp sampler2DArray cascadedDepthMap;
 uniform mat4 biasMatrix;
 
@@ -81,7 +81,7 @@ void main()
 
 	vec3 normal = normalize(fNormal);
 	vec3 lightDir = normalize(-dirLight.direction);
-	vec3 viewDir = normalize(viewPos - fFragPos);
+	vec3 viewDir = normalize(cameraPosition - fFragPos);
 	vec3 halfwayDir = normalize(lightDir + viewDir);
 
 	vec3 ambient = 0.2 * albedo * dirLight.color;
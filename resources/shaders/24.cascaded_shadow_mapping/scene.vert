@@ -5,9 +5,11 @@ layout(location = 2) in vec3 vNormal;
 layout(location = 3) in vec3 vTangent;
 layout(location = 4) in vec3 vBitangent;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#ifdef ES_INSTANCED
+layout(location = 8) in mat4 iModel;
+#endif
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 out vec2 fTexcoord;
 out vec3 fNormal;
@@ -17,11 +19,14 @@ out vec3 fViewSpaceFragPos;
 
 void main()
 {
+#ifdef ES_INSTANCED
+	mat4 model = iModel;
+#endif
 	fTexcoord = vTexcoord;
 	fNormal = transpose(inverse(mat3(model))) * vNormal;
 	fPos = vPos;
 	fFragPos = vec3(model * vec4(vPos, 1.0));
 	fViewSpaceFragPos = (view * vec4(vPos, 1.0f)).xyz;
 
-	gl_Position = projection * view * model * vec4(vPos, 1.0f);
+	gl_Position = viewProjection * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
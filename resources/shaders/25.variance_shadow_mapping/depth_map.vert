@@ -3,8 +3,8 @@ layout(location = 0) in vec3 vPos;
 
 out vec4 fPosition;
 
-uniform mat4 model;
-uniform mat4 lightSpaceMatrix;
+#define DRAW_PARAMETERS highp mat4 lightSpaceMatrix;
+#include "common/draw.glsl"
 
 void main()
 {
@@ -6,9 +6,8 @@ in vec2 fTexcoord;
 
 uniform sampler2D image;
 
-uniform float blurScale;
-uniform float blurStrength;
-uniform bool horizontal;
+#define DRAW_PARAMETERS highp float blurScale; highp float blurStrength; bool horizontal;
+#include "common/draw.glsl"
 
 void main()
 {
@@ -3,10 +3,17 @@ precision mediump float;
 layout(location = 0) out vec4 fragColor;
 layout(location = 1) out vec4 brightColor;
 
-uniform vec3 randomColor;
+#ifdef ES_INSTANCED
+flat in vec4 fInstanceParams0;
+#endif
+#define DRAW_PARAMETERS highp vec3 randomColor;
+#include "common/draw.glsl"
 
 void main()
 {
+#ifdef ES_INSTANCED
+	vec3 randomColor = fInstanceParams0.rgb;
+#endif
     fragColor = vec4(randomColor, 1.0f);
 	float brightness = dot(randomColor.rgb, vec3(0.2126, 0.7152, 0.0722));
 	if (brightness > 1.0f)
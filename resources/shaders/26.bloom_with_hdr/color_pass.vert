@@ -5,11 +5,24 @@ layout(location = 2) in vec3 vNormal;
 layout(location = 3) in vec3 vTangent;
 layout(location = 4) in vec3 vBitangent;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#ifdef ES_INSTANCED
+layout(location = 8) in mat4 iModel;
+layout(location = 12) in vec4 iParams0;
+layout(location = 13) in vec4 iParams1;
+
+flat out vec4 fInstanceParams0;
+flat out vec4 fInstanceParams1;
+#endif
+#define DRAW_PARAMETERS highp vec3 randomColor;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(vPos, 1.0f);
+#ifdef ES_INSTANCED
+	mat4 model = iModel;
+	fInstanceParams0 = iParams0;
+	fInstanceParams1 = iParams1;
+#endif
+	gl_Position = viewProjection * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
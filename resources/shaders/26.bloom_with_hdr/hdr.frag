@@ -7,7 +7,8 @@ in vec2 fTexcoord;
 uniform sampler2D scene;
 uniform sampler2D bloomBlur;
 
-uniform float exposure;
+#define DRAW_PARAMETERS highp float exposure;
+#include "common/draw.glsl"
 
 void main()
 {
@@ -11,10 +11,14 @@ struct Light {
 	vec3 position;
 };
 
-uniform vec3 viewPos;
-uniform vec3 albedo;
-uniform float roughness;
-uniform float metallic;
+#include "common/frame.glsl"
+
+#ifdef ES_INSTANCED
+flat in vec4 fInstanceParams0;
+flat in vec4 fInstanceParams1;
+#endif
+#define DRAW_PARAMETERS highp vec3 albedo; highp float roughness; highp float metallic;
+#include "common/draw.glsl"
 uniform float ao;
 
 uniform float exposure;
@@ -63,8 +67,14 @@ vec3 fresnelSchlick(vec3 F0, vec3 V, vec3 H)
 
 void main()
 {
+#ifdef ES_INSTANCED
+	vec3 albedo = fInstanceParams0.xyz;
+	float roughness = fInstanceParams0.w;
+	float metallic = fInstanceParams1.x;
+#endif
+
 	vec3 N = normalize(fNormal);
-	vec3 V = normalize(viewPos - fFragPos);
+	vec3 V = normalize(cameraPosition - fFragPos);
 
 	vec3 F0 = vec3(0.04);
 	F0 = mix(F0, albedo, metallic);
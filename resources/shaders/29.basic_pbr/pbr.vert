@@ -9,14 +9,28 @@ out vec3 fFragPos;
 out vec2 fTexcoord;
 out vec3 fNormal;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#ifdef ES_INSTANCED
+layout(location = 8) in mat4 iModel;
+layout(location = 12) in vec4 iParams0;
+layout(location = 13) in vec4 iParams1;
+
+flat out vec4 fInstanceParams0;
+flat out vec4 fInstanceParams1;
+#endif
+#define DRAW_PARAMETERS highp vec3 albedo; highp float roughness; highp float metallic;
+#include "common/draw.glsl"
+
+#include "common/frame.glsl"
 
 void main()
 {
+#ifdef ES_INSTANCED
+	mat4 model = iModel;
+	fInstanceParams0 = iParams0;
+	fInstanceParams1 = iParams1;
+#endif
 	fFragPos = vec3(model * vec4(vPos, 1.0f));
 	fTexcoord = vTexcoord;
 	fNormal = mat3(model) * vNormal;
-	gl_Position = projection * view * model * vec4(vPos, 1.0f);
+	gl_Position = viewProjection * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
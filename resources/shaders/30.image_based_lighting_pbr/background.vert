@@ -3,9 +3,8 @@ layout(location = 0) in vec3 vPos;
 
 out vec3 fFragPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 void main()
 {
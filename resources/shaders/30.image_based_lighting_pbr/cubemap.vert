@@ -3,8 +3,8 @@ layout(location = 0) in vec3 vPos;
 
 out vec3 fFragPos;
 
-uniform mat4 captureView;
-uniform mat4 captureProj;
+#define DRAW_PARAMETERS highp mat4 captureView; highp mat4 captureProj; highp float roughness;
+#include "common/draw.glsl"
 
 void main()
 {
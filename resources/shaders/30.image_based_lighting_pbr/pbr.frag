@@ -11,13 +11,9 @@ struct Light {
 	vec3 position;
 };
 
-uniform vec3 viewPos;
-uniform vec3 albedo;
-uniform float roughness;
-uniform float metallic;
-uniform float ao;
-
-uniform float exposure;
+#include "common/frame.glsl"
+#define DRAW_PARAMETERS highp vec3 albedo; highp float roughness; highp float metallic; highp float ao; highp float exposure;
+#include "common/draw.glsl"
 
 uniform samplerCube irradianceMap;
 uniform samplerCube prefilterMap;
@@ -73,7 +69,7 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
 void main()
 {
 	vec3 N = normalize(fNormal);
-	vec3 V = normalize(viewPos - fFragPos);
+	vec3 V = normalize(cameraPosition - fFragPos);
 	vec3 R = reflect(-V, N);
 
 	vec3 F0 = vec3(0.04);
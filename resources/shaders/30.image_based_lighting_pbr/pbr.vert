@@ -9,14 +9,14 @@ out vec3 fFragPos;
 out vec2 fTexcoord;
 out vec3 fNormal;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#define DRAW_PARAMETERS highp vec3 albedo; highp float roughness; highp float metallic; highp float ao; highp float exposure;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 
 void main()
 {
 	fFragPos = vec3(model * vec4(vPos, 1.0f));
 	fTexcoord = vTexcoord;
 	fNormal = mat3(transpose(inverse(model))) * vNormal;
-	gl_Position = projection * view * model * vec4(vPos, 1.0f);
+	gl_Position = viewProjection * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
@@ -5,7 +5,8 @@ layout(location = 0) out vec4 fragColor;
 in vec3 fFragPos;
 
 uniform samplerCube environmentMap;
-uniform float roughness;
+#define DRAW_PARAMETERS highp mat4 captureView; highp mat4 captureProj; highp float roughness;
+#include "common/draw.glsl"
 
 const float PI = 3.14159265359;
 
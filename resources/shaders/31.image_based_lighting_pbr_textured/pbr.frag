@@ -11,9 +11,9 @@ struct Light {
 	vec3 position;
 };
 
-uniform vec3 viewPos;
-
-uniform float exposure;
+#include "common/frame.glsl"
+#define DRAW_PARAMETERS highp float exposure;
+#include "common/draw.glsl"
 
 uniform sampler2D albedoMap;
 uniform sampler2D metallicMap;
@@ -42,7 +42,9 @@ vec3 uncharted2Tonemapping(vec3 x)
 
 vec3 getNormalFromMap()
 {
-	vec3 tangentNormal = texture(normalMap, fTexcoord).rgb * 2.0 - 1.0;
+	// z is rebuilt from xy so two channel eac normal maps work as well
+	vec2 tangentNormalXY = texture(normalMap, fTexcoord).rg * 2.0 - 1.0;
+	vec3 tangentNormal = vec3(tangentNormalXY, sqrt(max(1.0 - dot(tangentNormalXY, tangentNormalXY), 0.0)));
 
 	vec3 q1 = dFdx(fFragPos);
 	vec3 q2 = dFdy(fFragPos);
@@ -103,7 +105,7 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
 void main()
 {
 	vec3 N = getNormalFromMap();
-	vec3 V = normalize(viewPos - fFragPos);
+	vec3 V = normalize(cameraPosition - fFragPos);
 	vec3 R = reflect(-V, N);
 
 	vec3 F0 = vec3(0.04);
@@ -9,7 +9,7 @@ in vec3 camNormal;
 in vec4 lightSpaceFragPos;
 in float lightDist;
 
-uniform vec3 viewPos;
+#include "common/frame.glsl"
 uniform vec3 lightDir;
 uniform sampler2D depthMap;
 
@@ -24,7 +24,7 @@ void main()
 	vec3 albedo = vec3(0.7f);
 	vec3 N = normalize(fNormal);
 	vec3 L = normalize(-lightDir);
-	vec3 V = normalize(viewPos - fFragPos);
+	vec3 V = normalize(cameraPosition - fFragPos);
 
 	vec3 ambient = 0.1f * albedo;
 
@@ -10,14 +10,11 @@ out vec3 camNormal;
 out vec4 lightSpaceFragPos;
 out float lightDist;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#define DRAW_PARAMETERS highp mat4 lightView; highp mat4 lightProj;
+#include "common/draw.glsl"
+#include "common/frame.glsl"
 uniform mat4 biasMatrix;
 
-uniform mat4 lightView;
-uniform mat4 lightProj;
-
 void main()
 {
 	fFragPos = vec3(model * vec4(vPos, 1.0f));
@@ -27,5 +24,5 @@ void main()
 	lightSpaceFragPos = biasMatrix * lightProj * lightView * vec4(vPos, 1.0f);
 	lightDist = length(lightView * vec4(vPos, 1.0f));
 
-	gl_Position = projection * view * model * vec4(vPos, 1.0f);
+	gl_Position = viewProjection * model * vec4(vPos, 1.0f);
 }
\ No newline at end of file
@@ -5,9 +5,8 @@ layout(location = 2) in vec3 vNormal;
 
 out float distance;
 
-uniform mat4 model;
-uniform mat4 lightView;
-uniform mat4 lightProj;
+#define DRAW_PARAMETERS highp mat4 lightView; highp mat4 lightProj;
+#include "common/draw.glsl"
 
 void main()
 {
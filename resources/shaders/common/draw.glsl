@@ -0,0 +1,17 @@
+#ifndef DRAW_GLSL
+#define DRAW_GLSL
+
+// per draw values, setUniform writes them into the block of the program and the renderer streams it before each draw.
+// a shader lists its other per mesh values in DRAW_PARAMETERS before including this file, both stages of a program list
+// the same ones. the instanced variant reads them from the instance attributes instead
+#ifndef ES_INSTANCED
+layout(std140) uniform DrawParameters
+{
+	highp mat4 model;
+#ifdef DRAW_PARAMETERS
+	DRAW_PARAMETERS
+#endif
+};
+#endif
+
+#endif
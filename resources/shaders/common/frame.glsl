@@ -0,0 +1,16 @@
+#ifndef FRAME_GLSL
+#define FRAME_GLSL
+
+// per frame camera and scene values, written once a frame by World and bound for every program. matches FrameUniforms
+layout(std140) uniform FrameParameters
+{
+	highp mat4 view;
+	highp mat4 projection;
+	highp mat4 viewProjection;
+	highp mat4 previousViewProjection;
+	highp vec3 cameraPosition;
+	highp float time;
+	highp uint frameIndex;
+};
+
+#endif
@@ -32,13 +32,7 @@ public:
 			0.0f,  0.5f, 0.0f
 		};
 		
-		std::vector<Vertex> vertices = {};
-		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexAttribs.size() / 3); i++)
-		{
-			Vertex vertex;
-			vertex.vPosition = glm::vec3(vertexAttribs[i * 3], vertexAttribs[i * 3 + 1], vertexAttribs[i * 3 + 2]);
-			vertices.push_back(vertex);
-		}
+		VertexFormat format({ { VertexSemantic::Position, 3 } });
 
 		std::shared_ptr<Material> mat = Material::createFromFiles("triangle_mat",
 			{
@@ -51,7 +45,7 @@ public:
 		);
 		
 		// create triangle mesh
-		triangle = Mesh::createWithData("triangle", vertices, {});
+		triangle = Mesh::createWithData("triangle", format, vertexAttribs, {});
 		triangle->setDrawType(Mesh::DrawType::ARRAYS);
 		triangle->setMaterial(mat);
 	}
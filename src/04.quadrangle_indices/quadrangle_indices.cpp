@@ -33,13 +33,7 @@ public:
 			-0.5f,  0.5f, 0.0f
 		};
 
-		std::vector<Vertex> vertices = {};
-		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexAttribs.size() / 3); i++)
-		{
-			Vertex vertex;
-			vertex.vPosition = glm::vec3(vertexAttribs[i * 3], vertexAttribs[i * 3 + 1], vertexAttribs[i * 3 + 2]);
-			vertices.push_back(vertex);
-		}
+		VertexFormat format({ { VertexSemantic::Position, 3 } });
 
 		std::vector<GLuint> indices = {
 			0, 1, 3,
@@ -57,7 +51,7 @@ public:
 		);
 
 		// create quadrangle mesh
-		quadrangle = Mesh::createWithData("quadrangle", vertices, indices);
+		quadrangle = Mesh::createWithData("quadrangle", format, vertexAttribs, indices);
 		quadrangle->setDrawType(Mesh::DrawType::ELEMENTS);
 		quadrangle->setMaterial(mat);
 	}
@@ -33,17 +33,11 @@ public:
 			0.5f, 0.5f, 0.0f
 		}; 
 
-		std::vector<Vertex> vertices = {};
-		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexAttribs.size() / 3); i++)
-		{
-			Vertex vertex;
-			vertex.vPosition = glm::vec3(vertexAttribs[i * 3], vertexAttribs[i * 3 + 1], vertexAttribs[i * 3 + 2]);
-			vertices.push_back(vertex);
-		}
+		VertexFormat format({ { VertexSemantic::Position, 3 } });
 
 		std::vector<GLuint> indices = {
 			0, 1, 2,
-			0xFFFF,    // restart index
+			0xFFFFFFFF,    // restart index
 			1, 3, 2
 		};
 
@@ -58,7 +52,7 @@ public:
 		);
 
 		// create triangle mesh
-		triangle = Mesh::createWithData("triangle", vertices, indices);
+		triangle = Mesh::createWithData("triangle", format, vertexAttribs, indices);
 		triangle->setDrawType(Mesh::DrawType::ELEMENTS_RESTART_INDEX);
 		triangle->setMaterial(mat);
 	}
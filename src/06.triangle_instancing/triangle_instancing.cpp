@@ -45,14 +45,7 @@ public:
 			-0.05f,  0.05f, 0.0f,   0.0f, 0.0f, 1.0f, 1.0f,
 		};
 
-		std::vector<Vertex> vertices = {};
-		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexAttribs.size() / 7); i++)
-		{
-			Vertex vertex;
-			vertex.vPosition = glm::vec3(vertexAttribs[i * 7], vertexAttribs[i * 7 + 1], vertexAttribs[i * 7 + 2]);
-			vertex.vColor = glm::vec4(vertexAttribs[i * 7 + 3], vertexAttribs[i * 7 + 4], vertexAttribs[i * 7 + 5], vertexAttribs[i * 7 + 6]);
-			vertices.push_back(vertex);
-		}
+		VertexFormat format({ { VertexSemantic::Position, 3 }, { VertexSemantic::Color, 4 } });
 
 		std::vector<uint32_t> indices = {
 			0, 1, 2
@@ -69,7 +62,7 @@ public:
 		);
 
 		// create triangle mesh
-		triangle = Mesh::createWithData("triangle", vertices, indices);
+		triangle = Mesh::createWithData("triangle", format, vertexAttribs, indices);
 		triangle->setDrawType(Mesh::DrawType::ELEMENTS_INSTANCED);
 		triangle->setMaterial(mat);
 		triangle->setInstancingData<float>(sizeof(glm::vec2) * locations.size(), (void*)locations.data(), 100);
@@ -40,14 +40,7 @@ public:
 			1, 2, 3
 		};
 
-		std::vector<Vertex> vertices = {};
-		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexAttribs.size() / 5); i++)
-		{
-			Vertex vertex;
-			vertex.vPosition = glm::vec3(vertexAttribs[i * 5], vertexAttribs[i * 5 + 1], vertexAttribs[i * 5 + 2]);
-			vertex.vTexcoord = glm::vec2(vertexAttribs[i * 5 + 3], vertexAttribs[i * 5 + 4]);
-			vertices.push_back(vertex);
-		}
+		VertexFormat format({ { VertexSemantic::Position, 3 }, { VertexSemantic::Texcoord, 2 } });
 
 		std::shared_ptr<Material> mat = Material::createFromFiles("quad_mat",
 			{
@@ -59,7 +52,7 @@ public:
 			}
 		);
 
-		quad = Mesh::createWithData("quad", vertices, indices);
+		quad = Mesh::createWithData("quad", format, vertexAttribs, indices);
 		quad->setDrawType(Mesh::DrawType::ELEMENTS);
 		quad->setMaterial(mat);
 	}
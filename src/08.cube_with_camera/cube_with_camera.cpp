@@ -27,7 +27,7 @@ public:
 		ExampleBase::prepare();
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		std::vector<float> vertexAttribs = {
 			// positions         // texture coordinates
@@ -74,14 +74,7 @@ public:
 		   -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
 		};
 
-		std::vector<Vertex> vertices = {};
-		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexAttribs.size() / 5); i++)
-		{
-			Vertex vertex;
-			vertex.vPosition = glm::vec3(vertexAttribs[i * 5], vertexAttribs[i * 5 + 1], vertexAttribs[i * 5 + 2]);
-			vertex.vTexcoord = glm::vec2(vertexAttribs[i * 5 + 3], vertexAttribs[i * 5 + 4]);
-			vertices.push_back(vertex);
-		}
+		VertexFormat format({ { VertexSemantic::Position, 3 }, { VertexSemantic::Texcoord, 2 } });
 
 		std::shared_ptr<Material> mat = Material::createFromFiles("cube_mat",
 			{
@@ -94,7 +87,7 @@ public:
 		);
 
 		// create cube mesh
-		cube = Mesh::createWithData("cube", vertices, {});
+		cube = Mesh::createWithData("cube", format, vertexAttribs, {});
 		cube->setDrawType(Mesh::DrawType::ARRAYS);
 		cube->setMaterial(mat);
 	}
@@ -28,7 +28,7 @@ public:
 		ExampleBase::prepare();
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		model = Model::createFromFile("nanosuit", 
 			modelsDirectory + "/nanosuit/nanosuit.obj", 
@@ -44,7 +44,7 @@ public:
 
 	virtual void render(float deltaTime) override
 	{
-		model->render();
+		model->render(mMainCamera->getFrustum());
 	}
 
 	virtual void windowResized() override
@@ -28,10 +28,10 @@ public:
 		ExampleBase::prepare();
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		// enable cull face
-		glEnable(GL_CULL_FACE);
+		StateCache::enable(GL_CULL_FACE);
 		glFrontFace(GL_CCW);
 		glCullFace(GL_BACK);
 
@@ -31,10 +31,10 @@ public:
 		ExampleBase::prepare();
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		// enable stencil test
-		glEnable(GL_STENCIL_TEST);
+		StateCache::enable(GL_STENCIL_TEST);
 		glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
 		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
 
@@ -83,14 +83,7 @@ public:
 			-0.5f,  0.5f, -0.5f,  0.0f, 1.0f
 		};
 
-		std::vector<Vertex> vertices = {};
-		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexAttribs.size() / 5); i++)
-		{
-			Vertex vertex;
-			vertex.vPosition = glm::vec3(vertexAttribs[i * 5], vertexAttribs[i * 5 + 1], vertexAttribs[i * 5 + 2]);
-			vertex.vTexcoord = glm::vec2(vertexAttribs[i * 5 + 3], vertexAttribs[i * 5 + 4]);
-			vertices.push_back(vertex);
-		}
+		VertexFormat format({ { VertexSemantic::Position, 3 }, { VertexSemantic::Texcoord, 2 } });
 
 		std::shared_ptr<Material> cubeMat = Material::createFromFiles("cube_mat",
 			{
@@ -113,7 +106,7 @@ public:
 		);
 
 		// create cube mesh
-		cube1 = Mesh::createWithData("cube1", vertices, {});
+		cube1 = Mesh::createWithData("cube1", format, vertexAttribs, {});
 		cube1->setDrawType(Mesh::DrawType::ARRAYS);
 		cube1->setMaterial(cubeMat);
 		cube1->setPosition(glm::vec3(-1.0f, 0.0f, 0.5f));
@@ -121,7 +114,7 @@ public:
 		cube2 = Mesh::clone("cube2", cube1.get());
 		cube2->setPosition(glm::vec3(1.0f, 0.0f, -0.5f));
 
-		outlineCube1 = Mesh::createWithData("outline_cube1", vertices, {});
+		outlineCube1 = Mesh::createWithData("outline_cube1", format, vertexAttribs, {});
 		outlineCube1->setDrawType(Mesh::DrawType::ARRAYS);
 		outlineCube1->setMaterial(outlineMat);
 		outlineCube1->setPosition(cube1->getPosition());
@@ -141,13 +134,13 @@ public:
 
 		glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
 		glStencilMask(0x00);
-		glDisable(GL_DEPTH_TEST);
+		StateCache::disable(GL_DEPTH_TEST);
 
 		outlineCube1->render();
 		outlineCube2->render();
 	
 		glStencilMask(0xFF);
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 	}
 
 	virtual void windowResized() override
@@ -28,7 +28,7 @@ public:
 		ExampleBase::prepare();
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		// all positions of cubes
 		std::array<glm::vec3, 10> cubePositions = {
@@ -89,15 +89,7 @@ public:
 			-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
 		};
 
-		std::vector<Vertex> vertices = {};
-		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexAttribs.size() / 8); i++)
-		{
-			Vertex vertex;
-			vertex.vPosition = glm::vec3(vertexAttribs[i * 8], vertexAttribs[i * 8 + 1], vertexAttribs[i * 8 + 2]);
-			vertex.vTexcoord = glm::vec2(vertexAttribs[i * 8 + 6], vertexAttribs[i * 8 + 7]);
-			vertex.vNormal = glm::vec3(vertexAttribs[i * 8 + 3], vertexAttribs[i * 8 + 4], vertexAttribs[i * 8 + 5]);
-			vertices.push_back(vertex);
-		}
+		VertexFormat format({ { VertexSemantic::Position, 3 }, { VertexSemantic::Normal, 3 }, { VertexSemantic::Texcoord, 2 } });
 
 		cubeMat = Material::createFromFiles("cube_mat",
 			{
@@ -135,7 +127,7 @@ public:
 		cubeMat->setUniform("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
 
 		// create cube mesh
-		std::shared_ptr<Mesh> cubeTemplate = Mesh::createWithData("cube_template", vertices, {});
+		std::shared_ptr<Mesh> cubeTemplate = Mesh::createWithData("cube_template", format, vertexAttribs, {});
 		cubeTemplate->setDrawType(Mesh::DrawType::ARRAYS);
 		cubeTemplate->setMaterial(cubeMat);
 
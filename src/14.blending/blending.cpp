@@ -1,7 +1,7 @@
 ﻿#include <examplebase.h>
 #include <mesh.h>
 #include <material.h>
-#include <map>
+#include <renderqueue.h>
 using namespace es;
 
 class Example final : public ExampleBase
@@ -9,6 +9,9 @@ class Example final : public ExampleBase
 public:
 	std::vector<std::shared_ptr<Mesh>> quads;
 
+	// sorts the quads back to front every frame, so the order follows the camera
+	RenderQueue renderQueue;
+
 	Example()
 	{
 		title = "blending";
@@ -27,10 +30,10 @@ public:
 		ExampleBase::prepare();
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		// enable blend
-		glEnable(GL_BLEND);
+		StateCache::enable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 		glBlendEquation(GL_FUNC_ADD);
 
@@ -45,13 +48,6 @@ public:
 			glm::vec3(-0.2f, 0.0f, -1.4f)
 		};
 
-		std::map<float, glm::vec3> sortedMap;
-		for (unsigned int i = 0; i < quadPositions.size(); i++)
-		{
-			float distance = glm::length(mMainCamera->getPosition() - quadPositions[i]);
-			sortedMap[distance] = quadPositions[i];
-		}
-
 		std::vector<float> vertexAttribs = {
 			// positions         // texture coordinates
 			0.0f,  0.5f,  0.0f,  0.0f,  0.0f,
@@ -63,14 +59,7 @@ public:
 			1.0f,  0.5f,  0.0f,  1.0f,  0.0f
 		};
 
-		std::vector<Vertex> vertices = {};
-		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexAttribs.size() / 8); i++)
-		{
-			Vertex vertex;
-			vertex.vPosition = glm::vec3(vertexAttribs[i * 5], vertexAttribs[i * 5 + 1], vertexAttribs[i * 5 + 2]);
-			vertex.vTexcoord = glm::vec2(vertexAttribs[i * 5 + 3], vertexAttribs[i * 5 + 4]);
-			vertices.push_back(vertex);
-		}
+		VertexFormat format({ { VertexSemantic::Position, 3 }, { VertexSemantic::Texcoord, 2 } });
 
 		std::shared_ptr<Material> mat = Material::createFromFiles("mat",
 			{
@@ -81,16 +70,16 @@ public:
 
 			}
 		);
+		mat->setTranslucent(true);
 
-		std::shared_ptr<Mesh> quadTemplate = Mesh::createWithData("quad_template", vertices, {});
+		std::shared_ptr<Mesh> quadTemplate = Mesh::createWithData("quad_template", format, vertexAttribs, {});
 		quadTemplate->setDrawType(Mesh::DrawType::ARRAYS);
 		quadTemplate->setMaterial(mat);
 
-		uint8_t i = 0;
-		for (auto iter = sortedMap.rbegin(); iter != sortedMap.rend(); iter++)
+		for (std::size_t i = 0; i < quadPositions.size(); i++)
 		{
-			std::shared_ptr<Mesh> quad = Mesh::clone("quad_" + std::to_string(i++), quadTemplate.get());
-			quad->setPosition(iter->second);
+			std::shared_ptr<Mesh> quad = Mesh::clone("quad_" + std::to_string(i), quadTemplate.get());
+			quad->setPosition(quadPositions[i]);
 			quads.push_back(quad);
 		}
 	}
@@ -99,8 +88,9 @@ public:
 	{
 		for (std::size_t i = 0; i < quads.size(); i++)
 		{
-			quads[i]->render();
+			renderQueue.submit(quads[i].get());
 		}
+		renderQueue.flush();
 	}
 
 	virtual void windowResized() override
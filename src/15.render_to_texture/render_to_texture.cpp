@@ -34,7 +34,7 @@ public:
 		ExampleBase::prepare();
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		// setup camera
 		mMainCamera->setPosition(glm::vec3(0.0f, 10.0f, 35.0f));
@@ -52,15 +52,10 @@ public:
 			1, 2, 3
 		};
 
-		std::vector<Vertex> vertices = {};
-		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexAttribs.size() / 5); i++)
-		{
-			Vertex vertex;
-			vertex.vPosition = glm::vec3(vertexAttribs[i * 5], vertexAttribs[i * 5 + 1], vertexAttribs[i * 5 + 2]);
-			vertex.vTexcoord = glm::vec2(vertexAttribs[i * 5 + 3], vertexAttribs[i * 5 + 4]);
-			vertices.push_back(vertex);
-		}
+		VertexFormat format({ { VertexSemantic::Position, 3 }, { VertexSemantic::Texcoord, 2 } });
 
+		// the bunker never moves its parts, one draw per texture set instead of one per sub-mesh
+		Model::setStaticBatching(true);
 		model = Model::createFromFile("model",
 			modelsDirectory + "/devils-slide-bunker/HW1_Bunker.obj",
 			{
@@ -68,6 +63,7 @@ public:
 				shadersDirectory + "construction.frag"
 			}
 		);
+		Model::setStaticBatching(false);
 		model->setRotation(glm::vec3(-90.0f, 0.0f, 0.0f));
 		
 		renderTexture = Texture2D::createFromData(mWindowWidth, mWindowHeight, -1, 1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, false);
@@ -86,7 +82,7 @@ public:
 		);
 
 		// create offscreenQuad mesh
-		offscreenQuad = Mesh::createWithData("offscreen_quad", vertices, indices);
+		offscreenQuad = Mesh::createWithData("offscreen_quad", format, vertexAttribs, indices);
 		offscreenQuad->setDrawType(Mesh::DrawType::ELEMENTS);
 		offscreenQuad->setMaterial(screenMat);
 
@@ -112,9 +108,9 @@ public:
 		model->render();
 
 		// diable depth test for render quad in front of scene
-		glDisable(GL_DEPTH_TEST);
+		StateCache::disable(GL_DEPTH_TEST);
 		offscreenQuad->render();
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 	}
 
 	virtual void windowResized() override
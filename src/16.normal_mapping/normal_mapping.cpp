@@ -27,7 +27,7 @@ public:
 		ExampleBase::prepare();
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		mMainCamera->setPosition(glm::vec3(0.0f, 15.0f, 15.0f));
 		mMainCamera->setRotation(glm::vec3(45.0f, 0.0f, 0.0f));
@@ -58,7 +58,6 @@ public:
 	virtual void render(float deltaTime) override
 	{
 		planeModel->setUniform("lightPos", glm::vec3(sin(glm::radians(timePassed * 360.0f)) * 1.5f, 8.0f, cos(glm::radians(timePassed * 360.0f)) * 1.5f));
-		planeModel->setUniform("viewPos", mMainCamera->getPosition());
 		planeModel->render();
 	}
 
@@ -31,7 +31,7 @@ public:
 		ExampleBase::prepare();
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		std::vector<float> vertexAttribs = {
 			// positions         
@@ -78,13 +78,7 @@ public:
 			-0.5f,  0.5f, -0.5f
 		};
 
-		std::vector<Vertex> vertices = {};
-		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexAttribs.size() / 3); i++)
-		{
-			Vertex vertex;
-			vertex.vPosition = glm::vec3(vertexAttribs[i * 3], vertexAttribs[i * 3 + 1], vertexAttribs[i * 3 + 2]);
-			vertices.push_back(vertex);
-		}
+		VertexFormat format({ { VertexSemantic::Position, 3 } });
 
 		std::shared_ptr<Material> blueMat = Material::createFromFiles("blue_mat",
 			{
@@ -131,30 +125,32 @@ public:
 		glm::vec4 additionalColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
 		float mixValue = 0.5f;
 		
-		uniformBuffer = UniformBuffer::createWithData(GL_DYNAMIC_DRAW, blueMat->getProgram().get(), "mixColor", 0);
+		// written once here and never per draw, so it stays a static buffer. the stream ring recycles its regions every frame
+		// and would need the colors written again each frame
+		uniformBuffer = UniformBuffer::createWithData(GL_STATIC_DRAW, blueMat->getProgram().get(), "mixColor", 0);
 		uniformBuffer->setData(offsets[0], sizeof(glm::vec4), glm::value_ptr(additionalColor));
 		uniformBuffer->setData(offsets[1], sizeof(float), &mixValue);
 		
 		// create cubeBlue mesh
-		cubeBlue = Mesh::createWithData("cube_blue", vertices, {});
+		cubeBlue = Mesh::createWithData("cube_blue", format, vertexAttribs, {});
 		cubeBlue->setDrawType(Mesh::DrawType::ARRAYS);
 		cubeBlue->setMaterial(blueMat);
 		cubeBlue->setPosition(glm::vec3(-0.75f, 0.75f, 0.0f));
 
 		// create cubeGreen mesh
-		cubeGreen = Mesh::createWithData("cube_green", vertices, {});
+		cubeGreen = Mesh::createWithData("cube_green", format, vertexAttribs, {});
 		cubeGreen->setDrawType(Mesh::DrawType::ARRAYS);
 		cubeGreen->setMaterial(greenMat);
 		cubeGreen->setPosition(glm::vec3(0.75f, 0.75f, 0.0f));
 
 		// create cubeRed mesh
-		cubeRed = Mesh::createWithData("cube_red", vertices, {});
+		cubeRed = Mesh::createWithData("cube_red", format, vertexAttribs, {});
 		cubeRed->setDrawType(Mesh::DrawType::ARRAYS);
 		cubeRed->setMaterial(redMat);
 		cubeRed->setPosition(glm::vec3(-0.75f, -0.75f, 0.0f));
 
 		// create cubeYellow mesh
-		cubeYellow = Mesh::createWithData("cube_yellow", vertices, {});
+		cubeYellow = Mesh::createWithData("cube_yellow", format, vertexAttribs, {});
 		cubeYellow->setDrawType(Mesh::DrawType::ARRAYS);
 		cubeYellow->setMaterial(yellowMat);
 		cubeYellow->setPosition(glm::vec3(0.75f, -0.75f, 0.0f));
@@ -49,10 +49,10 @@ public:
 		mMainCamera->setRotation(glm::vec3(45.0f, 0.0f, 0.0f));
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		// enable cull face
-		glEnable(GL_CULL_FACE);
+		StateCache::enable(GL_CULL_FACE);
 		
 		lightMap = Texture2D::createFromData(lightMapSize, lightMapSize, 1, 1, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, true);
 		lightMap->setMinFilter(GL_NEAREST);
@@ -91,12 +91,11 @@ public:
 	{
 		lightMapPass();
 
-		glViewport(0, 0, mWindowWidth, mWindowHeight);
+		StateCache::viewport(0, 0, mWindowWidth, mWindowHeight);
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 		playground->setMaterial(diffuseMat);
 		playground->setUniform("lightDir", lightDir);
-		playground->setUniform("viewPos", mMainCamera->getPosition());
 		playground->setUniform("lightSpaceMatrix", lightSpaceMatrix);
 		playground->setUniform("biasMatrix", biasMatrix);
 		playground->render();
@@ -115,7 +114,7 @@ public:
 		glm::mat4 lightView = glm::lookAtLH<float>(lightDir, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 		lightSpaceMatrix = lightProj * lightView;
 
-		glViewport(0, 0, lightMapSize, lightMapSize);
+		StateCache::viewport(0, 0, lightMapSize, lightMapSize);
 		lightMapFBO->bind();
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
@@ -47,10 +47,10 @@ public:
 		mMainCamera->setRotation(glm::vec3(45.0f, 0.0f, 0.0f));
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		// enable cull face
-		glEnable(GL_CULL_FACE);
+		StateCache::enable(GL_CULL_FACE);
 
 		lightMap = TextureCube::createFromData("light_map", lightMapSize, lightMapSize, 1, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
 		lightMap->setMinFilter(GL_NEAREST);
@@ -79,22 +79,25 @@ public:
 			}
 		);
 
+		// the room is drawn seven times a frame with one material. the six shadow faces draw each batch whole, the main pass
+		// culls the merged sub-meshes and only draws the ones in view
+		Model::setStaticBatching(true);
 		room = Model::createFromFile("room", modelsDirectory + "/van-gogh-room/van-gogh-room.obj", {}, false);
+		Model::setStaticBatching(false);
 	}
 
 	virtual void render(float deltaTime) override
 	{
 		lightMapPass();
 
-		glViewport(0, 0, mWindowWidth, mWindowHeight);
+		StateCache::viewport(0, 0, mWindowWidth, mWindowHeight);
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		room->setMaterial(diffuseMat);
 		room->setUniform("farPlane", farPlane);
 		room->setUniform("lightPos", lightPos);
-		room->setUniform("viewPos", mMainCamera->getPosition());
-		room->render();
+		room->render(mMainCamera->getFrustum());
 	}
 
 	virtual void windowResized() override
@@ -114,7 +117,7 @@ public:
 		lightSpaceMatrices[4] = lightProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
 		lightSpaceMatrices[5] = lightProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
 
-		glViewport(0, 0, lightMapSize, lightMapSize);
+		StateCache::viewport(0, 0, lightMapSize, lightMapSize);
 		glCullFace(GL_FRONT);
 
 		room->setMaterial(lightPassMat);
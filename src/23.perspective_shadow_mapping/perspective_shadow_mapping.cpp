@@ -50,10 +50,10 @@ public:
 		mMainCamera->setRotation(glm::vec3(30.0f, 0.0f, 0.0f));
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		// enable cull face
-		glEnable(GL_CULL_FACE);
+		StateCache::enable(GL_CULL_FACE);
 
 		lightMap = Texture2D::createFromData(lightMapSize, lightMapSize, 1, 1, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, true);
 		lightMap->setMinFilter(GL_NEAREST);
@@ -92,13 +92,12 @@ public:
 	{
 		lightMapPass();
 
-		glViewport(0, 0, mWindowWidth, mWindowHeight);
+		StateCache::viewport(0, 0, mWindowWidth, mWindowHeight);
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		sampleScene->setMaterial(diffuseMat);
 		sampleScene->setUniform("lightPos", lightPos);
-		sampleScene->setUniform("viewPos", mMainCamera->getPosition());
 		sampleScene->setUniform("lightSpaceMatrix", lightSpaceMatrix);
 		sampleScene->setUniform("biasMatrix", biasMatrix);
 		sampleScene->render();
@@ -117,7 +116,7 @@ public:
 		glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0, 1.0, 0.0));
 		lightSpaceMatrix = lightProj * lightView;
 
-		glViewport(0, 0, lightMapSize, lightMapSize);
+		StateCache::viewport(0, 0, lightMapSize, lightMapSize);
 		lightMapFBO->bind();
 		glClear(GL_DEPTH_BUFFER_BIT);
 		sampleScene->setMaterial(lightPassMat);
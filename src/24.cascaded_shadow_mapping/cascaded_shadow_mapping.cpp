@@ -18,6 +18,14 @@ public:
 	std::shared_ptr<Material> lightPassMat;
 	std::shared_ptr<Material> sceneMat;
 
+	RenderQueue renderQueue;
+
+	// sub-meshes the world's object tree finds inside a cascade
+	std::vector<Object*> shadowCasters;
+
+	// culls and draws the main pass on the gpu
+	std::unique_ptr<GpuCuller> gpuCuller;
+
 	std::unique_ptr<Framebuffer> lightMapFBO;
 
 	const uint32_t lightMapSize = 4096;
@@ -77,10 +85,10 @@ public:
 		mMainCamera->setRotation(glm::vec3(30.0f, 0.0f, 0.0f));
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		// enable cull face
-		glEnable(GL_CULL_FACE);
+		StateCache::enable(GL_CULL_FACE);
 
 		dirLight.color = glm::vec3(1.0f, 1.0f, 1.0f);
 		dirLight.direction = glm::vec3(1.0f, -1.0f, 0.0f);
@@ -113,11 +121,24 @@ public:
 			}
 		);
 
-		plane = Model::createFromFile("plane", modelsDirectory + "/rocks_plane/rocks_plane.obj", {}, false);
+		// the venus clones are drawn with one instanced call per pass
+		lightPassMat->enableInstancing();
+		sceneMat->enableInstancing();
+
+		// the three models are imported concurrently, their meshes share the buffers and vertex array of the geometry arena
+		MeshGeometry::setArenaAllocation(true);
+		std::vector<std::shared_ptr<Model>> models = Model::createFromFiles({
+			{ "plane", modelsDirectory + "/rocks_plane/rocks_plane.obj", {}, false },
+			{ "venus_template", modelsDirectory + "/venus/venus.fbx", {}, false },
+			{ "debug_quad", modelsDirectory + "/quadrangle/quadrangle.obj", { shadersDirectory + "debug_quad.vert", shadersDirectory + "debug_quad.frag" } }
+		});
+		MeshGeometry::setArenaAllocation(false);
+
+		plane = models[0];
 		plane->setRotation(glm::vec3(-90.0f, 0.0f, 0.0f));
 		plane->setScale(glm::vec3(2.0f, 3.0f, 1.0f));
 
-		std::shared_ptr<Model> venusTemplate = Model::createFromFile("venus_template", modelsDirectory + "/venus/venus.fbx", {}, false);
+		std::shared_ptr<Model> venusTemplate = models[1];
 		
 		for (std::size_t i = 0; i < venuses.size(); i++)
 		{
@@ -130,12 +151,24 @@ public:
 		sceneMat->setUniform("dirLight.direction", dirLight.direction);
 		sceneMat->setUniform("biasMatrix", biasMatrix);
 
-		debugQuad = Model::createFromFile("debug_quad", modelsDirectory + "/quadrangle/quadrangle.obj",
-			{
-				shadersDirectory + "debug_quad.vert",
-				shadersDirectory + "debug_quad.frag"
-			}
-		);
+		// the culler groups meshes by material, so they get the one of the main pass before being added
+		gpuCuller = GpuCuller::create(getResourcesPath(ResourceType::Shader) + "/common/gpu_culling.comp");
+		plane->setMaterial(sceneMat);
+		plane->addTo(*gpuCuller);
+		for (std::size_t i = 0; i < venuses.size(); i++)
+		{
+			venuses[i]->setMaterial(sceneMat);
+			venuses[i]->addTo(*gpuCuller);
+		}
+
+		// the light passes find their casters in the world's object tree, one query per cascade
+		plane->addTo(*World::getWorld());
+		for (std::size_t i = 0; i < venuses.size(); i++)
+		{
+			venuses[i]->addTo(*World::getWorld());
+		}
+
+		debugQuad = models[2];
 		debugQuad->setTexture("cascadedDepthMap", lightMapArray);
 	}
 
@@ -144,23 +177,25 @@ public:
 		lightMapPass();
 
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glViewport(0, 0, mWindowWidth, mWindowHeight);
+		StateCache::viewport(0, 0, mWindowWidth, mWindowHeight);
 		glCullFace(GL_BACK);
 
+		std::array<float, MAX_SPLITS> splitDepths;
 		for (unsigned int i = 0; i < MAX_SPLITS; ++i)
 		{
-			sceneMat->setUniform("cascadedSplits[" + std::to_string(i) + "]", cascades[i].splitDepth);
-			sceneMat->setUniform("lightSpaceMatrices[" + std::to_string(i) + "]", cascades[i].viewProjMatrix);
+			splitDepths[i] = cascades[i].splitDepth;
+			cascadeMatrices[i] = cascades[i].viewProjMatrix;
 		}
-		sceneMat->setUniform("viewPos", mMainCamera->getPosition());
+		sceneMat->setUniform("cascadedSplits", splitDepths.data(), MAX_SPLITS);
+		sceneMat->setUniform("lightSpaceMatrices", cascadeMatrices.data(), MAX_SPLITS);
 
 		plane->setMaterial(sceneMat);
-		plane->render();
 		for (std::size_t i = 0; i < venuses.size(); i++)
 		{
 			venuses[i]->setMaterial(sceneMat);
-			venuses[i]->render();
 		}
+		gpuCuller->cull(mMainCamera->getFrustum());
+		gpuCuller->render();
 
 		//debugQuad->render();
 	}
@@ -195,6 +230,12 @@ public:
 			cascadeSplitArray[i] = (d - nearClip) / clipRange;
 		}
 
+		plane->setMaterial(lightPassMat);
+		for (std::size_t i = 0; i < venuses.size(); i++)
+		{
+			venuses[i]->setMaterial(lightPassMat);
+		}
+
 		float lastSplitDist = 0.0f;
 		for (uint32_t i = 0; i < MAX_SPLITS; i++)
 		{
@@ -249,20 +290,23 @@ public:
 			cascades[i].splitDepth = (nearClip + splitDist * clipRange) * -1.0f;
 			cascades[i].viewProjMatrix = lightOrthoMatrix * lightViewMatrix;
 
-			glViewport(0, 0, lightMapSize, lightMapSize);
+			StateCache::viewport(0, 0, lightMapSize, lightMapSize);
 			lightMapFBO->addAttachmentTextureLayer(GL_DEPTH_ATTACHMENT, lightMapArray->getID(), 0, i);
 			lightMapFBO->bind();
 			glClear(GL_DEPTH_BUFFER_BIT);
 
 			lightPassMat->setUniform("lightSpaceMatrix", cascades[i].viewProjMatrix);
 
-			plane->setMaterial(lightPassMat);
-			plane->render();
-			for (std::size_t i = 0; i < venuses.size(); i++)
+			Frustum cascadeFrustum;
+			cascadeFrustum.setPlanes(cascades[i].viewProjMatrix);
+			shadowCasters.clear();
+			World::getWorld()->queryFrustum(cascadeFrustum, shadowCasters);
+			for (Object* caster : shadowCasters)
 			{
-				venuses[i]->setMaterial(lightPassMat);
-				venuses[i]->render();
+				// only sub-meshes are registered
+				renderQueue.submit(static_cast<Mesh*>(caster));
 			}
+			renderQueue.flush();
 
 			lastSplitDist = cascadeSplitArray[i];
 		}
@@ -46,10 +46,10 @@ public:
 		mMainCamera->setRotation(glm::vec3(30.0f, 0.0f, 0.0f));
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		// enable cull face
-		glEnable(GL_CULL_FACE);
+		StateCache::enable(GL_CULL_FACE);
 		glFrontFace(GL_CCW);
 		glCullFace(GL_BACK);
 
@@ -93,7 +93,7 @@ public:
 		glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0, 1.0, 0.0));
 		glm::mat4 lightSpaceMatrix = lightProj * lightView;
 		
-		glViewport(0, 0, lightMapWidth, lightMapHeight);
+		StateCache::viewport(0, 0, lightMapWidth, lightMapHeight);
 		lightMapFBO->bind();
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		sampleSceneShadow->setUniform("lightSpaceMatrix", lightSpaceMatrix);
@@ -103,11 +103,10 @@ public:
 		glCullFace(GL_BACK);
 
 		lightMapFBO->unbind();
-		glViewport(0, 0, mWindowWidth, mWindowHeight);
+		StateCache::viewport(0, 0, mWindowWidth, mWindowHeight);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		sampleScene->setUniform("lightPos", lightPos);
-		sampleScene->setUniform("viewPos", mMainCamera->getPosition());
 		sampleScene->setUniform("lightSpaceMatrix", lightSpaceMatrix);
 		sampleScene->render();
 	}
@@ -11,6 +11,8 @@ class Example final : public ExampleBase
 public:
 	std::array<std::shared_ptr<Model>, 16> spheres;
 
+	RenderQueue renderQueue;
+
 	std::unique_ptr<Framebuffer> hdrFBO;
 	std::shared_ptr<Texture2D> fragColorTexture;
 	std::shared_ptr<Texture2D> brightColorTexture;
@@ -46,7 +48,7 @@ public:
 		mMainCamera->setPosition(glm::vec3(0.0f, 0.0f, 10.0f));
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		hdrFBO = Framebuffer::create();
 
@@ -93,14 +95,7 @@ public:
 			1, 2, 3
 		};
 
-		std::vector<Vertex> vertices = {};
-		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexAttribs.size() / 5); i++)
-		{
-			Vertex vertex;
-			vertex.vPosition = glm::vec3(vertexAttribs[i * 5], vertexAttribs[i * 5 + 1], vertexAttribs[i * 5 + 2]);
-			vertex.vTexcoord = glm::vec2(vertexAttribs[i * 5 + 3], vertexAttribs[i * 5 + 4]);
-			vertices.push_back(vertex);
-		}
+		VertexFormat format({ { VertexSemantic::Position, 3 }, { VertexSemantic::Texcoord, 2 } });
 
 		std::shared_ptr<Material> blurMat = Material::createFromData("blur_mat",
 			{
@@ -123,13 +118,13 @@ public:
 			}
 		);
 
-		blurQuad = Mesh::createWithData("hdr_quad", vertices, indices);
+		blurQuad = Mesh::createWithData("hdr_quad", format, vertexAttribs, indices);
 		blurQuad->setDrawType(Mesh::DrawType::ELEMENTS);
 		blurQuad->setMaterial(blurMat);
 		blurQuad->setUniform("blurScale", 2.0f);
 		blurQuad->setUniform("blurStrength", 1.0f);
 
-		hdrQuad = Mesh::createWithData("blur_quad", vertices, indices);
+		hdrQuad = Mesh::createWithData("blur_quad", format, vertexAttribs, indices);
 		hdrQuad->setDrawType(Mesh::DrawType::ELEMENTS);
 		hdrQuad->setMaterial(hdrMat);
 		hdrQuad->setUniform("exposure", 1.0f);
@@ -144,6 +139,7 @@ public:
 			},
 			true
 		);
+		sphereTemplate->enableInstancing({ { "randomColor", UniformType::VEC3 } });
 		
 		for (size_t i = 0; i < spheres.size(); i++)
 		{
@@ -166,8 +162,9 @@ public:
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 		for (size_t i = 0; i < spheres.size(); i++)
 		{
-			spheres[i]->render();
+			spheres[i]->submit(renderQueue);
 		}
+		renderQueue.flush();
 		hdrFBO->unbind();
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
@@ -188,7 +185,7 @@ public:
 				firstIteration = false;
 		}
 		
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		StateCache::bindFramebuffer(GL_FRAMEBUFFER, 0);
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 		hdrQuad->render();
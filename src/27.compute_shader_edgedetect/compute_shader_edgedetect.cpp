@@ -34,7 +34,7 @@ public:
 	{
 		ExampleBase::prepare();
 		
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 		
 		computeProgram = Program::createFromFiles("compute_program", 
 			{
@@ -57,6 +57,8 @@ public:
 		);
 
 
+		// the input is bound as a storage image, which a compressed .ktx sibling could not be
+		Texture2D::setPreferCompressed(false);
 		std::shared_ptr<Texture2D> inputImage = Texture2D::createFromFile(texturesDirectory + "vulkan.png", 1, false, false);
 		std::shared_ptr<Texture2D> intermediateImage = Texture2D::createFromData(inputImage->getWidth(), inputImage->getHeight(), 1, 1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, true);
 		std::shared_ptr<Texture2D> outputImage = Texture2D::createFromData(inputImage->getWidth(), inputImage->getHeight(), 1, 1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, true);
@@ -13,6 +13,8 @@ public:
 	const int col = 7;
 	std::vector<std::shared_ptr<Model>> spheres;
 
+	RenderQueue renderQueue;
+
 	struct Light
 	{
 		glm::vec3 color;
@@ -44,7 +46,7 @@ public:
 		mMainCamera->setRotation(glm::vec3(0.0f, 0.0f, 0.0f));
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		std::shared_ptr<Model> sphereTemplate = Model::createFromFile("sphere_template", modelsDirectory + "/sphere/sphere.obj",
 			{
@@ -54,6 +56,13 @@ public:
 			true
 		);
 
+		// the clones share the template's material, merged into one instanced draw they only differ in these
+		sphereTemplate->enableInstancing({
+			{ "albedo", UniformType::VEC3 },
+			{ "roughness", UniformType::FLOAT },
+			{ "metallic", UniformType::FLOAT }
+		});
+
 		lights[0].position = glm::vec3(-15.0f, 7.5f, -15.0f);
 		lights[1].position = glm::vec3(-15.0f, 7.5f, 15.0f);
 		lights[2].position = glm::vec3(15.0f, 7.5f, 15.0f);
@@ -88,11 +97,12 @@ public:
 
 	virtual void render(float deltaTime) override
 	{
+		// the camera comes from the per frame block, the spheres only carry their own parameters
 		for (std::size_t i = 0; i < spheres.size(); i++)
 		{
-			spheres[i]->setUniform("viewPos", mMainCamera->getPosition());
-			spheres[i]->render();
+			spheres[i]->submit(renderQueue);
 		}
+		renderQueue.flush();
 	}
 
 	virtual void windowResized() override
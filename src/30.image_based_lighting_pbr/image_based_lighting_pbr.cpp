@@ -54,7 +54,7 @@ public:
 		ExampleBase::prepare();
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 		glDepthFunc(GL_LEQUAL);
 
 		// setup camera
@@ -113,7 +113,7 @@ public:
 		cube->setMaterial(equirectangularToCubemapMat);
 		cube->setUniform("captureProj", captureProj);
 
-		glViewport(0, 0, 512, 512);
+		StateCache::viewport(0, 0, 512, 512);
 		for (unsigned int i = 0; i < 6; i++)
 		{
 			cube->setUniform("captureView", captureViews[i]);
@@ -138,7 +138,7 @@ public:
 
 		captureFBO->bind();
 		captureRBO->resize(32, 32);
-		glViewport(0, 0, 32, 32);
+		StateCache::viewport(0, 0, 32, 32);
 
 		cube->setMaterial(irradianceMat);
 		cube->setUniform("captureProj", captureProj);
@@ -173,7 +173,7 @@ public:
 			unsigned int mipHeight = 128 * std::pow(0.5, mip);
 			captureRBO->resize(mipWidth, mipHeight);
 
-			glViewport(0, 0, mipWidth, mipHeight);
+			StateCache::viewport(0, 0, mipWidth, mipHeight);
 
 			float roughness = (float)mip / (float)(maxMipLevels - 1);
 			cube->setUniform("roughness", roughness);
@@ -205,12 +205,12 @@ public:
 		captureFBO->addAttachmentTexture2D(GL_COLOR_ATTACHMENT0, brdfLUT->getTarget(), brdfLUT->getID(), 0);
 		captureFBO->bind();
 		captureRBO->resize(512, 512);
-		glViewport(0, 0, 512, 512);
+		StateCache::viewport(0, 0, 512, 512);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		quad->render();
 		captureFBO->unbind();
 	
-		glViewport(0, 0, mWindowWidth, mWindowHeight);
+		StateCache::viewport(0, 0, mWindowWidth, mWindowHeight);
 
 		std::shared_ptr<Material> pbrMat = Material::createFromData("pbr_mat",
 			{
@@ -279,14 +279,13 @@ public:
 	virtual void render(float deltaTime) override
 	{
 		
-		glEnable(GL_CULL_FACE);
+		StateCache::enable(GL_CULL_FACE);
 		for (std::size_t i = 0; i < spheres.size(); i++)
 		{
-			spheres[i]->setUniform("viewPos", mMainCamera->getPosition());
 			spheres[i]->render();
 		}
 
-		glDisable(GL_CULL_FACE);
+		StateCache::disable(GL_CULL_FACE);
 		cube->render();
 		
 	}
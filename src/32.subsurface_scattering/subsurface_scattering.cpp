@@ -46,10 +46,10 @@ public:
 		ExampleBase::prepare();
 
 		// enable depth test
-		glEnable(GL_DEPTH_TEST);
+		StateCache::enable(GL_DEPTH_TEST);
 
 		// enable cull face
-		glEnable(GL_CULL_FACE);
+		StateCache::enable(GL_CULL_FACE);
 
 		depthFBO = Framebuffer::create();
 
@@ -94,7 +94,7 @@ public:
 	virtual void render(float deltaTime) override
 	{
 		depthFBO->bind();
-		glViewport(0, 0, depthMapSize, depthMapSize);
+		StateCache::viewport(0, 0, depthMapSize, depthMapSize);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		glCullFace(GL_BACK);
 
@@ -107,12 +107,11 @@ public:
 		bunny->render();
 
 		depthFBO->unbind();
-		glViewport(0, 0, mWindowWidth, mWindowHeight);
+		StateCache::viewport(0, 0, mWindowWidth, mWindowHeight);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		bunny->setMaterial(sssMat);
 		bunny->setUniform("lightView", lightView);
 		bunny->setUniform("lightProj", lightProj);
-		bunny->setUniform("viewPos", mMainCamera->getPosition());
 		bunny->render();
 	}
 
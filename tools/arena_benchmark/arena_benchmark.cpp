@@ -0,0 +1,186 @@
+#include <rangeallocator.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+using namespace es;
+
+// churns the geometry arena's range allocator with mesh sized allocations, runs without a window or gl context
+//
+//   arena_benchmark [--rounds <n>] [--capacity <units>]
+//
+// every round frees a random third of the live ranges and refills the arena, the allocator is checked for overlaps after
+// each round and fragmentation is reported before and after compaction
+
+struct Options
+{
+	uint32_t mRounds = 200;
+	uint32_t mCapacity = 1u << 22;
+};
+
+struct Range
+{
+	uint32_t mHandle;
+	uint32_t mOffset;
+	uint32_t mSize;
+};
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--rounds") == 0 && i + 1 < argc)
+		{
+			options.mRounds = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--capacity") == 0 && i + 1 < argc)
+		{
+			options.mCapacity = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			std::printf("usage: arena_benchmark [--rounds <n>] [--capacity <units>]\n");
+			return false;
+		}
+	}
+	return options.mRounds > 0 && options.mCapacity > 0;
+}
+
+// the ranges the caller thinks it owns have to match the allocator and must not overlap
+static bool checkRanges(const RangeAllocator& allocator, std::vector<Range> ranges)
+{
+	if (!allocator.validate())
+	{
+		return false;
+	}
+
+	std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.mOffset < b.mOffset; });
+	uint32_t end = 0;
+	for (const Range& range : ranges)
+	{
+		if (range.mOffset < end || allocator.getOffset(range.mHandle) != range.mOffset || allocator.getSize(range.mHandle) != range.mSize)
+		{
+			return false;
+		}
+		end = range.mOffset + range.mSize;
+	}
+	return end <= allocator.getCapacity();
+}
+
+static void printStatistics(const char* label, const RangeAllocator& allocator)
+{
+	RangeAllocatorStatistics statistics = allocator.getStatistics();
+	std::printf("%-18s %10u %10u %8u %8u %12u %8.3f\n", label, statistics.mCapacity, statistics.mUsed, statistics.mAllocations,
+		statistics.mFreeBlocks, statistics.mLargestFreeBlock, statistics.mFragmentation);
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		return 1;
+	}
+
+	std::mt19937 random(options.mCapacity);
+
+	// mostly small meshes with the odd large one, sizes in vertices
+	std::lognormal_distribution<float> size(6.0f, 1.5f);
+	auto nextSize = [&]()
+	{
+		return std::max(1u, std::min(options.mCapacity / 16, static_cast<uint32_t>(size(random))));
+	};
+
+	RangeAllocator allocator(options.mCapacity);
+	std::vector<Range> ranges;
+	uint64_t allocations = 0;
+	uint64_t failures = 0;
+	double allocateTime = 0.0;
+	double releaseTime = 0.0;
+	bool isValid = true;
+
+	for (uint32_t round = 0; round < options.mRounds && isValid; round++)
+	{
+		std::shuffle(ranges.begin(), ranges.end(), random);
+		std::size_t keep = ranges.size() - ranges.size() / 3;
+		Clock::time_point start = Clock::now();
+		for (std::size_t i = keep; i < ranges.size(); i++)
+		{
+			allocator.release(ranges[i].mHandle);
+		}
+		releaseTime += elapsedMs(start);
+		ranges.resize(keep);
+
+		// fill until a request fails, like loading meshes into a fixed size arena
+		start = Clock::now();
+		for (;;)
+		{
+			uint32_t units = nextSize();
+			uint32_t handle = allocator.allocate(units);
+			if (handle == RangeAllocator::kInvalidHandle)
+			{
+				failures++;
+				break;
+			}
+			ranges.push_back({ handle, allocator.getOffset(handle), units });
+			allocations++;
+		}
+		allocateTime += elapsedMs(start);
+
+		isValid = checkRanges(allocator, ranges);
+	}
+
+	std::printf("%-18s %10s %10s %8s %8s %12s %8s\n", "", "capacity", "used", "ranges", "free", "largest free", "frag");
+	printStatistics("after churn", allocator);
+
+	// release another half so there are holes left to close
+	std::shuffle(ranges.begin(), ranges.end(), random);
+	for (std::size_t i = ranges.size() / 2; i < ranges.size(); i++)
+	{
+		allocator.release(ranges[i].mHandle);
+	}
+	ranges.resize(ranges.size() / 2);
+	isValid = isValid && checkRanges(allocator, ranges);
+	printStatistics("after release", allocator);
+
+	uint32_t moves = 0;
+	Clock::time_point start = Clock::now();
+	allocator.compact([&](uint32_t handle, uint32_t oldOffset, uint32_t newOffset, uint32_t units)
+	{
+		moves++;
+		for (Range& range : ranges)
+		{
+			if (range.mHandle == handle)
+			{
+				isValid = isValid && range.mOffset == oldOffset && range.mSize == units && newOffset < oldOffset;
+				range.mOffset = newOffset;
+			}
+		}
+	});
+	double compactTime = elapsedMs(start);
+	isValid = isValid && checkRanges(allocator, ranges);
+	printStatistics("after compact", allocator);
+
+	std::printf("%llu allocations, %.1f ns per allocate, %.1f ns per release, compaction moved %u ranges in %.3f ms\n",
+		static_cast<unsigned long long>(allocations),
+		allocations > 0 ? allocateTime * 1.0e6 / static_cast<double>(allocations + failures) : 0.0,
+		allocations > 0 ? releaseTime * 1.0e6 / static_cast<double>(allocations) : 0.0,
+		moves, compactTime);
+
+	if (!isValid)
+	{
+		std::printf("the allocator handed out overlapping or inconsistent ranges\n");
+	}
+	return isValid ? 0 : 1;
+}
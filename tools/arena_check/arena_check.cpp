@@ -0,0 +1,233 @@
+#include <mesh.h>
+#include <statecache.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+using namespace es;
+
+// fills a geometry arena pool with meshes, frees some of them, compacts the pool and reads the buffers back to see that every
+// live mesh still finds its vertices and indices at getBaseVertex and getFirstIndex. needs a gl es 3.1 context but opens no
+// visible window
+//
+//   arena_check [--meshes <n>] [--rounds <n>]
+//
+// the meshes use two vertex streams so the per stream copies of growing and compacting are covered too
+
+struct Options
+{
+	uint32_t mMeshes = 400;
+	uint32_t mRounds = 3;
+};
+
+// what a mesh was created with, kept to compare against the pool
+struct Source
+{
+	std::shared_ptr<const MeshGeometry> mGeometry;
+	std::vector<uint8_t> mVertices;
+	std::vector<uint32_t> mIndices;
+};
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--meshes") == 0 && i + 1 < argc)
+		{
+			options.mMeshes = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--rounds") == 0 && i + 1 < argc)
+		{
+			options.mRounds = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			std::printf("usage: arena_check [--meshes <n>] [--rounds <n>]\n");
+			return false;
+		}
+	}
+	return options.mMeshes > 0 && options.mRounds > 0;
+}
+
+// the same es 3.1 context the examples ask for, on a window that is never shown
+static bool createContext(SDL_Window*& window, SDL_GLContext& context)
+{
+	SDL_SetMainReady();
+	if (SDL_Init(SDL_INIT_VIDEO) != 0)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to init SDL! error : %s\n", SDL_GetError());
+		return false;
+	}
+
+	SDL_SetHint(SDL_HINT_OPENGL_ES_DRIVER, "1");
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_EGL, 1);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+
+	window = SDL_CreateWindow("arena_check", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	context = window != nullptr ? SDL_GL_CreateContext(window) : nullptr;
+	if (context == nullptr)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to create an OpenGL ES 3.1 context! error : %s\n", SDL_GetError());
+		return false;
+	}
+	StateCache::invalidate();
+	return true;
+}
+
+// vertices and indices made from the mesh number so no two meshes hold the same data
+static Source createMesh(const VertexFormat& format, uint32_t id, std::mt19937& random)
+{
+	std::uniform_int_distribution<uint32_t> vertexCount(3, 3000);
+	std::uniform_int_distribution<uint32_t> triangleCount(1, 2000);
+
+	Source source;
+	uint32_t vertices = vertexCount(random);
+	source.mVertices.resize(static_cast<std::size_t>(vertices) * format.getVertexSize());
+	float* values = reinterpret_cast<float*>(source.mVertices.data());
+	for (std::size_t i = 0; i < source.mVertices.size() / sizeof(float); i++)
+	{
+		values[i] = static_cast<float>(id) * 4096.0f + static_cast<float>(i);
+	}
+
+	source.mIndices.resize(triangleCount(random) * 3);
+	for (std::size_t i = 0; i < source.mIndices.size(); i++)
+	{
+		source.mIndices[i] = static_cast<uint32_t>((i * 7 + id) % vertices);
+	}
+
+	source.mGeometry = MeshGeometry::createWithPackedData(format, source.mVertices.data(), vertices, source.mIndices.data(),
+		static_cast<uint32_t>(source.mIndices.size()), GL_UNSIGNED_INT);
+	return source;
+}
+
+// every stream of the mesh has to sit at the base vertex of the same stream of the pool, the indices at the first index
+static uint32_t checkMeshes(const VertexFormat& format, const std::vector<Source>& sources)
+{
+	if (sources.empty())
+	{
+		return 0;
+	}
+
+	GeometryArena* arena = GeometryArena::getArena();
+	uint32_t vertexCapacity = arena->getVertexStatistics(0).mCapacity;
+	uint32_t indexCapacity = arena->getIndexStatistics(0).mCapacity;
+
+	VertexBuffer* vbo = sources[0].mGeometry->getVertexBuffer();
+	std::size_t vertexSize = static_cast<std::size_t>(vertexCapacity) * format.getVertexSize();
+	const uint8_t* vertices = static_cast<const uint8_t*>(vbo->mapRange(GL_MAP_READ_BIT, 0, vertexSize));
+	std::vector<uint8_t> pooledVertices(vertices, vertices + (vertices != nullptr ? vertexSize : 0));
+	vbo->unMap();
+
+	ElementBuffer* ebo = sources[0].mGeometry->getElementBuffer();
+	const uint32_t* indices = static_cast<const uint32_t*>(ebo->mapRange(GL_MAP_READ_BIT, 0, indexCapacity * sizeof(uint32_t)));
+	std::vector<uint32_t> pooledIndices(indices, indices + (indices != nullptr ? indexCapacity : 0));
+	ebo->unMap();
+
+	if (pooledVertices.empty() || pooledIndices.empty())
+	{
+		std::printf("failed to read back the pool\n");
+		return 1;
+	}
+
+	uint32_t mismatches = 0;
+	for (const Source& source : sources)
+	{
+		const MeshGeometry* geometry = source.mGeometry.get();
+		if (!geometry->isArenaAllocated() || geometry->getVertexBuffer() != vbo || geometry->getElementBuffer() != ebo)
+		{
+			mismatches++;
+			continue;
+		}
+
+		uint32_t vertexCount = geometry->getVertexCount();
+		uint32_t baseVertex = geometry->getBaseVertex();
+		for (uint32_t stream = 0; stream < format.getStreamCount(); stream++)
+		{
+			std::size_t stride = format.getStride(stream);
+			const uint8_t* pooled = pooledVertices.data() + format.getStreamOffset(stream, vertexCapacity) + baseVertex * stride;
+			mismatches += std::memcmp(pooled, source.mVertices.data() + format.getStreamOffset(stream, vertexCount), vertexCount * stride) != 0;
+		}
+
+		uint32_t firstIndex = geometry->getFirstIndex();
+		mismatches += std::memcmp(pooledIndices.data() + firstIndex, source.mIndices.data(), source.mIndices.size() * sizeof(uint32_t)) != 0;
+	}
+	return mismatches;
+}
+
+static void printStatistics(const char* label)
+{
+	RangeAllocatorStatistics vertices = GeometryArena::getArena()->getVertexStatistics(0);
+	RangeAllocatorStatistics indices = GeometryArena::getArena()->getIndexStatistics(0);
+	std::printf("%-16s %9u / %9u vertices %6.3f frag %9u / %9u indices %6.3f frag\n", label, vertices.mUsed, vertices.mCapacity,
+		vertices.mFragmentation, indices.mUsed, indices.mCapacity, indices.mFragmentation);
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		return 1;
+	}
+
+	SDL_Window* window = nullptr;
+	SDL_GLContext context = nullptr;
+	if (!createContext(window, context))
+	{
+		return 1;
+	}
+
+	VertexFormat format({
+		{ VertexSemantic::Position, 3, GL_FLOAT, false, 0 },
+		{ VertexSemantic::Normal, 3, GL_FLOAT, false, 0 },
+		{ VertexSemantic::Texcoord, 2, GL_FLOAT, false, 1 }
+	});
+
+	MeshGeometry::setArenaAllocation(true);
+	std::mt19937 random(options.mMeshes);
+	std::vector<Source> sources;
+	uint32_t mismatches = 0;
+	uint32_t id = 0;
+
+	for (uint32_t round = 0; round < options.mRounds; round++)
+	{
+		// the first round outgrows the initial pool, later ones refill the holes
+		while (sources.size() < options.mMeshes)
+		{
+			sources.push_back(createMesh(format, id++, random));
+		}
+		mismatches += checkMeshes(format, sources);
+		printStatistics("filled");
+
+		std::shuffle(sources.begin(), sources.end(), random);
+		sources.resize(sources.size() / 2);
+		printStatistics("released half");
+
+		GeometryArena::getArena()->compact();
+		uint32_t compacted = checkMeshes(format, sources);
+		mismatches += compacted;
+		printStatistics("compacted");
+
+		RangeAllocatorStatistics statistics = GeometryArena::getArena()->getVertexStatistics(0);
+		mismatches += statistics.mFreeBlocks > 1;
+		std::printf("round %u: %zu live meshes, %u mismatches after compaction\n", round, sources.size(), compacted);
+	}
+
+	// a request the pool can not grow to fails without touching the live meshes
+	GeometryArena::Allocation allocation = GeometryArena::getArena()->allocate(format, nullptr, GeometryArena::kMaxCapacity, nullptr, 3, GL_UNSIGNED_INT);
+	mismatches += allocation.isValid();
+	mismatches += checkMeshes(format, sources);
+
+	std::printf("%u mismatches on %s\n", mismatches, glGetString(GL_RENDERER));
+
+	sources.clear();
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+#include <aabbtree.h>
+#include <geometry.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+using namespace es;
+
+// times the world's object tree against a linear scan on random scenes, runs without a window or gl context
+//
+//   bvh_benchmark [--frames <n>] [--max <objects>]
+//
+// objects keep the same density at every count so a camera with a fixed far plane sees roughly the same number of them,
+// the tree's frustum and ray costs should stay flat while the linear scan grows with the object count
+
+struct Options
+{
+	uint32_t mFrames = 60;
+	uint32_t mMaxObjects = 100000;
+};
+
+struct SceneObject
+{
+	glm::vec3 mPosition;
+	glm::vec3 mHalfSize;
+	glm::vec3 mVelocity;
+	int32_t mProxy;
+
+	AABB getBounds() const
+	{
+		AABB box;
+		box.mMin = mPosition - mHalfSize;
+		box.mMax = mPosition + mHalfSize;
+		return box;
+	}
+};
+
+struct Timings
+{
+	double mBuild = 0.0;
+	double mMove = 0.0;
+	double mTreeFrustum = 0.0;
+	double mLinearFrustum = 0.0;
+	double mTreeRay = 0.0;
+	double mLinearRay = 0.0;
+	uint64_t mReinserted = 0;
+	uint64_t mVisible = 0;
+	uint64_t mVisited = 0;
+	uint32_t mMismatches = 0;
+};
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			options.mFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+		{
+			options.mMaxObjects = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			std::printf("usage: bvh_benchmark [--frames <n>] [--max <objects>]\n");
+			return false;
+		}
+	}
+	return options.mFrames > 0 && options.mMaxObjects > 0;
+}
+
+static Timings run(uint32_t objectCount, uint32_t frames)
+{
+	Timings timings;
+	std::mt19937 random(objectCount);
+
+	// one object per 64 cubic units
+	float side = std::cbrt(static_cast<float>(objectCount) * 64.0f);
+	std::uniform_real_distribution<float> position(-side * 0.5f, side * 0.5f);
+	std::uniform_real_distribution<float> size(0.25f, 1.5f);
+	std::uniform_real_distribution<float> speed(-2.0f, 2.0f);
+
+	std::vector<SceneObject> objects(objectCount);
+	for (SceneObject& object : objects)
+	{
+		object.mPosition = glm::vec3(position(random), position(random), position(random));
+		object.mHalfSize = glm::vec3(size(random), size(random), size(random));
+		object.mVelocity = glm::vec3(speed(random), speed(random), speed(random));
+	}
+
+	AABBTree tree;
+	Clock::time_point start = Clock::now();
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		objects[i].mProxy = tree.insert(objects[i].getBounds(), &objects[i]);
+	}
+	timings.mBuild = elapsedMs(start);
+
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 20.0f);
+	std::vector<const SceneObject*> treeHits;
+	std::vector<const SceneObject*> linearHits;
+	const float deltaTime = 1.0f / 60.0f;
+
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		// a tenth of the scene moves every frame
+		start = Clock::now();
+		for (uint32_t i = frame % 10; i < objectCount; i += 10)
+		{
+			SceneObject& object = objects[i];
+			object.mPosition += object.mVelocity * deltaTime;
+			timings.mReinserted += tree.move(object.mProxy, object.getBounds()) ? 1 : 0;
+		}
+		timings.mMove += elapsedMs(start);
+
+		float angle = static_cast<float>(frame) * 0.05f;
+		glm::vec3 eye = glm::vec3(0.0f);
+		glm::vec3 forward = glm::vec3(std::sin(angle), 0.1f, std::cos(angle));
+		Frustum frustum;
+		frustum.setPlanes(projection * glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+		// the tree reports fat boxes, both sides keep the exact test so they return the same set
+		treeHits.clear();
+		start = Clock::now();
+		tree.queryFrustum(frustum, [&](void* userData)
+		{
+			const SceneObject* object = static_cast<const SceneObject*>(userData);
+			if (frustum.classify(object->getBounds()) != Containment::OUTSIDE)
+			{
+				treeHits.push_back(object);
+			}
+		});
+		timings.mTreeFrustum += elapsedMs(start);
+		timings.mVisited += tree.getLastVisitCount();
+		timings.mVisible += treeHits.size();
+
+		linearHits.clear();
+		start = Clock::now();
+		for (const SceneObject& object : objects)
+		{
+			if (frustum.classify(object.getBounds()) != Containment::OUTSIDE)
+			{
+				linearHits.push_back(&object);
+			}
+		}
+		timings.mLinearFrustum += elapsedMs(start);
+		timings.mMismatches += treeHits.size() != linearHits.size() ? 1 : 0;
+
+		// picking ray down the view direction
+		glm::vec3 direction = glm::normalize(forward);
+		glm::vec3 inverseDirection = 1.0f / direction;
+		start = Clock::now();
+		float treeDistance = 0.0f;
+		void* treeHit = tree.raycast(eye, direction, 1000.0f, [&](void* userData, float limit, float& distance)
+		{
+			return static_cast<const SceneObject*>(userData)->getBounds().intersectRay(eye, inverseDirection, limit, distance);
+		}, treeDistance);
+		timings.mTreeRay += elapsedMs(start);
+
+		start = Clock::now();
+		const SceneObject* linearHit = nullptr;
+		float linearDistance = 1000.0f;
+		for (const SceneObject& object : objects)
+		{
+			float distance = 0.0f;
+			if (object.getBounds().intersectRay(eye, inverseDirection, linearDistance, distance) && distance < linearDistance)
+			{
+				linearDistance = distance;
+				linearHit = &object;
+			}
+		}
+		timings.mLinearRay += elapsedMs(start);
+		timings.mMismatches += (treeHit == nullptr) != (linearHit == nullptr) || (linearHit != nullptr && treeDistance != linearDistance) ? 1 : 0;
+	}
+	return timings;
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		return 1;
+	}
+
+	std::printf("%9s %10s %10s %12s %12s %10s %10s %9s %9s %8s\n", "objects", "build ms", "move ms", "tree frus", "linear frus", "tree ray", "lin ray", "visible", "visited", "reinsert");
+
+	bool isValid = true;
+	for (uint32_t count = 1000; count <= options.mMaxObjects; count *= 10)
+	{
+		Timings timings = run(count, options.mFrames);
+		double frames = static_cast<double>(options.mFrames);
+		std::printf("%9u %10.3f %10.4f %12.4f %12.4f %10.4f %10.4f %9.0f %9.0f %8.0f\n",
+			count, timings.mBuild, timings.mMove / frames,
+			timings.mTreeFrustum / frames, timings.mLinearFrustum / frames,
+			timings.mTreeRay / frames, timings.mLinearRay / frames,
+			timings.mVisible / frames, timings.mVisited / frames, timings.mReinserted / frames);
+
+		if (timings.mMismatches > 0)
+		{
+			std::printf("  %u frames where the tree and the linear scan disagree\n", timings.mMismatches);
+			isValid = false;
+		}
+	}
+	std::printf("per frame times except build, visited counts tree nodes touched by the frustum query\n");
+	return isValid ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+#include <gpuculler.h>
+#include <statecache.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+using namespace es;
+
+// runs the gpu culling shader on random objects and compares what it writes with GpuCuller::isVisible, the cpu side of the
+// same test. needs a gl es 3.1 context but opens no visible window
+//
+//   gpu_cull_check [--objects <n>] [--commands <n>] [--frames <n>] [--shader <gpu_culling.comp>]
+//
+// every frame looks in another direction. the instance count of each command has to match the cpu test, and the instances
+// written for a command have to be exactly its visible objects, packed from its base
+
+struct Options
+{
+	uint32_t mObjects = 10000;
+	uint32_t mCommands = 3;
+	uint32_t mFrames = 8;
+	std::string mShaderPath;
+};
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+#if defined(ES_EXAMPLE_RESOURCES_DIR)
+	options.mShaderPath = std::string(ES_EXAMPLE_RESOURCES_DIR) + "shaders/common/gpu_culling.comp";
+#else
+	options.mShaderPath = "./../resources/shaders/common/gpu_culling.comp";
+#endif
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+		{
+			options.mObjects = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--commands") == 0 && i + 1 < argc)
+		{
+			options.mCommands = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			options.mFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--shader") == 0 && i + 1 < argc)
+		{
+			options.mShaderPath = argv[++i];
+		}
+		else
+		{
+			std::printf("usage: gpu_cull_check [--objects <n>] [--commands <n>] [--frames <n>] [--shader <gpu_culling.comp>]\n");
+			return false;
+		}
+	}
+	return options.mObjects > 0 && options.mCommands > 0;
+}
+
+// the same es 3.1 context the examples ask for, on a window that is never shown
+static bool createContext(SDL_Window*& window, SDL_GLContext& context)
+{
+	SDL_SetMainReady();
+	if (SDL_Init(SDL_INIT_VIDEO) != 0)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to init SDL! error : %s\n", SDL_GetError());
+		return false;
+	}
+
+	SDL_SetHint(SDL_HINT_OPENGL_ES_DRIVER, "1");
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_EGL, 1);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+
+	window = SDL_CreateWindow("gpu_cull_check", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	context = window != nullptr ? SDL_GL_CreateContext(window) : nullptr;
+	if (context == nullptr)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to create an OpenGL ES 3.1 context! error : %s\n", SDL_GetError());
+		return false;
+	}
+	StateCache::invalidate();
+	return true;
+}
+
+// random transforms around the origin, the object index is kept in the params to find it again among the instances
+static std::vector<GpuCullObject> createObjects(const Options& options)
+{
+	std::mt19937 random(options.mObjects);
+	std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.28f);
+	std::uniform_real_distribution<float> scaling(0.2f, 3.0f);
+
+	std::vector<GpuCullObject> objects(options.mObjects);
+	for (uint32_t i = 0; i < options.mObjects; i++)
+	{
+		GpuCullObject& object = objects[i];
+		glm::vec3 axis = glm::normalize(glm::vec3(position(random), position(random), position(random)) + 0.01f);
+		object.mModel = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)));
+		object.mModel = glm::scale(glm::rotate(object.mModel, angle(random), axis), glm::vec3(scaling(random)));
+		object.mParams[0] = glm::vec4(static_cast<float>(i));
+		object.mParams[1] = glm::vec4(-static_cast<float>(i));
+		object.mCenter = glm::vec4(0.1f, -0.2f, 0.3f, 1.0f);
+		object.mExtents = glm::vec4(1.0f, 0.5f, 2.0f, 0.0f);
+
+		// what GpuCuller uploads for meshes without bounds, they have to pass every plane
+		if (i % 97 == 0)
+		{
+			object.mExtents = glm::vec4(glm::vec3(1.0e30f), 0.0f);
+		}
+		object.mCommand = i % options.mCommands;
+		object.mPadding[0] = object.mPadding[1] = object.mPadding[2] = 0;
+	}
+	return objects;
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		return 1;
+	}
+
+	SDL_Window* window = nullptr;
+	SDL_GLContext context = nullptr;
+	if (!createContext(window, context))
+	{
+		return 1;
+	}
+
+	std::shared_ptr<Program> program = Program::createFromFiles("gpu_culling", { options.mShaderPath });
+	if (program == nullptr || program->getID() == 0)
+	{
+		std::printf("failed to build %s\n", options.mShaderPath.c_str());
+		return 1;
+	}
+
+	std::vector<GpuCullObject> objects = createObjects(options);
+
+	// the instances of a command start at its base, like GpuCuller lays them out
+	std::vector<uint32_t> objectCounts(options.mCommands, 0);
+	for (const GpuCullObject& object : objects)
+	{
+		objectCounts[object.mCommand]++;
+	}
+	std::vector<uint32_t> bases(options.mCommands, 0);
+	for (uint32_t i = 1; i < options.mCommands; i++)
+	{
+		bases[i] = bases[i - 1] + objectCounts[i - 1];
+	}
+	std::vector<DrawElementsIndirectCommand> records(options.mCommands, { 36, 0, 0, 0, 0 });
+
+	std::size_t commandSize = records.size() * sizeof(DrawElementsIndirectCommand);
+	std::size_t instanceSize = objects.size() * sizeof(InstanceData);
+	std::shared_ptr<Buffer> objectBuffer = Buffer::createWithData(GL_SHADER_STORAGE_BUFFER, GL_STATIC_DRAW, objects.size() * sizeof(GpuCullObject), objects.data());
+	std::shared_ptr<Buffer> instanceBuffer = Buffer::createWithData(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY, instanceSize, nullptr);
+	std::shared_ptr<Buffer> commandBuffer = Buffer::createWithData(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY, commandSize, records.data());
+	std::shared_ptr<Buffer> baseBuffer = Buffer::createWithData(GL_SHADER_STORAGE_BUFFER, GL_STATIC_DRAW, bases.size() * sizeof(uint32_t), bases.data());
+
+	uint32_t mismatches = 0;
+	for (uint32_t frame = 0; frame < options.mFrames; frame++)
+	{
+		float yaw = static_cast<float>(frame) * 0.8f;
+		glm::vec3 forward = glm::vec3(std::sin(yaw), 0.2f * static_cast<float>(frame % 8) - 0.5f, std::cos(yaw));
+		Frustum frustum;
+		frustum.setPlanes(glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 50.0f) * glm::lookAt(glm::vec3(0.0f), forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+		// the cpu reference, visible objects of every command in index order
+		std::vector<std::vector<uint32_t>> expected(options.mCommands);
+		for (uint32_t i = 0; i < options.mObjects; i++)
+		{
+			if (GpuCuller::isVisible(objects[i], frustum))
+			{
+				expected[objects[i].mCommand].push_back(i);
+			}
+		}
+
+		commandBuffer->setData(0, commandSize, records.data());
+		program->apply();
+		program->setUniform("planes", frustum.mPlanes.data(), static_cast<uint32_t>(frustum.mPlanes.size()));
+		program->setUniform("objectCount", static_cast<int>(options.mObjects));
+
+		StateCache::bindBufferRange(GL_SHADER_STORAGE_BUFFER, GpuCuller::kObjectBinding, objectBuffer->getID());
+		StateCache::bindBufferRange(GL_SHADER_STORAGE_BUFFER, GpuCuller::kInstanceBinding, instanceBuffer->getID());
+		StateCache::bindBufferRange(GL_SHADER_STORAGE_BUFFER, GpuCuller::kCommandBinding, commandBuffer->getID());
+		StateCache::bindBufferRange(GL_SHADER_STORAGE_BUFFER, GpuCuller::kBaseBinding, baseBuffer->getID());
+
+		GLuint groupCount = (options.mObjects + GpuCuller::kWorkGroupSize - 1) / GpuCuller::kWorkGroupSize;
+		GLES_CHECK_ERROR(glDispatchCompute(groupCount, 1, 1));
+		GLES_CHECK_ERROR(glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT));
+
+		std::vector<uint32_t> counts(options.mCommands, 0);
+		const DrawElementsIndirectCommand* written = static_cast<const DrawElementsIndirectCommand*>(commandBuffer->mapRange(GL_MAP_READ_BIT, 0, commandSize));
+		if (written == nullptr)
+		{
+			std::printf("failed to read back the commands\n");
+			return 1;
+		}
+		for (uint32_t i = 0; i < options.mCommands; i++)
+		{
+			counts[i] = written[i].mInstanceCount;
+			// the shader only counts instances, the rest of the record has to come through untouched
+			mismatches += written[i].mCount != records[i].mCount || written[i].mFirstIndex != 0 || written[i].mBaseVertex != 0 || written[i].mReserved != 0;
+		}
+		commandBuffer->unMap();
+
+		const InstanceData* instances = static_cast<const InstanceData*>(instanceBuffer->mapRange(GL_MAP_READ_BIT, 0, instanceSize));
+		if (instances == nullptr)
+		{
+			std::printf("failed to read back the instances\n");
+			return 1;
+		}
+		uint32_t visible = 0;
+		uint32_t expectedVisible = 0;
+		for (uint32_t i = 0; i < options.mCommands; i++)
+		{
+			visible += counts[i];
+			expectedVisible += static_cast<uint32_t>(expected[i].size());
+			if (counts[i] != expected[i].size())
+			{
+				mismatches++;
+				continue;
+			}
+
+			// the atomic counter hands out slots in any order, the set of objects and their data have to match
+			std::vector<uint32_t> found;
+			for (uint32_t slot = 0; slot < counts[i]; slot++)
+			{
+				const InstanceData& instance = instances[bases[i] + slot];
+				uint32_t index = static_cast<uint32_t>(instance.mParams[0].x);
+				if (index >= options.mObjects || objects[index].mCommand != i || instance.mModel != objects[index].mModel || instance.mParams[1] != objects[index].mParams[1])
+				{
+					mismatches++;
+					continue;
+				}
+				found.push_back(index);
+			}
+			std::sort(found.begin(), found.end());
+			mismatches += found != expected[i];
+		}
+		instanceBuffer->unMap();
+
+		std::printf("frame %2u: %6u visible on the gpu, %6u on the cpu\n", frame, visible, expectedVisible);
+	}
+
+	std::printf("%u objects in %u commands, %u mismatches on %s\n", options.mObjects, options.mCommands, mismatches, glGetString(GL_RENDERER));
+
+	program.reset();
+	objectBuffer.reset();
+	instanceBuffer.reset();
+	commandBuffer.reset();
+	baseBuffer.reset();
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+	return mismatches == 0 ? 0 : 1;
+}
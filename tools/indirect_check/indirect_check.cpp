@@ -0,0 +1,172 @@
+#include <indirectcommand.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+using namespace es;
+
+// checks the byte layout IndirectCommandBuilder packs for IndirectBuffer, runs without a window or gl context
+//
+//   indirect_check [--commands <n>]
+//
+// a fixed mix of indexed and non-indexed commands is compared field by field, then a random sequence of the given length
+// is packed and read back against the values it was built from
+
+struct Options
+{
+	uint32_t mCommands = 10000;
+};
+
+// what a command was built from, the reference the packed bytes are read back against
+struct Expected
+{
+	bool mIsIndexed;
+	uint32_t mCount;
+	uint32_t mInstanceCount;
+	uint32_t mFirst;
+	int32_t mBaseVertex;
+	uint32_t mBaseInstance;
+	std::size_t mOffset;
+};
+
+// glDrawArraysIndirect reads 4 and glDrawElementsIndirect 5 tightly packed 32-bit words
+static_assert(sizeof(DrawArraysIndirectCommand) == 16, "DrawArraysIndirectCommand must match the gl record");
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must match the gl record");
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--commands") == 0 && i + 1 < argc)
+		{
+			options.mCommands = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			std::printf("usage: indirect_check [--commands <n>]\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool check(bool condition, const char* what)
+{
+	std::printf("  %-52s %s\n", what, condition ? "ok" : "FAILED");
+	return condition;
+}
+
+static std::size_t add(IndirectCommandBuilder& builder, const Expected& expected)
+{
+	if (expected.mIsIndexed)
+	{
+		return builder.addElements(expected.mCount, expected.mInstanceCount, expected.mFirst, expected.mBaseVertex, expected.mBaseInstance);
+	}
+	return builder.addArrays(expected.mCount, expected.mInstanceCount, expected.mFirst, expected.mBaseInstance);
+}
+
+// reads the records back word by word the way the gpu does, every field and the reserved word are compared
+static bool verify(const IndirectCommandBuilder& builder, const std::vector<Expected>& expected)
+{
+	const std::vector<uint8_t>& data = builder.getData();
+	const std::vector<IndirectCommandInfo>& commands = builder.getCommands();
+	if (commands.size() != expected.size())
+	{
+		return false;
+	}
+
+	std::size_t end = 0;
+	for (std::size_t i = 0; i < expected.size(); i++)
+	{
+		const Expected& command = expected[i];
+		const IndirectCommandInfo& info = commands[i];
+		std::size_t size = command.mIsIndexed ? sizeof(DrawElementsIndirectCommand) : sizeof(DrawArraysIndirectCommand);
+		if (info.mOffset != command.mOffset || info.mOffset != end || info.mOffset % 4 != 0 ||
+			info.mIsIndexed != command.mIsIndexed || info.mBaseInstance != command.mBaseInstance || info.mOffset + size > data.size())
+		{
+			return false;
+		}
+
+		uint32_t words[5];
+		std::memcpy(words, data.data() + info.mOffset, size);
+		bool isMatch = words[0] == command.mCount && words[1] == command.mInstanceCount && words[2] == command.mFirst;
+		if (command.mIsIndexed)
+		{
+			int32_t baseVertex;
+			std::memcpy(&baseVertex, &words[3], sizeof(baseVertex));
+			isMatch = isMatch && baseVertex == command.mBaseVertex && words[4] == 0;
+		}
+		else
+		{
+			isMatch = isMatch && words[3] == 0;
+		}
+		if (!isMatch)
+		{
+			return false;
+		}
+		end = info.mOffset + size;
+	}
+	return end == data.size();
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		return 1;
+	}
+
+	bool isPassed = true;
+	IndirectCommandBuilder builder;
+
+	// offsets follow the record sizes, 20 bytes per indexed and 16 per non-indexed command
+	std::vector<Expected> mixed =
+	{
+		{ true, 36, 1, 0, 0, 0, 0 },
+		{ false, 3, 2, 5, 0, 7, 20 },
+		{ true, 6, 4, 12, -3, 9, 36 },
+		{ true, 96, 1, 36, 65536, 0, 56 },
+		{ false, 4, 1, 0, 0, 0xffffffffu, 76 },
+		{ false, 1, 0, 1024, 0, 1, 92 }
+	};
+	bool isOffsetReturned = true;
+	for (const Expected& command : mixed)
+	{
+		isOffsetReturned = isOffsetReturned && add(builder, command) == command.mOffset;
+	}
+	isPassed &= check(isOffsetReturned, "returned offsets of mixed commands");
+	isPassed &= check(builder.getData().size() == 108, "packed size of mixed commands");
+	isPassed &= check(verify(builder, mixed), "record fields, mOffset and reserved words");
+
+	builder.clear();
+	isPassed &= check(builder.getData().empty() && builder.getCommands().empty(), "clear drops data and commands");
+
+	// the base instance goes to the side table only, the record keeps the reserved word at 0 whatever it is
+	std::mt19937 random(options.mCommands);
+	std::uniform_int_distribution<uint32_t> word;
+	std::vector<Expected> sequence;
+	std::size_t offset = 0;
+	for (uint32_t i = 0; i < options.mCommands; i++)
+	{
+		Expected command;
+		command.mIsIndexed = (word(random) & 1) != 0;
+		command.mCount = word(random);
+		command.mInstanceCount = word(random);
+		command.mFirst = word(random);
+		command.mBaseVertex = command.mIsIndexed ? static_cast<int32_t>(word(random)) : 0;
+		command.mBaseInstance = word(random);
+		command.mOffset = offset;
+		offset += command.mIsIndexed ? sizeof(DrawElementsIndirectCommand) : sizeof(DrawArraysIndirectCommand);
+
+		isOffsetReturned = isOffsetReturned && add(builder, command) == command.mOffset;
+		sequence.push_back(command);
+	}
+	isPassed &= check(isOffsetReturned, "returned offsets of random commands");
+	isPassed &= check(verify(builder, sequence), "random commands read back");
+
+	std::printf(isPassed ? "indirect check passed\n" : "indirect check failed\n");
+	return isPassed ? 0 : 1;
+}
@@ -0,0 +1,384 @@
+#include <texturecompressor.h>
+#include <ktx.h>
+#include <mipmap.h>
+#include <threadpool.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+using namespace es;
+
+namespace fs = std::filesystem;
+
+// converts the png/jpg assets under resources/ into etc2/eac ktx files next to them, runs without a window or gl context
+//
+//   texture_encoder [--force] [--linear] [--bottom-up] [--no-mips] [--min-psnr <db>] [files or directories...]
+//   texture_encoder --selftest
+//
+// color maps become etc2 rgb or rgba, normal maps become eac rg11 unless their alpha carries data (parallax heights).
+// rows stay top down since materials load their textures unflipped, --bottom-up matches Texture2D::createFromFile's default
+
+struct Options
+{
+	bool mIsForce = false;
+	bool mIsLinear = false;
+	bool mIsBottomUp = false;
+	bool mIsMips = true;
+	double mMinPSNR = 0.0;
+	std::vector<std::string> mPaths;
+};
+
+struct EncodeResult
+{
+	GLenum mFormat = 0;
+	uint32_t mWidth = 0;
+	uint32_t mHeight = 0;
+	uint32_t mLevels = 0;
+	double mPSNR = 0.0;
+	uint64_t mUncompressedBytes = 0;
+	uint64_t mCompressedBytes = 0;
+};
+
+static const char* formatName(GLenum format)
+{
+	switch (format)
+	{
+		case GL_COMPRESSED_RGB8_ETC2: return "RGB8_ETC2";
+		case GL_COMPRESSED_SRGB8_ETC2: return "SRGB8_ETC2";
+		case GL_COMPRESSED_RGBA8_ETC2_EAC: return "RGBA8_ETC2_EAC";
+		case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC: return "SRGB8_ALPHA8_ETC2_EAC";
+		case GL_COMPRESSED_R11_EAC: return "R11_EAC";
+		case GL_COMPRESSED_RG11_EAC: return "RG11_EAC";
+		default: return "unknown";
+	}
+}
+
+static std::string toLower(std::string text)
+{
+	std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return text;
+}
+
+static bool isNormalMap(const fs::path& path)
+{
+	std::string name = toLower(path.stem().string());
+	return name.find("normal") != std::string::npos || name.find("_nrm") != std::string::npos ||
+		name.find("_ddn") != std::string::npos || (name.size() > 2 && name.compare(name.size() - 2, 2, "_n") == 0);
+}
+
+static bool hasAlpha(const uint8_t* rgba, uint32_t w, uint32_t h)
+{
+	for (std::size_t i = 0; i < static_cast<std::size_t>(w) * h; i++)
+	{
+		if (rgba[i * 4 + 3] != 255)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static void flipRows(std::vector<uint8_t>& rgba, uint32_t w, uint32_t h)
+{
+	std::size_t rowSize = static_cast<std::size_t>(w) * 4;
+	for (uint32_t y = 0; y < h / 2; y++)
+	{
+		std::swap_ranges(rgba.begin() + y * rowSize, rgba.begin() + (y + 1) * rowSize, rgba.begin() + (h - 1 - y) * rowSize);
+	}
+}
+
+static GLenum chooseFormat(bool isNormal, bool isAlpha, bool isLinear)
+{
+	if (isNormal)
+	{
+		return isAlpha ? GL_COMPRESSED_RGBA8_ETC2_EAC : GL_COMPRESSED_RG11_EAC;
+	}
+	if (isAlpha)
+	{
+		return isLinear ? GL_COMPRESSED_RGBA8_ETC2_EAC : GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;
+	}
+	return isLinear ? GL_COMPRESSED_RGB8_ETC2 : GL_COMPRESSED_SRGB8_ETC2;
+}
+
+// encodes every level of an rgba8 image, the psnr is measured on level 0
+static EncodeResult encodeImage(const std::vector<uint8_t>& rgba, uint32_t w, uint32_t h, uint32_t components, GLenum format, bool isMips, KTXImage& ktx)
+{
+	EncodeResult result;
+	result.mFormat = format;
+	result.mWidth = w;
+	result.mHeight = h;
+
+	bool isSRGB = format == GL_COMPRESSED_SRGB8_ETC2 || format == GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;
+	uint32_t levelCount = isMips ? MipGenerator::getFullChainLength(w, h) : 1;
+	std::vector<MipLevel> mips = MipGenerator::generate(rgba.data(), w, h, 4, false, isSRGB, levelCount, MipFilter::Box);
+
+	ktx.mInternalFormat = format;
+	ktx.mBaseInternalFormat = TextureCompressor::getBaseFormat(format);
+	ktx.mWidth = w;
+	ktx.mHeight = h;
+	ktx.mLevels.clear();
+
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		const uint8_t* pixels = level == 0 ? rgba.data() : mips[level - 1].mData.data();
+		uint32_t levelWidth = level == 0 ? w : mips[level - 1].mWidth;
+		uint32_t levelHeight = level == 0 ? h : mips[level - 1].mHeight;
+
+		MipLevel compressed;
+		compressed.mWidth = levelWidth;
+		compressed.mHeight = levelHeight;
+		compressed.mData = TextureCompressor::compress(pixels, levelWidth, levelHeight, format);
+
+		if (level == 0)
+		{
+			std::vector<uint8_t> decoded = TextureCompressor::decompress(compressed.mData.data(), w, h, format);
+			result.mPSNR = TextureCompressor::computePSNR(rgba.data(), decoded.data(), w, h, TextureCompressor::getChannelCount(format));
+		}
+
+		// what the uncompressed path would have allocated for this level
+		result.mUncompressedBytes += static_cast<uint64_t>(levelWidth) * levelHeight * components;
+		result.mCompressedBytes += compressed.mData.size();
+		ktx.mLevels.push_back(std::move(compressed));
+	}
+
+	result.mLevels = levelCount;
+	return result;
+}
+
+static bool encodeFile(const fs::path& path, const Options& options, EncodeResult& result)
+{
+	int w, h, components;
+	uint8_t* data = stbi_load(path.string().c_str(), &w, &h, &components, 4);
+	if (!data)
+	{
+		std::printf("  failed to decode %s\n", path.string().c_str());
+		return false;
+	}
+
+	std::vector<uint8_t> rgba(data, data + static_cast<std::size_t>(w) * h * 4);
+	stbi_image_free(data);
+
+	KTXImage ktx;
+	ktx.mIsBottomUp = options.mIsBottomUp;
+	if (ktx.mIsBottomUp)
+	{
+		flipRows(rgba, w, h);
+	}
+
+	bool isNormal = isNormalMap(path);
+	GLenum format = chooseFormat(isNormal, components == 4 && hasAlpha(rgba.data(), w, h), options.mIsLinear || isNormal);
+	result = encodeImage(rgba, w, h, components, format, options.mIsMips, ktx);
+
+	fs::path ktxPath = path;
+	ktxPath.replace_extension(".ktx");
+	if (!KTX::write(ktxPath.string(), ktx))
+	{
+		std::printf("  failed to write %s\n", ktxPath.string().c_str());
+		return false;
+	}
+	return true;
+}
+
+static void collectFiles(const fs::path& path, std::vector<fs::path>& files)
+{
+	auto isImage = [](const fs::path& file)
+	{
+		std::string extension = toLower(file.extension().string());
+		return extension == ".png" || extension == ".jpg" || extension == ".jpeg";
+	};
+
+	if (fs::is_directory(path))
+	{
+		for (const fs::directory_entry& entry : fs::recursive_directory_iterator(path))
+		{
+			if (entry.is_regular_file() && isImage(entry.path()))
+			{
+				files.push_back(entry.path());
+			}
+		}
+	}
+	else if (fs::is_regular_file(path) && isImage(path))
+	{
+		files.push_back(path);
+	}
+}
+
+static int runEncoder(const Options& options)
+{
+	std::vector<fs::path> files;
+	for (const std::string& path : options.mPaths)
+	{
+		collectFiles(path, files);
+	}
+	std::sort(files.begin(), files.end());
+
+	std::printf("%-60s %11s %-22s %6s %8s %12s %12s %6s\n", "file", "size", "format", "levels", "psnr", "raw bytes", "ktx bytes", "ratio");
+
+	uint64_t totalUncompressed = 0;
+	uint64_t totalCompressed = 0;
+	uint32_t encodedCount = 0;
+	uint32_t failedCount = 0;
+	uint32_t lowQualityCount = 0;
+
+	for (const fs::path& file : files)
+	{
+		fs::path ktxPath = file;
+		ktxPath.replace_extension(".ktx");
+		if (!options.mIsForce && fs::exists(ktxPath) && fs::last_write_time(ktxPath) >= fs::last_write_time(file))
+		{
+			continue;
+		}
+
+		EncodeResult result;
+		if (!encodeFile(file, options, result))
+		{
+			failedCount++;
+			continue;
+		}
+
+		std::string size = std::to_string(result.mWidth) + "x" + std::to_string(result.mHeight);
+		std::printf("%-60s %11s %-22s %6u %8.2f %12llu %12llu %5.1fx\n", file.string().c_str(), size.c_str(), formatName(result.mFormat), result.mLevels,
+			result.mPSNR, (unsigned long long)result.mUncompressedBytes, (unsigned long long)result.mCompressedBytes,
+			static_cast<double>(result.mUncompressedBytes) / result.mCompressedBytes);
+
+		totalUncompressed += result.mUncompressedBytes;
+		totalCompressed += result.mCompressedBytes;
+		encodedCount++;
+		if (result.mPSNR < options.mMinPSNR)
+		{
+			lowQualityCount++;
+		}
+	}
+
+	std::printf("\nvram : %u textures, %.2f MB uncompressed -> %.2f MB compressed, %.2f MB saved\n", encodedCount,
+		totalUncompressed / (1024.0 * 1024.0), totalCompressed / (1024.0 * 1024.0), (totalUncompressed - totalCompressed) / (1024.0 * 1024.0));
+
+	if (lowQualityCount > 0)
+	{
+		std::printf("%u textures below %.2f dB\n", lowQualityCount, options.mMinPSNR);
+	}
+	return (failedCount > 0 || lowQualityCount > 0) ? 1 : 0;
+}
+
+// ----------------------------------------------------------------------------------------------------------------------------------------
+
+static bool check(bool condition, const char* what)
+{
+	std::printf("  %-52s %s\n", what, condition ? "ok" : "FAILED");
+	return condition;
+}
+
+// encodes synthetic images with known content, decodes them again and round trips a ktx file
+static int runSelfTest()
+{
+	const uint32_t w = 70;
+	const uint32_t h = 38;
+	std::vector<uint8_t> gradient(w * h * 4);
+	std::vector<uint8_t> normals(w * h * 4);
+	for (uint32_t y = 0; y < h; y++)
+	{
+		for (uint32_t x = 0; x < w; x++)
+		{
+			uint8_t* texel = &gradient[(y * w + x) * 4];
+			texel[0] = static_cast<uint8_t>(x * 255 / (w - 1));
+			texel[1] = static_cast<uint8_t>(y * 255 / (h - 1));
+			texel[2] = static_cast<uint8_t>(128 + 100 * std::sin(x * 0.2f));
+			texel[3] = ((x / 8 + y / 8) % 2) ? 255 : 40;
+
+			// hemisphere bump
+			float nx = std::sin(x * 0.15f) * 0.5f;
+			float ny = std::cos(y * 0.2f) * 0.5f;
+			float nz = std::sqrt(std::max(0.0f, 1.0f - nx * nx - ny * ny));
+			uint8_t* normal = &normals[(y * w + x) * 4];
+			normal[0] = static_cast<uint8_t>((nx * 0.5f + 0.5f) * 255.0f + 0.5f);
+			normal[1] = static_cast<uint8_t>((ny * 0.5f + 0.5f) * 255.0f + 0.5f);
+			normal[2] = static_cast<uint8_t>((nz * 0.5f + 0.5f) * 255.0f + 0.5f);
+			normal[3] = 255;
+		}
+	}
+
+	struct Case
+	{
+		const std::vector<uint8_t>* mImage;
+		GLenum mFormat;
+		double mMinPSNR;
+	};
+	const Case cases[] =
+	{
+		{ &gradient, GL_COMPRESSED_RGB8_ETC2, 32.0 },
+		{ &gradient, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 32.0 },
+		{ &normals, GL_COMPRESSED_RG11_EAC, 45.0 },
+		{ &normals, GL_COMPRESSED_R11_EAC, 45.0 }
+	};
+
+	bool isPassed = true;
+	for (const Case& test : cases)
+	{
+		KTXImage ktx;
+		EncodeResult result = encodeImage(*test.mImage, w, h, 4, test.mFormat, true, ktx);
+		std::printf("%s : %.2f dB, %llu -> %llu bytes\n", formatName(test.mFormat), result.mPSNR,
+			(unsigned long long)result.mUncompressedBytes, (unsigned long long)result.mCompressedBytes);
+
+		isPassed &= check(result.mPSNR >= test.mMinPSNR, "psnr above threshold");
+		isPassed &= check(result.mLevels == MipGenerator::getFullChainLength(w, h) && ktx.mLevels.back().mWidth == 1 && ktx.mLevels.back().mHeight == 1, "full mip chain down to 1x1");
+		isPassed &= check(ktx.mLevels[0].mData.size() == TextureCompressor::getCompressedSize(test.mFormat, w, h), "level 0 size matches the block count");
+
+		fs::path ktxPath = fs::temp_directory_path() / "texture_encoder_selftest.ktx";
+		KTXImage loaded;
+		bool isRoundTrip = KTX::write(ktxPath.string(), ktx) && KTX::read(ktxPath.string(), loaded) &&
+			loaded.mInternalFormat == ktx.mInternalFormat && loaded.mWidth == w && loaded.mHeight == h &&
+			loaded.mIsBottomUp == ktx.mIsBottomUp && loaded.mLevels.size() == ktx.mLevels.size();
+		for (std::size_t i = 0; isRoundTrip && i < ktx.mLevels.size(); i++)
+		{
+			isRoundTrip = loaded.mLevels[i].mData == ktx.mLevels[i].mData;
+		}
+		fs::remove(ktxPath);
+		isPassed &= check(isRoundTrip, "ktx write and read back");
+	}
+
+	std::printf(isPassed ? "selftest passed\n" : "selftest failed\n");
+	return isPassed ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	bool isSelfTest = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--selftest")
+			isSelfTest = true;
+		else if (argument == "--force")
+			options.mIsForce = true;
+		else if (argument == "--linear")
+			options.mIsLinear = true;
+		else if (argument == "--bottom-up")
+			options.mIsBottomUp = true;
+		else if (argument == "--no-mips")
+			options.mIsMips = false;
+		else if (argument == "--min-psnr" && i + 1 < argc)
+			options.mMinPSNR = std::atof(argv[++i]);
+		else
+			options.mPaths.push_back(argument);
+	}
+
+	if (isSelfTest)
+	{
+		return runSelfTest();
+	}
+
+	if (options.mPaths.empty())
+	{
+		options.mPaths.push_back(ES_EXAMPLE_RESOURCES_DIR);
+	}
+	return runEncoder(options);
+}